@@ -792,7 +792,15 @@ static ALandscape* CreateLandscape(
 						const int32 MaxX = FMath::Min( NumVerticesForRadius - 1, FMath::CeilToInt(Max.X));
 						const int32 MaxY = FMath::Min( NumVerticesForRadius - 1, FMath::CeilToInt(Max.Y));
 
-						const FPolygon2DView Polygon2DView(Polygon->Points);
+						const FPolygon2DView Polygon2DView(Polygon->GetPoints(*StreetMap));
+						const TArrayView<const FStreetMapPolygonRing> Holes = Polygon->GetHoles(*StreetMap);
+						TArray<FPolygon2DView> HoleViews;
+						HoleViews.Reserve(Holes.Num());
+						for (const FStreetMapPolygonRing& Hole : Holes)
+						{
+							HoleViews.Emplace(Hole.GetPoints(*StreetMap));
+						}
+
 						for (int32 Y = MinY; Y <= MaxY; Y++)
 						{
 							for (int32 X = MinX; X <= MaxX; X++)
@@ -802,6 +810,15 @@ static ALandscape* CreateLandscape(
 
 								bool IsInside;
 								float SquareDistance = Polygon2DView.ComputeSquareDistance(VertexLocation, IsInside);
+
+								// holes are outside of the polygon, and blend towards their edges just like the outer edge
+								for (const FPolygon2DView& HoleView : HoleViews)
+								{
+									bool IsInsideHole;
+									SquareDistance = FMath::Min(SquareDistance, HoleView.ComputeSquareDistance(VertexLocation, IsInsideHole));
+									IsInside = IsInside && !IsInsideHole;
+								}
+
 								if (IsInside || SquareDistance < HalfBlendGaugeSqr)
 								{
 									// use distance to polygon to enable smooth blend weights
@@ -1,10 +1,11 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "StreetMap.h"
 
 /**
 * Creates some additional information based on the given points that form a closed polygon.
-* It relies on the existence of the given vertices even after its creation.
+* It keeps its own copy of the vertices, decoded from however the street map stores them.
 */
 struct FPolygon2DView
 {
@@ -19,14 +20,14 @@ private:
 		float	  Extent;
 	};
 
-	const TArray<FVector2D>&		Vertices;
+	TArray<FVector2D>				Vertices;
 	TArray<FEdge>					Edges;
 
 public:
 
-	FPolygon2DView(const TArray<FVector2D>& Vertices)
-		: Vertices(Vertices)
+	FPolygon2DView(const FStreetMapPointView& Points)
 	{
+		Points.CopyTo(Vertices);
 		Edges.SetNumUninitialized(Vertices.Num());
 
 		const uint32 NumVertices = GetNumVertices();
@@ -29,9 +29,15 @@ static double ConvertEPSG4326LatitudeToMeters(const double Latitude)
 
 FVector2D FSpatialReferenceSystem::FromEPSG4326(const double Longitude, const double Latitude) const
 {
-	return FVector2D(
-		(float)(ConvertEPSG4326LongitudeToMeters(Longitude, Latitude) - ConvertEPSG4326LongitudeToMeters(OriginLongitude, Latitude)),
-		(float)(ConvertEPSG4326LatitudeToMeters(Latitude) - ConvertEPSG4326LatitudeToMeters(OriginLatitude)));
+	double X, Y;
+	FromEPSG4326(Longitude, Latitude, X, Y);
+	return FVector2D((float)X, (float)Y);
+};
+
+void FSpatialReferenceSystem::FromEPSG4326(const double Longitude, const double Latitude, double& OutX, double& OutY) const
+{
+	OutX = ConvertEPSG4326LongitudeToMeters(Longitude, Latitude) - ConvertEPSG4326LongitudeToMeters(OriginLongitude, Latitude);
+	OutY = ConvertEPSG4326LatitudeToMeters(Latitude) - ConvertEPSG4326LatitudeToMeters(OriginLatitude);
 };
 
 void FSpatialReferenceSystem::ToEPSG4326(const FVector2D& Location, double& OutLongitude, double& OutLatitude) const
@@ -19,6 +19,9 @@ public:
 	 */
 	FVector2D FromEPSG4326(const double Longitude, const double Latitude) const;
 
+	/** Same as above, without rounding the result to single precision */
+	void FromEPSG4326(const double Longitude, const double Latitude, double& OutX, double& OutY) const;
+
 	/** Converts local coordinates (meters) to WGS84 latitude and longitude (degrees). 
 	 * (see http://spatialreference.org/ref/epsg/4326/)
 	 */
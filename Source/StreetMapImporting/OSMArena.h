@@ -0,0 +1,82 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+
+/**
+ * Bump allocator for the objects an OSM file is parsed into.  Elements are constructed in large blocks and are never
+ * freed individually; everything is destroyed at once when the arena is emptied.  Pointers to elements stay valid
+ * for the lifetime of the arena, so elements may freely point at each other.
+ */
+template<typename ElementType, int32 NumElementsPerBlock = 4096>
+class TOSMArena
+{
+
+public:
+
+	TOSMArena()
+		: NumInLastBlock( NumElementsPerBlock )
+		, NumElements( 0 )
+	{
+	}
+
+	~TOSMArena()
+	{
+		Empty();
+	}
+
+	TOSMArena( const TOSMArena& ) = delete;
+	TOSMArena& operator=( const TOSMArena& ) = delete;
+
+	/** Constructs a new element in the arena */
+	template<typename... ArgsType>
+	ElementType* New( ArgsType&&... Args )
+	{
+		if( NumInLastBlock == NumElementsPerBlock )
+		{
+			Blocks.Add( (ElementType*)FMemory::Malloc( sizeof( ElementType ) * NumElementsPerBlock, alignof( ElementType ) ) );
+			NumInLastBlock = 0;
+		}
+
+		ElementType* Element = Blocks.Last() + NumInLastBlock++;
+		++NumElements;
+		return new( Element ) ElementType( Forward<ArgsType>( Args )... );
+	}
+
+	/** Destroys all elements and frees the memory */
+	void Empty()
+	{
+		for( int32 BlockIndex = 0; BlockIndex < Blocks.Num(); ++BlockIndex )
+		{
+			ElementType* Block = Blocks[ BlockIndex ];
+			const int32 NumInBlock = ( BlockIndex == Blocks.Num() - 1 ) ? NumInLastBlock : NumElementsPerBlock;
+			DestructItems( Block, NumInBlock );
+			FMemory::Free( Block );
+		}
+		Blocks.Empty();
+		NumInLastBlock = NumElementsPerBlock;
+		NumElements = 0;
+	}
+
+	/** @return The number of elements in the arena */
+	int64 Num() const
+	{
+		return NumElements;
+	}
+
+	/** @return The number of bytes allocated by the arena itself, not counting memory owned by the elements */
+	SIZE_T GetAllocatedSize() const
+	{
+		return (SIZE_T)Blocks.Num() * NumElementsPerBlock * sizeof( ElementType ) + Blocks.GetAllocatedSize();
+	}
+
+private:
+
+	/** Blocks of NumElementsPerBlock elements each.  Only the last one may be partially used. */
+	TArray<ElementType*> Blocks;
+
+	/** Number of elements constructed in the last block */
+	int32 NumInLastBlock;
+
+	/** Total number of elements */
+	int64 NumElements;
+};
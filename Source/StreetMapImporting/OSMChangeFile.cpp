@@ -0,0 +1,241 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapImporting.h"
+#include "OSMChangeFile.h"
+#include "OSMKeywords.h"
+
+
+FOSMChangeFile::FOSMChangeFile()
+	: NumRelationChanges( 0 )
+	, ParsingState( ParsingState::Root )
+	, CurrentAction( EOSMChangeAction::Modify )
+	, CurrentID( 0 )
+{
+}
+
+
+FOSMChangeFile::~FOSMChangeFile()
+{
+}
+
+
+bool FOSMChangeFile::LoadOpenStreetMapChangeFile( const FString& OSCFilePath, FFeedbackContext* FeedbackContext )
+{
+	// Change files are small compared to the maps they apply to, so we simply read them into memory
+	TArray<uint8> FileData;
+	if( !FFileHelper::LoadFileToArray( FileData, *OSCFilePath ) )
+	{
+		if( FeedbackContext != nullptr )
+		{
+			FeedbackContext->Logf( ELogVerbosity::Error, TEXT( "Failed to open OpenStreetMap change file '%s'" ), *OSCFilePath );
+		}
+		return false;
+	}
+
+	FText ErrorMessage;
+	int32 ErrorLineNumber;
+	FOSMXmlScanner Scanner( (const ANSICHAR*)FileData.GetData(), FileData.Num() );
+	if( !Scanner.Parse( *this, []( const int64 BytesParsed ) { return true; }, /* Out */ ErrorMessage, /* Out */ ErrorLineNumber ) )
+	{
+		if( FeedbackContext != nullptr )
+		{
+			FeedbackContext->Logf(
+				ELogVerbosity::Error,
+				TEXT( "Failed to load OpenStreetMap change file '%s' ('%s', Line %i)" ),
+				*OSCFilePath,
+				*ErrorMessage.ToString(),
+				ErrorLineNumber );
+		}
+		return false;
+	}
+
+	return true;
+}
+
+
+bool FOSMChangeFile::ProcessElement( const FOSMStringView& ElementName )
+{
+	const EOSMKeyword Element = FindOSMKeyword( ElementName );
+
+	if( ParsingState == ParsingState::Root )
+	{
+		// Everything else at this level is the <osmChange> root element itself
+		if( Element == EOSMKeyword::Create )
+		{
+			ParsingState = ParsingState::Action;
+			CurrentAction = EOSMChangeAction::Create;
+		}
+		else if( Element == EOSMKeyword::Modify )
+		{
+			ParsingState = ParsingState::Action;
+			CurrentAction = EOSMChangeAction::Modify;
+		}
+		else if( Element == EOSMKeyword::Delete )
+		{
+			ParsingState = ParsingState::Action;
+			CurrentAction = EOSMChangeAction::Delete;
+		}
+	}
+	else if( ParsingState == ParsingState::Action )
+	{
+		if( Element == EOSMKeyword::Node )
+		{
+			ParsingState = ParsingState::Node;
+			CurrentID = 0;
+			CurrentNodeChange.Action = CurrentAction;
+			CurrentNodeChange.Latitude = 0;
+			CurrentNodeChange.Longitude = 0;
+			CurrentNodeChange.Tags.Reset();
+		}
+		else if( Element == EOSMKeyword::Way )
+		{
+			ParsingState = ParsingState::Way;
+			CurrentID = 0;
+			CurrentWayChange.Action = CurrentAction;
+			CurrentWayChange.WayInfo = FOSMFile::FOSMWayInfo();
+			CurrentWayChange.WayInfo.WayType = FOSMFile::EOSMWayType::Other;
+			CurrentWayChange.WayInfo.Height = 0.0;
+			CurrentWayChange.WayInfo.BuildingLevels = 0;
+			CurrentWayChange.WayInfo.bIsOneWay = false;
+			CurrentWayChange.NodeRefs.Reset();
+		}
+		else if( Element == EOSMKeyword::Relation )
+		{
+			ParsingState = ParsingState::Relation;
+		}
+	}
+	else if( ParsingState == ParsingState::Node )
+	{
+		if( Element == EOSMKeyword::Tag )
+		{
+			ParsingState = ParsingState::Node_Tag;
+		}
+	}
+	else if( ParsingState == ParsingState::Way )
+	{
+		if( Element == EOSMKeyword::Nd )
+		{
+			ParsingState = ParsingState::Way_NodeRef;
+		}
+		else if( Element == EOSMKeyword::Tag )
+		{
+			ParsingState = ParsingState::Way_Tag;
+		}
+	}
+	else if( ParsingState == ParsingState::Relation )
+	{
+		ParsingState = ParsingState::Relation_Child;
+	}
+
+	return true;
+}
+
+
+bool FOSMChangeFile::ProcessAttribute( const FOSMStringView& AttributeName, const FOSMStringView& AttributeValue )
+{
+	const EOSMKeyword Attribute = FindOSMKeyword( AttributeName );
+
+	if( ParsingState == ParsingState::Node )
+	{
+		if( Attribute == EOSMKeyword::Id )
+		{
+			CurrentID = AttributeValue.ToInt64();
+		}
+		else if( Attribute == EOSMKeyword::Lat )
+		{
+			CurrentNodeChange.Latitude = AttributeValue.ToCoordinate();
+		}
+		else if( Attribute == EOSMKeyword::Lon )
+		{
+			CurrentNodeChange.Longitude = AttributeValue.ToCoordinate();
+		}
+	}
+	else if( ParsingState == ParsingState::Node_Tag )
+	{
+		if( Attribute == EOSMKeyword::K )
+		{
+			CurrentTagKey = AttributeValue;
+		}
+		else if( Attribute == EOSMKeyword::V )
+		{
+			FOSMFile::FOSMTag Tag;
+			Tag.Key = CurrentTagKey.ToName();
+			Tag.Value = AttributeValue.ToName();
+			CurrentNodeChange.Tags.Add( Tag );
+		}
+	}
+	else if( ParsingState == ParsingState::Way )
+	{
+		if( Attribute == EOSMKeyword::Id )
+		{
+			CurrentID = AttributeValue.ToInt64();
+		}
+	}
+	else if( ParsingState == ParsingState::Way_NodeRef )
+	{
+		if( Attribute == EOSMKeyword::Ref )
+		{
+			CurrentWayChange.NodeRefs.Add( AttributeValue.ToInt64() );
+		}
+	}
+	else if( ParsingState == ParsingState::Way_Tag )
+	{
+		if( Attribute == EOSMKeyword::K )
+		{
+			CurrentTagKey = AttributeValue;
+		}
+		else if( Attribute == EOSMKeyword::V )
+		{
+			FOSMFile::ApplyWayTag( CurrentWayChange.WayInfo, CurrentTagKey, AttributeValue );
+		}
+	}
+
+	return true;
+}
+
+
+bool FOSMChangeFile::ProcessClose( const FOSMStringView& ElementName )
+{
+	if( ParsingState == ParsingState::Action )
+	{
+		ParsingState = ParsingState::Root;
+	}
+	else if( ParsingState == ParsingState::Node )
+	{
+		// Changes are listed in the order they happened, so a later change of the same node replaces an earlier one
+		NodeChanges.Add( CurrentID, CurrentNodeChange );
+		ParsingState = ParsingState::Action;
+	}
+	else if( ParsingState == ParsingState::Node_Tag )
+	{
+		CurrentTagKey = FOSMStringView();
+		ParsingState = ParsingState::Node;
+	}
+	else if( ParsingState == ParsingState::Way )
+	{
+		CurrentWayChange.WayInfo.Id = CurrentID;
+		WayChanges.Add( CurrentID, CurrentWayChange );
+		ParsingState = ParsingState::Action;
+	}
+	else if( ParsingState == ParsingState::Way_NodeRef )
+	{
+		ParsingState = ParsingState::Way;
+	}
+	else if( ParsingState == ParsingState::Way_Tag )
+	{
+		CurrentTagKey = FOSMStringView();
+		ParsingState = ParsingState::Way;
+	}
+	else if( ParsingState == ParsingState::Relation )
+	{
+		++NumRelationChanges;
+		ParsingState = ParsingState::Action;
+	}
+	else if( ParsingState == ParsingState::Relation_Child )
+	{
+		ParsingState = ParsingState::Relation;
+	}
+
+	return true;
+}
+
@@ -0,0 +1,104 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+#include "OSMFile.h"
+
+
+/**
+ * OpenStreetMap change file (.osc) loader.  Change files list the nodes, ways and relations that were created,
+ * modified or deleted since some point in time, always with their complete new state.  Only the changes themselves
+ * are kept, so loading one costs as much as the size of the change, not the size of the map it applies to.
+ */
+class FOSMChangeFile : public IOSMXmlCallback
+{
+
+public:
+
+	/** Default constructor for FOSMChangeFile */
+	FOSMChangeFile();
+
+	/** Destructor for FOSMChangeFile */
+	virtual ~FOSMChangeFile();
+
+	/** Loads an OpenStreetMap change file in osmChange XML format */
+	bool LoadOpenStreetMapChangeFile( const FString& OSCFilePath, class FFeedbackContext* FeedbackContext );
+
+	/** What happened to an element */
+	enum class EOSMChangeAction : uint8
+	{
+		Create,
+		Modify,
+		Delete,
+	};
+
+	struct FOSMNodeChange
+	{
+		EOSMChangeAction Action;
+
+		/** New location, fixed point like in FOSMFile.  Not set for deleted nodes. */
+		int32 Latitude;
+		int32 Longitude;
+
+		TArray<FOSMFile::FOSMTag> Tags;
+	};
+
+	struct FOSMWayChange
+	{
+		EOSMChangeAction Action;
+
+		/** New state of the way.  Its Nodes are left empty, since the nodes are not in a node table. */
+		FOSMFile::FOSMWayInfo WayInfo;
+
+		/** IDs of the way's nodes, in order */
+		TArray<int64> NodeRefs;
+	};
+
+	/** Changed nodes by ID.  If a node changed more than once, the last change in the file wins. */
+	TMap<int64, FOSMNodeChange> NodeChanges;
+
+	/** Changed ways by ID.  If a way changed more than once, the last change in the file wins. */
+	TMap<int64, FOSMWayChange> WayChanges;
+
+	/** Number of relations that changed.  We don't apply these, but let the user know about them. */
+	int32 NumRelationChanges;
+
+protected:
+
+	// IOSMXmlCallback overrides
+	virtual bool ProcessElement( const FOSMStringView& ElementName ) override;
+	virtual bool ProcessAttribute( const FOSMStringView& AttributeName, const FOSMStringView& AttributeValue ) override;
+	virtual bool ProcessClose( const FOSMStringView& ElementName ) override;
+
+protected:
+
+	enum class ParsingState
+	{
+		Root,
+		Action,
+		Node,
+		Node_Tag,
+		Way,
+		Way_NodeRef,
+		Way_Tag,
+		Relation,
+		Relation_Child,
+	};
+
+	// Current state of parser
+	ParsingState ParsingState;
+
+	// Action block we're in
+	EOSMChangeAction CurrentAction;
+
+	// ID of the node or way that is currently being parsed
+	int64 CurrentID;
+
+	// Node that is currently being parsed
+	FOSMNodeChange CurrentNodeChange;
+
+	// Way that is currently being parsed
+	FOSMWayChange CurrentWayChange;
+
+	// Current tag key string
+	FOSMStringView CurrentTagKey;
+};
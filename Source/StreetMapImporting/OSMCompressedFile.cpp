@@ -0,0 +1,359 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapImporting.h"
+#include "OSMFile.h"
+#include "OSMDecompressor.h"
+#include "StreetMapImportProfile.h"
+#include "StreetMapImportProgress.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "Async/Async.h"
+
+#define LOCTEXT_NAMESPACE "StreetMapImporting"
+
+// Compressed XML files are decompressed on a thread of their own, which hands the data to the parser through a small
+// ring buffer.  Decompressing and parsing overlap, and the decompressed file is never written anywhere or held in
+// memory as a whole.  FOSMXmlScanner::ParseStream copies the data into windows that the scanner can parse on their own.
+
+/** Size of the ring buffer between the decompression thread and the parser */
+static const int32 DecompressionRingBufferSize = 8 * 1024 * 1024;
+
+/** How much data the decompression thread produces at once */
+static const int32 DecompressionBlockSize = 256 * 1024;
+
+
+/** Bounded byte queue between one writer thread and one reader thread.  Either side blocks while it can't make progress. */
+class FOSMStreamRingBuffer
+{
+
+public:
+
+	FOSMStreamRingBuffer( const int32 Capacity )
+		: ReadPosition( 0 )
+		, WritePosition( 0 )
+		, bWriterClosed( false )
+		, bReaderClosed( false )
+		, DataAvailableEvent( FPlatformProcess::GetSynchEventFromPool( false ) )
+		, SpaceAvailableEvent( FPlatformProcess::GetSynchEventFromPool( false ) )
+	{
+		Buffer.SetNumUninitialized( Capacity );
+	}
+
+	~FOSMStreamRingBuffer()
+	{
+		FPlatformProcess::ReturnSynchEventToPool( DataAvailableEvent );
+		FPlatformProcess::ReturnSynchEventToPool( SpaceAvailableEvent );
+	}
+
+	/** Writes all of the data, waiting for the reader to make room as needed.  Returns false if the reader went away. */
+	bool Write( const uint8* Data, int32 Size )
+	{
+		while( Size > 0 )
+		{
+			int32 ChunkSize = 0;
+			int64 ChunkPosition = 0;
+			{
+				FScopeLock Lock( &CriticalSection );
+				if( bReaderClosed )
+				{
+					return false;
+				}
+				ChunkPosition = WritePosition;
+				ChunkSize = (int32)FMath::Min<int64>( Size, Buffer.Num() - ( WritePosition - ReadPosition ) );
+			}
+
+			if( ChunkSize == 0 )
+			{
+				SpaceAvailableEvent->Wait();
+				continue;
+			}
+
+			// Only the writer touches the free part of the buffer, so the copy doesn't need the lock
+			CopyIn( ChunkPosition, Data, ChunkSize );
+			Data += ChunkSize;
+			Size -= ChunkSize;
+
+			{
+				FScopeLock Lock( &CriticalSection );
+				WritePosition += ChunkSize;
+			}
+			DataAvailableEvent->Trigger();
+		}
+		return true;
+	}
+
+	/** Marks the end of the data */
+	void CloseWriter()
+	{
+		{
+			FScopeLock Lock( &CriticalSection );
+			bWriterClosed = true;
+		}
+		DataAvailableEvent->Trigger();
+	}
+
+	/** Reads whatever data is available, waiting for at least one byte.  @return Number of bytes read, zero at the end of the data. */
+	int32 Read( uint8* Dest, const int32 DestSize )
+	{
+		for( ;; )
+		{
+			int32 ChunkSize = 0;
+			int64 ChunkPosition = 0;
+			{
+				FScopeLock Lock( &CriticalSection );
+				ChunkPosition = ReadPosition;
+				ChunkSize = (int32)FMath::Min<int64>( DestSize, WritePosition - ReadPosition );
+				if( ChunkSize == 0 && bWriterClosed )
+				{
+					return 0;
+				}
+			}
+
+			if( ChunkSize == 0 )
+			{
+				DataAvailableEvent->Wait();
+				continue;
+			}
+
+			CopyOut( ChunkPosition, Dest, ChunkSize );
+
+			{
+				FScopeLock Lock( &CriticalSection );
+				ReadPosition += ChunkSize;
+			}
+			SpaceAvailableEvent->Trigger();
+			return ChunkSize;
+		}
+	}
+
+	/** Tells the writer that nobody is going to read the rest of the data */
+	void CloseReader()
+	{
+		{
+			FScopeLock Lock( &CriticalSection );
+			bReaderClosed = true;
+		}
+		SpaceAvailableEvent->Trigger();
+	}
+
+private:
+
+	void CopyIn( const int64 Position, const uint8* Data, const int32 Size )
+	{
+		const int32 Offset = (int32)( Position % Buffer.Num() );
+		const int32 FirstPartSize = FMath::Min( Size, Buffer.Num() - Offset );
+		FMemory::Memcpy( Buffer.GetData() + Offset, Data, FirstPartSize );
+		FMemory::Memcpy( Buffer.GetData(), Data + FirstPartSize, Size - FirstPartSize );
+	}
+
+	void CopyOut( const int64 Position, uint8* Dest, const int32 Size ) const
+	{
+		const int32 Offset = (int32)( Position % Buffer.Num() );
+		const int32 FirstPartSize = FMath::Min( Size, Buffer.Num() - Offset );
+		FMemory::Memcpy( Dest, Buffer.GetData() + Offset, FirstPartSize );
+		FMemory::Memcpy( Dest + FirstPartSize, Buffer.GetData(), Size - FirstPartSize );
+	}
+
+	TArray<uint8> Buffer;
+
+	/** Total number of bytes read and written so far.  The data in between is in the buffer. */
+	int64 ReadPosition;
+	int64 WritePosition;
+
+	bool bWriterClosed;
+	bool bReaderClosed;
+
+	FCriticalSection CriticalSection;
+	FEvent* DataAvailableEvent;
+	FEvent* SpaceAvailableEvent;
+};
+
+
+/** Decompresses a file on a thread of its own, and lets the calling thread read the decompressed data as it comes */
+class FOSMDecompressionStream
+{
+
+public:
+
+	FOSMDecompressionStream()
+		: RingBuffer( DecompressionRingBufferSize )
+	{
+	}
+
+	~FOSMDecompressionStream()
+	{
+		// Stop the decompression thread if we didn't read everything
+		RingBuffer.CloseReader();
+		if( DecompressionTask.IsValid() )
+		{
+			DecompressionTask.Wait();
+		}
+	}
+
+	/** Opens the file and starts decompressing it */
+	bool Open( const FString& FilePath, FString& OutError )
+	{
+		Reader.Reset( IFileManager::Get().CreateFileReader( *FilePath ) );
+		if( !Reader.IsValid() )
+		{
+			OutError = TEXT( "Failed to open the file" );
+			return false;
+		}
+
+		uint8 Header[ 4 ] = { 0 };
+		const int32 HeaderSize = (int32)FMath::Min<int64>( ARRAY_COUNT( Header ), Reader->TotalSize() );
+		Reader->Serialize( Header, HeaderSize );
+		Reader->Seek( 0 );
+
+		Decompressor = IOSMDecompressor::Create( IOSMDecompressor::DetectFormat( Header, HeaderSize ), *Reader );
+		if( !Decompressor.IsValid() )
+		{
+			OutError = TEXT( "The file is neither gzip nor bzip2 compressed" );
+			return false;
+		}
+
+		DecompressionTask = Async<void>( EAsyncExecution::Thread, [this]()
+		{
+			TArray<uint8> Block;
+			Block.SetNumUninitialized( DecompressionBlockSize );
+			for( ;; )
+			{
+				const int32 BlockSize = Decompressor->Decompress( Block.GetData(), Block.Num() );
+				CompressedBytesRead.Set( Reader->Tell() );
+				if( BlockSize < 0 )
+				{
+					Error = Decompressor->GetError();
+					break;
+				}
+				if( BlockSize == 0 || !RingBuffer.Write( Block.GetData(), BlockSize ) )
+				{
+					break;
+				}
+			}
+			RingBuffer.CloseWriter();
+		} );
+
+		return true;
+	}
+
+	/** Reads the next decompressed bytes, waiting for the decompression thread if necessary.  @return Number of bytes read, zero at the end of the file or on failure. */
+	int32 Read( uint8* Dest, const int32 DestSize )
+	{
+		return RingBuffer.Read( Dest, DestSize );
+	}
+
+	/** @return Why decompression failed, once Read returned zero */
+	const FString& GetError() const
+	{
+		return Error;
+	}
+
+	/** @return How far the decompression thread got into the file */
+	int64 GetCompressedBytesRead() const
+	{
+		return CompressedBytesRead.GetValue();
+	}
+
+private:
+
+	TUniquePtr<FArchive> Reader;
+	TUniquePtr<IOSMDecompressor> Decompressor;
+	FOSMStreamRingBuffer RingBuffer;
+	TFuture<void> DecompressionTask;
+	FThreadSafeCounter64 CompressedBytesRead;
+
+	/** Set by the decompression thread before it closes the ring buffer */
+	FString Error;
+};
+
+
+bool FOSMFile::LoadOpenStreetMapCompressedFile( const FString& OSMFilePath, FFeedbackContext* FeedbackContext )
+{
+	const int64 FileSize = IFileManager::Get().FileSize( *OSMFilePath );
+	if( FileSize < 0 )
+	{
+		if( FeedbackContext != nullptr )
+		{
+			FeedbackContext->Logf( ELogVerbosity::Error, TEXT( "Failed to open compressed OpenStreetMap XML file '%s'" ), *OSMFilePath );
+		}
+		return false;
+	}
+
+	if( Profile != nullptr )
+	{
+		Profile->SetCounter( TEXT( "Compressed bytes" ), FileSize );
+	}
+
+	// Every pass decompresses the file again, which is still a lot cheaper than keeping the whole file around
+	auto StreamPass = [this, &OSMFilePath, FileSize, FeedbackContext]( IOSMXmlCallback& Callback ) -> bool
+	{
+		// Progress is measured in compressed bytes, since we don't know how large the file is going to be
+		FScopedStreetMapImportProgress SlowTask( Progress, (float)FileSize, LOCTEXT( "LoadingCompressedXml", "Loading compressed OpenStreetMap XML file" ) );
+
+		FOSMDecompressionStream Stream;
+
+		FText ErrorMessage;
+		int32 ErrorLineNumber = 0;
+		int64 XmlDataSize = 0;
+
+		FString OpenError;
+		bool bSuccess = Stream.Open( OSMFilePath, OpenError );
+		if( !bSuccess )
+		{
+			ErrorMessage = FText::FromString( OpenError );
+		}
+		else
+		{
+			int64 LastProgressOffset = 0;
+			auto ReportProgress = [&SlowTask, &Stream, &LastProgressOffset]() -> bool
+			{
+				const int64 ProgressOffset = Stream.GetCompressedBytesRead();
+				SlowTask.EnterProgressFrame( (float)( ProgressOffset - LastProgressOffset ) );
+				LastProgressOffset = ProgressOffset;
+				return !SlowTask.ShouldCancel();
+			};
+
+			bool bEndOfStream = false;
+			auto Read = [&Stream, &bEndOfStream]( ANSICHAR* Dest, const int32 DestSize ) -> int32
+			{
+				const int32 BytesRead = Stream.Read( (uint8*)Dest, DestSize );
+				bEndOfStream = bEndOfStream || ( BytesRead == 0 );
+				return BytesRead;
+			};
+
+			bSuccess = FOSMXmlScanner::ParseStream( Read, Callback, ReportProgress, /* Out */ ErrorMessage, /* Out */ ErrorLineNumber, /* Out */ XmlDataSize );
+
+			// The stream ends early if decompressing fails, which is what went wrong then, no matter what the scanner
+			// thinks.  The error can only be looked at once the stream ended, since the decompression thread sets it.
+			if( bEndOfStream && !Stream.GetError().IsEmpty() )
+			{
+				ErrorMessage = FText::Format( LOCTEXT( "DecompressionFailed", "Failed to decompress: {0}" ), FText::FromString( Stream.GetError() ) );
+				bSuccess = false;
+			}
+		}
+
+		if( !bSuccess )
+		{
+			if( FeedbackContext != nullptr )
+			{
+				FeedbackContext->Logf(
+					ELogVerbosity::Error,
+					TEXT( "Failed to load compressed OpenStreetMap XML file '%s' ('%s', Line %i)" ),
+					*OSMFilePath,
+					*ErrorMessage.ToString(),
+					ErrorLineNumber );
+			}
+			return false;
+		}
+
+		if( Profile != nullptr )
+		{
+			Profile->SetCounter( TEXT( "XML bytes" ), XmlDataSize );
+		}
+		return true;
+	};
+
+	return LoadXmlInPasses( StreamPass );
+}
+
+
+#undef LOCTEXT_NAMESPACE
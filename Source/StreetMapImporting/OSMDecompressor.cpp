@@ -0,0 +1,781 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapImporting.h"
+#include "OSMDecompressor.h"
+#include "zlib.h"
+
+/** How much compressed data we read from the file at once */
+static const int32 DecompressorInputBufferSize = 256 * 1024;
+
+
+/** Reads the next bytes of the archive into the buffer.  @return Number of bytes read, zero at the end of the file, or INDEX_NONE on failure. */
+static int32 ReadCompressedData( FArchive& Reader, TArray<uint8>& Buffer )
+{
+	const int64 RemainingSize = Reader.TotalSize() - Reader.Tell();
+	const int32 ReadSize = (int32)FMath::Min<int64>( RemainingSize, Buffer.Num() );
+	if( ReadSize <= 0 )
+	{
+		return 0;
+	}
+
+	Reader.Serialize( Buffer.GetData(), ReadSize );
+	return Reader.IsError() ? INDEX_NONE : ReadSize;
+}
+
+
+/** gzip decompressor, which simply feeds zlib */
+class FOSMGzipDecompressor : public IOSMDecompressor
+{
+
+public:
+
+	FOSMGzipDecompressor( FArchive& InReader )
+		: Reader( InReader )
+		, bAtMemberStart( false )
+		, bFinished( false )
+	{
+		InputBuffer.SetNumUninitialized( DecompressorInputBufferSize );
+
+		FMemory::Memzero( Stream );
+
+		// The extra 16 window bits tell zlib to expect a gzip header and trailer instead of a zlib one
+		bInitialized = inflateInit2( &Stream, 16 + MAX_WBITS ) == Z_OK;
+	}
+
+	virtual ~FOSMGzipDecompressor()
+	{
+		if( bInitialized )
+		{
+			inflateEnd( &Stream );
+		}
+	}
+
+	// IOSMDecompressor overrides
+	virtual int32 Decompress( uint8* Dest, const int32 DestSize ) override
+	{
+		if( !Error.IsEmpty() )
+		{
+			return INDEX_NONE;
+		}
+		if( !bInitialized )
+		{
+			return Fail( TEXT( "Failed to initialize zlib" ) );
+		}
+
+		Stream.next_out = Dest;
+		Stream.avail_out = DestSize;
+
+		while( Stream.avail_out > 0 && !bFinished )
+		{
+			if( Stream.avail_in == 0 )
+			{
+				const int32 ReadSize = ReadCompressedData( Reader, InputBuffer );
+				if( ReadSize < 0 )
+				{
+					return Fail( TEXT( "Failed to read from the file" ) );
+				}
+				if( ReadSize == 0 )
+				{
+					if( !bAtMemberStart )
+					{
+						return Fail( TEXT( "Unexpected end of file" ) );
+					}
+					bFinished = true;
+					break;
+				}
+
+				Stream.next_in = InputBuffer.GetData();
+				Stream.avail_in = ReadSize;
+			}
+
+			bAtMemberStart = false;
+			const int Result = inflate( &Stream, Z_NO_FLUSH );
+			if( Result == Z_STREAM_END )
+			{
+				// Another gzip member may follow, which continues where this one left off
+				inflateReset( &Stream );
+				bAtMemberStart = true;
+			}
+			else if( Result != Z_OK && Result != Z_BUF_ERROR )
+			{
+				return Fail( Stream.msg != nullptr ? ANSI_TO_TCHAR( Stream.msg ) : TEXT( "Corrupt gzip data" ) );
+			}
+		}
+
+		return DestSize - (int32)Stream.avail_out;
+	}
+
+	virtual const FString& GetError() const override
+	{
+		return Error;
+	}
+
+private:
+
+	int32 Fail( const TCHAR* Message )
+	{
+		Error = Message;
+		return INDEX_NONE;
+	}
+
+	FArchive& Reader;
+	TArray<uint8> InputBuffer;
+	z_stream Stream;
+	bool bInitialized;
+
+	/** True between two gzip members, where the file may end */
+	bool bAtMemberStart;
+
+	/** True once the end of the file is reached */
+	bool bFinished;
+
+	FString Error;
+};
+
+
+// Reference: https://github.com/dsnet/compress/blob/master/doc/bzip2-format.pdf
+//
+// A bzip2 stream is a "BZh" header with the block size, followed by blocks and an end of stream marker.  Each block
+// holds up to 900 KB of data, run length encoded, then Burrows-Wheeler transformed, move-to-front coded, run length
+// encoded again and finally Huffman coded.  We undo these steps in reverse order.
+
+/** Block and end of stream markers (the BCD digits of pi and sqrt(pi)) */
+static const uint64 Bzip2BlockMagic = 0x314159265359ull;
+static const uint64 Bzip2EndOfStreamMagic = 0x177245385090ull;
+
+/** Limits from the bzip2 format */
+static const int32 Bzip2MaxAlphabetSize = 258;
+static const int32 Bzip2MaxCodeLength = 20;
+static const int32 Bzip2MaxTables = 6;
+static const int32 Bzip2MaxSelectors = 18002;
+static const int32 Bzip2SymbolsPerSelector = 50;
+
+
+/** CRC-32 as used by bzip2: the same polynomial as zlib, but most significant bit first */
+static const uint32* GetBzip2CRCTable()
+{
+	struct FTable
+	{
+		uint32 Entries[ 256 ];
+
+		FTable()
+		{
+			for( uint32 Index = 0; Index < 256; ++Index )
+			{
+				uint32 CRC = Index << 24;
+				for( int32 Bit = 0; Bit < 8; ++Bit )
+				{
+					CRC = ( CRC & 0x80000000 ) ? ( CRC << 1 ) ^ 0x04C11DB7 : ( CRC << 1 );
+				}
+				Entries[ Index ] = CRC;
+			}
+		}
+	};
+	static const FTable Table;
+	return Table.Entries;
+}
+
+
+/** Canonical Huffman code, decoded one bit at a time starting with the shortest code length */
+struct FBzip2HuffmanTable
+{
+	int32 MinLength;
+	int32 MaxLength;
+
+	/** Largest code of each length, or less than the smallest code of the next length if there are none */
+	int32 Limit[ Bzip2MaxCodeLength + 2 ];
+
+	/** Added to a code of each length to get the index of its symbol in Symbols */
+	int32 Base[ Bzip2MaxCodeLength + 2 ];
+
+	/** Symbols, ordered by code length */
+	uint16 Symbols[ Bzip2MaxAlphabetSize ];
+
+	void Build( const uint8* Lengths, const int32 AlphabetSize )
+	{
+		MinLength = Bzip2MaxCodeLength;
+		MaxLength = 0;
+		for( int32 Symbol = 0; Symbol < AlphabetSize; ++Symbol )
+		{
+			MinLength = FMath::Min<int32>( MinLength, Lengths[ Symbol ] );
+			MaxLength = FMath::Max<int32>( MaxLength, Lengths[ Symbol ] );
+		}
+
+		int32 SymbolIndex = 0;
+		int32 Code = 0;
+		for( int32 Length = MinLength; Length <= MaxLength; ++Length )
+		{
+			Base[ Length ] = SymbolIndex - Code;
+			for( int32 Symbol = 0; Symbol < AlphabetSize; ++Symbol )
+			{
+				if( Lengths[ Symbol ] == Length )
+				{
+					Symbols[ SymbolIndex++ ] = (uint16)Symbol;
+					++Code;
+				}
+			}
+			Limit[ Length ] = Code - 1;
+			Code <<= 1;
+		}
+	}
+};
+
+
+/**
+ * bzip2 decompressor.  Blocks are decoded one at a time, and their output is produced as it is asked for, so memory
+ * usage is bounded by the block size.
+ */
+class FOSMBzip2Decompressor : public IOSMDecompressor
+{
+
+public:
+
+	FOSMBzip2Decompressor( FArchive& InReader )
+		: Reader( InReader )
+		, InputPosition( 0 )
+		, InputSize( 0 )
+		, BitBuffer( 0 )
+		, NumBitsInBuffer( 0 )
+		, NumPaddingBits( 0 )
+		, NumStreams( 0 )
+		, MaxBlockSize( 0 )
+		, BlockPosition( 0 )
+		, NumSymbolsLeft( 0 )
+		, LastByte( 0 )
+		, RunLength( 0 )
+		, NumCopiesLeft( 0 )
+		, ExpectedBlockCRC( 0 )
+		, BlockCRC( 0 )
+		, StreamCRC( 0 )
+		, bInBlock( false )
+		, bNeedStreamHeader( true )
+		, bFinished( false )
+	{
+		InputBuffer.SetNumUninitialized( DecompressorInputBufferSize );
+	}
+
+	// IOSMDecompressor overrides
+	virtual int32 Decompress( uint8* Dest, const int32 DestSize ) override
+	{
+		if( !Error.IsEmpty() )
+		{
+			return INDEX_NONE;
+		}
+
+		const uint32* CRCTable = GetBzip2CRCTable();
+
+		int32 NumWritten = 0;
+		while( NumWritten < DestSize )
+		{
+			if( NumCopiesLeft > 0 )
+			{
+				// Repeats of the last byte, from the first run length encoding step
+				const int32 NumCopies = FMath::Min( NumCopiesLeft, DestSize - NumWritten );
+				for( int32 Index = 0; Index < NumCopies; ++Index )
+				{
+					Dest[ NumWritten++ ] = LastByte;
+					BlockCRC = ( BlockCRC << 8 ) ^ CRCTable[ ( BlockCRC >> 24 ) ^ LastByte ];
+				}
+				NumCopiesLeft -= NumCopies;
+			}
+			else if( NumSymbolsLeft > 0 )
+			{
+				// Follow the inverse Burrows-Wheeler transform to the next byte
+				const uint32 Entry = Block[ BlockPosition ];
+				const uint8 Byte = (uint8)( Entry & 0xff );
+				BlockPosition = Entry >> 8;
+				--NumSymbolsLeft;
+
+				if( RunLength == 4 )
+				{
+					// Four equal bytes in a row are followed by the number of times the byte is repeated after them
+					NumCopiesLeft = Byte;
+					RunLength = 0;
+					continue;
+				}
+
+				RunLength = ( RunLength > 0 && Byte == LastByte ) ? RunLength + 1 : 1;
+				LastByte = Byte;
+
+				Dest[ NumWritten++ ] = Byte;
+				BlockCRC = ( BlockCRC << 8 ) ^ CRCTable[ ( BlockCRC >> 24 ) ^ Byte ];
+			}
+			else
+			{
+				if( bInBlock )
+				{
+					bInBlock = false;
+					BlockCRC = ~BlockCRC;
+					if( BlockCRC != ExpectedBlockCRC )
+					{
+						return Fail( TEXT( "Block checksum mismatch" ) );
+					}
+					StreamCRC = ( ( StreamCRC << 1 ) | ( StreamCRC >> 31 ) ) ^ BlockCRC;
+				}
+
+				if( bFinished || !ReadBlock() )
+				{
+					if( !Error.IsEmpty() )
+					{
+						return INDEX_NONE;
+					}
+					bFinished = true;
+					break;
+				}
+			}
+		}
+
+		return NumWritten;
+	}
+
+	virtual const FString& GetError() const override
+	{
+		return Error;
+	}
+
+private:
+
+	/** Reads the next bits of the file, most significant first.  Reads zeros past the end of the file, which we check for with IsTruncated. */
+	uint32 ReadBits( const int32 NumBits )
+	{
+		while( NumBitsInBuffer < NumBits )
+		{
+			if( InputPosition == InputSize )
+			{
+				InputPosition = 0;
+				InputSize = FMath::Max( 0, ReadCompressedData( Reader, InputBuffer ) );
+			}
+
+			if( InputPosition < InputSize )
+			{
+				BitBuffer = ( BitBuffer << 8 ) | InputBuffer[ InputPosition++ ];
+			}
+			else
+			{
+				BitBuffer <<= 8;
+				NumPaddingBits += 8;
+			}
+			NumBitsInBuffer += 8;
+		}
+
+		NumBitsInBuffer -= NumBits;
+		return (uint32)( ( BitBuffer >> NumBitsInBuffer ) & ( ( 1ull << NumBits ) - 1 ) );
+	}
+
+	/** @return True if we read past the end of the file */
+	bool IsTruncated() const
+	{
+		return NumPaddingBits > NumBitsInBuffer;
+	}
+
+	/** @return True if there is anything left to read */
+	bool HasMoreInput() const
+	{
+		return NumBitsInBuffer > NumPaddingBits || InputPosition < InputSize || Reader.Tell() < Reader.TotalSize();
+	}
+
+	/** Reads the "BZh" header of a stream.  Returns false at the end of the file. */
+	bool ReadStreamHeader()
+	{
+		// Streams end on a byte boundary
+		ReadBits( NumBitsInBuffer % 8 );
+
+		if( NumStreams > 0 && !HasMoreInput() )
+		{
+			return false;
+		}
+
+		const uint32 Signature = ReadBits( 24 );
+		const uint32 Level = ReadBits( 8 );
+		if( Signature != 0x425A68 || Level < '1' || Level > '9' || IsTruncated() )
+		{
+			if( NumStreams > 0 )
+			{
+				// Like bzip2, we ignore trailing garbage after a complete stream
+				return false;
+			}
+			Fail( TEXT( "Not a bzip2 file" ) );
+			return false;
+		}
+
+		MaxBlockSize = ( Level - '0' ) * 100000;
+		Block.SetNumUninitialized( MaxBlockSize );
+		StreamCRC = 0;
+		++NumStreams;
+		return true;
+	}
+
+	/** Decodes the Huffman coded symbols of the next block, and sets up the inverse Burrows-Wheeler transform.  Returns false at the end of the file. */
+	bool ReadBlock()
+	{
+		for( ;; )
+		{
+			if( bNeedStreamHeader )
+			{
+				if( !ReadStreamHeader() )
+				{
+					return false;
+				}
+				bNeedStreamHeader = false;
+			}
+
+			const uint64 Magic = ( (uint64)ReadBits( 24 ) << 24 ) | ReadBits( 24 );
+			const uint32 CRC = ReadBits( 32 );
+			if( IsTruncated() )
+			{
+				Fail( TEXT( "Unexpected end of file" ) );
+				return false;
+			}
+
+			if( Magic == Bzip2EndOfStreamMagic )
+			{
+				if( CRC != StreamCRC )
+				{
+					Fail( TEXT( "Stream checksum mismatch" ) );
+					return false;
+				}
+				bNeedStreamHeader = true;
+				continue;
+			}
+
+			if( Magic != Bzip2BlockMagic )
+			{
+				Fail( TEXT( "Corrupt block header" ) );
+				return false;
+			}
+
+			ExpectedBlockCRC = CRC;
+			if( !ReadBlockContents() )
+			{
+				if( IsTruncated() )
+				{
+					// Whatever went wrong was caused by the zeros we read past the end
+					Error = TEXT( "Unexpected end of file" );
+				}
+				return false;
+			}
+			return true;
+		}
+	}
+
+	/** Reads the block after its header.  Returns false if it is corrupt. */
+	bool ReadBlockContents()
+	{
+		if( ReadBits( 1 ) != 0 )
+		{
+			// Randomized blocks haven't been written by bzip2 since version 0.9.5
+			Fail( TEXT( "Randomized blocks are not supported" ) );
+			return false;
+		}
+
+		const int32 OriginPointer = ReadBits( 24 );
+
+		// Bytes that occur in the block, in two levels of 16 bits each
+		uint8 SymbolToByte[ 256 ];
+		int32 NumBytesInUse = 0;
+		const uint32 UsedRanges = ReadBits( 16 );
+		for( int32 Range = 0; Range < 16; ++Range )
+		{
+			if( UsedRanges & ( 0x8000 >> Range ) )
+			{
+				const uint32 UsedBytes = ReadBits( 16 );
+				for( int32 Bit = 0; Bit < 16; ++Bit )
+				{
+					if( UsedBytes & ( 0x8000 >> Bit ) )
+					{
+						SymbolToByte[ NumBytesInUse++ ] = (uint8)( Range * 16 + Bit );
+					}
+				}
+			}
+		}
+		if( NumBytesInUse == 0 )
+		{
+			Fail( TEXT( "Block uses no symbols" ) );
+			return false;
+		}
+
+		// Two run length symbols, the move-to-front indices 1 and up, and the end of block symbol
+		const int32 AlphabetSize = NumBytesInUse + 2;
+		const int32 EndOfBlockSymbol = AlphabetSize - 1;
+
+		const int32 NumTables = ReadBits( 3 );
+		const int32 NumSelectors = ReadBits( 15 );
+		if( NumTables < 2 || NumTables > Bzip2MaxTables || NumSelectors == 0 )
+		{
+			Fail( TEXT( "Corrupt Huffman table header" ) );
+			return false;
+		}
+
+		// Which table each group of 50 symbols uses, move-to-front coded in unary.  Some encoders write more
+		// selectors than the format allows; those are never used, so we read and drop them like bzip2 does.
+		uint8 TableOrder[ Bzip2MaxTables ] = { 0, 1, 2, 3, 4, 5 };
+		Selectors.SetNumUninitialized( FMath::Min( NumSelectors, Bzip2MaxSelectors ) );
+		for( int32 SelectorIndex = 0; SelectorIndex < NumSelectors; ++SelectorIndex )
+		{
+			int32 OrderIndex = 0;
+			while( ReadBits( 1 ) != 0 )
+			{
+				if( ++OrderIndex >= NumTables )
+				{
+					Fail( TEXT( "Corrupt selector" ) );
+					return false;
+				}
+			}
+
+			const uint8 Table = TableOrder[ OrderIndex ];
+			for( ; OrderIndex > 0; --OrderIndex )
+			{
+				TableOrder[ OrderIndex ] = TableOrder[ OrderIndex - 1 ];
+			}
+			TableOrder[ 0 ] = Table;
+
+			if( SelectorIndex < Selectors.Num() )
+			{
+				Selectors[ SelectorIndex ] = Table;
+			}
+		}
+
+		// Code lengths of each table, delta coded
+		FBzip2HuffmanTable Tables[ Bzip2MaxTables ];
+		for( int32 TableIndex = 0; TableIndex < NumTables; ++TableIndex )
+		{
+			uint8 Lengths[ Bzip2MaxAlphabetSize ];
+			int32 Length = ReadBits( 5 );
+			for( int32 Symbol = 0; Symbol < AlphabetSize; ++Symbol )
+			{
+				for( ;; )
+				{
+					if( Length < 1 || Length > Bzip2MaxCodeLength )
+					{
+						Fail( TEXT( "Corrupt Huffman code length" ) );
+						return false;
+					}
+					if( ReadBits( 1 ) == 0 )
+					{
+						break;
+					}
+					Length += ( ReadBits( 1 ) == 0 ) ? 1 : -1;
+				}
+				Lengths[ Symbol ] = (uint8)Length;
+			}
+
+			Tables[ TableIndex ].Build( Lengths, AlphabetSize );
+		}
+
+		// Decode the symbols, undoing the move-to-front coding and the second run length encoding as we go
+		uint8 MoveToFront[ 256 ];
+		for( int32 Index = 0; Index < 256; ++Index )
+		{
+			MoveToFront[ Index ] = (uint8)Index;
+		}
+
+		int32 ByteCounts[ 256 ] = { 0 };
+		int32 NumSymbols = 0;
+		int32 SelectorIndex = -1;
+		int32 NumSymbolsLeftInGroup = 0;
+		const FBzip2HuffmanTable* Table = nullptr;
+		int32 PendingRunLength = 0;
+		int32 RunWeight = 1;
+
+		for( ;; )
+		{
+			if( NumSymbolsLeftInGroup == 0 )
+			{
+				if( ++SelectorIndex >= Selectors.Num() )
+				{
+					Fail( TEXT( "Ran out of selectors" ) );
+					return false;
+				}
+				if( Selectors[ SelectorIndex ] >= NumTables )
+				{
+					Fail( TEXT( "Corrupt selector" ) );
+					return false;
+				}
+				Table = &Tables[ Selectors[ SelectorIndex ] ];
+				NumSymbolsLeftInGroup = Bzip2SymbolsPerSelector;
+			}
+			--NumSymbolsLeftInGroup;
+
+			int32 Length = Table->MinLength;
+			int32 Code = ReadBits( Length );
+			while( Code > Table->Limit[ Length ] )
+			{
+				if( ++Length > Table->MaxLength )
+				{
+					Fail( TEXT( "Corrupt Huffman code" ) );
+					return false;
+				}
+				Code = ( Code << 1 ) | ReadBits( 1 );
+			}
+			const int32 SymbolIndex = Code + Table->Base[ Length ];
+			if( SymbolIndex < 0 || SymbolIndex >= AlphabetSize )
+			{
+				Fail( TEXT( "Corrupt Huffman code" ) );
+				return false;
+			}
+			const int32 Symbol = Table->Symbols[ SymbolIndex ];
+
+			if( Symbol <= 1 )
+			{
+				// RUNA and RUNB spell out a run length of the front byte in bijective base 2
+				if( RunWeight > MaxBlockSize )
+				{
+					Fail( TEXT( "Run is longer than the block" ) );
+					return false;
+				}
+				PendingRunLength += ( Symbol + 1 ) * RunWeight;
+				RunWeight <<= 1;
+				continue;
+			}
+
+			if( PendingRunLength > 0 )
+			{
+				if( PendingRunLength > MaxBlockSize - NumSymbols )
+				{
+					Fail( TEXT( "Run is longer than the block" ) );
+					return false;
+				}
+				const uint8 Byte = SymbolToByte[ MoveToFront[ 0 ] ];
+				ByteCounts[ Byte ] += PendingRunLength;
+				for( ; PendingRunLength > 0; --PendingRunLength )
+				{
+					Block[ NumSymbols++ ] = Byte;
+				}
+				RunWeight = 1;
+			}
+
+			if( Symbol == EndOfBlockSymbol )
+			{
+				break;
+			}
+
+			if( NumSymbols >= MaxBlockSize )
+			{
+				Fail( TEXT( "Block is larger than the stream allows" ) );
+				return false;
+			}
+
+			const int32 FrontIndex = Symbol - 1;
+			const uint8 Value = MoveToFront[ FrontIndex ];
+			FMemory::Memmove( MoveToFront + 1, MoveToFront, FrontIndex );
+			MoveToFront[ 0 ] = Value;
+
+			const uint8 Byte = SymbolToByte[ Value ];
+			++ByteCounts[ Byte ];
+			Block[ NumSymbols++ ] = Byte;
+		}
+
+		if( IsTruncated() )
+		{
+			return false;
+		}
+		if( OriginPointer >= NumSymbols )
+		{
+			Fail( TEXT( "Corrupt origin pointer" ) );
+			return false;
+		}
+
+		// Link every symbol to the one that follows it in the original data, in the upper 24 bits of its entry
+		int32 FirstIndexOfByte = 0;
+		for( int32 Byte = 0; Byte < 256; ++Byte )
+		{
+			const int32 Count = ByteCounts[ Byte ];
+			ByteCounts[ Byte ] = FirstIndexOfByte;
+			FirstIndexOfByte += Count;
+		}
+		for( int32 Index = 0; Index < NumSymbols; ++Index )
+		{
+			const uint8 Byte = (uint8)( Block[ Index ] & 0xff );
+			Block[ ByteCounts[ Byte ]++ ] |= (uint32)Index << 8;
+		}
+
+		BlockPosition = Block[ OriginPointer ] >> 8;
+		NumSymbolsLeft = NumSymbols;
+		RunLength = 0;
+		NumCopiesLeft = 0;
+		BlockCRC = 0xffffffff;
+		bInBlock = true;
+		return true;
+	}
+
+	int32 Fail( const TCHAR* Message )
+	{
+		Error = Message;
+		return INDEX_NONE;
+	}
+
+	/** Source of compressed data */
+	FArchive& Reader;
+
+	/** Compressed data that was read from the archive, but not decoded yet */
+	TArray<uint8> InputBuffer;
+	int32 InputPosition;
+	int32 InputSize;
+
+	/** Bits that were read from the input buffer, but not consumed yet, right aligned */
+	uint64 BitBuffer;
+	int32 NumBitsInBuffer;
+
+	/** Number of zero bits we made up after the end of the file */
+	int32 NumPaddingBits;
+
+	/** Number of streams started so far */
+	int32 NumStreams;
+
+	/** Maximum number of symbols in a block of the current stream */
+	int32 MaxBlockSize;
+
+	/** Huffman table used by each group of symbols of the current block */
+	TArray<uint8> Selectors;
+
+	/** Byte of each symbol of the current block in the low 8 bits, and the index of the symbol after it in the high 24 bits */
+	TArray<uint32> Block;
+
+	/** State of the inverse Burrows-Wheeler transform, and of undoing the first run length encoding on its output */
+	uint32 BlockPosition;
+	int32 NumSymbolsLeft;
+	uint8 LastByte;
+	int32 RunLength;
+	int32 NumCopiesLeft;
+
+	/** Checksums of the current block and stream */
+	uint32 ExpectedBlockCRC;
+	uint32 BlockCRC;
+	uint32 StreamCRC;
+
+	/** True while the output of a block is being produced */
+	bool bInBlock;
+
+	/** True at the start of the file, and after the end of every stream */
+	bool bNeedStreamHeader;
+
+	/** True once the end of the file is reached */
+	bool bFinished;
+
+	FString Error;
+};
+
+
+EOSMCompressionFormat IOSMDecompressor::DetectFormat( const uint8* Header, const int32 HeaderSize )
+{
+	if( HeaderSize >= 2 && Header[ 0 ] == 0x1F && Header[ 1 ] == 0x8B )
+	{
+		return EOSMCompressionFormat::Gzip;
+	}
+	if( HeaderSize >= 4 && Header[ 0 ] == 'B' && Header[ 1 ] == 'Z' && Header[ 2 ] == 'h' && Header[ 3 ] >= '1' && Header[ 3 ] <= '9' )
+	{
+		return EOSMCompressionFormat::Bzip2;
+	}
+	return EOSMCompressionFormat::None;
+}
+
+
+TUniquePtr<IOSMDecompressor> IOSMDecompressor::Create( const EOSMCompressionFormat Format, FArchive& Reader )
+{
+	switch( Format )
+	{
+		case EOSMCompressionFormat::Gzip: return MakeUnique<FOSMGzipDecompressor>( Reader );
+		case EOSMCompressionFormat::Bzip2: return MakeUnique<FOSMBzip2Decompressor>( Reader );
+		default: return nullptr;
+	}
+}
@@ -0,0 +1,43 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+
+/** Compression formats OpenStreetMap extracts are distributed in */
+enum class EOSMCompressionFormat : uint8
+{
+	None,
+	Gzip,
+	Bzip2,
+};
+
+
+/**
+ * Streaming decompressor.  Reads compressed data from an archive as it goes, so neither the compressed nor the
+ * decompressed file ever has to be in memory as a whole.  Files made of several concatenated streams, as written by
+ * parallel compressors such as pigz, pbzip2 or lbzip2, are decompressed as one.
+ */
+class IOSMDecompressor
+{
+
+public:
+
+	virtual ~IOSMDecompressor()
+	{
+	}
+
+	/**
+	 * Decompresses the next bytes of the file
+	 *
+	 * @return Number of bytes written to Dest, zero at the end of the file, or INDEX_NONE if the data is corrupt (see GetError)
+	 */
+	virtual int32 Decompress( uint8* Dest, const int32 DestSize ) = 0;
+
+	/** @return Why decompression failed */
+	virtual const FString& GetError() const = 0;
+
+	/** Finds out how a file is compressed from its first few bytes */
+	static EOSMCompressionFormat DetectFormat( const uint8* Header, const int32 HeaderSize );
+
+	/** Creates a decompressor for data in the given format, read from the current position of the archive on */
+	static TUniquePtr<IOSMDecompressor> Create( const EOSMCompressionFormat Format, FArchive& Reader );
+};
@@ -0,0 +1,159 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapImporting.h"
+#include "OSMDecompressor.h"
+#include "Serialization/MemoryReader.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/** Length of the run of 'x' in the fixture data.  bzip2 encodes runs of at most 255 bytes, so this one is split up. */
+static const int32 FixtureRunLength = 300;
+
+/** First part of the fixture data, up to the run */
+static const ANSICHAR* FixtureDataBeforeRun =
+	"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	"<osm version=\"0.6\">\n"
+	" <node id=\"1\" lat=\"47.0010000\" lon=\"8.0010000\">\n"
+	"  <tag k=\"note\" v=\"";
+
+/** Rest of the first stream of the fixtures, after the run */
+static const ANSICHAR* FixtureDataAfterRun =
+	"\"/>\n"
+	" </node>\n";
+
+/** Everything in the second stream of the fixtures */
+static const ANSICHAR* FixtureSecondStreamData =
+	" <node id=\"2\" lat=\"47.0020000\" lon=\"8.0020000\"/>\n"
+	"</osm>\n";
+
+/**
+ * The fixture data compressed as two concatenated streams, the way parallel compressors write them.  Made with
+ * Python's bz2.compress() at levels 1 and 9 for the two streams, and gzip.compress() with mtime=0.
+ */
+static const uint8 Bzip2Fixture[] =
+{
+	0x42, 0x5A, 0x68, 0x31, 0x31, 0x41, 0x59, 0x26, 0x53, 0x59, 0xA3, 0x91, 0xFD, 0x02, 0x00, 0x00,
+	0x21, 0xDF, 0x80, 0xC0, 0x10, 0x50, 0x23, 0xE5, 0xC7, 0x81, 0x00, 0x06, 0x00, 0x2E, 0xAF, 0x9D,
+	0x40, 0x00, 0x08, 0x20, 0x00, 0x74, 0x1A, 0x9E, 0x90, 0x81, 0xA2, 0x79, 0x23, 0xD4, 0xC0, 0x6A,
+	0x66, 0xA6, 0xD4, 0x0D, 0x29, 0xE5, 0x34, 0x7A, 0x9A, 0x34, 0x06, 0x80, 0x34, 0x00, 0x51, 0x59,
+	0x04, 0x28, 0xD9, 0x96, 0x66, 0x50, 0x82, 0xD2, 0xD9, 0x67, 0x79, 0x04, 0xB2, 0xE4, 0x2F, 0x71,
+	0x5B, 0xD8, 0xD7, 0x60, 0x61, 0xE8, 0x60, 0x48, 0x10, 0x18, 0x40, 0x41, 0x4C, 0xBD, 0xAF, 0xD4,
+	0x49, 0x3C, 0xC8, 0xF6, 0x73, 0xEA, 0x96, 0x6E, 0x74, 0xE1, 0x31, 0x97, 0xC5, 0xBB, 0x8B, 0xE7,
+	0xF5, 0x4F, 0x69, 0x87, 0x81, 0x3A, 0xD6, 0xCA, 0x04, 0x99, 0x09, 0x2B, 0x55, 0x8B, 0xA1, 0xE5,
+	0xEE, 0x1D, 0xB4, 0x42, 0xA6, 0x56, 0x28, 0x2D, 0x7B, 0x53, 0x05, 0x5F, 0x12, 0x3F, 0x60, 0x80,
+	0x7F, 0x17, 0x72, 0x45, 0x38, 0x50, 0x90, 0xA3, 0x91, 0xFD, 0x02, 0x42, 0x5A, 0x68, 0x39, 0x31,
+	0x41, 0x59, 0x26, 0x53, 0x59, 0xA1, 0xFA, 0x3A, 0xA4, 0x00, 0x00, 0x02, 0x59, 0x80, 0x40, 0x10,
+	0x50, 0x01, 0xD4, 0xC7, 0x26, 0x27, 0x8C, 0x00, 0x20, 0x00, 0x54, 0x50, 0x68, 0xD1, 0xA0, 0xC8,
+	0x0D, 0x06, 0x8A, 0x69, 0xB2, 0x9A, 0x36, 0x53, 0xD4, 0x66, 0xA6, 0x88, 0x18, 0x52, 0x10, 0x59,
+	0x03, 0x95, 0xDA, 0xAF, 0xC8, 0x25, 0x17, 0x1B, 0x0D, 0xCC, 0x1B, 0x9F, 0x4D, 0x1A, 0x99, 0xF6,
+	0x67, 0xE5, 0xE0, 0xB5, 0x48, 0xB2, 0xCC, 0x17, 0xE2, 0xEE, 0x48, 0xA7, 0x0A, 0x12, 0x14, 0x3F,
+	0x47, 0x54, 0x80,
+};
+
+static const uint8 GzipFixture[] =
+{
+	0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xB3, 0xB1, 0xAF, 0xC8, 0xCD, 0x51,
+	0x28, 0x4B, 0x2D, 0x2A, 0xCE, 0xCC, 0xCF, 0xB3, 0x55, 0x32, 0xD4, 0x33, 0x50, 0x52, 0x48, 0xCD,
+	0x4B, 0xCE, 0x4F, 0xC9, 0xCC, 0x4B, 0xB7, 0x55, 0x0A, 0x0D, 0x71, 0xD3, 0xB5, 0x50, 0xB2, 0xB7,
+	0xE3, 0xB2, 0xC9, 0x2F, 0xCE, 0x45, 0xA8, 0x32, 0xD0, 0x33, 0x53, 0xB2, 0xE3, 0x52, 0xB0, 0xC9,
+	0xCB, 0x4F, 0x49, 0x55, 0xC8, 0x4C, 0x01, 0x6A, 0x53, 0x52, 0xC8, 0x49, 0x2C, 0xB1, 0x55, 0x32,
+	0x31, 0xD7, 0x33, 0x30, 0x30, 0x34, 0x00, 0x02, 0xA0, 0x00, 0x48, 0xA5, 0x05, 0x9C, 0x0F, 0x54,
+	0xAF, 0x60, 0x53, 0x92, 0x98, 0xAE, 0x90, 0x6D, 0xAB, 0x94, 0x97, 0x5F, 0x92, 0xAA, 0xA4, 0x50,
+	0x66, 0xAB, 0x54, 0x31, 0x0A, 0x88, 0x06, 0x4A, 0xFA, 0xA0, 0x20, 0xD7, 0x07, 0x85, 0xB9, 0x1D,
+	0x17, 0x00, 0x56, 0x22, 0xD4, 0xA2, 0xB7, 0x01, 0x00, 0x00, 0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x02, 0x03, 0x53, 0xB0, 0xC9, 0xCB, 0x4F, 0x49, 0x55, 0xC8, 0x4C, 0xB1, 0x55, 0x32,
+	0x52, 0x52, 0xC8, 0x49, 0x2C, 0xB1, 0x55, 0x32, 0x31, 0xD7, 0x33, 0x30, 0x30, 0x32, 0x00, 0x02,
+	0xA0, 0x40, 0x7E, 0x9E, 0xAD, 0x92, 0x05, 0x9C, 0xAF, 0x6F, 0xC7, 0x65, 0xA3, 0x9F, 0x5F, 0x9C,
+	0x6B, 0xC7, 0x05, 0x00, 0xE6, 0x62, 0xE1, 0x9E, 0x38, 0x00, 0x00, 0x00,
+};
+
+
+/** @return What the fixtures decompress to */
+static TArray<uint8> MakeFixtureData()
+{
+	TArray<uint8> Data;
+	Data.Append( (const uint8*)FixtureDataBeforeRun, FCStringAnsi::Strlen( FixtureDataBeforeRun ) );
+	Data.AddUninitialized( FixtureRunLength );
+	FMemory::Memset( Data.GetData() + Data.Num() - FixtureRunLength, 'x', FixtureRunLength );
+	Data.Append( (const uint8*)FixtureDataAfterRun, FCStringAnsi::Strlen( FixtureDataAfterRun ) );
+	Data.Append( (const uint8*)FixtureSecondStreamData, FCStringAnsi::Strlen( FixtureSecondStreamData ) );
+	return Data;
+}
+
+
+/** Decompresses all of the data, DestSize bytes at a time at most.  @return False if the decompressor rejected the data. */
+static bool DecompressFixture( const TArray<uint8>& CompressedData, const int32 DestSize, TArray<uint8>& OutData, FString& OutError )
+{
+	FMemoryReader Reader( CompressedData );
+	TUniquePtr<IOSMDecompressor> Decompressor = IOSMDecompressor::Create( IOSMDecompressor::DetectFormat( CompressedData.GetData(), CompressedData.Num() ), Reader );
+	if( !Decompressor.IsValid() )
+	{
+		OutError = TEXT( "Unknown compression format" );
+		return false;
+	}
+
+	TArray<uint8> Dest;
+	Dest.SetNumUninitialized( DestSize );
+	for( ;; )
+	{
+		const int32 BytesWritten = Decompressor->Decompress( Dest.GetData(), Dest.Num() );
+		if( BytesWritten < 0 )
+		{
+			OutError = Decompressor->GetError();
+			return false;
+		}
+		if( BytesWritten == 0 )
+		{
+			return true;
+		}
+		OutData.Append( Dest.GetData(), BytesWritten );
+	}
+}
+
+
+/** Decompresses a fixture with a tiny and a large buffer, and checks that it's rejected once it's cut short or corrupted */
+static void TestDecompression( FAutomationTestBase& Test, const uint8* Fixture, const int32 FixtureSize, const TCHAR* What )
+{
+	const TArray<uint8> ExpectedData = MakeFixtureData();
+	const TArray<uint8> CompressedData( Fixture, FixtureSize );
+
+	const int32 DestSizes[] = { 1, 1024 * 1024 };
+	for( const int32 DestSize : DestSizes )
+	{
+		TArray<uint8> Data;
+		FString Error;
+		const bool bDecompressed = DecompressFixture( CompressedData, DestSize, Data, Error );
+		Test.TestTrue( FString::Printf( TEXT( "%s, %i byte buffer: decompressing succeeds (%s)" ), What, DestSize, *Error ), bDecompressed );
+		Test.TestTrue( FString::Printf( TEXT( "%s, %i byte buffer: both streams decompress to the original data" ), What, DestSize ), Data == ExpectedData );
+	}
+
+	// The second stream loses its end of stream marker and part of its checksum
+	{
+		const TArray<uint8> TruncatedData( Fixture, FixtureSize - 10 );
+		TArray<uint8> Data;
+		FString Error;
+		Test.TestFalse( FString::Printf( TEXT( "%s: truncated data is rejected" ), What ), DecompressFixture( TruncatedData, 1024 * 1024, Data, Error ) );
+	}
+
+	// Somewhere in the compressed data of the first stream, past its header
+	{
+		TArray<uint8> CorruptData = CompressedData;
+		CorruptData[ FixtureSize / 4 ] ^= 0x55;
+		TArray<uint8> Data;
+		FString Error;
+		Test.TestFalse( FString::Printf( TEXT( "%s: corrupt data is rejected" ), What ), DecompressFixture( CorruptData, 1024 * 1024, Data, Error ) );
+	}
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST( FStreetMapDecompressionTest, "StreetMap.Importing.Decompression", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter )
+
+bool FStreetMapDecompressionTest::RunTest( const FString& Parameters )
+{
+	TestDecompression( *this, Bzip2Fixture, ARRAY_COUNT( Bzip2Fixture ), TEXT( "bzip2" ) );
+	TestDecompression( *this, GzipFixture, ARRAY_COUNT( GzipFixture ), TEXT( "gzip" ) );
+	return true;
+}
+
+#endif
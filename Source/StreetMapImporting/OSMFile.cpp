@@ -2,149 +2,1833 @@
 
 #include "StreetMapImporting.h"
 #include "OSMFile.h"
+#include "OSMKeywords.h"
+#include "StreetMapImportProfile.h"
+#include "StreetMapImportProgress.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+
+#define LOCTEXT_NAMESPACE "StreetMapImporting"
+
+
+/** First pass of the two-pass import.  Skips nodes entirely and only looks at ways and multipolygon relations. */
+class FOSMXmlReferenceCollector : public IOSMXmlCallback
+{
+
+public:
+
+	FOSMXmlReferenceCollector( FOSMFile& InOSMFile )
+		: OSMFile( InOSMFile )
+		, ParsingState( ParsingState::Root )
+		, CurrentID( 0 )
+		, bIsMultipolygon( false )
+		, bIsWayMember( false )
+	{
+	}
+
+	virtual bool ProcessElement( const FOSMStringView& ElementName ) override
+	{
+		const EOSMKeyword Element = FindOSMKeyword( ElementName );
+
+		if( ParsingState == ParsingState::Root )
+		{
+			if( Element == EOSMKeyword::Way )
+			{
+				ParsingState = ParsingState::Way;
+				CurrentWayInfo = FOSMFile::FOSMWayInfo();
+				CurrentWayInfo.WayType = FOSMFile::EOSMWayType::Other;
+				CurrentWayInfo.Height = 0.0;
+				CurrentWayInfo.BuildingLevels = 0;
+				CurrentWayInfo.bIsOneWay = false;
+				CurrentRefs.Reset();
+			}
+			else if( Element == EOSMKeyword::Relation )
+			{
+				ParsingState = ParsingState::Relation;
+				bIsMultipolygon = false;
+				CurrentRefs.Reset();
+			}
+			else if( Element == EOSMKeyword::Node )
+			{
+				ParsingState = ParsingState::Node;
+			}
+		}
+		else if( ParsingState == ParsingState::Way )
+		{
+			if( Element == EOSMKeyword::Nd )
+			{
+				ParsingState = ParsingState::Way_NodeRef;
+			}
+			else if( Element == EOSMKeyword::Tag )
+			{
+				ParsingState = ParsingState::Way_Tag;
+			}
+		}
+		else if( ParsingState == ParsingState::Relation )
+		{
+			if( Element == EOSMKeyword::Member )
+			{
+				ParsingState = ParsingState::Relation_Member;
+				bIsWayMember = false;
+				CurrentID = 0;
+			}
+			else if( Element == EOSMKeyword::Tag )
+			{
+				ParsingState = ParsingState::Relation_Tag;
+			}
+		}
+		else if( ParsingState == ParsingState::Node )
+		{
+			ParsingState = ParsingState::Node_Child;
+		}
+
+		return true;
+	}
+
+	virtual bool ProcessAttribute( const FOSMStringView& AttributeName, const FOSMStringView& AttributeValue ) override
+	{
+		const EOSMKeyword Attribute = FindOSMKeyword( AttributeName );
+
+		if( ParsingState == ParsingState::Way )
+		{
+			if( Attribute == EOSMKeyword::Id )
+			{
+				CurrentID = AttributeValue.ToInt64();
+			}
+		}
+		else if( ParsingState == ParsingState::Way_NodeRef )
+		{
+			if( Attribute == EOSMKeyword::Ref )
+			{
+				CurrentRefs.Add( AttributeValue.ToInt64() );
+			}
+		}
+		else if( ParsingState == ParsingState::Way_Tag )
+		{
+			if( Attribute == EOSMKeyword::K )
+			{
+				CurrentTagKey = AttributeValue;
+			}
+			else if( Attribute == EOSMKeyword::V )
+			{
+				FOSMFile::ApplyWayTag( CurrentWayInfo, CurrentTagKey, AttributeValue );
+			}
+		}
+		else if( ParsingState == ParsingState::Relation_Member )
+		{
+			if( Attribute == EOSMKeyword::Type )
+			{
+				bIsWayMember = FindOSMKeyword( AttributeValue ) == EOSMKeyword::Way;
+			}
+			else if( Attribute == EOSMKeyword::Ref )
+			{
+				CurrentID = AttributeValue.ToInt64();
+			}
+		}
+		else if( ParsingState == ParsingState::Relation_Tag )
+		{
+			if( Attribute == EOSMKeyword::K )
+			{
+				CurrentTagKey = AttributeValue;
+			}
+			else if( Attribute == EOSMKeyword::V )
+			{
+				if( FindOSMKeyword( CurrentTagKey ) == EOSMKeyword::Type && FindOSMKeyword( AttributeValue ) == EOSMKeyword::Multipolygon )
+				{
+					bIsMultipolygon = true;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	virtual bool ProcessClose( const FOSMStringView& ElementName ) override
+	{
+		if( ParsingState == ParsingState::Way )
+		{
+			OSMFile.CollectWayReferences( CurrentID, CurrentWayInfo, CurrentRefs );
+			ParsingState = ParsingState::Root;
+		}
+		else if( ParsingState == ParsingState::Way_NodeRef || ParsingState == ParsingState::Way_Tag )
+		{
+			CurrentTagKey = FOSMStringView();
+			ParsingState = ParsingState::Way;
+		}
+		else if( ParsingState == ParsingState::Relation )
+		{
+			if( bIsMultipolygon )
+			{
+				OSMFile.CollectMultipolygonReferences( CurrentRefs );
+			}
+			ParsingState = ParsingState::Root;
+		}
+		else if( ParsingState == ParsingState::Relation_Member )
+		{
+			if( bIsWayMember )
+			{
+				CurrentRefs.Add( CurrentID );
+			}
+			ParsingState = ParsingState::Relation;
+		}
+		else if( ParsingState == ParsingState::Relation_Tag )
+		{
+			CurrentTagKey = FOSMStringView();
+			ParsingState = ParsingState::Relation;
+		}
+		else if( ParsingState == ParsingState::Node )
+		{
+			ParsingState = ParsingState::Root;
+		}
+		else if( ParsingState == ParsingState::Node_Child )
+		{
+			ParsingState = ParsingState::Node;
+		}
+
+		return true;
+	}
+
+private:
+
+	enum class ParsingState
+	{
+		Root,
+		Node,
+		Node_Child,
+		Way,
+		Way_NodeRef,
+		Way_Tag,
+		Relation,
+		Relation_Member,
+		Relation_Tag
+	};
+
+	FOSMFile& OSMFile;
+
+	// Current state of parser
+	ParsingState ParsingState;
+
+	// ID of the way or relation member that is currently being parsed
+	int64 CurrentID;
+
+	// Way that is currently being parsed.  Only its tags are filled in.
+	FOSMFile::FOSMWayInfo CurrentWayInfo;
+
+	// Node references of the current way, or way members of the current relation
+	TArray<int64> CurrentRefs;
+
+	// Current tag key string
+	FOSMStringView CurrentTagKey;
+
+	// True if the current relation is a multipolygon
+	bool bIsMultipolygon;
+
+	// True if the current relation member is a way
+	bool bIsWayMember;
+};
 
 
 FOSMFile::FOSMFile()
 	: ParsingState( ParsingState::Root )
 	, SpatialReferenceSystem( 0, 0 )
+	, NumAccumulatedNodes( 0 )
+	, LatitudeSum( 0 )
+	, LongitudeSum( 0 )
+	, bNodeIdsSorted( true )
+	, bHasFileBounds( false )
+	, bParseInParallel( false )
+	, ParallelChunkSize( DefaultParallelChunkSize )
+	, Profile( nullptr )
+	, Progress( nullptr )
+	, ParentFile( nullptr )
+{
+	ImportArea.Type = EImportAreaType::EntireFile;
+	NodeTagOffsets.Add( 0 );
+	PendingNodeRefOffsets.Add( 0 );
+}
+		
+
+FOSMFile::~FOSMFile()
+{
+	// Ways and relations are owned by the arenas, which free them all at once
+}
+
+
+/** Resets a way to the state it's in before any of its tags were parsed */
+static void ResetWayInfo( FOSMFile::FOSMWayInfo& WayInfo )
+{
+	WayInfo.Name.Empty();
+	WayInfo.Ref.Empty();
+	WayInfo.Nodes.Reset();
+	WayInfo.WayType = FOSMFile::EOSMWayType::Other;
+	WayInfo.Category = NAME_None;
+	WayInfo.Height = 0.0;
+	WayInfo.BuildingLevels = 0;
+	WayInfo.bIsOneWay = false;
+}
+
+
+bool FOSMFile::LoadOpenStreetMapFile( const FString& OSMFilePath, FFeedbackContext* FeedbackContext )
+{
+	// Map the file into memory and parse it right there.  Pages are brought in by the OS as the scanner touches them,
+	// so our memory usage is bounded by the parsed data instead of the size of the file.
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	TUniquePtr<IMappedFileHandle> MappedFile( PlatformFile.OpenMapped( *OSMFilePath ) );
+	TUniquePtr<IMappedFileRegion> MappedRegion( MappedFile.IsValid() ? MappedFile->MapRegion() : nullptr );
+	if( MappedRegion.IsValid() )
+	{
+		return LoadOpenStreetMapXml( (const ANSICHAR*)MappedRegion->GetMappedPtr(), MappedRegion->GetMappedSize(), FeedbackContext );
+	}
+
+	// Memory mapping is not supported on every platform.  Fall back to reading the raw bytes, which still avoids
+	// widening the whole file to TCHAR.
+	TArray<uint8> FileData;
+	if( !FFileHelper::LoadFileToArray( FileData, *OSMFilePath ) )
+	{
+		if( FeedbackContext != nullptr )
+		{
+			FeedbackContext->Logf( ELogVerbosity::Error, TEXT( "Failed to open OpenStreetMap XML file '%s'" ), *OSMFilePath );
+		}
+		return false;
+	}
+
+	return LoadOpenStreetMapXml( (const ANSICHAR*)FileData.GetData(), FileData.Num(), FeedbackContext );
+}
+
+
+static TAutoConsoleVariable<int32> CVarVerifyParallelXmlParsing(
+	TEXT( "StreetMap.VerifyParallelXmlParsing" ),
+	0,
+	TEXT( "If enabled, XML files that were parsed in parallel are parsed again sequentially, and the results are checked to be identical." ) );
+
+
+/** @return True if an element with the given name starts at the position, right after the '<' */
+static bool IsElementStart( const ANSICHAR* Position, const ANSICHAR* End, const ANSICHAR* ElementName, const int32 ElementNameLen )
+{
+	if( End - Position <= ElementNameLen || FCStringAnsi::Strncmp( Position, ElementName, ElementNameLen ) != 0 )
+	{
+		return false;
+	}
+	const ANSICHAR Terminator = Position[ ElementNameLen ];
+	return Terminator == ' ' || Terminator == '\t' || Terminator == '\r' || Terminator == '\n' || Terminator == '>' || Terminator == '/';
+}
+
+
+/**
+ * Splits XML data into chunks of roughly ChunkSize bytes, each of which starts with a top-level <node>, <way> or
+ * <relation> element (except for the first one, which starts at the beginning of the file).  These elements never
+ * nest in OpenStreetMap files, so every chunk can be parsed on its own.  Elements inside of comments and CDATA
+ * sections are never split at, since they aren't really elements.
+ *
+ * @return Offsets of all chunks, plus the size of the data at the end
+ */
+static TArray<int64> SplitXmlIntoChunks( const ANSICHAR* XmlData, const int64 XmlDataSize, const int64 ChunkSize )
+{
+	const ANSICHAR* End = XmlData + XmlDataSize;
+
+	// Everything before this has been checked for comments and CDATA sections, and it isn't inside of one
+	const ANSICHAR* CheckedEnd = XmlData;
+
+	TArray<int64> ChunkOffsets;
+	ChunkOffsets.Add( 0 );
+	for( int64 SearchOffset = ChunkSize; SearchOffset < XmlDataSize; )
+	{
+		const ANSICHAR* TagStart = (const ANSICHAR*)memchr( XmlData + SearchOffset, '<', End - ( XmlData + SearchOffset ) );
+		if( TagStart == nullptr )
+		{
+			break;
+		}
+
+		const ANSICHAR* Name = TagStart + 1;
+		if( !IsElementStart( Name, End, "node", 4 ) && !IsElementStart( Name, End, "way", 3 ) && !IsElementStart( Name, End, "relation", 8 ) )
+		{
+			SearchOffset = Name - XmlData;
+			continue;
+		}
+
+		// Skip over every section that starts before the element, to find out whether the element is inside of one
+		const ANSICHAR* SectionTerminator = nullptr;
+		const ANSICHAR* SectionStart;
+		while( CheckedEnd < TagStart && ( SectionStart = FOSMXmlScanner::FindCommentOrCData( CheckedEnd, TagStart, SectionTerminator ) ) != nullptr )
+		{
+			CheckedEnd = FOSMXmlScanner::FindSectionEnd( SectionStart + 4, End, SectionTerminator );
+		}
+
+		if( CheckedEnd > TagStart )
+		{
+			// Look for the next element after the section
+			SearchOffset = CheckedEnd - XmlData;
+			continue;
+		}
+
+		CheckedEnd = TagStart;
+		ChunkOffsets.Add( TagStart - XmlData );
+		SearchOffset = ( TagStart - XmlData ) + ChunkSize;
+	}
+	ChunkOffsets.Add( XmlDataSize );
+
+	return ChunkOffsets;
+}
+
+
+bool FOSMFile::LoadOpenStreetMapXml( const ANSICHAR* XmlData, const int64 XmlDataSize, FFeedbackContext* FeedbackContext )
+{
+	// Collecting references may take a second look at the ways, for the nodes of multipolygon members
+	const int32 NumPasses = WayFilter ? 3 : 1;
+
+	TArray<int64> ChunkOffsets;
+	if( bParseInParallel )
+	{
+		FScopedStreetMapImportPhase Phase( Profile, TEXT( "Split into chunks" ) );
+		ChunkOffsets = SplitXmlIntoChunks( XmlData, XmlDataSize, ParallelChunkSize );
+	}
+	const int32 NumChunks = ChunkOffsets.Num() - 1;
+
+	if( Profile != nullptr )
+	{
+		Profile->SetCounter( TEXT( "XML bytes" ), XmlDataSize );
+		Profile->SetCounter( TEXT( "XML chunks" ), FMath::Max( 1, NumChunks ) );
+	}
+
+	// Finishing up (resolving way nodes) is counted as one more pass
+	FScopedStreetMapImportProgress SlowTask( Progress, (float)( XmlDataSize * ( NumPasses + 1 ) ), LOCTEXT( "LoadingXml", "Loading OpenStreetMap XML file" ) );
+
+	auto ReportError = [FeedbackContext]( const FText& ErrorMessage, const int32 ErrorLineNumber )
+	{
+		if( FeedbackContext != nullptr )
+		{
+			FeedbackContext->Logf(
+				ELogVerbosity::Error,
+				TEXT( "Failed to load OpenStreetMap XML file ('%s', Line %i)" ),
+				*ErrorMessage.ToString(),
+				ErrorLineNumber );
+		}
+	};
+
+	auto ParsePass = [XmlData, XmlDataSize, &ReportError, &SlowTask]( IOSMXmlCallback& Callback ) -> bool
+	{
+		int64 LastProgressOffset = 0;
+		auto ReportProgress = [&SlowTask, &LastProgressOffset]( const int64 BytesParsed ) -> bool
+		{
+			SlowTask.EnterProgressFrame( (float)( BytesParsed - LastProgressOffset ) );
+			LastProgressOffset = BytesParsed;
+			return !SlowTask.ShouldCancel();
+		};
+
+		FText ErrorMessage;
+		int32 ErrorLineNumber;
+		FOSMXmlScanner Scanner( XmlData, XmlDataSize );
+		if( Scanner.Parse( Callback, ReportProgress, /* Out */ ErrorMessage, /* Out */ ErrorLineNumber ) )
+		{
+			return true;
+		}
+
+		ReportError( ErrorMessage, ErrorLineNumber );
+		return false;
+	};
+
+	// Parses all chunks into fragments, and merges the fragments back in file order.  Chunks are parsed in batches,
+	// so that we never hold more than a few fragments in memory while still keeping all worker threads busy.
+	auto ParseChunksPass = [this, XmlData, NumChunks, &ChunkOffsets, &ReportError, &SlowTask]( const bool bCollectReferences ) -> bool
+	{
+		const int32 BatchSize = FMath::Max( 1, FTaskGraphInterface::Get().GetNumWorkerThreads() ) * 2;
+
+		for( int32 FirstChunkIndex = 0; FirstChunkIndex < NumChunks; FirstChunkIndex += BatchSize )
+		{
+			const int32 NumChunksInBatch = FMath::Min( BatchSize, NumChunks - FirstChunkIndex );
+
+			TArray<TUniquePtr<FOSMFile>> Fragments;
+			TArray<FText> ErrorMessages;
+			TArray<int32> ErrorLineNumbers;
+			Fragments.SetNum( NumChunksInBatch );
+			ErrorMessages.SetNum( NumChunksInBatch );
+			ErrorLineNumbers.SetNumZeroed( NumChunksInBatch );
+
+			ParallelFor( NumChunksInBatch, [this, XmlData, FirstChunkIndex, bCollectReferences, &ChunkOffsets, &Fragments, &ErrorMessages, &ErrorLineNumbers]( int32 BatchIndex )
+			{
+				const int32 ChunkIndex = FirstChunkIndex + BatchIndex;
+				FOSMXmlScanner Scanner( XmlData + ChunkOffsets[ ChunkIndex ], ChunkOffsets[ ChunkIndex + 1 ] - ChunkOffsets[ ChunkIndex ] );
+
+				// Progress is reported once the whole batch is merged
+				auto IgnoreProgress = []( const int64 BytesParsed ) -> bool { return true; };
+
+				FOSMFile* Fragment = new FOSMFile();
+				Fragments[ BatchIndex ].Reset( Fragment );
+				Fragment->ParentFile = this;
+				if( bCollectReferences )
+				{
+					Fragment->WayFilter = WayFilter;
+					Fragment->ReferencedIds.Reset( new FReferencedIds() );
+
+					FOSMXmlReferenceCollector Collector( *Fragment );
+					Scanner.Parse( Collector, IgnoreProgress, /* Out */ ErrorMessages[ BatchIndex ], /* Out */ ErrorLineNumbers[ BatchIndex ] );
+				}
+				else
+				{
+					Scanner.Parse( *Fragment, IgnoreProgress, /* Out */ ErrorMessages[ BatchIndex ], /* Out */ ErrorLineNumbers[ BatchIndex ] );
+				}
+			} );
+
+			// All fragments of the batch are alive right now, so this is where memory usage peaks
+			if( Profile != nullptr )
+			{
+				Profile->SampleMemory();
+			}
+
+			for( int32 BatchIndex = 0; BatchIndex < NumChunksInBatch; ++BatchIndex )
+			{
+				if( !ErrorMessages[ BatchIndex ].IsEmpty() )
+				{
+					// The scanner counts lines from the start of its chunk
+					const ANSICHAR* ChunkStart = XmlData + ChunkOffsets[ FirstChunkIndex + BatchIndex ];
+					int32 ErrorLineNumber = ErrorLineNumbers[ BatchIndex ];
+					for( const ANSICHAR* Position = XmlData; Position < ChunkStart; ++Position )
+					{
+						ErrorLineNumber += ( *Position == '\n' ) ? 1 : 0;
+					}
+
+					ReportError( ErrorMessages[ BatchIndex ], ErrorLineNumber );
+					return false;
+				}
+
+				if( bCollectReferences )
+				{
+					MergeReferencedIds( *Fragments[ BatchIndex ]->ReferencedIds );
+				}
+				else
+				{
+					MergeFragment( *Fragments[ BatchIndex ] );
+				}
+
+				// Free the fragment's memory as soon as possible
+				Fragments[ BatchIndex ].Reset();
+			}
+
+			const int32 EndChunkIndex = FirstChunkIndex + NumChunksInBatch;
+			SlowTask.EnterProgressFrame( (float)( ChunkOffsets[ EndChunkIndex ] - ChunkOffsets[ FirstChunkIndex ] ) );
+			if( SlowTask.ShouldCancel() )
+			{
+				ReportError( LOCTEXT( "XmlCanceled", "Canceled by user" ), 0 );
+				return false;
+			}
+		}
+
+		return true;
+	};
+
+	// Files that fit into a single chunk aren't worth the trouble
+	const bool bParseChunks = NumChunks > 1;
+
+	if( WayFilter )
+	{
+		FScopedStreetMapImportPhase Phase( Profile, TEXT( "Collect references" ) );
+
+		ReferencedIds.Reset( new FReferencedIds() );
+
+		auto CollectPass = [this, bParseChunks, &ParsePass, &ParseChunksPass]() -> bool
+		{
+			if( bParseChunks )
+			{
+				return ParseChunksPass( true );
+			}
+
+			FOSMXmlReferenceCollector Collector( *this );
+			return ParsePass( Collector );
+		};
+
+		if( !CollectPass() )
+		{
+			return false;
+		}
+
+		if( FinishCollectingReferences() )
+		{
+			if( !CollectPass() )
+			{
+				return false;
+			}
+			FinishCollectingReferences();
+		}
+		else
+		{
+			SlowTask.EnterProgressFrame( (float)XmlDataSize );
+		}
+	}
+
+	{
+		FScopedStreetMapImportPhase Phase( Profile, TEXT( "Parse" ) );
+		if( !( bParseChunks ? ParseChunksPass( false ) : ParsePass( *this ) ) )
+		{
+			return false;
+		}
+	}
+
+	SlowTask.EnterProgressFrame( (float)XmlDataSize );
+	if( !FinishLoading() )
+	{
+		ReportError( LOCTEXT( "XmlCanceled", "Canceled by user" ), 0 );
+		return false;
+	}
+
+	if( bParseChunks && CVarVerifyParallelXmlParsing.GetValueOnAnyThread() != 0 )
+	{
+		FScopedStreetMapImportPhase Phase( Profile, TEXT( "Verify parallel parsing" ) );
+		FOSMFile SequentialFile;
+		SequentialFile.CopyParseSettings( *this );
+		SequentialFile.SetParallelParsing( false );
+		if( SequentialFile.LoadOpenStreetMapXml( XmlData, XmlDataSize, FeedbackContext ) )
+		{
+			ensureMsgf( IsIdenticalTo( SequentialFile ), TEXT( "Parsing OpenStreetMap XML in parallel gave different results than parsing it sequentially" ) );
+		}
+	}
+
+	return true;
+}
+
+
+bool FOSMFile::LoadXmlInPasses( TFunctionRef<bool( IOSMXmlCallback& )> ScanPass )
+{
+	// Every pass is one frame, and finishing up is another.  Collecting references may take a second look at the ways,
+	// for the nodes of multipolygon members.
+	FScopedStreetMapImportProgress PassProgress( Progress, WayFilter ? 4.0f : 2.0f, FText() );
+
+	if( WayFilter )
+	{
+		PassProgress.EnterProgressFrame();
+		FScopedStreetMapImportPhase Phase( Profile, TEXT( "Collect references" ) );
+
+		ReferencedIds.Reset( new FReferencedIds() );
+
+		FOSMXmlReferenceCollector Collector( *this );
+		if( !ScanPass( Collector ) )
+		{
+			return false;
+		}
+
+		PassProgress.EnterProgressFrame();
+		if( FinishCollectingReferences() )
+		{
+			FOSMXmlReferenceCollector MemberCollector( *this );
+			if( !ScanPass( MemberCollector ) )
+			{
+				return false;
+			}
+			FinishCollectingReferences();
+		}
+	}
+
+	{
+		PassProgress.EnterProgressFrame();
+		FScopedStreetMapImportPhase Phase( Profile, TEXT( "Parse" ) );
+		if( !ScanPass( *this ) )
+		{
+			return false;
+		}
+	}
+
+	PassProgress.EnterProgressFrame();
+	return FinishLoading();
+}
+
+
+void FOSMFile::SetWayFilter( FWayFilter InWayFilter )
+{
+	WayFilter = MoveTemp( InWayFilter );
+}
+
+
+/** Sorts a list of IDs and removes duplicates, so that it can be searched with ContainsId */
+static void SortUniqueIds( TArray<int64>& Ids )
+{
+	Ids.Sort();
+	int32 NumUniqueIds = 0;
+	for( int32 Index = 0; Index < Ids.Num(); ++Index )
+	{
+		if( NumUniqueIds == 0 || Ids[ Index ] != Ids[ NumUniqueIds - 1 ] )
+		{
+			Ids[ NumUniqueIds++ ] = Ids[ Index ];
+		}
+	}
+	Ids.SetNum( NumUniqueIds, true );
+}
+
+
+/** @return True if the ID is in a list sorted by SortUniqueIds */
+static bool ContainsId( const TArray<int64>& SortedIds, const int64 Id )
+{
+	int32 Low = 0;
+	int32 High = SortedIds.Num();
+	while( Low < High )
+	{
+		const int32 Middle = Low + ( High - Low ) / 2;
+		if( SortedIds[ Middle ] < Id )
+		{
+			Low = Middle + 1;
+		}
+		else
+		{
+			High = Middle;
+		}
+	}
+
+	return Low < SortedIds.Num() && SortedIds[ Low ] == Id;
+}
+
+
+void FOSMFile::CollectWayReferences( const int64 WayID, const FOSMWayInfo& WayInfo, const TArray<int64>& NodeRefs )
+{
+	// Chunks parsed in parallel collect into their own IDs, and look things up in their parent file's
+	FReferencedIds& Ids = *ReferencedIds;
+	const FReferencedIds& CollectedIds = *GetReferencedIds();
+	if( CollectedIds.bCollectingMemberNodes )
+	{
+		if( ContainsId( CollectedIds.MissingMemberWays, WayID ) )
+		{
+			Ids.Nodes.Append( NodeRefs );
+		}
+	}
+	else if( WayFilter( WayInfo ) )
+	{
+		Ids.Ways.Add( WayID );
+		Ids.Nodes.Append( NodeRefs );
+	}
+	else
+	{
+		Ids.FilteredWays.Add( WayID );
+		Ids.FilteredNodes.Append( NodeRefs );
+	}
+}
+
+
+void FOSMFile::CollectMultipolygonReferences( const TArray<int64>& MemberWayIDs )
+{
+	if( !GetReferencedIds()->bCollectingMemberNodes )
+	{
+		ReferencedIds->MultipolygonMemberWays.Append( MemberWayIDs );
+	}
+}
+
+
+bool FOSMFile::FinishCollectingReferences()
+{
+	FReferencedIds& Ids = *ReferencedIds;
+
+	if( Ids.bCollectingMemberNodes )
+	{
+		SortUniqueIds( Ids.Nodes );
+		Ids.MissingMemberWays.Empty();
+		Ids.bCollectingMemberNodes = false;
+		return false;
+	}
+
+	SortUniqueIds( Ids.Ways );
+	SortUniqueIds( Ids.FilteredWays );
+	SortUniqueIds( Ids.MultipolygonMemberWays );
+
+	// Multipolygons can turn ways we don't know into land use areas, so all of their members have to stay
+	for( const int64 WayID : Ids.MultipolygonMemberWays )
+	{
+		if( ContainsId( Ids.FilteredWays, WayID ) && !ContainsId( Ids.Ways, WayID ) )
+		{
+			Ids.MissingMemberWays.Add( WayID );
+		}
+	}
+	Ids.MultipolygonMemberWays.Empty();
+	Ids.FilteredWays.Empty();
+
+	if( Ids.MissingMemberWays.Num() > 0 )
+	{
+		Ids.Ways.Append( Ids.MissingMemberWays );
+		SortUniqueIds( Ids.Ways );
+	}
+
+	// In a single pass import, tagged nodes on ways we throw away are dropped along with those ways.  Remember them so
+	// that we don't mistake them for points of interest.
+	SortUniqueIds( Ids.Nodes );
+	SortUniqueIds( Ids.FilteredNodes );
+
+	Ids.bCollectingMemberNodes = Ids.MissingMemberWays.Num() > 0;
+	return Ids.bCollectingMemberNodes;
+}
+
+
+void FOSMFile::MergeReferencedIds( FReferencedIds& ChunkIds )
+{
+	FReferencedIds& Ids = *ReferencedIds;
+
+	// Everything is keyed by ID, so this gives the same result as collecting the whole file in one go
+	Ids.Nodes.Append( ChunkIds.Nodes );
+	Ids.Ways.Append( ChunkIds.Ways );
+	Ids.FilteredNodes.Append( ChunkIds.FilteredNodes );
+	Ids.FilteredWays.Append( ChunkIds.FilteredWays );
+	Ids.MultipolygonMemberWays.Append( ChunkIds.MultipolygonMemberWays );
+}
+
+
+void FOSMFile::MergeFragment( FOSMFile& Fragment )
+{
+	// The <bounds> element comes before any nodes
+	if( Fragment.bHasFileBounds )
+	{
+		SetFileBounds( Fragment.MinLatitude, Fragment.MinLongitude, Fragment.MaxLatitude, Fragment.MaxLongitude );
+	}
+
+	for( const TPair<int32, int32>& NodeLocation : Fragment.FragmentNodeLocations )
+	{
+		AccumulateNodeLocation( NodeLocation.Key, NodeLocation.Value );
+	}
+
+	if( Fragment.NodeIds.Num() > 0 )
+	{
+		if( !Fragment.bNodeIdsSorted || ( NodeIds.Num() > 0 && Fragment.NodeIds[ 0 ] <= NodeIds.Last() ) )
+		{
+			bNodeIdsSorted = false;
+		}
+
+		NodeIds.Append( Fragment.NodeIds );
+		NodeLatitudes.Append( Fragment.NodeLatitudes );
+		NodeLongitudes.Append( Fragment.NodeLongitudes );
+
+		const int32 FirstTag = NodeTags.Num();
+		NodeTags.Append( Fragment.NodeTags );
+		for( int32 NodeIndex = 1; NodeIndex < Fragment.NodeTagOffsets.Num(); ++NodeIndex )
+		{
+			NodeTagOffsets.Add( FirstTag + Fragment.NodeTagOffsets[ NodeIndex ] );
+		}
+	}
+
+	// Node references are still IDs at this point, so they resolve across chunks once everything is loaded
+	for( int32 WayIndex = 0; WayIndex < Fragment.Ways.Num(); ++WayIndex )
+	{
+		const int32 FirstRef = Fragment.PendingNodeRefOffsets[ WayIndex ];
+		PendingNodeRefs.Append( Fragment.PendingNodeRefs.GetData() + FirstRef, Fragment.PendingNodeRefOffsets[ WayIndex + 1 ] - FirstRef );
+
+		FOSMWayInfo* WayInfo = WayArena.New( MoveTemp( *Fragment.Ways[ WayIndex ] ) );
+		AddWay( WayInfo->Id, WayInfo );
+	}
+
+	for( FOSMRelation* Relation : Fragment.Relations )
+	{
+		Relations.Add( RelationArena.New( MoveTemp( *Relation ) ) );
+	}
+}
+
+
+const FOSMFile::FReferencedIds* FOSMFile::GetReferencedIds() const
+{
+	return ParentFile != nullptr ? ParentFile->ReferencedIds.Get() : ReferencedIds.Get();
+}
+
+
+void FOSMFile::SetImportBounds( const double InMinLatitude, const double InMinLongitude, const double InMaxLatitude, const double InMaxLongitude )
+{
+	ImportArea.Type = EImportAreaType::Box;
+	ImportArea.Box.MinLatitude = InMinLatitude;
+	ImportArea.Box.MinLongitude = InMinLongitude;
+	ImportArea.Box.MaxLatitude = InMaxLatitude;
+	ImportArea.Box.MaxLongitude = InMaxLongitude;
+}
+
+
+void FOSMFile::SetImportRadius( const double CenterLatitude, const double CenterLongitude, const double RadiusMeters )
+{
+	ImportArea.Type = EImportAreaType::Circle;
+	ImportArea.CenterLatitude = CenterLatitude;
+	ImportArea.CenterLongitude = CenterLongitude;
+	ImportArea.RadiusMeters = RadiusMeters;
+
+	// Box around the circle, for quickly rejecting most nodes.  Longitude degrees get shorter towards the poles, so we
+	// size the box for the latitude closest to the pole.
+	const FSpatialReferenceSystem CenterReference( CenterLongitude, CenterLatitude );
+	double LatitudeOffset, LongitudeOffset;
+	CenterReference.ToEPSG4326( FVector2D( 0.0f, (float)-RadiusMeters ), LongitudeOffset, LatitudeOffset );
+	ImportArea.Box.MaxLatitude = FMath::Min( LatitudeOffset, 90.0 );
+	ImportArea.Box.MinLatitude = FMath::Max( 2.0 * CenterLatitude - LatitudeOffset, -90.0 );
+
+	const double PolewardLatitude = FMath::Max( FMath::Abs( ImportArea.Box.MinLatitude ), FMath::Abs( ImportArea.Box.MaxLatitude ) );
+	const FSpatialReferenceSystem PolewardReference( CenterLongitude, PolewardLatitude );
+	PolewardReference.ToEPSG4326( FVector2D( (float)RadiusMeters, 0.0f ), LongitudeOffset, LatitudeOffset );
+	const double LongitudeRadius = ( PolewardLatitude < 90.0 ) ? FMath::Min( LongitudeOffset - CenterLongitude, 180.0 ) : 180.0;
+	ImportArea.Box.MinLongitude = CenterLongitude - LongitudeRadius;
+	ImportArea.Box.MaxLongitude = CenterLongitude + LongitudeRadius;
+}
+
+
+bool FOSMFile::IsInImportArea( const double Latitude, const double Longitude ) const
+{
+	const FImportArea& Area = ( ParentFile != nullptr ) ? ParentFile->ImportArea : ImportArea;
+	if( Area.Type == EImportAreaType::EntireFile )
+	{
+		return true;
+	}
+
+	if( Latitude < Area.Box.MinLatitude || Latitude > Area.Box.MaxLatitude ||
+		Longitude < Area.Box.MinLongitude || Longitude > Area.Box.MaxLongitude )
+	{
+		return false;
+	}
+
+	if( Area.Type == EImportAreaType::Circle )
+	{
+		// Same projection the street map is built with
+		const FSpatialReferenceSystem CenterReference( Area.CenterLongitude, Area.CenterLatitude );
+		const FVector2D Offset = CenterReference.FromEPSG4326( Longitude, Latitude );
+		return Offset.SizeSquared() <= FMath::Square( Area.RadiusMeters );
+	}
+
+	return true;
+}
+
+
+bool FOSMFile::ShouldKeepNode( const int64 NodeID, const bool bHasTags, const int32 Latitude, const int32 Longitude ) const
+{
+	if( !IsInImportArea( CoordinateToDegrees( Latitude ), CoordinateToDegrees( Longitude ) ) )
+	{
+		return false;
+	}
+
+	const FReferencedIds* Ids = GetReferencedIds();
+	if( Ids == nullptr )
+	{
+		return true;
+	}
+
+	if( ContainsId( Ids->Nodes, NodeID ) )
+	{
+		return true;
+	}
+
+	// Points of interest
+	return bHasTags && !ContainsId( Ids->FilteredNodes, NodeID );
+}
+
+
+bool FOSMFile::ShouldKeepWay( const int64 WayID ) const
+{
+	const FReferencedIds* Ids = GetReferencedIds();
+	return Ids == nullptr || ContainsId( Ids->Ways, WayID );
+}
+
+
+void FOSMFile::SetParallelParsing( const bool bInParseInParallel, const int64 InChunkSize )
+{
+	bParseInParallel = bInParseInParallel;
+	ParallelChunkSize = FMath::Max<int64>( InChunkSize, 1 );
+}
+
+
+void FOSMFile::CopyParseSettings( const FOSMFile& Other )
+{
+	WayFilter = Other.WayFilter;
+	ImportArea = Other.ImportArea;
+	bParseInParallel = Other.bParseInParallel;
+	ParallelChunkSize = Other.ParallelChunkSize;
+}
+
+
+void FOSMFile::SetProfile( FStreetMapImportProfile* InProfile )
+{
+	Profile = InProfile;
+}
+
+
+void FOSMFile::SetProgress( FStreetMapImportProgress* InProgress )
+{
+	Progress = InProgress;
+}
+
+
+static bool AreTagsIdentical( TArrayView<const FOSMFile::FOSMTag> A, TArrayView<const FOSMFile::FOSMTag> B )
+{
+	if( A.Num() != B.Num() )
+	{
+		return false;
+	}
+	for( int32 TagIndex = 0; TagIndex < A.Num(); ++TagIndex )
+	{
+		if( A[ TagIndex ].Key != B[ TagIndex ].Key || A[ TagIndex ].Value != B[ TagIndex ].Value )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+static bool AreWaysIdentical( const FOSMFile::FOSMWayInfo& A, const FOSMFile::FOSMWayInfo& B )
+{
+	return 
+		A.Id == B.Id &&
+		A.Name.Equals( B.Name, ESearchCase::CaseSensitive ) &&
+		A.Ref.Equals( B.Ref, ESearchCase::CaseSensitive ) &&
+		A.Nodes == B.Nodes &&
+		A.WayType == B.WayType &&
+		A.Category == B.Category &&
+		A.Height == B.Height &&
+		A.BuildingLevels == B.BuildingLevels &&
+		A.bIsOneWay == B.bIsOneWay;
+}
+
+
+static bool AreRelationsIdentical( const FOSMFile::FOSMRelation& A, const FOSMFile::FOSMRelation& B )
+{
+	if( A.Type != B.Type || A.Members.Num() != B.Members.Num() || !AreTagsIdentical( A.Tags, B.Tags ) )
+	{
+		return false;
+	}
+	for( int32 MemberIndex = 0; MemberIndex < A.Members.Num(); ++MemberIndex )
+	{
+		const FOSMFile::FOSMRelationMember& MemberA = A.Members[ MemberIndex ];
+		const FOSMFile::FOSMRelationMember& MemberB = B.Members[ MemberIndex ];
+		if( MemberA.Type != MemberB.Type || MemberA.Role != MemberB.Role || MemberA.Ref != MemberB.Ref )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+bool FOSMFile::IsIdenticalTo( const FOSMFile& Other ) const
+{
+	// Bounds and averages have to match bit for bit, since the whole map is placed relative to them
+	if( MinLatitude != Other.MinLatitude || MinLongitude != Other.MinLongitude ||
+		MaxLatitude != Other.MaxLatitude || MaxLongitude != Other.MaxLongitude ||
+		AverageLatitude != Other.AverageLatitude || AverageLongitude != Other.AverageLongitude )
+	{
+		return false;
+	}
+
+	if( NodeIds != Other.NodeIds || NodeLatitudes != Other.NodeLatitudes || NodeLongitudes != Other.NodeLongitudes ||
+		NodeTagOffsets != Other.NodeTagOffsets || !AreTagsIdentical( NodeTags, Other.NodeTags ) ||
+		NodeWayRefOffsets != Other.NodeWayRefOffsets || NodeWayRefs.Num() != Other.NodeWayRefs.Num() )
+	{
+		return false;
+	}
+
+	for( int32 WayRefIndex = 0; WayRefIndex < NodeWayRefs.Num(); ++WayRefIndex )
+	{
+		if( NodeWayRefs[ WayRefIndex ].WayIndex != Other.NodeWayRefs[ WayRefIndex ].WayIndex ||
+			NodeWayRefs[ WayRefIndex ].NodeIndex != Other.NodeWayRefs[ WayRefIndex ].NodeIndex )
+		{
+			return false;
+		}
+	}
+
+	if( Ways.Num() != Other.Ways.Num() || WayMap.Num() != Other.WayMap.Num() || Relations.Num() != Other.Relations.Num() )
+	{
+		return false;
+	}
+
+	for( int32 WayIndex = 0; WayIndex < Ways.Num(); ++WayIndex )
+	{
+		if( !AreWaysIdentical( *Ways[ WayIndex ], *Other.Ways[ WayIndex ] ) )
+		{
+			return false;
+		}
+	}
+
+	for( const TPair<int64, FOSMWayInfo*>& Way : WayMap )
+	{
+		FOSMWayInfo* const* OtherWay = Other.WayMap.Find( Way.Key );
+		if( OtherWay == nullptr || !AreWaysIdentical( *Way.Value, **OtherWay ) )
+		{
+			return false;
+		}
+	}
+
+	for( int32 RelationIndex = 0; RelationIndex < Relations.Num(); ++RelationIndex )
+	{
+		if( !AreRelationsIdentical( *Relations[ RelationIndex ], *Other.Relations[ RelationIndex ] ) )
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/**
+ * Writes or reads all elements of an array of plain data in one go.  The parsed data cache never leaves the machine
+ * that wrote it, so we don't have to care about byte order.
+ */
+template<typename ElementType>
+static void SerializeRawArray( FArchive& Ar, TArray<ElementType>& Array )
+{
+	int32 Num = Array.Num();
+	Ar << Num;
+	if( Ar.IsLoading() )
+	{
+		// Don't trust broken data to tell us how much memory to allocate
+		if( Num < 0 || (int64)Num * sizeof( ElementType ) > Ar.TotalSize() - Ar.Tell() )
+		{
+			Ar.SetError();
+			return;
+		}
+		Array.SetNumUninitialized( Num );
+	}
+	Ar.Serialize( Array.GetData(), (int64)Num * sizeof( ElementType ) );
+}
+
+
+bool FOSMFile::SerializeParsedData( FArchive& Ar )
+{
+	Ar << MinLatitude << MinLongitude << MaxLatitude << MaxLongitude;
+	Ar << AverageLatitude << AverageLongitude;
+
+	double OriginLongitude = SpatialReferenceSystem.GetOriginLongitude();
+	double OriginLatitude = SpatialReferenceSystem.GetOriginLatitude();
+	Ar << OriginLongitude << OriginLatitude;
+	if( Ar.IsLoading() )
+	{
+		SpatialReferenceSystem = FSpatialReferenceSystem( OriginLongitude, OriginLatitude );
+	}
+
+	// Names are stored as strings once, and referenced by index everywhere else.  Most tag keys, tag values and
+	// categories repeat a lot, so this saves space as well as time spent looking names up when loading.
+	TArray<FName> Names;
+	TMap<FName, int32> NameIndices;
+	if( Ar.IsSaving() )
+	{
+		auto AddName = [&Names, &NameIndices]( const FName Name )
+		{
+			if( !NameIndices.Contains( Name ) )
+			{
+				NameIndices.Add( Name, Names.Add( Name ) );
+			}
+		};
+		for( const FOSMTag& Tag : NodeTags )
+		{
+			AddName( Tag.Key );
+			AddName( Tag.Value );
+		}
+		for( const FOSMWayInfo* Way : Ways )
+		{
+			AddName( Way->Category );
+		}
+		for( const FOSMRelation* Relation : Relations )
+		{
+			for( const FOSMTag& Tag : Relation->Tags )
+			{
+				AddName( Tag.Key );
+				AddName( Tag.Value );
+			}
+		}
+	}
+
+	int32 NumNames = Names.Num();
+	Ar << NumNames;
+	if( Ar.IsLoading() )
+	{
+		if( NumNames < 0 || NumNames > Ar.TotalSize() - Ar.Tell() )
+		{
+			return false;
+		}
+		Names.SetNum( NumNames );
+	}
+	for( FName& Name : Names )
+	{
+		FString NameString = Ar.IsSaving() ? Name.ToString() : FString();
+		Ar << NameString;
+		if( Ar.IsLoading() )
+		{
+			Name = FName( *NameString );
+		}
+	}
+
+	auto SerializeName = [&Ar, &Names, &NameIndices]( FName& Name )
+	{
+		int32 NameIndex = Ar.IsSaving() ? NameIndices.FindChecked( Name ) : INDEX_NONE;
+		Ar << NameIndex;
+		if( Ar.IsLoading() )
+		{
+			if( Names.IsValidIndex( NameIndex ) )
+			{
+				Name = Names[ NameIndex ];
+			}
+			else
+			{
+				Ar.SetError();
+			}
+		}
+	};
+
+	auto SerializeTags = [&Ar, &SerializeName]( TArray<FOSMTag>& Tags )
+	{
+		int32 NumTags = Tags.Num();
+		Ar << NumTags;
+		if( Ar.IsLoading() )
+		{
+			if( NumTags < 0 || NumTags > Ar.TotalSize() - Ar.Tell() )
+			{
+				Ar.SetError();
+				return;
+			}
+			Tags.SetNum( NumTags );
+		}
+		for( FOSMTag& Tag : Tags )
+		{
+			SerializeName( Tag.Key );
+			SerializeName( Tag.Value );
+		}
+	};
+
+	// The node table.  The reverse index from nodes to ways is cheap to build again, so it isn't stored.
+	SerializeRawArray( Ar, NodeIds );
+	SerializeRawArray( Ar, NodeLatitudes );
+	SerializeRawArray( Ar, NodeLongitudes );
+	SerializeRawArray( Ar, NodeTagOffsets );
+	SerializeTags( NodeTags );
+
+	if( Ar.IsLoading() && ( Ar.IsError() ||
+		NodeLatitudes.Num() != NodeIds.Num() || 
+		NodeLongitudes.Num() != NodeIds.Num() || 
+		NodeTagOffsets.Num() != NodeIds.Num() + 1 || 
+		NodeTagOffsets.Last() != NodeTags.Num() ) )
+	{
+		return false;
+	}
+
+	int32 NumWays = Ways.Num();
+	Ar << NumWays;
+	if( Ar.IsLoading() )
+	{
+		if( NumWays < 0 || NumWays > Ar.TotalSize() - Ar.Tell() )
+		{
+			return false;
+		}
+		Ways.Reserve( NumWays );
+	}
+	for( int32 WayIndex = 0; WayIndex < NumWays && !Ar.IsError(); ++WayIndex )
+	{
+		FOSMWayInfo* Way = Ar.IsSaving() ? Ways[ WayIndex ] : Ways[ Ways.Add( WayArena.New() ) ];
+
+		uint8 WayType = (uint8)Way->WayType;
+		uint8 bIsOneWay = Way->bIsOneWay;
+		Ar << Way->Name << Way->Ref << Way->Id;
+		SerializeRawArray( Ar, Way->Nodes );
+		Ar << WayType;
+		SerializeName( Way->Category );
+		Ar << Way->Height << Way->BuildingLevels << bIsOneWay;
+
+		if( Ar.IsLoading() )
+		{
+			Way->WayType = (EOSMWayType)WayType;
+			Way->bIsOneWay = bIsOneWay != 0;
+			for( const int32 NodeIndex : Way->Nodes )
+			{
+				if( !NodeIds.IsValidIndex( NodeIndex ) )
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	// Several ways can share an ID when they were cut at the edge of the import area.  The way map points at the first
+	// piece, so we store it by index.
+	int32 NumMappedWays = WayMap.Num();
+	Ar << NumMappedWays;
+	if( Ar.IsSaving() )
+	{
+		TMap<const FOSMWayInfo*, int32> WayIndices;
+		WayIndices.Reserve( Ways.Num() );
+		for( int32 WayIndex = 0; WayIndex < Ways.Num(); ++WayIndex )
+		{
+			WayIndices.Add( Ways[ WayIndex ], WayIndex );
+		}
+		for( const TPair<int64, FOSMWayInfo*>& MappedWay : WayMap )
+		{
+			int64 WayId = MappedWay.Key;
+			int32 WayIndex = WayIndices.FindChecked( MappedWay.Value );
+			Ar << WayId << WayIndex;
+		}
+	}
+	else
+	{
+		if( NumMappedWays < 0 || NumMappedWays > Ar.TotalSize() - Ar.Tell() )
+		{
+			return false;
+		}
+		WayMap.Reserve( NumMappedWays );
+		for( int32 MappedWayIndex = 0; MappedWayIndex < NumMappedWays; ++MappedWayIndex )
+		{
+			int64 WayId = 0;
+			int32 WayIndex = INDEX_NONE;
+			Ar << WayId << WayIndex;
+			if( !Ways.IsValidIndex( WayIndex ) )
+			{
+				return false;
+			}
+			WayMap.Add( WayId, Ways[ WayIndex ] );
+		}
+	}
+
+	int32 NumRelations = Relations.Num();
+	Ar << NumRelations;
+	if( Ar.IsLoading() )
+	{
+		if( NumRelations < 0 || NumRelations > Ar.TotalSize() - Ar.Tell() )
+		{
+			return false;
+		}
+		Relations.Reserve( NumRelations );
+	}
+	for( int32 RelationIndex = 0; RelationIndex < NumRelations && !Ar.IsError(); ++RelationIndex )
+	{
+		FOSMRelation* Relation = Ar.IsSaving() ? Relations[ RelationIndex ] : Relations[ Relations.Add( RelationArena.New() ) ];
+
+		uint8 RelationType = (uint8)Relation->Type;
+		Ar << RelationType;
+		Relation->Type = (EOSMRelationType)RelationType;
+
+		int32 NumMembers = Relation->Members.Num();
+		Ar << NumMembers;
+		if( Ar.IsLoading() )
+		{
+			if( NumMembers < 0 || NumMembers > Ar.TotalSize() - Ar.Tell() )
+			{
+				return false;
+			}
+			Relation->Members.SetNum( NumMembers );
+		}
+		for( FOSMRelationMember& Member : Relation->Members )
+		{
+			uint8 MemberType = (uint8)Member.Type;
+			uint8 MemberRole = (uint8)Member.Role;
+			Ar << MemberType << MemberRole << Member.Ref;
+			Member.Type = (EOSMRelationMemberType)MemberType;
+			Member.Role = (EOSMRelationMemberRole)MemberRole;
+		}
+
+		SerializeTags( Relation->Tags );
+	}
+
+	if( Ar.IsError() )
+	{
+		return false;
+	}
+
+	if( Ar.IsLoading() )
+	{
+		BuildNodeWayRefs();
+
+		if( Profile != nullptr )
+		{
+			Profile->SetCounter( TEXT( "OSM nodes" ), GetNumNodes() );
+			Profile->SetCounter( TEXT( "OSM ways" ), Ways.Num() );
+			Profile->SetCounter( TEXT( "OSM relations" ), Relations.Num() );
+		}
+	}
+
+	return true;
+}
+
+
+void FOSMFile::AddNode( const int64 NodeID, const FOSMNodeInfo& NodeInfo )
 {
+	if( NodeIds.Num() > 0 && NodeID <= NodeIds.Last() )
+	{
+		bNodeIdsSorted = false;
+	}
+
+	NodeIds.Add( NodeID );
+	NodeLatitudes.Add( NodeInfo.Latitude );
+	NodeLongitudes.Add( NodeInfo.Longitude );
+	NodeTags.Append( NodeInfo.Tags );
+	NodeTagOffsets.Add( NodeTags.Num() );
 }
-		
 
-FOSMFile::~FOSMFile()
+
+void FOSMFile::AddWay( const int64 WayID, FOSMWayInfo* WayInfo )
 {
-	// Clean up time
+	WayMap.Add( WayID, WayInfo );
+	Ways.Add( WayInfo );
+	PendingNodeRefOffsets.Add( PendingNodeRefs.Num() );
+}
+
+
+int32 FOSMFile::FindNodeIndex( const int64 NodeID ) const
+{
+	int32 Low = 0;
+	int32 High = NodeIds.Num();
+	while( Low < High )
 	{
-		for( auto* Way : Ways )
+		const int32 Middle = Low + ( High - Low ) / 2;
+		if( NodeIds[ Middle ] < NodeID )
 		{
-			delete Way;
+			Low = Middle + 1;
 		}
-		Ways.Empty();
-				
-		for( auto HashPair : NodeMap )
+		else
 		{
-			FOSMNodeInfo* NodeInfo = HashPair.Value;
-			delete NodeInfo;
+			High = Middle;
 		}
-		NodeMap.Empty();
 	}
+
+	return ( Low < NodeIds.Num() && NodeIds[ Low ] == NodeID ) ? Low : INDEX_NONE;
 }
 
 
-bool FOSMFile::LoadOpenStreetMapFile( FString& OSMFilePath, const bool bIsFilePathActuallyTextBuffer, FFeedbackContext* FeedbackContext )
+void FOSMFile::SortNodeTable()
 {
-	const bool bShowSlowTaskDialog = true;
-	const bool bShowCancelButton = true;
+	const int32 NumNodes = NodeIds.Num();
+
+	TArray<int32> SortedOrder;
+	SortedOrder.SetNumUninitialized( NumNodes );
+	for( int32 NodeIndex = 0; NodeIndex < NumNodes; ++NodeIndex )
+	{
+		SortedOrder[ NodeIndex ] = NodeIndex;
+	}
+
+	const TArray<int64>& Ids = NodeIds;
+	SortedOrder.StableSort( [&Ids]( const int32 A, const int32 B ) { return Ids[ A ] < Ids[ B ]; } );
 
-	FText ErrorMessage;
-	int32 ErrorLineNumber;
-	if( FFastXml::ParseXmlFile( 
-		this, 
-		bIsFilePathActuallyTextBuffer ? nullptr : *OSMFilePath, 
-		bIsFilePathActuallyTextBuffer ? OSMFilePath.GetCharArray().GetData() : nullptr, 
-		FeedbackContext, 
-		bShowSlowTaskDialog, 
-		bShowCancelButton, 
-		/* Out */ ErrorMessage, 
-		/* Out */ ErrorLineNumber ) )
+	// If a node is listed more than once, the last one wins
+	TArray<int32> UniqueOrder;
+	UniqueOrder.Reserve( NumNodes );
+	for( const int32 NodeIndex : SortedOrder )
 	{
-		if( NodeMap.Num() > 0 )
+		if( UniqueOrder.Num() > 0 && Ids[ UniqueOrder.Last() ] == Ids[ NodeIndex ] )
+		{
+			UniqueOrder.Last() = NodeIndex;
+		}
+		else
 		{
-			AverageLatitude /= NodeMap.Num();
-			AverageLongitude /= NodeMap.Num();
+			UniqueOrder.Add( NodeIndex );
+		}
+	}
+
+	TArray<int64> SortedIds;
+	TArray<int32> SortedLatitudes;
+	TArray<int32> SortedLongitudes;
+	TArray<FOSMTag> SortedTags;
+	TArray<int32> SortedTagOffsets;
+	SortedIds.Reserve( UniqueOrder.Num() );
+	SortedLatitudes.Reserve( UniqueOrder.Num() );
+	SortedLongitudes.Reserve( UniqueOrder.Num() );
+	SortedTags.Reserve( NodeTags.Num() );
+	SortedTagOffsets.Reserve( UniqueOrder.Num() + 1 );
+	SortedTagOffsets.Add( 0 );
+
+	for( const int32 NodeIndex : UniqueOrder )
+	{
+		SortedIds.Add( NodeIds[ NodeIndex ] );
+		SortedLatitudes.Add( NodeLatitudes[ NodeIndex ] );
+		SortedLongitudes.Add( NodeLongitudes[ NodeIndex ] );
+		SortedTags.Append( GetNodeTags( NodeIndex ).GetData(), GetNodeTags( NodeIndex ).Num() );
+		SortedTagOffsets.Add( SortedTags.Num() );
+	}
+
+	NodeIds = MoveTemp( SortedIds );
+	NodeLatitudes = MoveTemp( SortedLatitudes );
+	NodeLongitudes = MoveTemp( SortedLongitudes );
+	NodeTags = MoveTemp( SortedTags );
+	NodeTagOffsets = MoveTemp( SortedTagOffsets );
+	bNodeIdsSorted = true;
+}
+
+
+bool FOSMFile::ResolveWayNodes()
+{
+	FScopedStreetMapImportProgress ResolveProgress( Progress, 4.0f, FText() );
+
+	ResolveProgress.EnterProgressFrame( 1.0f, LOCTEXT( "SortingNodes", "Sorting nodes" ) );
+	if( !bNodeIdsSorted )
+	{
+		SortNodeTable();
+	}
+
+	ResolveProgress.EnterProgressFrame( 1.0f, LOCTEXT( "ResolvingWayNodes", "Resolving way nodes" ) );
+	if( ResolveProgress.ShouldCancel() )
+	{
+		return false;
+	}
+
+	// When importing only part of the file, ways that leave the import area are cut where their nodes are missing.
+	// For every way, these are the positions in its Nodes array where a new piece starts.  Closed ways are never cut,
+	// because the pieces of a building or an area would be open lines.  Their nodes outside of the area weren't loaded,
+	// so they can't be kept whole either, and are dropped instead.
+	const bool bCutWays = ImportArea.Type != EImportAreaType::EntireFile;
+	TArray<TArray<int32>> WayCuts;
+	if( bCutWays )
+	{
+		WayCuts.SetNum( Ways.Num() );
+	}
 
-			SpatialReferenceSystem = FSpatialReferenceSystem(AverageLongitude, AverageLatitude);
+	// Binary searches are independent for every way
+	ParallelFor( Ways.Num(), [this, bCutWays, &WayCuts]( int32 WayIndex )
+	{
+		FOSMWayInfo& WayInfo = *Ways[ WayIndex ];
+		const int32 FirstRef = PendingNodeRefOffsets[ WayIndex ];
+		const int32 EndRef = PendingNodeRefOffsets[ WayIndex + 1 ];
+
+		const bool bIsClosed = EndRef - FirstRef >= 4 && PendingNodeRefs[ FirstRef ] == PendingNodeRefs[ EndRef - 1 ];
+
+		bool bCutPending = false;
+		WayInfo.Nodes.Reset( EndRef - FirstRef );
+		for( int32 RefIndex = FirstRef; RefIndex < EndRef; ++RefIndex )
+		{
+			const int32 NodeIndex = FindNodeIndex( PendingNodeRefs[ RefIndex ] );
+			if( NodeIndex == INDEX_NONE && bCutWays && bIsClosed )
+			{
+				WayInfo.Nodes.Reset();
+				break;
+			}
+			else if( NodeIndex != INDEX_NONE )
+			{
+				if( bCutPending )
+				{
+					WayCuts[ WayIndex ].Add( WayInfo.Nodes.Num() );
+					bCutPending = false;
+				}
+				WayInfo.Nodes.Add( NodeIndex );
+			}
+			else if( bCutWays && WayInfo.Nodes.Num() > 0 )
+			{
+				bCutPending = true;
+			}
 		}
+	} );
 
-		return true;
+	PendingNodeRefs.Empty();
+	PendingNodeRefOffsets.Empty();
+
+	ResolveProgress.EnterProgressFrame( 1.0f, LOCTEXT( "CuttingWays", "Cutting ways at the edge of the import area" ) );
+	if( ResolveProgress.ShouldCancel() )
+	{
+		return false;
+	}
+
+	if( bCutWays )
+	{
+		// The first piece stays in the original way, so relations and the way map keep pointing at it.  Other pieces
+		// become new ways with the same ID and tags, as long as they're long enough to be drawn.
+		const int32 NumOriginalWays = Ways.Num();
+		for( int32 WayIndex = 0; WayIndex < NumOriginalWays; ++WayIndex )
+		{
+			const TArray<int32>& Cuts = WayCuts[ WayIndex ];
+			if( Cuts.Num() == 0 )
+			{
+				continue;
+			}
+
+			FOSMWayInfo& WayInfo = *Ways[ WayIndex ];
+			for( int32 CutIndex = 0; CutIndex < Cuts.Num(); ++CutIndex )
+			{
+				const int32 PieceStart = Cuts[ CutIndex ];
+				const int32 PieceEnd = ( CutIndex + 1 < Cuts.Num() ) ? Cuts[ CutIndex + 1 ] : WayInfo.Nodes.Num();
+				if( PieceEnd - PieceStart >= 2 )
+				{
+					FOSMWayInfo* Piece = WayArena.New( WayInfo );
+					Piece->Nodes = TArray<int32>( WayInfo.Nodes.GetData() + PieceStart, PieceEnd - PieceStart );
+					Ways.Add( Piece );
+				}
+			}
+			WayInfo.Nodes.SetNum( Cuts[ 0 ] );
+		}
 	}
 
-	if( FeedbackContext != nullptr )
+	ResolveProgress.EnterProgressFrame( 1.0f, LOCTEXT( "LinkingNodes", "Linking nodes to ways" ) );
+	if( ResolveProgress.ShouldCancel() )
 	{
-		FeedbackContext->Logf(
-			ELogVerbosity::Error,
-			TEXT( "Failed to load OpenStreetMap XML file ('%s', Line %i)" ),
-			*ErrorMessage.ToString(),
-			ErrorLineNumber );
+		return false;
 	}
 
-	return false;
+	BuildNodeWayRefs();
+
+	return true;
 }
 
-		
-bool FOSMFile::ProcessXmlDeclaration( const TCHAR* ElementData, int32 XmlFileLineNumber )
+
+void FOSMFile::BuildNodeWayRefs()
 {
-	// Don't care about XML declaration
-	return true;
+	// Build the reverse index in way order, so that every node lists its ways in the order they appear in the file
+	const int32 NumNodes = NodeIds.Num();
+	NodeWayRefOffsets.SetNumZeroed( NumNodes + 1 );
+	for( const FOSMWayInfo* WayInfo : Ways )
+	{
+		for( const int32 NodeIndex : WayInfo->Nodes )
+		{
+			++NodeWayRefOffsets[ NodeIndex + 1 ];
+		}
+	}
+	for( int32 NodeIndex = 0; NodeIndex < NumNodes; ++NodeIndex )
+	{
+		NodeWayRefOffsets[ NodeIndex + 1 ] += NodeWayRefOffsets[ NodeIndex ];
+	}
+
+	TArray<int32> NextWayRef( NodeWayRefOffsets.GetData(), NumNodes );
+	NodeWayRefs.SetNumUninitialized( NodeWayRefOffsets[ NumNodes ] );
+	for( int32 WayIndex = 0; WayIndex < Ways.Num(); ++WayIndex )
+	{
+		const TArray<int32>& WayNodes = Ways[ WayIndex ]->Nodes;
+		for( int32 PointIndex = 0; PointIndex < WayNodes.Num(); ++PointIndex )
+		{
+			FOSMWayRef& WayRef = NodeWayRefs[ NextWayRef[ WayNodes[ PointIndex ] ]++ ];
+			WayRef.WayIndex = WayIndex;
+			WayRef.NodeIndex = PointIndex;
+		}
+	}
+}
+
+
+void FOSMFile::AccumulateNodeLocation( const int32 Latitude, const int32 Longitude )
+{
+	if( ParentFile != nullptr )
+	{
+		// Accumulated by the parent file, in file order
+		FragmentNodeLocations.Add( TPairInitializer<int32, int32>( Latitude, Longitude ) );
+		return;
+	}
+
+	const double LatitudeDegrees = CoordinateToDegrees( Latitude );
+	const double LongitudeDegrees = CoordinateToDegrees( Longitude );
+	if( !IsInImportArea( LatitudeDegrees, LongitudeDegrees ) )
+	{
+		return;
+	}
+
+	++NumAccumulatedNodes;
+	LatitudeSum += Latitude;
+	LongitudeSum += Longitude;
+
+	// Update minimum and maximum latitude/longitude, unless the file told us already
+	if( !bHasFileBounds )
+	{
+		MinLatitude = FMath::Min( MinLatitude, LatitudeDegrees );
+		MaxLatitude = FMath::Max( MaxLatitude, LatitudeDegrees );
+		MinLongitude = FMath::Min( MinLongitude, LongitudeDegrees );
+		MaxLongitude = FMath::Max( MaxLongitude, LongitudeDegrees );
+	}
 }
 
 
-bool FOSMFile::ProcessComment( const TCHAR* Comment )
+void FOSMFile::SetFileBounds( const double InMinLatitude, const double InMinLongitude, const double InMaxLatitude, const double InMaxLongitude )
 {
-	// Don't care about comments
+	MinLatitude = InMinLatitude;
+	MinLongitude = InMinLongitude;
+	MaxLatitude = InMaxLatitude;
+	MaxLongitude = InMaxLongitude;
+	bHasFileBounds = true;
+}
+
+
+bool FOSMFile::FinishLoading()
+{
+	FScopedStreetMapImportPhase Phase( Profile, TEXT( "Finish loading" ) );
+
+	// Only needed while loading
+	ReferencedIds.Reset();
+
+	if( !ResolveWayNodes() )
+	{
+		return false;
+	}
+
+	// Bounds stated by the file cover all of it, not just what we imported
+	if( bHasFileBounds && ImportArea.Type != EImportAreaType::EntireFile )
+	{
+		MinLatitude = FMath::Max( MinLatitude, ImportArea.Box.MinLatitude );
+		MinLongitude = FMath::Max( MinLongitude, ImportArea.Box.MinLongitude );
+		MaxLatitude = FMath::Min( MaxLatitude, ImportArea.Box.MaxLatitude );
+		MaxLongitude = FMath::Min( MaxLongitude, ImportArea.Box.MaxLongitude );
+	}
+
+	if( NumAccumulatedNodes > 0 )
+	{
+		AverageLatitude = (double)LatitudeSum / NumAccumulatedNodes / 10000000.0;
+		AverageLongitude = (double)LongitudeSum / NumAccumulatedNodes / 10000000.0;
+
+		SpatialReferenceSystem = FSpatialReferenceSystem(AverageLongitude, AverageLatitude);
+	}
+
+	if( Profile != nullptr )
+	{
+		Profile->SetCounter( TEXT( "OSM nodes" ), GetNumNodes() );
+		Profile->SetCounter( TEXT( "OSM ways" ), Ways.Num() );
+		Profile->SetCounter( TEXT( "OSM relations" ), Relations.Num() );
+	}
+
 	return true;
 }
-	
-	
-bool FOSMFile::ProcessElement( const TCHAR* ElementName, const TCHAR* ElementData, int32 XmlFileLineNumber )
+
+
+void FOSMFile::ApplyWayTag( FOSMWayInfo& WayInfo, const FOSMStringView& Key, const FOSMStringView& Value )
+{
+	const EOSMKeyword TagKey = FindOSMKeyword( Key );
+
+	if( TagKey == EOSMKeyword::Name )
+	{
+		WayInfo.Name = Value.ToString();
+	}
+	else if( TagKey == EOSMKeyword::Ref )
+	{
+		WayInfo.Ref = Value.ToString();
+	}
+	else if( TagKey == EOSMKeyword::Highway )
+	{
+		WayInfo.WayType = EOSMWayType::Highway;
+		WayInfo.Category = Value.ToName();
+	}
+	else if (TagKey == EOSMKeyword::Railway)
+	{
+		WayInfo.WayType = EOSMWayType::Railway;
+		WayInfo.Category = Value.ToName();
+	}
+	else if( TagKey == EOSMKeyword::Building )
+	{
+		WayInfo.WayType = EOSMWayType::Building;
+
+		if( FindOSMKeyword( Value ) != EOSMKeyword::Yes )
+		{
+			WayInfo.Category = Value.ToName();
+		}
+	}
+	else if( TagKey == EOSMKeyword::Height )
+	{
+		// Check to see if there is a space character in the height value.  For now, we're looking
+		// for straight-up floating point values.
+		if( !Value.Contains( ' ' ) )
+		{
+			// Okay, no space character.  So this has got to be a floating point number.  The OSM
+			// spec says that the height values are in meters.
+			WayInfo.Height = Value.ToDouble();
+		}
+		else
+		{
+			// Looks like the height value contains units of some sort.
+			// @todo: Add support for interpreting unit strings and converting the values
+		}
+	}
+	else if (TagKey == EOSMKeyword::BuildingLevels)
+	{
+		WayInfo.BuildingLevels = Value.ToInt32();
+	}
+	else if( TagKey == EOSMKeyword::Oneway )
+	{
+		if( FindOSMKeyword( Value ) == EOSMKeyword::Yes )
+		{
+			WayInfo.bIsOneWay = true;
+		}
+		else
+		{
+			WayInfo.bIsOneWay = false;
+		}
+	}
+	else if(WayInfo.WayType == EOSMWayType::Other)
+	{
+		// if this way was not already marked as building or highway, try other types as well
+		if (TagKey == EOSMKeyword::Leisure)
+		{
+			WayInfo.WayType = EOSMWayType::Leisure;
+			WayInfo.Category = Value.ToName();
+		}
+		else if (TagKey == EOSMKeyword::Natural)
+		{
+			WayInfo.WayType = EOSMWayType::Natural;
+			WayInfo.Category = Value.ToName();
+		}
+		else if (TagKey == EOSMKeyword::Landuse)
+		{
+			WayInfo.WayType = EOSMWayType::LandUse;
+			WayInfo.Category = Value.ToName();
+		}
+	}
+}
+
+
+void FOSMFile::ApplyRelationTag( FOSMRelation& Relation, const FOSMStringView& Key, const FOSMStringView& Value )
+{
+	const EOSMKeyword TagKey = FindOSMKeyword( Key );
+
+	FOSMTag Tag;
+	Tag.Key = Key.ToName();
+	Tag.Value = Value.ToName();
+	Relation.Tags.Add(Tag);
+
+	if (TagKey == EOSMKeyword::Type)
+	{
+		const EOSMKeyword TagValue = FindOSMKeyword( Value );
+		if (TagValue == EOSMKeyword::Boundary)
+		{
+			Relation.Type = EOSMRelationType::Boundary;
+		}
+		else if (TagValue == EOSMKeyword::Multipolygon)
+		{
+			Relation.Type = EOSMRelationType::Multipolygon;
+		}
+	}
+}
+
+		
+bool FOSMFile::ProcessElement( const FOSMStringView& ElementName )
 {
+	const EOSMKeyword Element = FindOSMKeyword( ElementName );
+
 	if( ParsingState == ParsingState::Root )
 	{
-		if( !FCString::Stricmp( ElementName, TEXT( "node" ) ) )
+		if( Element == EOSMKeyword::Node )
 		{
 			ParsingState = ParsingState::Node;
-			CurrentNodeInfo = new FOSMNodeInfo();
-			CurrentNodeInfo->Latitude = 0.0;
-			CurrentNodeInfo->Longitude = 0.0;
+			CurrentNodeInfo = &ScratchNodeInfo;
+			CurrentNodeInfo->Latitude = 0;
+			CurrentNodeInfo->Longitude = 0;
+			CurrentNodeInfo->Tags.Reset();
 		}
-		else if( !FCString::Stricmp( ElementName, TEXT( "way" ) ) )
+		else if( Element == EOSMKeyword::Way )
 		{
 			ParsingState = ParsingState::Way;
-			CurrentWayInfo = new FOSMWayInfo();
-			CurrentWayInfo->Name.Empty();
-			CurrentWayInfo->Ref.Empty();
-			CurrentWayInfo->WayType = EOSMWayType::Other;
-			CurrentWayInfo->Height = 0.0;
-			CurrentWayInfo->bIsOneWay = false;
+
+			// During the second pass of a two-pass import, we don't know whether we'll keep the way until we've seen its ID
+			CurrentWayInfo = GetReferencedIds() != nullptr ? &DiscardedWayInfo : WayArena.New();
+			ResetWayInfo( *CurrentWayInfo );
 
 			// @todo: We're currently ignoring the "visible" tag on ways, which means that roads will always
 			//        be included in our data set.  It might be nice to make this an import option.
 		}
-		else if (!FCString::Stricmp(ElementName, TEXT("relation")))
+		else if (Element == EOSMKeyword::Relation)
 		{
 			ParsingState = ParsingState::Relation;
-			CurrentRelation = new FOSMRelation();
+			CurrentRelation = RelationArena.New();
 			CurrentRelation->Type = EOSMRelationType::Other;
 		}
+		else if( Element == EOSMKeyword::Bounds )
+		{
+			ParsingState = ParsingState::Bounds;
+			CurrentFileBounds.MinLatitude = CurrentFileBounds.MinLongitude = MAX_dbl;
+			CurrentFileBounds.MaxLatitude = CurrentFileBounds.MaxLongitude = -MAX_dbl;
+		}
 	}
 	else if (ParsingState == ParsingState::Node)
 	{
-		if (!FCString::Stricmp(ElementName, TEXT("tag")))
+		if (Element == EOSMKeyword::Tag)
 		{
 			ParsingState = ParsingState::Node_Tag;
 		}
 	}
 	else if( ParsingState == ParsingState::Way )
 	{
-		if( !FCString::Stricmp( ElementName, TEXT( "nd" ) ) )
+		if( Element == EOSMKeyword::Nd )
 		{
 			ParsingState = ParsingState::Way_NodeRef;
 		}
-		else if( !FCString::Stricmp( ElementName, TEXT( "tag" ) ) )
+		else if( Element == EOSMKeyword::Tag )
 		{
 			ParsingState = ParsingState::Way_Tag;
 		}
 	}
 	else if (ParsingState == ParsingState::Relation)
 	{
-		if (!FCString::Stricmp(ElementName, TEXT("member")))
+		if (Element == EOSMKeyword::Member)
 		{
 			ParsingState = ParsingState::Relation_Member;
-			CurrentRelationMember = new FOSMRelationMember();
-			CurrentRelationMember->Type = EOSMRelationMemberType::Other;
-			CurrentRelationMember->Role = EOSMRelationMemberRole::Other;
+			CurrentRelationMember.Type = EOSMRelationMemberType::Other;
+			CurrentRelationMember.Role = EOSMRelationMemberRole::Other;
+			CurrentRelationMember.Ref = 0;
 		}
-		else if (!FCString::Stricmp(ElementName, TEXT("tag")))
+		else if (Element == EOSMKeyword::Tag)
 		{
 			ParsingState = ParsingState::Relation_Tag;
 		}
@@ -154,241 +1838,141 @@ bool FOSMFile::ProcessElement( const TCHAR* ElementName, const TCHAR* ElementDat
 }
 
 
-bool FOSMFile::ProcessAttribute( const TCHAR* AttributeName, const TCHAR* AttributeValue )
+bool FOSMFile::ProcessAttribute( const FOSMStringView& AttributeName, const FOSMStringView& AttributeValue )
 {
-	if( ParsingState == ParsingState::Node )
+	const EOSMKeyword Attribute = FindOSMKeyword( AttributeName );
+
+	if( ParsingState == ParsingState::Bounds )
 	{
-		if( !FCString::Stricmp( AttributeName, TEXT( "id" ) ) )
+		if( Attribute == EOSMKeyword::MinLat )
 		{
-			CurrentNodeID = FPlatformString::Atoi64( AttributeValue );
+			CurrentFileBounds.MinLatitude = AttributeValue.ToDouble();
 		}
-		else if( !FCString::Stricmp( AttributeName, TEXT( "lat" ) ) )
+		else if( Attribute == EOSMKeyword::MinLon )
 		{
-			CurrentNodeInfo->Latitude = FPlatformString::Atod( AttributeValue );
-
-			AverageLatitude += CurrentNodeInfo->Latitude;
-					
-			// Update minimum and maximum latitude
-			// @todo: Performance: Instead of computing our own bounding box, we could parse the "minlat" and
-			//        "minlon" tags from the OSM file
-			if( CurrentNodeInfo->Latitude < MinLatitude )
-			{
-				MinLatitude = CurrentNodeInfo->Latitude;
-			}
-			if( CurrentNodeInfo->Latitude > MaxLatitude )
-			{
-				MaxLatitude = CurrentNodeInfo->Latitude;
-			}
+			CurrentFileBounds.MinLongitude = AttributeValue.ToDouble();
 		}
-		else if( !FCString::Stricmp( AttributeName, TEXT( "lon" ) ) )
+		else if( Attribute == EOSMKeyword::MaxLat )
 		{
-			CurrentNodeInfo->Longitude = FPlatformString::Atod( AttributeValue );
-
-			AverageLongitude += CurrentNodeInfo->Longitude;
-					
-			// Update minimum and maximum longitude
-			if( CurrentNodeInfo->Longitude < MinLongitude )
-			{
-				MinLongitude = CurrentNodeInfo->Longitude;
-			}
-			if( CurrentNodeInfo->Longitude > MaxLongitude )
-			{
-				MaxLongitude = CurrentNodeInfo->Longitude;
-			}
+			CurrentFileBounds.MaxLatitude = AttributeValue.ToDouble();
+		}
+		else if( Attribute == EOSMKeyword::MaxLon )
+		{
+			CurrentFileBounds.MaxLongitude = AttributeValue.ToDouble();
+		}
+	}
+	else if( ParsingState == ParsingState::Node )
+	{
+		if( Attribute == EOSMKeyword::Id )
+		{
+			CurrentNodeID = AttributeValue.ToInt64();
+		}
+		else if( Attribute == EOSMKeyword::Lat )
+		{
+			CurrentNodeInfo->Latitude = AttributeValue.ToCoordinate();
+		}
+		else if( Attribute == EOSMKeyword::Lon )
+		{
+			CurrentNodeInfo->Longitude = AttributeValue.ToCoordinate();
 		}
 	}
 	else if (ParsingState == ParsingState::Node_Tag)
 	{
-		if (!FCString::Stricmp(AttributeName, TEXT("k")))
+		if (Attribute == EOSMKeyword::K)
 		{
 			CurrentNodeTagKey = AttributeValue;
 		}
-		else if (!FCString::Stricmp(AttributeName, TEXT("v")))
+		else if (Attribute == EOSMKeyword::V)
 		{
 			FOSMTag Tag;
-			Tag.Key = FName::FName(CurrentNodeTagKey);
-			Tag.Value = FName::FName(AttributeValue);
+			Tag.Key = CurrentNodeTagKey.ToName();
+			Tag.Value = AttributeValue.ToName();
 			CurrentNodeInfo->Tags.Add(Tag);
 		}
 	}
 	else if( ParsingState == ParsingState::Way )
 	{
-		if (!FCString::Stricmp(AttributeName, TEXT("id")))
+		if (Attribute == EOSMKeyword::Id)
 		{
-			CurrentWayID = FPlatformString::Atoi64(AttributeValue);
+			CurrentWayID = AttributeValue.ToInt64();
+
+			if( CurrentWayInfo == &DiscardedWayInfo && ShouldKeepWay( CurrentWayID ) )
+			{
+				CurrentWayInfo = WayArena.New();
+				ResetWayInfo( *CurrentWayInfo );
+			}
 		}
 	}
 	else if( ParsingState == ParsingState::Way_NodeRef )
 	{
-		if( !FCString::Stricmp( AttributeName, TEXT( "ref" ) ) )
+		if( Attribute == EOSMKeyword::Ref && CurrentWayInfo != &DiscardedWayInfo )
 		{
-			FOSMNodeInfo* ReferencedNode = NodeMap.FindRef( FPlatformString::Atoi64( AttributeValue ) );
-			if(ReferencedNode)
-			{
-				const int NewNodeIndex = CurrentWayInfo->Nodes.Num();
-				CurrentWayInfo->Nodes.Add( ReferencedNode );
-					
-				// Update the node with information about the way that is referencing it
-				{
-					FOSMWayRef NewWayRef;
-					NewWayRef.Way = CurrentWayInfo;
-					NewWayRef.NodeIndex = NewNodeIndex;
-					ReferencedNode->WayRefs.Add( NewWayRef );
-				}
-			}
+			// Resolved into a node index once all nodes are loaded
+			PendingNodeRefs.Add( AttributeValue.ToInt64() );
 		}
 	}
 	else if( ParsingState == ParsingState::Way_Tag )
 	{
-		if( !FCString::Stricmp( AttributeName, TEXT( "k" ) ) )
+		if( Attribute == EOSMKeyword::K )
 		{
 			CurrentWayTagKey = AttributeValue;
 		}
-		else if( !FCString::Stricmp( AttributeName, TEXT( "v" ) ) )
+		else if( Attribute == EOSMKeyword::V && CurrentWayInfo != &DiscardedWayInfo )
 		{
-			if( !FCString::Stricmp( CurrentWayTagKey, TEXT( "name" ) ) )
-			{
-				CurrentWayInfo->Name = AttributeValue;
-			}
-			else if( !FCString::Stricmp( CurrentWayTagKey, TEXT( "ref" ) ) )
-			{
-				CurrentWayInfo->Ref = AttributeValue;
-			}
-			else if( !FCString::Stricmp( CurrentWayTagKey, TEXT( "highway" ) ) )
-			{
-				CurrentWayInfo->WayType = EOSMWayType::Highway;
-				CurrentWayInfo->Category = AttributeValue;
-			}
-			else if (!FCString::Stricmp(CurrentWayTagKey, TEXT("railway")))
-			{
-				CurrentWayInfo->WayType = EOSMWayType::Railway;
-				CurrentWayInfo->Category = AttributeValue;
-			}
-			else if( !FCString::Stricmp( CurrentWayTagKey, TEXT( "building" ) ) )
-			{
-				CurrentWayInfo->WayType = EOSMWayType::Building;
-
-				if( FCString::Stricmp( AttributeValue, TEXT( "yes" ) ) )
-				{
-					CurrentWayInfo->Category = AttributeValue;
-				}
-			}
-			else if( !FCString::Stricmp( CurrentWayTagKey, TEXT( "height" ) ) )
-			{
-				// Check to see if there is a space character in the height value.  For now, we're looking
-				// for straight-up floating point values.
-				if( !FString( AttributeValue ).Contains( TEXT( " " ) ) )
-				{
-					// Okay, no space character.  So this has got to be a floating point number.  The OSM
-					// spec says that the height values are in meters.
-					CurrentWayInfo->Height = FPlatformString::Atod( AttributeValue );
-				}
-				else
-				{
-					// Looks like the height value contains units of some sort.
-					// @todo: Add support for interpreting unit strings and converting the values
-				}
-			}
-			else if (!FCString::Stricmp(CurrentWayTagKey, TEXT("building:levels")))
-			{
-				CurrentWayInfo->BuildingLevels = FPlatformString::Atoi(AttributeValue);
-			}
-			else if( !FCString::Stricmp( CurrentWayTagKey, TEXT( "oneway" ) ) )
-			{
-				if( !FCString::Stricmp( AttributeValue, TEXT( "yes" ) ) )
-				{
-					CurrentWayInfo->bIsOneWay = true;
-				}
-				else
-				{
-					CurrentWayInfo->bIsOneWay = false;
-				}
-			}
-			else if(CurrentWayInfo->WayType == EOSMWayType::Other)
-			{
-				// if this way was not already marked as building or highway, try other types as well
-				if (!FCString::Stricmp(CurrentWayTagKey, TEXT("leisure")))
-				{
-					CurrentWayInfo->WayType = EOSMWayType::Leisure;
-					CurrentWayInfo->Category = AttributeValue;
-				}
-				else if (!FCString::Stricmp(CurrentWayTagKey, TEXT("natural")))
-				{
-					CurrentWayInfo->WayType = EOSMWayType::Natural;
-					CurrentWayInfo->Category = AttributeValue;
-				}
-				else if (!FCString::Stricmp(CurrentWayTagKey, TEXT("landuse")))
-				{
-					CurrentWayInfo->WayType = EOSMWayType::LandUse;
-					CurrentWayInfo->Category = AttributeValue;
-				}
-			}
+			ApplyWayTag( *CurrentWayInfo, CurrentWayTagKey, AttributeValue );
 		}
 	}
 	else if (ParsingState == ParsingState::Relation)
  	{
-		if (!FCString::Stricmp(AttributeName, TEXT("id")))
+		if (Attribute == EOSMKeyword::Id)
 		{
-			CurrentRelationID = FPlatformString::Atoi64(AttributeValue);
+			CurrentRelationID = AttributeValue.ToInt64();
 		}
 	}
 	else if (ParsingState == ParsingState::Relation_Member)
 	{
-		if (!FCString::Stricmp(AttributeName, TEXT("type")))
+		if (Attribute == EOSMKeyword::Type)
 		{
-			if (!FCString::Stricmp(AttributeValue, TEXT("node")))
+			const EOSMKeyword MemberType = FindOSMKeyword( AttributeValue );
+			if (MemberType == EOSMKeyword::Node)
 			{
-				CurrentRelationMember->Type = EOSMRelationMemberType::Node;
+				CurrentRelationMember.Type = EOSMRelationMemberType::Node;
 			}
-			else if (!FCString::Stricmp(AttributeValue, TEXT("way")))
+			else if (MemberType == EOSMKeyword::Way)
 			{
-				CurrentRelationMember->Type = EOSMRelationMemberType::Way;
+				CurrentRelationMember.Type = EOSMRelationMemberType::Way;
 			}
-			else if (!FCString::Stricmp(AttributeValue, TEXT("relation")))
+			else if (MemberType == EOSMKeyword::Relation)
 			{
-				CurrentRelationMember->Type = EOSMRelationMemberType::Relation;
+				CurrentRelationMember.Type = EOSMRelationMemberType::Relation;
 			}
 		}
-		else if (!FCString::Stricmp(AttributeName, TEXT("ref")))
+		else if (Attribute == EOSMKeyword::Ref)
 		{
-			CurrentRelationMember->Ref = FPlatformString::Atoi64(AttributeValue); // TODO: decide if int64 or FString is better
+			CurrentRelationMember.Ref = AttributeValue.ToInt64(); // TODO: decide if int64 or FString is better
 		}
-		else if (!FCString::Stricmp(AttributeName, TEXT("role")))
+		else if (Attribute == EOSMKeyword::Role)
 		{
-			if (!FCString::Stricmp(AttributeValue, TEXT("outer")))
+			const EOSMKeyword MemberRole = FindOSMKeyword( AttributeValue );
+			if (MemberRole == EOSMKeyword::Outer)
 			{
-				CurrentRelationMember->Role = EOSMRelationMemberRole::Outer;
+				CurrentRelationMember.Role = EOSMRelationMemberRole::Outer;
 			}
-			else if (!FCString::Stricmp(AttributeValue, TEXT("inner")))
+			else if (MemberRole == EOSMKeyword::Inner)
 			{
-				CurrentRelationMember->Role = EOSMRelationMemberRole::Inner;
+				CurrentRelationMember.Role = EOSMRelationMemberRole::Inner;
 			}
 		}
 	}
 	else if (ParsingState == ParsingState::Relation_Tag)
 	{
-		if (!FCString::Stricmp(AttributeName, TEXT("k")))
+		if (Attribute == EOSMKeyword::K)
 		{
 			CurrentRelationTagKey = AttributeValue;
 		}
-		else if (!FCString::Stricmp(AttributeName, TEXT("v")))
+		else if (Attribute == EOSMKeyword::V)
 		{
-			FOSMTag Tag;
-			Tag.Key = FName::FName(CurrentRelationTagKey);
-			Tag.Value = FName::FName(AttributeValue);
-			CurrentRelation->Tags.Add(Tag);
-
-			if (!FCString::Stricmp(CurrentRelationTagKey, TEXT("type")))
-			{
-				if (!FCString::Stricmp(AttributeValue, TEXT("boundary")))
-				{
-					CurrentRelation->Type = EOSMRelationType::Boundary;
-				}
-				else if (!FCString::Stricmp(AttributeValue, TEXT("multipolygon")))
-				{
-					CurrentRelation->Type = EOSMRelationType::Multipolygon;
-				}
-			}
+			ApplyRelationTag(*CurrentRelation, CurrentRelationTagKey, AttributeValue);
 		}
 	}
 
@@ -396,11 +1980,24 @@ bool FOSMFile::ProcessAttribute( const TCHAR* AttributeName, const TCHAR* Attrib
 }
 
 
-bool FOSMFile::ProcessClose( const TCHAR* Element )
+bool FOSMFile::ProcessClose( const FOSMStringView& ElementName )
 {
-	if( ParsingState == ParsingState::Node )
+	if( ParsingState == ParsingState::Bounds )
+	{
+		// Ignore incomplete bounds, we'll compute our own then
+		if( CurrentFileBounds.MinLatitude <= CurrentFileBounds.MaxLatitude && CurrentFileBounds.MinLongitude <= CurrentFileBounds.MaxLongitude )
+		{
+			SetFileBounds( CurrentFileBounds.MinLatitude, CurrentFileBounds.MinLongitude, CurrentFileBounds.MaxLatitude, CurrentFileBounds.MaxLongitude );
+		}
+		ParsingState = ParsingState::Root;
+	}
+	else if( ParsingState == ParsingState::Node )
 	{
-		NodeMap.Add( CurrentNodeID, CurrentNodeInfo );
+		AccumulateNodeLocation( CurrentNodeInfo->Latitude, CurrentNodeInfo->Longitude );
+		if( ShouldKeepNode( CurrentNodeID, CurrentNodeInfo->Tags.Num() > 0, CurrentNodeInfo->Latitude, CurrentNodeInfo->Longitude ) )
+		{
+			AddNode( CurrentNodeID, *CurrentNodeInfo );
+		}
 		CurrentNodeID = 0;
 		CurrentNodeInfo = nullptr;
 				
@@ -408,14 +2005,17 @@ bool FOSMFile::ProcessClose( const TCHAR* Element )
 	}
 	else if (ParsingState == ParsingState::Node_Tag)
 	{
-		CurrentNodeTagKey = TEXT("");
+		CurrentNodeTagKey = FOSMStringView();
 		ParsingState = ParsingState::Node;
 	}
 	else if( ParsingState == ParsingState::Way )
 	{
-		WayMap.Add(CurrentWayID, CurrentWayInfo );
+		if( CurrentWayInfo != &DiscardedWayInfo )
+		{
+			CurrentWayInfo->Id = CurrentWayID;
+			AddWay( CurrentWayID, CurrentWayInfo );
+		}
 		CurrentWayID = 0;
-		Ways.Add( CurrentWayInfo );
 		CurrentWayInfo = nullptr;
 				
 		ParsingState = ParsingState::Root;
@@ -426,12 +2026,13 @@ bool FOSMFile::ProcessClose( const TCHAR* Element )
 	}
 	else if( ParsingState == ParsingState::Way_Tag )
 	{
-		CurrentWayTagKey = TEXT( "" );
+		CurrentWayTagKey = FOSMStringView();
 		ParsingState = ParsingState::Way;
 	}
 	else if (ParsingState == ParsingState::Relation)
 	{
 		Relations.Add( CurrentRelation );
+		CurrentRelation = nullptr;
 		ParsingState = ParsingState::Root;
 	}
 	else if (ParsingState == ParsingState::Relation_Member)
@@ -441,9 +2042,11 @@ bool FOSMFile::ProcessClose( const TCHAR* Element )
 	}
 	else if (ParsingState == ParsingState::Relation_Tag)
 	{
-		CurrentWayTagKey = TEXT("");
+		CurrentRelationTagKey = FOSMStringView();
 		ParsingState = ParsingState::Relation;
 	}
 
 	return true;
 }
+
+#undef LOCTEXT_NAMESPACE
@@ -1,12 +1,17 @@
 // Copyright 2017 Mike Fricker. All Rights Reserved.
 #pragma once
 
-#include "FastXml.h"
+#include "OSMXmlScanner.h"
+#include "OSMArena.h"
+#include "Containers/ArrayView.h"
 #include "GISUtils/SpatialReferenceSystem.h"
 
+class FStreetMapImportProfile;
+class FStreetMapImportProgress;
+
 
 /** OpenStreetMap file loader */
-class FOSMFile : public IFastXmlCallback
+class FOSMFile : public IOSMXmlCallback
 {
 	
 public:
@@ -17,8 +22,17 @@ public:
 	/** Destructor for FOSMFile */
 	virtual ~FOSMFile();
 
-	/** Loads the map from an OpenStreetMap XML file.  Note that in the case of the file path containing the XML data, the string must be mutable for us to parse it quickly. */
-	bool LoadOpenStreetMapFile( FString& OSMFilePath, const bool bIsFilePathActuallyTextBuffer, class FFeedbackContext* FeedbackContext );
+	/** Loads the map from an OpenStreetMap XML file.  The file is memory mapped and parsed in place, so it never has to fit into memory as a whole. */
+	bool LoadOpenStreetMapFile( const FString& OSMFilePath, class FFeedbackContext* FeedbackContext );
+
+	/** Loads the map from OpenStreetMap XML data that is already in memory.  The data must be UTF-8 encoded. */
+	bool LoadOpenStreetMapXml( const ANSICHAR* XmlData, const int64 XmlDataSize, class FFeedbackContext* FeedbackContext );
+
+	/** Loads the map from an OpenStreetMap PBF (protocol buffer binary) file.  Primitive blocks are decoded on worker threads. */
+	bool LoadOpenStreetMapPbfFile( const FString& OSMFilePath, class FFeedbackContext* FeedbackContext );
+
+	/** Loads the map from a gzip or bzip2 compressed OpenStreetMap XML file.  The file is decompressed on another thread while we parse it. */
+	bool LoadOpenStreetMapCompressedFile( const FString& OSMFilePath, class FFeedbackContext* FeedbackContext );
 
 
 	struct FOSMWayInfo;
@@ -96,8 +110,8 @@ public:
 
 	struct FOSMWayRef
 	{
-		// Way that we're referencing at this node
-		FOSMWayInfo* Way;
+		// Index of the way that we're referencing at this node, in the Ways array
+		int32 WayIndex;
 			
 		// Index of the node in the way's array of nodes
 		int32 NodeIndex;
@@ -109,12 +123,12 @@ public:
 		FName Value;
 	};
 
+	/** A node while it is being parsed.  Once complete, it's added to the node table.  Coordinates are fixed point, see CoordinateToDegrees(). */
 	struct FOSMNodeInfo
 	{
-		double Latitude;
-		double Longitude;
+		int32 Latitude;
+		int32 Longitude;
 		TArray<FOSMTag> Tags;
-		TArray<FOSMWayRef> WayRefs;
 	};
 		
 	struct FOSMWayInfo
@@ -123,10 +137,11 @@ public:
 		FString Ref;
 		int64 Id;
 
-		TArray<FOSMNodeInfo*> Nodes;
+		/** Indices of the way's nodes in the node table */
+		TArray<int32> Nodes;
 		EOSMWayType WayType;
-		/** subtype according to WayType */
-		FString Category;
+		/** subtype according to WayType, interned so that classifying it is a single hash lookup */
+		FName Category;
 
 		///
 		/// BUILDING
@@ -151,7 +166,7 @@ public:
 	struct FOSMRelation
 	{
 		EOSMRelationType Type;
-		TArray<FOSMRelationMember*> Members;
+		TArray<FOSMRelationMember> Members;
 		TArray<FOSMTag> Tags;
 	};
 
@@ -172,21 +187,221 @@ public:
 
 	// All relations we've parsed
 	TArray<FOSMRelation*> Relations;
-		
-	// Maps node IDs to info about each node
-	TMap<int64, FOSMNodeInfo*> NodeMap;
 
-	// Maps node IDs to info about each node
+	// Maps way IDs to info about each way
 	TMap<int64, FOSMWayInfo*> WayMap;
 
+	/** @return The number of nodes in the node table */
+	int32 GetNumNodes() const
+	{
+		return NodeIds.Num();
+	}
+
+	/** @return The OpenStreetMap ID of a node in the node table */
+	int64 GetNodeId( const int32 NodeIndex ) const
+	{
+		return NodeIds[ NodeIndex ];
+	}
+
+	double GetNodeLatitude( const int32 NodeIndex ) const
+	{
+		return CoordinateToDegrees( NodeLatitudes[ NodeIndex ] );
+	}
+
+	double GetNodeLongitude( const int32 NodeIndex ) const
+	{
+		return CoordinateToDegrees( NodeLongitudes[ NodeIndex ] );
+	}
+
+	/** Converts a fixed point coordinate, in units of 1e-7 degrees as OpenStreetMap stores them, to degrees */
+	static double CoordinateToDegrees( const int32 Coordinate )
+	{
+		return (double)Coordinate / 10000000.0;
+	}
+
+	/** @return The tags of a node in the node table */
+	TArrayView<const FOSMTag> GetNodeTags( const int32 NodeIndex ) const
+	{
+		const int32 FirstTag = NodeTagOffsets[ NodeIndex ];
+		return TArrayView<const FOSMTag>( NodeTags.GetData() + FirstTag, NodeTagOffsets[ NodeIndex + 1 ] - FirstTag );
+	}
+
+	/** @return All places where ways touch a node in the node table */
+	TArrayView<const FOSMWayRef> GetNodeWayRefs( const int32 NodeIndex ) const
+	{
+		const int32 FirstWayRef = NodeWayRefOffsets[ NodeIndex ];
+		return TArrayView<const FOSMWayRef>( NodeWayRefs.GetData() + FirstWayRef, NodeWayRefOffsets[ NodeIndex + 1 ] - FirstWayRef );
+	}
+
+	/** Looks up a node by its OpenStreetMap ID.  Only valid once loading has finished.  Returns INDEX_NONE if the node wasn't loaded. */
+	int32 FindNodeIndex( const int64 NodeID ) const;
+
+	/** Decides whether a way is going to be used once the file is loaded */
+	typedef TFunction<bool( const FOSMWayInfo& )> FWayFilter;
+
+	/**
+	 * Enables the two-pass import.  The first pass only looks at ways and relations and collects the nodes referenced
+	 * by ways that pass the filter, as well as by the members of multipolygon relations.  The second pass then only
+	 * keeps those ways, their nodes, and any tagged nodes that don't sit on a way we're throwing away.  Must be called
+	 * before loading.
+	 */
+	void SetWayFilter( FWayFilter InWayFilter );
+
+	/**
+	 * Restricts the import to a box.  Nodes outside of the box are dropped while parsing, and ways that leave the box
+	 * are cut into separate pieces wherever they do.  Closed ways that leave the box are dropped instead, so buildings
+	 * and areas never turn into open lines.  The bounds of the map are limited to the box.  Must be called before
+	 * loading.
+	 */
+	void SetImportBounds( const double InMinLatitude, const double InMinLongitude, const double InMaxLatitude, const double InMaxLongitude );
+
+	/** Restricts the import to a circle around a location, with a radius in meters.  Works like SetImportBounds otherwise. */
+	void SetImportRadius( const double CenterLatitude, const double CenterLongitude, const double RadiusMeters );
+
+	/** @return True if the location is inside of the area set up by SetImportBounds or SetImportRadius, or if there is no such area */
+	bool IsInImportArea( const double Latitude, const double Longitude ) const;
+
+	/** @return True if the node should be loaded.  Always true unless this is the second pass of a two-pass import, or the node is outside of the import area. */
+	bool ShouldKeepNode( const int64 NodeID, const bool bHasTags, const int32 Latitude, const int32 Longitude ) const;
+
+	/** @return True if the way should be loaded.  Always true unless this is the second pass of a two-pass import. */
+	bool ShouldKeepWay( const int64 WayID ) const;
+
+	/**
+	 * Enables parsing large XML files in parallel.  The file is split into chunks at top-level <node>, <way> and
+	 * <relation> elements, the chunks are parsed on worker threads, and the results are merged back in file order.  The
+	 * result is identical to parsing the file in one go.  The way filter, if any, must be safe to call from worker
+	 * threads.  Must be called before loading.
+	 *
+	 * @param	bInParseInParallel	True to parse in parallel
+	 * @param	InChunkSize			Roughly how many bytes go into every chunk.  Files that fit into one chunk are parsed sequentially.
+	 */
+	void SetParallelParsing( const bool bInParseInParallel, const int64 InChunkSize = DefaultParallelChunkSize );
+
+	/** Size of the chunks large XML files are split into when parsing in parallel, unless told otherwise */
+	static const int64 DefaultParallelChunkSize = 8 * 1024 * 1024;
+
+	/** Records how long each phase of loading takes, how many elements were loaded and how much memory it needed.  May be null. */
+	void SetProfile( FStreetMapImportProfile* InProfile );
+
+	/** Reports how far loading got, and lets the user cancel it.  May be null, in which case loading can't be canceled. */
+	void SetProgress( FStreetMapImportProgress* InProgress );
+
+	/** @return True if both files hold exactly the same nodes, ways, relations and bounds.  Used to check the parallel parser against the sequential one. */
+	bool IsIdenticalTo( const FOSMFile& Other ) const;
+
+	/** Version of the data written by SerializeParsedData.  Bump this whenever the parser or the parsed data changes, so that cached files are parsed again. */
+	static const uint32 ParsedDataVersion = 2;
+
+	/**
+	 * Writes everything that was loaded to an archive, or reads it back instead of loading a file.  Reading must be
+	 * done on a new FOSMFile, and leaves it in the same state as loading the original file did.  Not portable between
+	 * platforms; meant for caching on the machine that parsed the file.
+	 *
+	 * @return False if the data that was read is broken
+	 */
+	bool SerializeParsedData( FArchive& Ar );
+
+	/** Applies a key/value tag to a way, filling in its type, category, name and other well-known attributes */
+	static void ApplyWayTag( FOSMWayInfo& WayInfo, const FOSMStringView& Key, const FOSMStringView& Value );
+
+	/** Applies a key/value tag to a relation, storing the tag and filling in the relation's type */
+	static void ApplyRelationTag( FOSMRelation& Relation, const FOSMStringView& Key, const FOSMStringView& Value );
+
 protected:
 
-	// IFastXmlCallback overrides
-	virtual bool ProcessXmlDeclaration( const TCHAR* ElementData, int32 XmlFileLineNumber ) override;
-	virtual bool ProcessComment( const TCHAR* Comment ) override;
-	virtual bool ProcessElement( const TCHAR* ElementName, const TCHAR* ElementData, int32 XmlFileLineNumber ) override;
-	virtual bool ProcessAttribute( const TCHAR* AttributeName, const TCHAR* AttributeValue ) override;
-	virtual bool ProcessClose( const TCHAR* Element ) override;
+	/** IDs collected by the first pass of the two-pass import.  Only IDs are kept, never the node references of ways,
+	    which are left to the second pass.  Every list is sorted once collecting is done, so it can be searched. */
+	struct FReferencedIds
+	{
+		FReferencedIds()
+			: bCollectingMemberNodes( false )
+		{
+		}
+
+		/** Nodes used by ways we keep */
+		TArray<int64> Nodes;
+
+		/** Ways we keep */
+		TArray<int64> Ways;
+
+		/** Nodes that sit on ways we throw away.  Tags on these don't turn them into points of interest, unless the
+		    nodes are used by a way we keep as well. */
+		TArray<int64> FilteredNodes;
+
+		/** Ways that didn't pass the filter, until we know whether a relation needs them */
+		TArray<int64> FilteredWays;
+
+		/** Ways that are members of multipolygon relations */
+		TArray<int64> MultipolygonMemberWays;
+
+		/** Multipolygon members that didn't pass the filter.  Their nodes weren't collected the first time around. */
+		TArray<int64> MissingMemberWays;
+
+		/** True while the ways are scanned once more, for the nodes of MissingMemberWays */
+		bool bCollectingMemberNodes;
+	};
+
+	/** First pass: records a way, along with its node references if it passes the filter */
+	void CollectWayReferences( const int64 WayID, const FOSMWayInfo& WayInfo, const TArray<int64>& NodeRefs );
+
+	/** First pass: records the way members of a multipolygon relation, which we have to keep no matter what */
+	void CollectMultipolygonReferences( const TArray<int64>& MemberWayIDs );
+
+	/**
+	 * Called after the first pass.  Resolves relation members and sorts the IDs for searching.  Multipolygon members
+	 * the filter threw away still need their nodes, which we didn't keep track of.
+	 *
+	 * @return	True if the ways have to be scanned once more to collect the nodes of those members, after which this has to be called again
+	 */
+	bool FinishCollectingReferences();
+
+	/** Runs the passes of a sequential XML import: collecting references if there is a way filter, then parsing.  ScanPass scans the whole file once. */
+	bool LoadXmlInPasses( TFunctionRef<bool( IOSMXmlCallback& )> ScanPass );
+
+	/** @return The IDs the second pass of a two-pass import keeps, or null.  Chunks parsed in parallel use their parent file's. */
+	const FReferencedIds* GetReferencedIds() const;
+
+	/** First pass: adds the references collected from one chunk of a file parsed in parallel */
+	void MergeReferencedIds( FReferencedIds& ChunkIds );
+
+	/** Adds everything that was parsed from one chunk of a file parsed in parallel, as if we had parsed it ourselves */
+	void MergeFragment( FOSMFile& Fragment );
+
+	/** Adds a fully parsed node to the node table */
+	void AddNode( const int64 NodeID, const FOSMNodeInfo& NodeInfo );
+
+	/** Adds a fully parsed way.  Its node references must have been added to PendingNodeRefs already. */
+	void AddWay( const int64 WayID, FOSMWayInfo* WayInfo );
+
+	/** Sorts the node table by ID.  Only needed for files that don't list their nodes in order. */
+	void SortNodeTable();
+
+	/** Turns the node references of all ways into node table indices, and builds the reverse index from nodes to ways.  @return False if loading was canceled */
+	bool ResolveWayNodes();
+
+	/** Builds the reverse index from nodes to the ways touching them */
+	void BuildNodeWayRefs();
+
+	/** Accumulates a node's location into the map's bounds and average.  Called for every node in the file, including
+	    the ones the two-pass import drops, so the origin of the map does not depend on the import mode.  Nodes outside
+	    of the import area are ignored. */
+	void AccumulateNodeLocation( const int32 Latitude, const int32 Longitude );
+
+	/** Sets up parsing the way another file is set up: the way filter, the import area and parallel parsing.  Every
+	    setting that must be made before loading belongs in here, so that files parsed to check each other agree. */
+	void CopyParseSettings( const FOSMFile& Other );
+
+	/** Uses the bounds stated by the file, instead of computing them from the nodes */
+	void SetFileBounds( const double InMinLatitude, const double InMinLongitude, const double InMaxLatitude, const double InMaxLongitude );
+
+	/** Called once all nodes, ways and relations were parsed.  Sets up the spatial reference system around the map's center.  @return False if loading was canceled */
+	bool FinishLoading();
+
+	// IOSMXmlCallback overrides
+	virtual bool ProcessElement( const FOSMStringView& ElementName ) override;
+	virtual bool ProcessAttribute( const FOSMStringView& AttributeName, const FOSMStringView& AttributeValue ) override;
+	virtual bool ProcessClose( const FOSMStringView& ElementName ) override;
 
 	
 protected:
@@ -194,6 +409,7 @@ protected:
 	enum class ParsingState
 	{
 		Root,
+		Bounds,
 		Node,
 		Node_Tag,
 		Way,
@@ -225,17 +441,118 @@ protected:
 	// Relation that is currently being parsed
 	FOSMRelation* CurrentRelation;
 
-	// Relation meber that is currently being parsed
-	FOSMRelationMember* CurrentRelationMember;
+	// Relation member that is currently being parsed
+	FOSMRelationMember CurrentRelationMember;
+
+	// Holds the node that is currently being parsed.  Only copied into the node table once we know we'll keep it.
+	FOSMNodeInfo ScratchNodeInfo;
+
+	// Stands in for ways the two-pass import doesn't keep
+	FOSMWayInfo DiscardedWayInfo;
 
 	// Current way's tag key string
-	const TCHAR* CurrentWayTagKey;
+	FOSMStringView CurrentWayTagKey;
 
 	// Current nodes's tag key string
-	const TCHAR* CurrentNodeTagKey;
+	FOSMStringView CurrentNodeTagKey;
 
 	// Current relation's tag key string
-	const TCHAR* CurrentRelationTagKey;
+	FOSMStringView CurrentRelationTagKey;
+
+	// Filter for the two-pass import, if enabled
+	FWayFilter WayFilter;
+
+	/** Shapes of import areas */
+	enum class EImportAreaType
+	{
+		EntireFile,
+		Box,
+		Circle,
+	};
+
+	/** Latitude/longitude box, in degrees */
+	struct FLatLonBox
+	{
+		double MinLatitude;
+		double MinLongitude;
+		double MaxLatitude;
+		double MaxLongitude;
+	};
+
+	/** Part of the file we import.  Circles are also limited to the box around them, which is checked first. */
+	struct FImportArea
+	{
+		EImportAreaType Type;
+		FLatLonBox Box;
+		double CenterLatitude;
+		double CenterLongitude;
+		double RadiusMeters;
+	};
+
+	// Part of the file we import
+	FImportArea ImportArea;
+
+	// Bounds stated by the <bounds> element that is currently being parsed
+	FLatLonBox CurrentFileBounds;
+
+	// True once the file stated its own bounds, which makes computing them from the nodes unnecessary
+	bool bHasFileBounds;
+
+	// IDs we keep during the second pass of a two-pass import.  Null otherwise.
+	TUniquePtr<FReferencedIds> ReferencedIds;
+
+	// Number of nodes accumulated into the average location
+	int64 NumAccumulatedNodes;
+
+	// Sums of the fixed point coordinates of all accumulated nodes.  Integer sums are exact, no matter in which order the nodes come in.
+	int64 LatitudeSum;
+	int64 LongitudeSum;
+
+	// Storage for ways and relations.  Ways, WayMap and Relations point into these.
+	TOSMArena<FOSMWayInfo> WayArena;
+	TOSMArena<FOSMRelation> RelationArena;
+
+	// The node table, one entry per node in each array, sorted by ID.  Coordinates are fixed point, in units of 1e-7 degrees.
+	TArray<int64> NodeIds;
+	TArray<int32> NodeLatitudes;
+	TArray<int32> NodeLongitudes;
+
+	// Tags of all nodes.  The tags of node N are NodeTags[ NodeTagOffsets[ N ] ] up to NodeTags[ NodeTagOffsets[ N + 1 ] ].
+	TArray<FOSMTag> NodeTags;
+	TArray<int32> NodeTagOffsets;
+
+	// Reverse index from nodes to the ways touching them, laid out like the tags.  Built once all ways are loaded.
+	TArray<FOSMWayRef> NodeWayRefs;
+	TArray<int32> NodeWayRefOffsets;
+
+	// Node IDs referenced by each way while loading.  Way N references PendingNodeRefs[ PendingNodeRefOffsets[ N ] ]
+	// up to PendingNodeRefs[ PendingNodeRefOffsets[ N + 1 ] ].  Resolved once all nodes are known.
+	TArray<int64> PendingNodeRefs;
+	TArray<int32> PendingNodeRefOffsets;
+
+	// True as long as nodes were added in ascending ID order, which is the case for almost all files
+	bool bNodeIdsSorted;
+
+	// True if large XML files are split into chunks that are parsed on worker threads
+	bool bParseInParallel;
+
+	// Roughly how many bytes go into every chunk when parsing in parallel
+	int64 ParallelChunkSize;
+
+	// Where the phases of loading are recorded, if anywhere
+	FStreetMapImportProfile* Profile;
+
+	// Where progress of loading is reported, if anywhere
+	FStreetMapImportProgress* Progress;
+
+	// If this holds one chunk of a file that's parsed in parallel, the file it belongs to.  Null otherwise.
+	const FOSMFile* ParentFile;
+
+	// Locations of all nodes in the chunk, in file order.  The parent file accumulates them when merging the chunk, once
+	// it knows the bounds stated by the file.
+	TArray<TPair<int32, int32>> FragmentNodeLocations;
+
+	friend class FOSMXmlReferenceCollector;
 };
 
 
@@ -0,0 +1,191 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapImporting.h"
+#include "OSMFile.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * A small file with elements hidden in a comment and a CDATA section.  Chunks of one byte make every <node>, <way> and
+ * <relation> a place where the file could be split, including the ones that aren't really elements.
+ */
+static const ANSICHAR* ParallelXmlFixture =
+	"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	"<osm version=\"0.6\" generator=\"test\">\n"
+	" <bounds minlat=\"47.0000000\" minlon=\"8.0000000\" maxlat=\"47.0100000\" maxlon=\"8.0100000\"/>\n"
+	" <node id=\"1\" lat=\"47.0010000\" lon=\"8.0010000\"/>\n"
+	" <node id=\"2\" lat=\"47.0020000\" lon=\"8.0020000\">\n"
+	"  <tag k=\"amenity\" v=\"cafe\"/>\n"
+	" </node>\n"
+	" <!-- Deleted in an earlier edit:\n"
+	" <node id=\"100\" lat=\"47.0050000\" lon=\"8.0050000\"/>\n"
+	" <way id=\"101\">\n"
+	"  <nd ref=\"1\"/>\n"
+	"  <nd ref=\"100\"/>\n"
+	"  <tag k=\"highway\" v=\"primary\"/>\n"
+	" </way>\n"
+	" -->\n"
+	" <node id=\"3\" lat=\"47.0030000\" lon=\"8.0030000\"/>\n"
+	" <node id=\"4\" lat=\"47.0040000\" lon=\"8.0010000\"/>\n"
+	" <node id=\"5\" lat=\"47.0040000\" lon=\"8.0040000\">\n"
+	"  <tag k=\"shop\" v=\"bakery\"/>\n"
+	" </node>\n"
+	" <way id=\"10\">\n"
+	"  <nd ref=\"1\"/>\n"
+	"  <nd ref=\"2\"/>\n"
+	"  <nd ref=\"3\"/>\n"
+	"  <tag k=\"highway\" v=\"residential\"/>\n"
+	"  <tag k=\"name\" v=\"Test Street\"/>\n"
+	" </way>\n"
+	" <way id=\"11\">\n"
+	"  <nd ref=\"3\"/>\n"
+	"  <nd ref=\"5\"/>\n"
+	"  <tag k=\"power\" v=\"line\"/>\n"
+	" </way>\n"
+	" <way id=\"12\">\n"
+	"  <nd ref=\"1\"/>\n"
+	"  <nd ref=\"4\"/>\n"
+	"  <nd ref=\"3\"/>\n"
+	"  <nd ref=\"1\"/>\n"
+	" </way>\n"
+	" <![CDATA[\n"
+	" <relation id=\"102\">\n"
+	"  <member type=\"way\" ref=\"11\" role=\"outer\"/>\n"
+	"  <tag k=\"type\" v=\"multipolygon\"/>\n"
+	" </relation>\n"
+	" ]]>\n"
+	" <relation id=\"20\">\n"
+	"  <member type=\"way\" ref=\"12\" role=\"outer\"/>\n"
+	"  <tag k=\"type\" v=\"multipolygon\"/>\n"
+	"  <tag k=\"landuse\" v=\"grass\"/>\n"
+	" </relation>\n"
+	"</osm>\n";
+
+
+/** Parses the fixture sequentially and in parallel, with or without a way filter, and checks the results match */
+static void TestParallelXmlParsing( FAutomationTestBase& Test, const FOSMFile::FWayFilter& WayFilter, const TCHAR* What )
+{
+	const int64 FixtureSize = FCStringAnsi::Strlen( ParallelXmlFixture );
+
+	FOSMFile SequentialFile;
+	FOSMFile ParallelFile;
+	if( WayFilter )
+	{
+		SequentialFile.SetWayFilter( WayFilter );
+		ParallelFile.SetWayFilter( WayFilter );
+	}
+	ParallelFile.SetParallelParsing( true, 1 );
+
+	const bool bSequentialLoaded = SequentialFile.LoadOpenStreetMapXml( ParallelXmlFixture, FixtureSize, nullptr );
+	const bool bParallelLoaded = ParallelFile.LoadOpenStreetMapXml( ParallelXmlFixture, FixtureSize, nullptr );
+	Test.TestTrue( FString::Printf( TEXT( "%s: sequential parsing succeeds" ), What ), bSequentialLoaded );
+	Test.TestTrue( FString::Printf( TEXT( "%s: parallel parsing succeeds" ), What ), bParallelLoaded );
+	if( !bSequentialLoaded || !bParallelLoaded )
+	{
+		return;
+	}
+
+	Test.TestFalse( FString::Printf( TEXT( "%s: way in a comment is skipped" ), What ), ParallelFile.WayMap.Contains( 101 ) );
+	Test.TestEqual( FString::Printf( TEXT( "%s: relation in a CDATA section is skipped" ), What ), ParallelFile.Relations.Num(), 1 );
+	Test.TestTrue( FString::Printf( TEXT( "%s: multipolygon member is kept" ), What ), ParallelFile.WayMap.Contains( 12 ) );
+	Test.TestTrue( FString::Printf( TEXT( "%s: parallel parsing matches sequential parsing" ), What ), ParallelFile.IsIdenticalTo( SequentialFile ) );
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST( FStreetMapParallelXmlParsingTest, "StreetMap.Importing.ParallelXmlParsing", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter )
+
+bool FStreetMapParallelXmlParsingTest::RunTest( const FString& Parameters )
+{
+	TestParallelXmlParsing( *this, FOSMFile::FWayFilter(), TEXT( "Entire file" ) );
+
+	// Two passes, where the multipolygon member doesn't pass the filter and has to be collected separately
+	const FOSMFile::FWayFilter OnlyHighways = []( const FOSMFile::FOSMWayInfo& WayInfo )
+	{
+		return WayInfo.WayType == FOSMFile::EOSMWayType::Highway;
+	};
+	TestParallelXmlParsing( *this, OnlyHighways, TEXT( "Only highways" ) );
+
+	return true;
+}
+
+
+/** Writes down every event the scanner sends, so that two ways of scanning the same data can be compared */
+class FOSMXmlEventRecorder : public IOSMXmlCallback
+{
+
+public:
+
+	TArray<FString> Events;
+
+	// IOSMXmlCallback overrides
+	virtual bool ProcessElement( const FOSMStringView& ElementName ) override
+	{
+		Events.Add( TEXT( "<" ) + ElementName.ToString() );
+		return true;
+	}
+
+	virtual bool ProcessAttribute( const FOSMStringView& AttributeName, const FOSMStringView& AttributeValue ) override
+	{
+		Events.Add( AttributeName.ToString() + TEXT( "=" ) + AttributeValue.ToString() );
+		return true;
+	}
+
+	virtual bool ProcessClose( const FOSMStringView& ElementName ) override
+	{
+		Events.Add( TEXT( "/" ) + ElementName.ToString() );
+		return true;
+	}
+};
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST( FStreetMapStreamedXmlParsingTest, "StreetMap.Importing.StreamedXmlParsing", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter )
+
+bool FStreetMapStreamedXmlParsingTest::RunTest( const FString& Parameters )
+{
+	const int64 FixtureSize = FCStringAnsi::Strlen( ParallelXmlFixture );
+
+	FText ErrorMessage;
+	int32 ErrorLineNumber = 0;
+
+	FOSMXmlEventRecorder ExpectedEvents;
+	FOSMXmlScanner Scanner( ParallelXmlFixture, FixtureSize );
+	if( !Scanner.Parse( ExpectedEvents, []( const int64 BytesParsed ) { return true; }, /* Out */ ErrorMessage, /* Out */ ErrorLineNumber ) )
+	{
+		AddError( FString::Printf( TEXT( "Parsing the fixture in one go fails ('%s', Line %i)" ), *ErrorMessage.ToString(), ErrorLineNumber ) );
+		return false;
+	}
+
+	// Windows of every size up to the whole file end at every start tag at least once, including the ones in the
+	// comment and the CDATA section, which must never be cut off from the end of their section
+	for( int32 WindowSize = 1; WindowSize <= FixtureSize; ++WindowSize )
+	{
+		// A few bytes at a time, like a decompressor that can't keep up
+		int64 ReadOffset = 0;
+		auto Read = [&ReadOffset, FixtureSize]( ANSICHAR* Dest, const int32 DestSize ) -> int32
+		{
+			const int32 BytesRead = (int32)FMath::Min<int64>( FMath::Min( DestSize, 7 ), FixtureSize - ReadOffset );
+			FMemory::Memcpy( Dest, ParallelXmlFixture + ReadOffset, BytesRead );
+			ReadOffset += BytesRead;
+			return BytesRead;
+		};
+
+		FOSMXmlEventRecorder StreamedEvents;
+		int64 StreamedSize = 0;
+		const bool bStreamed = FOSMXmlScanner::ParseStream( Read, StreamedEvents, []() { return true; }, /* Out */ ErrorMessage, /* Out */ ErrorLineNumber, /* Out */ StreamedSize, WindowSize );
+		if( !bStreamed )
+		{
+			AddError( FString::Printf( TEXT( "Streaming with a %i byte window fails ('%s', Line %i)" ), WindowSize, *ErrorMessage.ToString(), ErrorLineNumber ) );
+			return false;
+		}
+		if( StreamedEvents.Events != ExpectedEvents.Events || StreamedSize != FixtureSize )
+		{
+			AddError( FString::Printf( TEXT( "Streaming with a %i byte window gives different results than parsing in one go" ), WindowSize ) );
+			return false;
+		}
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,134 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapImporting.h"
+#include "OSMKeywords.h"
+
+
+/** Confirms that the name actually is the candidate keyword we picked */
+static FORCEINLINE EOSMKeyword MatchOSMKeyword( const FOSMStringView& Name, const ANSICHAR* Literal, const EOSMKeyword Keyword )
+{
+	return Name.Equals( Literal ) ? Keyword : EOSMKeyword::Unknown;
+}
+
+
+EOSMKeyword FindOSMKeyword( const FOSMStringView& Name )
+{
+	if( Name.IsEmpty() )
+	{
+		return EOSMKeyword::Unknown;
+	}
+
+	// NOTE: When adding keywords, make sure that no two of them share a length and first character.  Where they do, we
+	//       look at one more character to tell them apart.
+	const ANSICHAR First = FCharAnsi::ToLower( Name.Data[ 0 ] );
+	switch( Name.Len )
+	{
+		case 1:
+			switch( First )
+			{
+				case 'k': return EOSMKeyword::K;
+				case 'v': return EOSMKeyword::V;
+			}
+			break;
+
+		case 2:
+			switch( First )
+			{
+				case 'i': return MatchOSMKeyword( Name, "id", EOSMKeyword::Id );
+				case 'n': return MatchOSMKeyword( Name, "nd", EOSMKeyword::Nd );
+			}
+			break;
+
+		case 3:
+			switch( First )
+			{
+				case 'w': return MatchOSMKeyword( Name, "way", EOSMKeyword::Way );
+				case 't': return MatchOSMKeyword( Name, "tag", EOSMKeyword::Tag );
+				case 'r': return MatchOSMKeyword( Name, "ref", EOSMKeyword::Ref );
+				case 'y': return MatchOSMKeyword( Name, "yes", EOSMKeyword::Yes );
+				case 'l':
+					return FCharAnsi::ToLower( Name.Data[ 1 ] ) == 'a' ? 
+						MatchOSMKeyword( Name, "lat", EOSMKeyword::Lat ) : 
+						MatchOSMKeyword( Name, "lon", EOSMKeyword::Lon );
+			}
+			break;
+
+		case 4:
+			switch( First )
+			{
+				case 'n':
+					return FCharAnsi::ToLower( Name.Data[ 1 ] ) == 'o' ? 
+						MatchOSMKeyword( Name, "node", EOSMKeyword::Node ) : 
+						MatchOSMKeyword( Name, "name", EOSMKeyword::Name );
+				case 't': return MatchOSMKeyword( Name, "type", EOSMKeyword::Type );
+				case 'r': return MatchOSMKeyword( Name, "role", EOSMKeyword::Role );
+			}
+			break;
+
+		case 5:
+			switch( First )
+			{
+				case 'i': return MatchOSMKeyword( Name, "inner", EOSMKeyword::Inner );
+				case 'o': return MatchOSMKeyword( Name, "outer", EOSMKeyword::Outer );
+			}
+			break;
+
+		case 6:
+			switch( First )
+			{
+				case 'm':
+					switch( FCharAnsi::ToLower( Name.Data[ 1 ] ) )
+					{
+						case 'e': return MatchOSMKeyword( Name, "member", EOSMKeyword::Member );
+						case 'o': return MatchOSMKeyword( Name, "modify", EOSMKeyword::Modify );
+						case 'i':
+							return FCharAnsi::ToLower( Name.Data[ 4 ] ) == 'a' ? 
+								MatchOSMKeyword( Name, "minlat", EOSMKeyword::MinLat ) : 
+								MatchOSMKeyword( Name, "minlon", EOSMKeyword::MinLon );
+						case 'a':
+							return FCharAnsi::ToLower( Name.Data[ 4 ] ) == 'a' ? 
+								MatchOSMKeyword( Name, "maxlat", EOSMKeyword::MaxLat ) : 
+								MatchOSMKeyword( Name, "maxlon", EOSMKeyword::MaxLon );
+					}
+					break;
+				case 'b': return MatchOSMKeyword( Name, "bounds", EOSMKeyword::Bounds );
+				case 'c': return MatchOSMKeyword( Name, "create", EOSMKeyword::Create );
+				case 'd': return MatchOSMKeyword( Name, "delete", EOSMKeyword::Delete );
+				case 'h': return MatchOSMKeyword( Name, "height", EOSMKeyword::Height );
+				case 'o': return MatchOSMKeyword( Name, "oneway", EOSMKeyword::Oneway );
+			}
+			break;
+
+		case 7:
+			switch( First )
+			{
+				case 'h': return MatchOSMKeyword( Name, "highway", EOSMKeyword::Highway );
+				case 'r': return MatchOSMKeyword( Name, "railway", EOSMKeyword::Railway );
+				case 'n': return MatchOSMKeyword( Name, "natural", EOSMKeyword::Natural );
+				case 'l':
+					return FCharAnsi::ToLower( Name.Data[ 1 ] ) == 'e' ? 
+						MatchOSMKeyword( Name, "leisure", EOSMKeyword::Leisure ) : 
+						MatchOSMKeyword( Name, "landuse", EOSMKeyword::Landuse );
+			}
+			break;
+
+		case 8:
+			switch( First )
+			{
+				case 'r': return MatchOSMKeyword( Name, "relation", EOSMKeyword::Relation );
+				case 'b':
+					return FCharAnsi::ToLower( Name.Data[ 1 ] ) == 'u' ? 
+						MatchOSMKeyword( Name, "building", EOSMKeyword::Building ) : 
+						MatchOSMKeyword( Name, "boundary", EOSMKeyword::Boundary );
+			}
+			break;
+
+		case 12:
+			return MatchOSMKeyword( Name, "multipolygon", EOSMKeyword::Multipolygon );
+
+		case 15:
+			return MatchOSMKeyword( Name, "building:levels", EOSMKeyword::BuildingLevels );
+	}
+
+	return EOSMKeyword::Unknown;
+}
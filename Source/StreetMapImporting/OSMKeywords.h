@@ -0,0 +1,66 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+#include "OSMXmlScanner.h"
+
+
+/** Names the OpenStreetMap parsers care about.  Element names, attribute names, tag keys and tag values share one set. */
+enum class EOSMKeyword : uint8
+{
+	/** Anything we don't know about */
+	Unknown,
+
+	// Elements (also used as relation member types)
+	Node,
+	Way,
+	Relation,
+	Nd,
+	Tag,
+	Member,
+	Bounds,
+
+	// Change file (.osc) action blocks
+	Create,
+	Modify,
+	Delete,
+
+	// Attributes
+	Id,
+	Lat,
+	Lon,
+	Ref,
+	K,
+	V,
+	Type,
+	Role,
+	MinLat,
+	MinLon,
+	MaxLat,
+	MaxLon,
+
+	// Tag keys
+	Name,
+	Highway,
+	Railway,
+	Building,
+	BuildingLevels,
+	Height,
+	Oneway,
+	Leisure,
+	Natural,
+	Landuse,
+
+	// Tag and attribute values
+	Yes,
+	Outer,
+	Inner,
+	Boundary,
+	Multipolygon,
+};
+
+
+/**
+ * Maps a name to its keyword, ignoring case.  The length and first character of the name select the only possible
+ * candidate, so it costs a single string comparison at most, instead of one per keyword.
+ */
+EOSMKeyword FindOSMKeyword( const FOSMStringView& Name );
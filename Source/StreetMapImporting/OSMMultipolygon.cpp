@@ -0,0 +1,215 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapImporting.h"
+#include "OSMMultipolygon.h"
+
+
+int32 FOSMMultipolygonAssembler::Assemble( const FOSMFile& OSMFile, const FOSMFile::FOSMRelation& Relation, const TArray<FVector2D>& NodePositions, TArray<FArea>& OutAreas )
+{
+	OuterSegments.Reset();
+	InnerSegments.Reset();
+	OuterRings.Reset();
+	InnerRings.Reset();
+
+	for( const FOSMFile::FOSMRelationMember& Member : Relation.Members )
+	{
+		if( Member.Type != FOSMFile::EOSMRelationMemberType::Way )
+		{
+			continue;
+		}
+
+		// Ways we don't have simply leave a gap, and the ring they were part of won't close
+		const FOSMFile::FOSMWayInfo* Way = OSMFile.WayMap.FindRef( Member.Ref );
+		if( Way == nullptr || Way->Nodes.Num() < 2 )
+		{
+			continue;
+		}
+
+		const bool bIsInner = Member.Role == FOSMFile::EOSMRelationMemberRole::Inner;
+		if( Way->Nodes[ 0 ] == Way->Nodes.Last() )
+		{
+			// Already closed, no need to look for other pieces
+			if( Way->Nodes.Num() >= 4 )
+			{
+				TArray<FRing>& Rings = bIsInner ? InnerRings : OuterRings;
+				FRing& Ring = Rings[ Rings.AddDefaulted() ];
+				Ring.Nodes.Append( Way->Nodes.GetData(), Way->Nodes.Num() - 1 );
+				Ring.WayId = Way->Id;
+				Ring.bIsSingleWay = true;
+			}
+		}
+		else
+		{
+			FSegment Segment;
+			Segment.Way = Way;
+			Segment.bIsUsed = false;
+			( bIsInner ? InnerSegments : OuterSegments ).Add( Segment );
+		}
+	}
+
+	const int32 NumOpenRings = JoinSegments( OuterSegments, OuterRings ) + JoinSegments( InnerSegments, InnerRings );
+
+	// Find the outer ring every hole belongs to.  With a single outer ring (by far the most common case) that's a given,
+	// otherwise it's the smallest outer ring around it, so that holes end up in the right ring when rings are nested.
+	TArray<int32> InnerRingOwners;
+	InnerRingOwners.Init( OuterRings.Num() == 1 ? 0 : INDEX_NONE, InnerRings.Num() );
+	if( OuterRings.Num() > 1 && InnerRings.Num() > 0 )
+	{
+		ComputeRingBounds( OuterRings, NodePositions );
+		for( int32 InnerRingIndex = 0; InnerRingIndex < InnerRings.Num(); ++InnerRingIndex )
+		{
+			// Rings may touch each other at a node, but never share an edge, so the middle of an edge is safe to test
+			const TArray<int32>& InnerNodes = InnerRings[ InnerRingIndex ].Nodes;
+			const FVector2D TestPoint = ( NodePositions[ InnerNodes[ 0 ] ] + NodePositions[ InnerNodes[ 1 ] ] ) * 0.5f;
+
+			float SmallestOwnerArea = MAX_flt;
+			for( int32 OuterRingIndex = 0; OuterRingIndex < OuterRings.Num(); ++OuterRingIndex )
+			{
+				const FRing& OuterRing = OuterRings[ OuterRingIndex ];
+				const FVector2D OuterSize = OuterRing.BoundsMax - OuterRing.BoundsMin;
+				const float OuterArea = OuterSize.X * OuterSize.Y;
+				if( OuterArea < SmallestOwnerArea &&
+					TestPoint.X >= OuterRing.BoundsMin.X && TestPoint.X <= OuterRing.BoundsMax.X &&
+					TestPoint.Y >= OuterRing.BoundsMin.Y && TestPoint.Y <= OuterRing.BoundsMax.Y &&
+					IsPointInRing( TestPoint, OuterRing.Nodes, NodePositions ) )
+				{
+					SmallestOwnerArea = OuterArea;
+					InnerRingOwners[ InnerRingIndex ] = OuterRingIndex;
+				}
+			}
+		}
+	}
+
+	const int32 FirstAreaIndex = OutAreas.Num();
+	for( FRing& OuterRing : OuterRings )
+	{
+		FArea& Area = OutAreas[ OutAreas.AddDefaulted() ];
+		Area.OuterNodes = MoveTemp( OuterRing.Nodes );
+		Area.WayId = OuterRing.WayId;
+		Area.bIsSingleWay = OuterRing.bIsSingleWay;
+	}
+
+	// Holes that aren't inside of any outer ring are broken data, and are left out
+	for( int32 InnerRingIndex = 0; InnerRingIndex < InnerRings.Num(); ++InnerRingIndex )
+	{
+		if( InnerRingOwners[ InnerRingIndex ] != INDEX_NONE )
+		{
+			OutAreas[ FirstAreaIndex + InnerRingOwners[ InnerRingIndex ] ].InnerNodes.Add( MoveTemp( InnerRings[ InnerRingIndex ].Nodes ) );
+		}
+	}
+
+	return NumOpenRings;
+}
+
+
+int32 FOSMMultipolygonAssembler::JoinSegments( TArray<FSegment>& Segments, TArray<FRing>& OutRings )
+{
+	SegmentsByEndNode.Reset();
+	for( int32 SegmentIndex = 0; SegmentIndex < Segments.Num(); ++SegmentIndex )
+	{
+		const TArray<int32>& Nodes = Segments[ SegmentIndex ].Way->Nodes;
+		SegmentsByEndNode.Add( Nodes[ 0 ], SegmentIndex );
+		SegmentsByEndNode.Add( Nodes.Last(), SegmentIndex );
+	}
+
+	int32 NumOpenRings = 0;
+	for( FSegment& FirstSegment : Segments )
+	{
+		if( FirstSegment.bIsUsed )
+		{
+			continue;
+		}
+		FirstSegment.bIsUsed = true;
+
+		FRing Ring;
+		Ring.Nodes = FirstSegment.Way->Nodes;
+		Ring.WayId = FirstSegment.Way->Id;
+		Ring.bIsSingleWay = false;
+
+		// Keep appending whichever unused way starts or ends where the ring currently ends, until we're back at the start.
+		// Every way is appended once, and finding it is a hash lookup, so this is linear in the number of nodes.
+		while( Ring.Nodes.Last() != Ring.Nodes[ 0 ] )
+		{
+			const int32 EndNode = Ring.Nodes.Last();
+
+			const FSegment* NextSegment = nullptr;
+			for( auto It = SegmentsByEndNode.CreateConstKeyIterator( EndNode ); It; ++It )
+			{
+				FSegment& Candidate = Segments[ It.Value() ];
+				if( !Candidate.bIsUsed )
+				{
+					Candidate.bIsUsed = true;
+					NextSegment = &Candidate;
+					break;
+				}
+			}
+
+			if( NextSegment == nullptr )
+			{
+				break;
+			}
+
+			// Ways in a relation don't have to point the same way, so turn the next one around if needed
+			const TArray<int32>& NextNodes = NextSegment->Way->Nodes;
+			if( NextNodes[ 0 ] == EndNode )
+			{
+				Ring.Nodes.Append( NextNodes.GetData() + 1, NextNodes.Num() - 1 );
+			}
+			else
+			{
+				for( int32 NodeIndex = NextNodes.Num() - 2; NodeIndex >= 0; --NodeIndex )
+				{
+					Ring.Nodes.Add( NextNodes[ NodeIndex ] );
+				}
+			}
+		}
+
+		if( Ring.Nodes.Num() >= 4 && Ring.Nodes.Last() == Ring.Nodes[ 0 ] )
+		{
+			// Remove the final redundant node
+			Ring.Nodes.Pop( false );
+			OutRings.Add( MoveTemp( Ring ) );
+		}
+		else
+		{
+			++NumOpenRings;
+		}
+	}
+
+	return NumOpenRings;
+}
+
+
+void FOSMMultipolygonAssembler::ComputeRingBounds( TArray<FRing>& Rings, const TArray<FVector2D>& NodePositions )
+{
+	for( FRing& Ring : Rings )
+	{
+		Ring.BoundsMin = FVector2D( TNumericLimits<float>::Max(), TNumericLimits<float>::Max() );
+		Ring.BoundsMax = FVector2D( TNumericLimits<float>::Lowest(), TNumericLimits<float>::Lowest() );
+		for( const int32 NodeIndex : Ring.Nodes )
+		{
+			const FVector2D& Position = NodePositions[ NodeIndex ];
+			Ring.BoundsMin.X = FMath::Min( Ring.BoundsMin.X, Position.X );
+			Ring.BoundsMin.Y = FMath::Min( Ring.BoundsMin.Y, Position.Y );
+			Ring.BoundsMax.X = FMath::Max( Ring.BoundsMax.X, Position.X );
+			Ring.BoundsMax.Y = FMath::Max( Ring.BoundsMax.Y, Position.Y );
+		}
+	}
+}
+
+
+bool FOSMMultipolygonAssembler::IsPointInRing( const FVector2D& Point, const TArray<int32>& RingNodes, const TArray<FVector2D>& NodePositions )
+{
+	bool bIsInside = false;
+	const FVector2D* Vertex0 = &NodePositions[ RingNodes.Last() ];
+	for( const int32 NodeIndex : RingNodes )
+	{
+		const FVector2D* Vertex1 = &NodePositions[ NodeIndex ];
+		if( ( Vertex0->Y > Point.Y ) != ( Vertex1->Y > Point.Y ) )
+		{
+			bIsInside ^= ( Point.X < ( Vertex1->X - Vertex0->X ) * ( Point.Y - Vertex0->Y ) / ( Vertex1->Y - Vertex0->Y ) + Vertex0->X );
+		}
+		Vertex0 = Vertex1;
+	}
+	return bIsInside;
+}
@@ -0,0 +1,85 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+#include "OSMFile.h"
+
+
+/**
+ * Joins the member ways of multipolygon relations into closed rings, and works out which inner rings are holes of
+ * which outer ring.  Ways are joined by looking up their end nodes in a hash, so big relations (forests, lakes,
+ * country-sized land use areas) made of thousands of pieces are assembled in time linear to their number of nodes.
+ */
+class FOSMMultipolygonAssembler
+{
+
+public:
+
+	/** One area of a multipolygon: an outer ring, and the inner rings that cut holes into it */
+	struct FArea
+	{
+		/** Indices of the outer ring's nodes in the node table.  The first node isn't repeated at the end. */
+		TArray<int32> OuterNodes;
+
+		/** Indices of the nodes of every hole, in the same form as the outer ring */
+		TArray<TArray<int32>> InnerNodes;
+
+		/** ID of the first way of the outer ring */
+		int64 WayId;
+
+		/** True if the outer ring is a single closed way, which may have been imported on its own already */
+		bool bIsSingleWay;
+	};
+
+	/**
+	 * Assembles the areas of a multipolygon relation.  Members without a role are treated as outer members.  Ways
+	 * that are missing from the file (usually because the relation reaches past the edge of an extract) leave rings
+	 * open, and open rings are skipped.
+	 *
+	 * @param	OSMFile			The file the relation was loaded from
+	 * @param	Relation		The multipolygon relation
+	 * @param	NodePositions	Position of every node in the file's node table, for matching holes to outer rings
+	 * @param	OutAreas		Receives the areas of the relation
+	 *
+	 * @return	The number of rings that couldn't be closed
+	 */
+	int32 Assemble( const FOSMFile& OSMFile, const FOSMFile::FOSMRelation& Relation, const TArray<FVector2D>& NodePositions, TArray<FArea>& OutAreas );
+
+protected:
+
+	/** A member way that isn't closed by itself */
+	struct FSegment
+	{
+		const FOSMFile::FOSMWayInfo* Way;
+		bool bIsUsed;
+	};
+
+	/** A closed ring, either a closed member way or joined from segments */
+	struct FRing
+	{
+		TArray<int32> Nodes;
+		int64 WayId;
+		bool bIsSingleWay;
+		FVector2D BoundsMin;
+		FVector2D BoundsMax;
+	};
+
+	/** Joins open ways into rings, reversing them where needed.  @return Number of rings that couldn't be closed */
+	int32 JoinSegments( TArray<FSegment>& Segments, TArray<FRing>& OutRings );
+
+	/** Computes the bounds of every ring */
+	static void ComputeRingBounds( TArray<FRing>& Rings, const TArray<FVector2D>& NodePositions );
+
+	/** @return True if the point is inside of the ring */
+	static bool IsPointInRing( const FVector2D& Point, const TArray<int32>& RingNodes, const TArray<FVector2D>& NodePositions );
+
+	/** Open ways, per role */
+	TArray<FSegment> OuterSegments;
+	TArray<FSegment> InnerSegments;
+
+	/** Assembled rings, per role */
+	TArray<FRing> OuterRings;
+	TArray<FRing> InnerRings;
+
+	/** Maps the end nodes of open ways to the index of the way in the segment list, both ends of every way */
+	TMultiMap<int32, int32> SegmentsByEndNode;
+};
@@ -0,0 +1,980 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapImporting.h"
+#include "OSMFile.h"
+#include "OSMKeywords.h"
+#include "StreetMapImportProfile.h"
+#include "StreetMapImportProgress.h"
+#include "Async/ParallelFor.h"
+
+#define LOCTEXT_NAMESPACE "StreetMapImporting"
+
+// Reference: http://wiki.openstreetmap.org/wiki/PBF_Format
+//
+// A PBF file is a sequence of (4 byte big endian header length, BlobHeader, Blob) records.  The first blob is an
+// "OSMHeader" blob, every following one is an "OSMData" blob holding one zlib compressed PrimitiveBlock.  Each
+// PrimitiveBlock is self-contained (it has its own string table), which lets us decode them independently.
+
+/** Protocol buffer wire types */
+enum class EPbfWireType : uint32
+{
+	Varint = 0,
+	Fixed64 = 1,
+	LengthDelimited = 2,
+	Fixed32 = 5,
+};
+
+/** Maximum sizes allowed by the PBF specification */
+static const int32 PbfMaxBlobHeaderSize = 64 * 1024;
+static const int32 PbfMaxUncompressedBlobSize = 32 * 1024 * 1024;
+
+
+/** Minimal forward-only protocol buffer message reader.  Operates on memory owned by the caller. */
+class FPbfMessage
+{
+
+public:
+
+	FPbfMessage()
+		: Cur( nullptr )
+		, End( nullptr )
+		, FieldNumber( 0 )
+		, WireType( EPbfWireType::Varint )
+		, bIsValid( true )
+	{
+	}
+
+	FPbfMessage( const uint8* Data, const int64 Size )
+		: Cur( Data )
+		, End( Data + Size )
+		, FieldNumber( 0 )
+		, WireType( EPbfWireType::Varint )
+		, bIsValid( true )
+	{
+	}
+
+	/** Advances to the next field.  Returns false at the end of the message or if the data is malformed. */
+	bool Next()
+	{
+		if( !bIsValid || Cur >= End )
+		{
+			return false;
+		}
+
+		const uint64 Key = ReadVarint();
+		FieldNumber = (uint32)( Key >> 3 );
+		WireType = (EPbfWireType)( Key & 0x7 );
+		return bIsValid;
+	}
+
+	uint32 GetFieldNumber() const
+	{
+		return FieldNumber;
+	}
+
+	EPbfWireType GetWireType() const
+	{
+		return WireType;
+	}
+
+	/** @return True if no malformed data was encountered so far */
+	bool IsValid() const
+	{
+		return bIsValid;
+	}
+
+	uint64 ReadVarint()
+	{
+		uint64 Result = 0;
+		for( int32 Shift = 0; Shift < 64; Shift += 7 )
+		{
+			if( Cur >= End )
+			{
+				break;
+			}
+
+			const uint8 Byte = *Cur++;
+			Result |= (uint64)( Byte & 0x7F ) << Shift;
+			if( ( Byte & 0x80 ) == 0 )
+			{
+				return Result;
+			}
+		}
+
+		bIsValid = false;
+		return 0;
+	}
+
+	/** Reads a zigzag encoded signed varint (sint32/sint64) */
+	int64 ReadSignedVarint()
+	{
+		const uint64 Value = ReadVarint();
+		return (int64)( Value >> 1 ) ^ -(int64)( Value & 1 );
+	}
+
+	/** Reads a length delimited field and returns a reader for its contents */
+	FPbfMessage ReadMessage()
+	{
+		const uint64 Length = ReadVarint();
+		if( !bIsValid || Length > (uint64)( End - Cur ) )
+		{
+			bIsValid = false;
+			return FPbfMessage();
+		}
+
+		FPbfMessage SubMessage( Cur, (int64)Length );
+		Cur += Length;
+		return SubMessage;
+	}
+
+	/** Reads a length delimited field as a view of the UTF-8 string inside the message */
+	FOSMStringView ReadStringView()
+	{
+		const FPbfMessage Bytes = ReadMessage();
+		return FOSMStringView( (const ANSICHAR*)Bytes.Cur, (int32)( Bytes.End - Bytes.Cur ) );
+	}
+
+	/** Reads a length delimited field as UTF-8 string */
+	FString ReadString()
+	{
+		return ReadStringView().ToString();
+	}
+
+	/** Reads a repeated varint field.  Handles both packed and (legacy) non-packed encoding. */
+	template< typename ValueType >
+	void ReadPackedVarints( TArray<ValueType>& OutValues, const bool bIsZigZagEncoded )
+	{
+		if( WireType == EPbfWireType::LengthDelimited )
+		{
+			FPbfMessage Packed = ReadMessage();
+			while( Packed.bIsValid && Packed.Cur < Packed.End )
+			{
+				OutValues.Add( (ValueType)( bIsZigZagEncoded ? Packed.ReadSignedVarint() : (int64)Packed.ReadVarint() ) );
+			}
+			bIsValid &= Packed.bIsValid;
+		}
+		else
+		{
+			OutValues.Add( (ValueType)( bIsZigZagEncoded ? ReadSignedVarint() : (int64)ReadVarint() ) );
+		}
+	}
+
+	/** Skips the value of the current field */
+	void Skip()
+	{
+		switch( WireType )
+		{
+			case EPbfWireType::Varint: ReadVarint(); break;
+			case EPbfWireType::Fixed64: Advance( 8 ); break;
+			case EPbfWireType::LengthDelimited: ReadMessage(); break;
+			case EPbfWireType::Fixed32: Advance( 4 ); break;
+			default: bIsValid = false; break;
+		}
+	}
+
+	/** Raw access to the remaining bytes */
+	const uint8* GetData() const
+	{
+		return Cur;
+	}
+
+	int64 GetSize() const
+	{
+		return End - Cur;
+	}
+
+private:
+
+	void Advance( const int64 NumBytes )
+	{
+		if( NumBytes > End - Cur )
+		{
+			bIsValid = false;
+			Cur = End;
+		}
+		else
+		{
+			Cur += NumBytes;
+		}
+	}
+
+	const uint8* Cur;
+	const uint8* End;
+	uint32 FieldNumber;
+	EPbfWireType WireType;
+	bool bIsValid;
+};
+
+
+/** A raw blob as read from the file, before decompression */
+struct FPbfRawBlob
+{
+	TArray<uint8> Data;
+};
+
+
+/**
+ * Result of decoding a single PrimitiveBlock on a worker thread.  Everything is stored by value, so a block takes a
+ * handful of allocations no matter how many entities it has.  Merged into the FOSMFile's arenas on the calling thread.
+ */
+struct FPbfDecodedBlock
+{
+	struct FNode
+	{
+		int64 Id;
+		FOSMFile::FOSMNodeInfo NodeInfo;
+	};
+
+	struct FWay
+	{
+		int64 Id;
+		FOSMFile::FOSMWayInfo WayInfo;
+		TArray<int64> NodeRefs;
+	};
+
+	TArray<FNode> Nodes;
+	TArray<FWay> Ways;
+	TArray<FOSMFile::FOSMRelation> Relations;
+
+	/** Location of every node in the block, including the ones we didn't keep, in file order */
+	TArray<TPair<int32, int32>> NodeLocations;
+
+	/** Set if the block could not be decoded */
+	FString Error;
+};
+
+
+/** Bounding box stated by the OSMHeader block, in degrees */
+struct FPbfHeaderBounds
+{
+	bool bIsValid = false;
+	double MinLatitude = 0.0;
+	double MinLongitude = 0.0;
+	double MaxLatitude = 0.0;
+	double MaxLongitude = 0.0;
+};
+
+
+/** What DecodePrimitiveBlock should keep */
+struct FPbfDecodeOptions
+{
+	/** Skips all nodes.  Used by the first pass of the two-pass import, which only looks at ways and relations. */
+	bool bSkipNodes = false;
+
+	/** The file we're loading into, used to check which nodes and ways to keep.  Only read on worker threads. */
+	const FOSMFile* OSMFile = nullptr;
+
+	/** Where memory usage is sampled while decoding, if anywhere.  Only used on the calling thread. */
+	FStreetMapImportProfile* Profile = nullptr;
+};
+
+
+/** Reads the next BlobHeader/Blob pair from the file.  Returns false at the end of the file or on error. */
+static bool ReadNextBlob( FArchive& Reader, FString& OutBlobType, FPbfRawBlob& OutBlob, FString& OutError )
+{
+	if( Reader.AtEnd() )
+	{
+		return false;
+	}
+
+	// 4 byte network byte order length of the BlobHeader
+	uint8 HeaderSizeBytes[ 4 ];
+	Reader.Serialize( HeaderSizeBytes, 4 );
+	const int32 HeaderSize = ( HeaderSizeBytes[ 0 ] << 24 ) | ( HeaderSizeBytes[ 1 ] << 16 ) | ( HeaderSizeBytes[ 2 ] << 8 ) | HeaderSizeBytes[ 3 ];
+	if( Reader.IsError() || HeaderSize <= 0 || HeaderSize > PbfMaxBlobHeaderSize )
+	{
+		OutError = TEXT( "Invalid BlobHeader size" );
+		return false;
+	}
+
+	TArray<uint8> HeaderBytes;
+	HeaderBytes.AddUninitialized( HeaderSize );
+	Reader.Serialize( HeaderBytes.GetData(), HeaderSize );
+
+	int64 DataSize = -1;
+	FPbfMessage BlobHeader( HeaderBytes.GetData(), HeaderSize );
+	while( BlobHeader.Next() )
+	{
+		switch( BlobHeader.GetFieldNumber() )
+		{
+			case 1: OutBlobType = BlobHeader.ReadString(); break;
+			case 3: DataSize = (int64)BlobHeader.ReadVarint(); break;
+			default: BlobHeader.Skip(); break;
+		}
+	}
+
+	if( Reader.IsError() || !BlobHeader.IsValid() || DataSize < 0 || DataSize > PbfMaxUncompressedBlobSize )
+	{
+		OutError = TEXT( "Invalid BlobHeader" );
+		return false;
+	}
+
+	OutBlob.Data.SetNumUninitialized( (int32)DataSize );
+	Reader.Serialize( OutBlob.Data.GetData(), DataSize );
+	if( Reader.IsError() )
+	{
+		OutError = TEXT( "Unexpected end of file" );
+		return false;
+	}
+
+	return true;
+}
+
+
+/** Extracts the (possibly compressed) payload of a Blob message */
+static bool DecompressBlob( const FPbfRawBlob& Blob, TArray<uint8>& OutData, FString& OutError )
+{
+	const uint8* RawData = nullptr;
+	int64 RawDataSize = 0;
+	const uint8* ZlibData = nullptr;
+	int64 ZlibDataSize = 0;
+	int64 UncompressedSize = -1;
+
+	FPbfMessage Message( Blob.Data.GetData(), Blob.Data.Num() );
+	while( Message.Next() )
+	{
+		switch( Message.GetFieldNumber() )
+		{
+			case 1:
+			{
+				const FPbfMessage Raw = Message.ReadMessage();
+				RawData = Raw.GetData();
+				RawDataSize = Raw.GetSize();
+				break;
+			}
+			case 2: UncompressedSize = (int64)Message.ReadVarint(); break;
+			case 3:
+			{
+				const FPbfMessage Zlib = Message.ReadMessage();
+				ZlibData = Zlib.GetData();
+				ZlibDataSize = Zlib.GetSize();
+				break;
+			}
+			case 4:
+			case 5:
+			case 6:
+				// lzma, (obsolete) bzip2 and lz4 compression are not supported
+				OutError = TEXT( "Unsupported blob compression (only raw and zlib are supported)" );
+				return false;
+			default: Message.Skip(); break;
+		}
+	}
+
+	if( !Message.IsValid() )
+	{
+		OutError = TEXT( "Malformed Blob" );
+		return false;
+	}
+
+	if( RawData != nullptr )
+	{
+		OutData.SetNumUninitialized( (int32)RawDataSize );
+		FMemory::Memcpy( OutData.GetData(), RawData, RawDataSize );
+		return true;
+	}
+
+	if( ZlibData != nullptr && UncompressedSize >= 0 && UncompressedSize <= PbfMaxUncompressedBlobSize )
+	{
+		OutData.SetNumUninitialized( (int32)UncompressedSize );
+		if( FCompression::UncompressMemory( COMPRESS_ZLIB, OutData.GetData(), (int32)UncompressedSize, ZlibData, (int32)ZlibDataSize ) )
+		{
+			return true;
+		}
+	}
+
+	OutError = TEXT( "Failed to decompress blob" );
+	return false;
+}
+
+
+/** Validates the OSMHeader block and reads its bounding box.  We only support the features every PBF writer emits by default. */
+static bool CheckHeaderBlock( const TArray<uint8>& Data, FPbfHeaderBounds& OutBounds, FString& OutError )
+{
+	FPbfMessage HeaderBlock( Data.GetData(), Data.Num() );
+	while( HeaderBlock.Next() )
+	{
+		if( HeaderBlock.GetFieldNumber() == 1 )
+		{
+			// HeaderBBox, in nanodegrees
+			FPbfMessage BBox = HeaderBlock.ReadMessage();
+			while( BBox.Next() )
+			{
+				const double Degrees = (double)BBox.ReadSignedVarint() * 1e-9;
+				switch( BBox.GetFieldNumber() )
+				{
+					case 1: OutBounds.MinLongitude = Degrees; break;
+					case 2: OutBounds.MaxLongitude = Degrees; break;
+					case 3: OutBounds.MaxLatitude = Degrees; break;
+					case 4: OutBounds.MinLatitude = Degrees; break;
+				}
+			}
+			OutBounds.bIsValid = BBox.IsValid() && OutBounds.MinLatitude <= OutBounds.MaxLatitude && OutBounds.MinLongitude <= OutBounds.MaxLongitude;
+		}
+		else if( HeaderBlock.GetFieldNumber() == 4 )
+		{
+			const FString RequiredFeature = HeaderBlock.ReadString();
+			if( RequiredFeature != TEXT( "OsmSchema-V0.6" ) && RequiredFeature != TEXT( "DenseNodes" ) )
+			{
+				OutError = FString::Printf( TEXT( "Unsupported required feature '%s'" ), *RequiredFeature );
+				return false;
+			}
+		}
+		else
+		{
+			HeaderBlock.Skip();
+		}
+	}
+
+	return HeaderBlock.IsValid();
+}
+
+
+/** Decodes a single PrimitiveBlock.  This runs on worker threads, so it must not touch the FOSMFile. */
+static void DecodePrimitiveBlock( const TArray<uint8>& Data, const FPbfDecodeOptions& Options, FPbfDecodedBlock& Out )
+{
+	// Strings are views into the decompressed block, so nothing is copied or widened until we actually keep a value
+	TArray<FOSMStringView> StringTable;
+	TArray<FPbfMessage> Groups;
+	int64 Granularity = 100;
+	int64 LatOffset = 0;
+	int64 LonOffset = 0;
+
+	FPbfMessage Block( Data.GetData(), Data.Num() );
+	while( Block.Next() )
+	{
+		switch( Block.GetFieldNumber() )
+		{
+			case 1:
+			{
+				FPbfMessage Table = Block.ReadMessage();
+				while( Table.Next() )
+				{
+					if( Table.GetFieldNumber() == 1 )
+					{
+						StringTable.Add( Table.ReadStringView() );
+					}
+					else
+					{
+						Table.Skip();
+					}
+				}
+				break;
+			}
+			case 2: Groups.Add( Block.ReadMessage() ); break;
+			case 17: Granularity = (int64)Block.ReadVarint(); break;
+			case 19: LatOffset = (int64)Block.ReadVarint(); break;
+			case 20: LonOffset = (int64)Block.ReadVarint(); break;
+			default: Block.Skip(); break;
+		}
+	}
+
+	if( !Block.IsValid() )
+	{
+		Out.Error = TEXT( "Malformed PrimitiveBlock" );
+		return;
+	}
+
+	// Looks up a string table entry, tolerating out of range indices in malformed files
+	auto GetString = [&StringTable]( const int64 StringIndex ) -> FOSMStringView
+	{
+		return StringTable.IsValidIndex( (int32)StringIndex ) ? StringTable[ (int32)StringIndex ] : FOSMStringView();
+	};
+
+	// Coordinates are stored in units of nanodegrees.  We keep them in units of 1e-7 degrees, which is exact for the
+	// default granularity of 100.
+	auto ToCoordinate = [Granularity]( const int64 Offset, const int64 Value ) -> int32
+	{
+		const int64 Nanodegrees = Offset + Granularity * Value;
+		return (int32)( Nanodegrees >= 0 ? ( Nanodegrees + 50 ) / 100 : -( ( 50 - Nanodegrees ) / 100 ) );
+	};
+
+	auto AddNodeTag = []( FOSMFile::FOSMNodeInfo& NodeInfo, const FOSMStringView& Key, const FOSMStringView& Value )
+	{
+		FOSMFile::FOSMTag Tag;
+		Tag.Key = Key.ToName();
+		Tag.Value = Value.ToName();
+		NodeInfo.Tags.Add( Tag );
+	};
+
+	TArray<int64> Ids;
+	TArray<int64> Lats;
+	TArray<int64> Lons;
+	TArray<int32> KeysVals;
+	TArray<uint32> Keys;
+	TArray<uint32> Vals;
+	TArray<int32> Roles;
+	TArray<int64> MemberIds;
+	TArray<int32> MemberTypes;
+
+	for( FPbfMessage& Group : Groups )
+	{
+		while( Group.Next() )
+		{
+			const uint32 GroupField = Group.GetFieldNumber();
+			if( Options.bSkipNodes && ( GroupField == 1 || GroupField == 2 ) )
+			{
+				Group.Skip();
+			}
+			else if( GroupField == 1 )
+			{
+				// Node
+				FPbfMessage Node = Group.ReadMessage();
+				int64 Id = 0;
+				int64 Lat = 0;
+				int64 Lon = 0;
+				Keys.Reset();
+				Vals.Reset();
+				while( Node.Next() )
+				{
+					switch( Node.GetFieldNumber() )
+					{
+						case 1: Id = Node.ReadSignedVarint(); break;
+						case 2: Node.ReadPackedVarints( Keys, false ); break;
+						case 3: Node.ReadPackedVarints( Vals, false ); break;
+						case 8: Lat = Node.ReadSignedVarint(); break;
+						case 9: Lon = Node.ReadSignedVarint(); break;
+						default: Node.Skip(); break;
+					}
+				}
+
+				const int32 Latitude = ToCoordinate( LatOffset, Lat );
+				const int32 Longitude = ToCoordinate( LonOffset, Lon );
+				Out.NodeLocations.Add( TPairInitializer<int32, int32>( Latitude, Longitude ) );
+
+				const int32 NumTags = FMath::Min( Keys.Num(), Vals.Num() );
+				if( Options.OSMFile->ShouldKeepNode( Id, NumTags > 0, Latitude, Longitude ) )
+				{
+					FPbfDecodedBlock::FNode& NewNode = *new( Out.Nodes ) FPbfDecodedBlock::FNode();
+					NewNode.Id = Id;
+					NewNode.NodeInfo.Latitude = Latitude;
+					NewNode.NodeInfo.Longitude = Longitude;
+					for( int32 TagIndex = 0; TagIndex < NumTags; ++TagIndex )
+					{
+						AddNodeTag( NewNode.NodeInfo, GetString( Keys[ TagIndex ] ), GetString( Vals[ TagIndex ] ) );
+					}
+				}
+			}
+			else if( GroupField == 2 )
+			{
+				// DenseNodes: ids and coordinates are delta coded, tags are a flat list of (key, value)* 0 per node
+				FPbfMessage Dense = Group.ReadMessage();
+				Ids.Reset();
+				Lats.Reset();
+				Lons.Reset();
+				KeysVals.Reset();
+				while( Dense.Next() )
+				{
+					switch( Dense.GetFieldNumber() )
+					{
+						case 1: Dense.ReadPackedVarints( Ids, true ); break;
+						case 8: Dense.ReadPackedVarints( Lats, true ); break;
+						case 9: Dense.ReadPackedVarints( Lons, true ); break;
+						case 10: Dense.ReadPackedVarints( KeysVals, false ); break;
+						default: Dense.Skip(); break;
+					}
+				}
+
+				if( !Dense.IsValid() || Ids.Num() != Lats.Num() || Ids.Num() != Lons.Num() )
+				{
+					Out.Error = TEXT( "Malformed DenseNodes" );
+					return;
+				}
+
+				int64 Id = 0;
+				int64 Lat = 0;
+				int64 Lon = 0;
+				int32 KeyValIndex = 0;
+				Out.NodeLocations.Reserve( Out.NodeLocations.Num() + Ids.Num() );
+				for( int32 NodeIndex = 0; NodeIndex < Ids.Num(); ++NodeIndex )
+				{
+					Id += Ids[ NodeIndex ];
+					Lat += Lats[ NodeIndex ];
+					Lon += Lons[ NodeIndex ];
+
+					const int32 Latitude = ToCoordinate( LatOffset, Lat );
+					const int32 Longitude = ToCoordinate( LonOffset, Lon );
+					Out.NodeLocations.Add( TPairInitializer<int32, int32>( Latitude, Longitude ) );
+
+					const bool bHasTags = KeyValIndex < KeysVals.Num() && KeysVals[ KeyValIndex ] != 0;
+					FOSMFile::FOSMNodeInfo* NodeInfo = nullptr;
+					if( Options.OSMFile->ShouldKeepNode( Id, bHasTags, Latitude, Longitude ) )
+					{
+						FPbfDecodedBlock::FNode& NewNode = *new( Out.Nodes ) FPbfDecodedBlock::FNode();
+						NewNode.Id = Id;
+						NewNode.NodeInfo.Latitude = Latitude;
+						NewNode.NodeInfo.Longitude = Longitude;
+						NodeInfo = &NewNode.NodeInfo;
+					}
+
+					while( KeyValIndex < KeysVals.Num() && KeysVals[ KeyValIndex ] != 0 )
+					{
+						const int32 KeyIndex = KeysVals[ KeyValIndex++ ];
+						const int32 ValueIndex = KeyValIndex < KeysVals.Num() ? KeysVals[ KeyValIndex++ ] : 0;
+						if( NodeInfo != nullptr )
+						{
+							AddNodeTag( *NodeInfo, GetString( KeyIndex ), GetString( ValueIndex ) );
+						}
+					}
+					++KeyValIndex;	// Skip the delimiter
+				}
+			}
+			else if( GroupField == 3 )
+			{
+				// Way
+				FPbfMessage Way = Group.ReadMessage();
+				FPbfDecodedBlock::FWay& NewWay = *new( Out.Ways ) FPbfDecodedBlock::FWay();
+				NewWay.Id = 0;
+				NewWay.WayInfo.WayType = FOSMFile::EOSMWayType::Other;
+				Keys.Reset();
+				Vals.Reset();
+				while( Way.Next() )
+				{
+					switch( Way.GetFieldNumber() )
+					{
+						case 1: NewWay.Id = (int64)Way.ReadVarint(); break;
+						case 2: Way.ReadPackedVarints( Keys, false ); break;
+						case 3: Way.ReadPackedVarints( Vals, false ); break;
+						case 8: Way.ReadPackedVarints( NewWay.NodeRefs, true ); break;
+						default: Way.Skip(); break;
+					}
+				}
+
+				// Node references are delta coded
+				for( int32 RefIndex = 1; RefIndex < NewWay.NodeRefs.Num(); ++RefIndex )
+				{
+					NewWay.NodeRefs[ RefIndex ] += NewWay.NodeRefs[ RefIndex - 1 ];
+				}
+
+				if( !Options.bSkipNodes && !Options.OSMFile->ShouldKeepWay( NewWay.Id ) )
+				{
+					Out.Ways.Pop( false );
+					continue;
+				}
+
+				NewWay.WayInfo.Id = NewWay.Id;
+				for( int32 TagIndex = 0; TagIndex < FMath::Min( Keys.Num(), Vals.Num() ); ++TagIndex )
+				{
+					FOSMFile::ApplyWayTag( NewWay.WayInfo, GetString( Keys[ TagIndex ] ), GetString( Vals[ TagIndex ] ) );
+				}
+			}
+			else if( GroupField == 4 )
+			{
+				// Relation
+				FPbfMessage Relation = Group.ReadMessage();
+				FOSMFile::FOSMRelation& NewRelation = *new( Out.Relations ) FOSMFile::FOSMRelation();
+				NewRelation.Type = FOSMFile::EOSMRelationType::Other;
+				Keys.Reset();
+				Vals.Reset();
+				Roles.Reset();
+				MemberIds.Reset();
+				MemberTypes.Reset();
+				while( Relation.Next() )
+				{
+					switch( Relation.GetFieldNumber() )
+					{
+						case 2: Relation.ReadPackedVarints( Keys, false ); break;
+						case 3: Relation.ReadPackedVarints( Vals, false ); break;
+						case 8: Relation.ReadPackedVarints( Roles, false ); break;
+						case 9: Relation.ReadPackedVarints( MemberIds, true ); break;
+						case 10: Relation.ReadPackedVarints( MemberTypes, false ); break;
+						default: Relation.Skip(); break;
+					}
+				}
+
+				for( int32 TagIndex = 0; TagIndex < FMath::Min( Keys.Num(), Vals.Num() ); ++TagIndex )
+				{
+					FOSMFile::ApplyRelationTag( NewRelation, GetString( Keys[ TagIndex ] ), GetString( Vals[ TagIndex ] ) );
+				}
+
+				const int32 NumMembers = FMath::Min3( Roles.Num(), MemberIds.Num(), MemberTypes.Num() );
+				NewRelation.Members.Reserve( NumMembers );
+				int64 MemberId = 0;
+				for( int32 MemberIndex = 0; MemberIndex < NumMembers; ++MemberIndex )
+				{
+					MemberId += MemberIds[ MemberIndex ];
+
+					FOSMFile::FOSMRelationMember& NewMember = NewRelation.Members[ NewRelation.Members.AddUninitialized() ];
+					NewMember.Ref = MemberId;
+					switch( MemberTypes[ MemberIndex ] )
+					{
+						case 0: NewMember.Type = FOSMFile::EOSMRelationMemberType::Node; break;
+						case 1: NewMember.Type = FOSMFile::EOSMRelationMemberType::Way; break;
+						case 2: NewMember.Type = FOSMFile::EOSMRelationMemberType::Relation; break;
+						default: NewMember.Type = FOSMFile::EOSMRelationMemberType::Other; break;
+					}
+
+					const EOSMKeyword Role = FindOSMKeyword( GetString( Roles[ MemberIndex ] ) );
+					if( Role == EOSMKeyword::Outer )
+					{
+						NewMember.Role = FOSMFile::EOSMRelationMemberRole::Outer;
+					}
+					else if( Role == EOSMKeyword::Inner )
+					{
+						NewMember.Role = FOSMFile::EOSMRelationMemberRole::Inner;
+					}
+					else
+					{
+						NewMember.Role = FOSMFile::EOSMRelationMemberRole::Other;
+					}
+				}
+			}
+			else
+			{
+				// Changesets are not relevant to us
+				Group.Skip();
+			}
+		}
+
+		if( !Group.IsValid() )
+		{
+			Out.Error = TEXT( "Malformed PrimitiveGroup" );
+			return;
+		}
+	}
+}
+
+
+/**
+ * Reads all blobs from the file, decoding them on worker threads in batches.  Decoded blocks are handed to MergeBlock
+ * on the calling thread, in file order, which keeps the output deterministic.
+ */
+static bool ReadPrimitiveBlocks( FArchive& Reader, FScopedStreetMapImportProgress& SlowTask, const FPbfDecodeOptions& Options, FPbfHeaderBounds& OutHeaderBounds, TFunctionRef<void( FPbfDecodedBlock& )> MergeBlock, FString& OutError )
+{
+	// Blobs are decoded in batches, so that we never hold more than a few of them in memory while still keeping all
+	// worker threads busy.
+	const int32 BatchSize = FMath::Max( 1, FTaskGraphInterface::Get().GetNumWorkerThreads() ) * 4;
+
+	bool bSeenHeader = false;
+	bool bReachedEnd = false;
+	int64 LastProgressOffset = 0;
+
+	while( !bReachedEnd && OutError.IsEmpty() )
+	{
+		TArray<FPbfRawBlob> RawBlobs;
+		while( RawBlobs.Num() < BatchSize )
+		{
+			FString BlobType;
+			FPbfRawBlob RawBlob;
+			if( !ReadNextBlob( Reader, BlobType, RawBlob, OutError ) )
+			{
+				bReachedEnd = true;
+				break;
+			}
+
+			if( BlobType == TEXT( "OSMHeader" ) )
+			{
+				TArray<uint8> HeaderData;
+				if( !DecompressBlob( RawBlob, HeaderData, OutError ) || !CheckHeaderBlock( HeaderData, OutHeaderBounds, OutError ) )
+				{
+					break;
+				}
+				bSeenHeader = true;
+			}
+			else if( BlobType == TEXT( "OSMData" ) )
+			{
+				RawBlobs.Add( MoveTemp( RawBlob ) );
+			}
+			else
+			{
+				// Unknown blob types must be skipped according to the specification
+			}
+		}
+
+		if( !OutError.IsEmpty() )
+		{
+			break;
+		}
+
+		if( !bSeenHeader && RawBlobs.Num() > 0 )
+		{
+			OutError = TEXT( "Missing OSMHeader block" );
+			break;
+		}
+
+		TArray<FPbfDecodedBlock> DecodedBlocks;
+		DecodedBlocks.SetNum( RawBlobs.Num() );
+		ParallelFor( RawBlobs.Num(), [&RawBlobs, &DecodedBlocks, &Options]( int32 BlobIndex )
+		{
+			TArray<uint8> BlockData;
+			if( DecompressBlob( RawBlobs[ BlobIndex ], BlockData, DecodedBlocks[ BlobIndex ].Error ) )
+			{
+				RawBlobs[ BlobIndex ].Data.Empty();
+				DecodePrimitiveBlock( BlockData, Options, DecodedBlocks[ BlobIndex ] );
+			}
+		} );
+
+		// All blocks of the batch are decoded right now, so this is where memory usage peaks
+		if( Options.Profile != nullptr )
+		{
+			Options.Profile->SampleMemory();
+		}
+
+		for( FPbfDecodedBlock& DecodedBlock : DecodedBlocks )
+		{
+			if( !DecodedBlock.Error.IsEmpty() )
+			{
+				OutError = DecodedBlock.Error;
+				break;
+			}
+
+			MergeBlock( DecodedBlock );
+		}
+
+		const int64 ProgressOffset = Reader.Tell();
+		SlowTask.EnterProgressFrame( (float)( ProgressOffset - LastProgressOffset ) );
+		LastProgressOffset = ProgressOffset;
+
+		if( SlowTask.ShouldCancel() )
+		{
+			OutError = TEXT( "Canceled by user" );
+		}
+	}
+
+	return OutError.IsEmpty();
+}
+
+
+bool FOSMFile::LoadOpenStreetMapPbfFile( const FString& OSMFilePath, FFeedbackContext* FeedbackContext )
+{
+	TUniquePtr<FArchive> Reader( IFileManager::Get().CreateFileReader( *OSMFilePath ) );
+	if( !Reader.IsValid() )
+	{
+		if( FeedbackContext != nullptr )
+		{
+			FeedbackContext->Logf( ELogVerbosity::Error, TEXT( "Failed to open OpenStreetMap PBF file '%s'" ), *OSMFilePath );
+		}
+		return false;
+	}
+
+	const int64 FileSize = Reader->TotalSize();
+	if( Profile != nullptr )
+	{
+		Profile->SetCounter( TEXT( "PBF bytes" ), FileSize );
+	}
+
+	// Finishing up (resolving way nodes) is counted as one more pass.  Collecting references may take a second look at
+	// the ways, for the nodes of multipolygon members.
+	const int32 NumPasses = WayFilter ? 3 : 1;
+	FScopedStreetMapImportProgress SlowTask( Progress, (float)( FileSize * ( NumPasses + 1 ) ), LOCTEXT( "LoadingPbf", "Loading OpenStreetMap PBF file" ) );
+
+	FString Error;
+	FPbfDecodeOptions Options;
+	Options.OSMFile = this;
+	Options.Profile = Profile;
+	FPbfHeaderBounds HeaderBounds;
+
+	if( WayFilter )
+	{
+		// First pass: ways and relations only.  Nothing is kept, we just collect IDs.
+		FScopedStreetMapImportPhase Phase( Profile, TEXT( "Collect references" ) );
+		ReferencedIds.Reset( new FReferencedIds() );
+
+		Options.bSkipNodes = true;
+		auto CollectReferences = [this]( FPbfDecodedBlock& DecodedBlock )
+		{
+			for( FPbfDecodedBlock::FWay& Way : DecodedBlock.Ways )
+			{
+				CollectWayReferences( Way.Id, Way.WayInfo, Way.NodeRefs );
+			}
+
+			TArray<int64> MemberWayIDs;
+			for( const FOSMRelation& Relation : DecodedBlock.Relations )
+			{
+				if( Relation.Type == EOSMRelationType::Multipolygon )
+				{
+					MemberWayIDs.Reset();
+					for( const FOSMRelationMember& Member : Relation.Members )
+					{
+						if( Member.Type == EOSMRelationMemberType::Way )
+						{
+							MemberWayIDs.Add( Member.Ref );
+						}
+					}
+					CollectMultipolygonReferences( MemberWayIDs );
+				}
+			}
+		};
+
+		bool bCollectedReferences = ReadPrimitiveBlocks( *Reader, SlowTask, Options, HeaderBounds, CollectReferences, Error );
+		if( bCollectedReferences )
+		{
+			if( FinishCollectingReferences() )
+			{
+				Reader->Seek( 0 );
+				bCollectedReferences = ReadPrimitiveBlocks( *Reader, SlowTask, Options, HeaderBounds, CollectReferences, Error );
+				FinishCollectingReferences();
+			}
+			else
+			{
+				SlowTask.EnterProgressFrame( (float)FileSize );
+			}
+		}
+
+		if( bCollectedReferences )
+		{
+			Options.bSkipNodes = false;
+			Reader->Seek( 0 );
+		}
+	}
+
+	if( Error.IsEmpty() )
+	{
+		FScopedStreetMapImportPhase Phase( Profile, TEXT( "Decode" ) );
+		ReadPrimitiveBlocks( *Reader, SlowTask, Options, HeaderBounds, [this, &HeaderBounds]( FPbfDecodedBlock& DecodedBlock )
+		{
+			// The header always comes before the first data block
+			if( HeaderBounds.bIsValid && !bHasFileBounds )
+			{
+				SetFileBounds( HeaderBounds.MinLatitude, HeaderBounds.MinLongitude, HeaderBounds.MaxLatitude, HeaderBounds.MaxLongitude );
+			}
+
+			for( const TPair<int32, int32>& NodeLocation : DecodedBlock.NodeLocations )
+			{
+				AccumulateNodeLocation( NodeLocation.Key, NodeLocation.Value );
+			}
+
+			for( const FPbfDecodedBlock::FNode& Node : DecodedBlock.Nodes )
+			{
+				AddNode( Node.Id, Node.NodeInfo );
+			}
+
+			// Node references are resolved once everything is loaded
+			for( FPbfDecodedBlock::FWay& Way : DecodedBlock.Ways )
+			{
+				PendingNodeRefs.Append( Way.NodeRefs );
+				AddWay( Way.Id, WayArena.New( MoveTemp( Way.WayInfo ) ) );
+			}
+
+			for( FOSMRelation& Relation : DecodedBlock.Relations )
+			{
+				Relations.Add( RelationArena.New( MoveTemp( Relation ) ) );
+			}
+		}, Error );
+	}
+
+	if( !Error.IsEmpty() )
+	{
+		if( FeedbackContext != nullptr )
+		{
+			FeedbackContext->Logf(
+				ELogVerbosity::Error,
+				TEXT( "Failed to load OpenStreetMap PBF file ('%s', Offset %lld)" ),
+				*Error,
+				Reader->Tell() );
+		}
+		return false;
+	}
+
+	SlowTask.EnterProgressFrame( (float)FileSize );
+	if( !FinishLoading() )
+	{
+		if( FeedbackContext != nullptr )
+		{
+			FeedbackContext->Logf( ELogVerbosity::Error, TEXT( "Failed to load OpenStreetMap PBF file ('Canceled by user')" ) );
+		}
+		return false;
+	}
+	return true;
+}
+
+#undef LOCTEXT_NAMESPACE
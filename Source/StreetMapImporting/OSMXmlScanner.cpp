@@ -0,0 +1,550 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapImporting.h"
+#include "OSMXmlScanner.h"
+
+#define LOCTEXT_NAMESPACE "StreetMapImporting"
+
+/** How often we report progress while scanning */
+static const int64 ProgressIntervalBytes = 4 * 1024 * 1024;
+
+
+static inline bool IsXmlWhitespace( const ANSICHAR Character )
+{
+	return Character == ' ' || Character == '\t' || Character == '\r' || Character == '\n';
+}
+
+
+static inline bool IsNameTerminator( const ANSICHAR Character )
+{
+	return IsXmlWhitespace( Character ) || Character == '/' || Character == '>' || Character == '=';
+}
+
+
+FOSMXmlScanner::FOSMXmlScanner( const ANSICHAR* InData, const int64 InSize )
+	: Data( InData )
+	, Cur( InData )
+	, End( InData + InSize )
+	, NumDecodedValues( 0 )
+{
+}
+
+
+bool FOSMXmlScanner::Parse( IOSMXmlCallback& Callback, TFunctionRef<bool( int64 )> ProgressCallback, FText& OutErrorMessage, int32& OutErrorLineNumber )
+{
+	Cur = Data;
+	Error = FText::GetEmpty();
+
+	// Skip the UTF-8 byte order mark, if any
+	if( End - Cur >= 3 && (uint8)Cur[ 0 ] == 0xEF && (uint8)Cur[ 1 ] == 0xBB && (uint8)Cur[ 2 ] == 0xBF )
+	{
+		Cur += 3;
+	}
+
+	const ANSICHAR* NextProgressReport = Cur + ProgressIntervalBytes;
+	bool bSuccess = true;
+
+	while( bSuccess && Cur < End )
+	{
+		// Text content is of no interest to us, so jump straight to the next tag
+		const ANSICHAR* TagStart = (const ANSICHAR*)memchr( Cur, '<', End - Cur );
+		if( TagStart == nullptr )
+		{
+			Cur = End;
+			break;
+		}
+		Cur = TagStart + 1;
+
+		if( Cur >= End )
+		{
+			Error = LOCTEXT( "XmlUnexpectedEnd", "Unexpected end of file" );
+			bSuccess = false;
+		}
+		else if( *Cur == '/' )
+		{
+			++Cur;
+			bSuccess = ScanEndTag( Callback );
+		}
+		else if( *Cur == '?' )
+		{
+			// XML declaration or processing instruction
+			bSuccess = SkipPast( "?>" );
+		}
+		else if( *Cur == '!' )
+		{
+			if( End - Cur >= 3 && Cur[ 1 ] == '-' && Cur[ 2 ] == '-' )
+			{
+				bSuccess = SkipPast( "-->" );
+			}
+			else if( End - Cur >= 8 && FCStringAnsi::Strncmp( Cur, "![CDATA[", 8 ) == 0 )
+			{
+				bSuccess = SkipPast( "]]>" );
+			}
+			else
+			{
+				// DOCTYPE, possibly with an internal subset in square brackets
+				int32 BracketDepth = 0;
+				while( Cur < End && ( *Cur != '>' || BracketDepth > 0 ) )
+				{
+					BracketDepth += ( *Cur == '[' ) ? 1 : ( *Cur == ']' ) ? -1 : 0;
+					++Cur;
+				}
+				bSuccess = Cur < End;
+				++Cur;
+			}
+		}
+		else
+		{
+			bSuccess = ScanStartTag( Callback );
+		}
+
+		if( bSuccess && Cur >= NextProgressReport )
+		{
+			NextProgressReport = Cur + ProgressIntervalBytes;
+			if( !ProgressCallback( Cur - Data ) )
+			{
+				Error = LOCTEXT( "XmlCanceled", "Canceled by user" );
+				bSuccess = false;
+			}
+		}
+	}
+
+	if( !bSuccess )
+	{
+		OutErrorMessage = Error.IsEmpty() ? LOCTEXT( "XmlMalformed", "Malformed XML" ) : Error;
+		OutErrorLineNumber = ComputeLineNumber();
+	}
+
+	return bSuccess;
+}
+
+
+bool FOSMXmlScanner::ScanStartTag( IOSMXmlCallback& Callback )
+{
+	const ANSICHAR* NameStart = Cur;
+	while( Cur < End && !IsNameTerminator( *Cur ) )
+	{
+		++Cur;
+	}
+	const FOSMStringView ElementName( NameStart, (int32)( Cur - NameStart ) );
+	if( ElementName.IsEmpty() || Cur >= End )
+	{
+		Error = LOCTEXT( "XmlMissingElementName", "Expected element name" );
+		return false;
+	}
+
+	NumDecodedValues = 0;
+
+	if( !Callback.ProcessElement( ElementName ) )
+	{
+		return false;
+	}
+
+	for( ;; )
+	{
+		while( Cur < End && IsXmlWhitespace( *Cur ) )
+		{
+			++Cur;
+		}
+		if( Cur >= End )
+		{
+			Error = LOCTEXT( "XmlUnterminatedTag", "Unterminated start tag" );
+			return false;
+		}
+
+		if( *Cur == '>' )
+		{
+			++Cur;
+			return true;
+		}
+
+		if( *Cur == '/' )
+		{
+			if( Cur + 1 >= End || Cur[ 1 ] != '>' )
+			{
+				Error = LOCTEXT( "XmlExpectedTagEnd", "Expected '>' after '/'" );
+				return false;
+			}
+			Cur += 2;
+
+			// Empty element, report it as closed right away
+			return Callback.ProcessClose( ElementName );
+		}
+
+		const ANSICHAR* AttributeNameStart = Cur;
+		while( Cur < End && !IsNameTerminator( *Cur ) )
+		{
+			++Cur;
+		}
+		const FOSMStringView AttributeName( AttributeNameStart, (int32)( Cur - AttributeNameStart ) );
+
+		while( Cur < End && IsXmlWhitespace( *Cur ) )
+		{
+			++Cur;
+		}
+		if( AttributeName.IsEmpty() || Cur >= End || *Cur != '=' )
+		{
+			Error = LOCTEXT( "XmlExpectedEquals", "Expected '=' after attribute name" );
+			return false;
+		}
+		++Cur;
+
+		while( Cur < End && IsXmlWhitespace( *Cur ) )
+		{
+			++Cur;
+		}
+		if( Cur >= End || ( *Cur != '"' && *Cur != '\'' ) )
+		{
+			Error = LOCTEXT( "XmlExpectedQuote", "Expected quoted attribute value" );
+			return false;
+		}
+
+		const ANSICHAR Quote = *Cur++;
+		const ANSICHAR* ValueStart = Cur;
+		const ANSICHAR* ValueEnd = (const ANSICHAR*)memchr( Cur, Quote, End - Cur );
+		if( ValueEnd == nullptr )
+		{
+			Error = LOCTEXT( "XmlUnterminatedValue", "Unterminated attribute value" );
+			return false;
+		}
+		Cur = ValueEnd + 1;
+
+		FOSMStringView AttributeValue( ValueStart, (int32)( ValueEnd - ValueStart ) );
+		if( AttributeValue.Contains( '&' ) )
+		{
+			AttributeValue = DecodeEntities( AttributeValue );
+		}
+
+		if( !Callback.ProcessAttribute( AttributeName, AttributeValue ) )
+		{
+			return false;
+		}
+	}
+}
+
+
+bool FOSMXmlScanner::ScanEndTag( IOSMXmlCallback& Callback )
+{
+	const ANSICHAR* NameStart = Cur;
+	while( Cur < End && !IsNameTerminator( *Cur ) )
+	{
+		++Cur;
+	}
+	const FOSMStringView ElementName( NameStart, (int32)( Cur - NameStart ) );
+
+	const ANSICHAR* TagEnd = (const ANSICHAR*)memchr( Cur, '>', End - Cur );
+	if( TagEnd == nullptr )
+	{
+		Error = LOCTEXT( "XmlUnterminatedEndTag", "Unterminated end tag" );
+		return false;
+	}
+	Cur = TagEnd + 1;
+
+	return Callback.ProcessClose( ElementName );
+}
+
+
+bool FOSMXmlScanner::SkipPast( const ANSICHAR* Terminator )
+{
+	const int32 TerminatorLen = FCStringAnsi::Strlen( Terminator );
+	while( Cur < End )
+	{
+		const ANSICHAR* Candidate = (const ANSICHAR*)memchr( Cur, Terminator[ 0 ], End - Cur );
+		if( Candidate == nullptr || End - Candidate < TerminatorLen )
+		{
+			break;
+		}
+		if( FCStringAnsi::Strncmp( Candidate, Terminator, TerminatorLen ) == 0 )
+		{
+			Cur = Candidate + TerminatorLen;
+			return true;
+		}
+		Cur = Candidate + 1;
+	}
+
+	Cur = End;
+	Error = LOCTEXT( "XmlUnterminatedSection", "Unterminated comment, CDATA section or processing instruction" );
+	return false;
+}
+
+
+FOSMStringView FOSMXmlScanner::DecodeEntities( const FOSMStringView& Value )
+{
+	// Every decoded value gets its own buffer, so views handed out earlier for the same tag stay valid
+	if( NumDecodedValues == DecodedValues.Num() )
+	{
+		DecodedValues.AddDefaulted();
+	}
+	TArray<ANSICHAR>& Scratch = DecodedValues[ NumDecodedValues++ ];
+	Scratch.Reset();
+
+	int32 Index = 0;
+	while( Index < Value.Len )
+	{
+		const ANSICHAR Character = Value.Data[ Index ];
+		const ANSICHAR* Semicolon = Character == '&' ? (const ANSICHAR*)memchr( Value.Data + Index, ';', Value.Len - Index ) : nullptr;
+		if( Semicolon == nullptr )
+		{
+			Scratch.Add( Character );
+			++Index;
+			continue;
+		}
+
+		const FOSMStringView Entity( Value.Data + Index + 1, (int32)( Semicolon - ( Value.Data + Index + 1 ) ) );
+		uint32 CodePoint = 0;
+		if( Entity.Equals( "lt" ) )
+		{
+			CodePoint = '<';
+		}
+		else if( Entity.Equals( "gt" ) )
+		{
+			CodePoint = '>';
+		}
+		else if( Entity.Equals( "amp" ) )
+		{
+			CodePoint = '&';
+		}
+		else if( Entity.Equals( "quot" ) )
+		{
+			CodePoint = '"';
+		}
+		else if( Entity.Equals( "apos" ) )
+		{
+			CodePoint = '\'';
+		}
+		else if( Entity.Len > 1 && Entity.Data[ 0 ] == '#' )
+		{
+			const bool bIsHex = Entity.Data[ 1 ] == 'x' || Entity.Data[ 1 ] == 'X';
+			for( int32 DigitIndex = bIsHex ? 2 : 1; DigitIndex < Entity.Len; ++DigitIndex )
+			{
+				const ANSICHAR Digit = Entity.Data[ DigitIndex ];
+				CodePoint = CodePoint * ( bIsHex ? 16 : 10 ) + ( FCharAnsi::IsDigit( Digit ) ? Digit - '0' : FCharAnsi::ToLower( Digit ) - 'a' + 10 );
+			}
+		}
+
+		if( CodePoint == 0 || CodePoint > 0x10FFFF )
+		{
+			// Unknown entity, keep it verbatim
+			Scratch.Add( Character );
+			++Index;
+			continue;
+		}
+
+		// Encode the code point as UTF-8.  An entity is always at least as long as its encoding.
+		if( CodePoint < 0x80 )
+		{
+			Scratch.Add( (ANSICHAR)CodePoint );
+		}
+		else if( CodePoint < 0x800 )
+		{
+			Scratch.Add( (ANSICHAR)( 0xC0 | ( CodePoint >> 6 ) ) );
+			Scratch.Add( (ANSICHAR)( 0x80 | ( CodePoint & 0x3F ) ) );
+		}
+		else if( CodePoint < 0x10000 )
+		{
+			Scratch.Add( (ANSICHAR)( 0xE0 | ( CodePoint >> 12 ) ) );
+			Scratch.Add( (ANSICHAR)( 0x80 | ( ( CodePoint >> 6 ) & 0x3F ) ) );
+			Scratch.Add( (ANSICHAR)( 0x80 | ( CodePoint & 0x3F ) ) );
+		}
+		else
+		{
+			Scratch.Add( (ANSICHAR)( 0xF0 | ( CodePoint >> 18 ) ) );
+			Scratch.Add( (ANSICHAR)( 0x80 | ( ( CodePoint >> 12 ) & 0x3F ) ) );
+			Scratch.Add( (ANSICHAR)( 0x80 | ( ( CodePoint >> 6 ) & 0x3F ) ) );
+			Scratch.Add( (ANSICHAR)( 0x80 | ( CodePoint & 0x3F ) ) );
+		}
+
+		Index = (int32)( Semicolon - Value.Data ) + 1;
+	}
+
+	return FOSMStringView( Scratch.GetData(), Scratch.Num() );
+}
+
+
+int32 FOSMXmlScanner::ComputeLineNumber() const
+{
+	int32 LineNumber = 1;
+	for( const ANSICHAR* Position = Data; Position < Cur && Position < End; ++Position )
+	{
+		LineNumber += ( *Position == '\n' ) ? 1 : 0;
+	}
+	return LineNumber;
+}
+
+
+const ANSICHAR* FOSMXmlScanner::FindCommentOrCData( const ANSICHAR* Position, const ANSICHAR* End, const ANSICHAR*& OutSectionTerminator )
+{
+	// '!' is rare in OpenStreetMap data, so looking for it first is much faster than checking every tag
+	const ANSICHAR* SearchStart = Position;
+	while( SearchStart < End )
+	{
+		const ANSICHAR* Bang = (const ANSICHAR*)memchr( SearchStart, '!', End - SearchStart );
+		if( Bang == nullptr )
+		{
+			break;
+		}
+
+		const ANSICHAR* TagStart = Bang - 1;
+		if( TagStart >= Position && *TagStart == '<' )
+		{
+			if( End - Bang >= 3 && FCStringAnsi::Strncmp( Bang, "!--", 3 ) == 0 )
+			{
+				OutSectionTerminator = "-->";
+				return TagStart;
+			}
+			if( End - Bang >= 8 && FCStringAnsi::Strncmp( Bang, "![CDATA[", 8 ) == 0 )
+			{
+				OutSectionTerminator = "]]>";
+				return TagStart;
+			}
+		}
+		SearchStart = Bang + 1;
+	}
+
+	return nullptr;
+}
+
+
+const ANSICHAR* FOSMXmlScanner::FindSectionEnd( const ANSICHAR* Position, const ANSICHAR* End, const ANSICHAR* SectionTerminator )
+{
+	const ANSICHAR* SearchStart = Position;
+	while( SearchStart < End )
+	{
+		const ANSICHAR* Close = (const ANSICHAR*)memchr( SearchStart, '>', End - SearchStart );
+		if( Close == nullptr )
+		{
+			break;
+		}
+
+		if( Close - Position >= 2 && Close[ -2 ] == SectionTerminator[ 0 ] && Close[ -1 ] == SectionTerminator[ 1 ] )
+		{
+			return Close + 1;
+		}
+		SearchStart = Close + 1;
+	}
+
+	return End;
+}
+
+
+/** @return The last start tag in the range, or null if there is none */
+static const ANSICHAR* FindLastStartTagInRange( const ANSICHAR* Start, const ANSICHAR* End )
+{
+	for( const ANSICHAR* Position = End - 1; Position > Start; --Position )
+	{
+		if( Position[ -1 ] == '<' && FCharAnsi::IsAlpha( Position[ 0 ] ) )
+		{
+			return Position - 1;
+		}
+	}
+	return nullptr;
+}
+
+
+/**
+ * @return Offset of the last start tag in the data that isn't inside of a comment or CDATA section, or zero if there
+ *         is none after the first byte.  The data must not start inside of such a section.  A section that doesn't end
+ *         in the data may still hold start tags that aren't really there, so only start tags before it count.
+ */
+static int64 FindLastStartTag( const ANSICHAR* Data, const int64 DataSize )
+{
+	const ANSICHAR* End = Data + DataSize;
+	const ANSICHAR* LastStartTag = nullptr;
+
+	// Look between one section and the next, from the start of the data on
+	const ANSICHAR* GapStart = Data;
+	for( ;; )
+	{
+		const ANSICHAR* SectionTerminator = nullptr;
+		const ANSICHAR* SectionStart = FOSMXmlScanner::FindCommentOrCData( GapStart, End, SectionTerminator );
+
+		const ANSICHAR* StartTag = FindLastStartTagInRange( FMath::Max( GapStart, Data + 1 ), ( SectionStart != nullptr ) ? SectionStart : End );
+		if( StartTag != nullptr )
+		{
+			LastStartTag = StartTag;
+		}
+
+		if( SectionStart == nullptr )
+		{
+			break;
+		}
+
+		// Sections that end with the data are treated as if they didn't end, since there's nothing after them anyway
+		GapStart = FOSMXmlScanner::FindSectionEnd( SectionStart + 4, End, SectionTerminator );
+		if( GapStart >= End )
+		{
+			break;
+		}
+	}
+
+	return ( LastStartTag != nullptr ) ? LastStartTag - Data : 0;
+}
+
+
+bool FOSMXmlScanner::ParseStream( TFunctionRef<int32( ANSICHAR*, int32 )> Read, IOSMXmlCallback& Callback, TFunctionRef<bool()> ProgressCallback, FText& OutErrorMessage, int32& OutErrorLineNumber, int64& OutDataSize, const int32 WindowSize )
+{
+	TArray<ANSICHAR> Window;
+	Window.SetNumUninitialized( FMath::Max( WindowSize, 1 ) );
+	int64 WindowFill = 0;
+	bool bEndOfStream = false;
+
+	OutDataSize = 0;
+	int32 NumLinesBefore = 0;
+
+	while( !bEndOfStream || WindowFill > 0 )
+	{
+		while( !bEndOfStream && WindowFill < Window.Num() )
+		{
+			const int32 BytesRead = Read( Window.GetData() + WindowFill, Window.Num() - WindowFill );
+			bEndOfStream = ( BytesRead == 0 );
+			WindowFill += BytesRead;
+			OutDataSize += BytesRead;
+		}
+
+		// Keep the last tag for the next window, since it may not be complete yet
+		const int64 ScanSize = bEndOfStream ? WindowFill : FindLastStartTag( Window.GetData(), WindowFill );
+		if( ScanSize == 0 )
+		{
+			if( bEndOfStream )
+			{
+				break;
+			}
+
+			// A single element or section that is larger than the whole window
+			Window.SetNumUninitialized( Window.Num() * 2 );
+			continue;
+		}
+
+		auto ReportProgress = [&ProgressCallback]( const int64 BytesParsed ) -> bool
+		{
+			return ProgressCallback();
+		};
+
+		FOSMXmlScanner Scanner( Window.GetData(), ScanSize );
+		if( !Scanner.Parse( Callback, ReportProgress, /* Out */ OutErrorMessage, /* Out */ OutErrorLineNumber ) )
+		{
+			// The scanner counts lines from the start of the window
+			OutErrorLineNumber += NumLinesBefore;
+			return false;
+		}
+
+		for( int64 Offset = 0; Offset < ScanSize; ++Offset )
+		{
+			NumLinesBefore += ( Window[ Offset ] == '\n' ) ? 1 : 0;
+		}
+
+		FMemory::Memmove( Window.GetData(), Window.GetData() + ScanSize, WindowFill - ScanSize );
+		WindowFill -= ScanSize;
+
+		if( !ProgressCallback() )
+		{
+			OutErrorMessage = LOCTEXT( "XmlCanceled", "Canceled by user" );
+			OutErrorLineNumber = NumLinesBefore;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,258 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+
+/** Non-owning view of a UTF-8 string.  Used to pass names and values straight out of the (memory mapped) source buffer. */
+struct FOSMStringView
+{
+	const ANSICHAR* Data;
+	int32 Len;
+
+	FOSMStringView()
+		: Data( "" )
+		, Len( 0 )
+	{
+	}
+
+	FOSMStringView( const ANSICHAR* InData, const int32 InLen )
+		: Data( InData )
+		, Len( InLen )
+	{
+	}
+
+	bool IsEmpty() const
+	{
+		return Len == 0;
+	}
+
+	/** Case insensitive comparison against an ASCII literal, matching what FCString::Stricmp did for us before */
+	bool Equals( const ANSICHAR* Literal ) const
+	{
+		int32 Index = 0;
+		for( ; Index < Len; ++Index )
+		{
+			if( Literal[ Index ] == 0 || FCharAnsi::ToLower( Data[ Index ] ) != FCharAnsi::ToLower( Literal[ Index ] ) )
+			{
+				return false;
+			}
+		}
+		return Literal[ Index ] == 0;
+	}
+
+	bool Contains( const ANSICHAR Character ) const
+	{
+		for( int32 Index = 0; Index < Len; ++Index )
+		{
+			if( Data[ Index ] == Character )
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/** Parses a leading (optionally signed) integer, ignoring anything after it like Atoi64 does */
+	int64 ToInt64() const
+	{
+		int32 Index = 0;
+		const bool bIsNegative = Len > 0 && Data[ 0 ] == '-';
+		if( bIsNegative || ( Len > 0 && Data[ 0 ] == '+' ) )
+		{
+			++Index;
+		}
+
+		int64 Result = 0;
+		for( ; Index < Len && Data[ Index ] >= '0' && Data[ Index ] <= '9'; ++Index )
+		{
+			Result = Result * 10 + ( Data[ Index ] - '0' );
+		}
+		return bIsNegative ? -Result : Result;
+	}
+
+	int32 ToInt32() const
+	{
+		return (int32)ToInt64();
+	}
+
+	/**
+	 * Parses a latitude or longitude into units of 1e-7 degrees, the fixed point precision OpenStreetMap stores them
+	 * with.  Coordinates are plain decimals, so this is a lot faster than ToDouble.  Extra digits are rounded off.
+	 */
+	int32 ToCoordinate() const
+	{
+		static const int64 FractionScales[] = { 10000000, 1000000, 100000, 10000, 1000, 100, 10, 1 };
+
+		int32 Index = 0;
+		const bool bIsNegative = Len > 0 && Data[ 0 ] == '-';
+		if( bIsNegative || ( Len > 0 && Data[ 0 ] == '+' ) )
+		{
+			++Index;
+		}
+
+		int64 Result = 0;
+		int32 NumIntegerDigits = 0;
+		for( ; Index < Len && Data[ Index ] >= '0' && Data[ Index ] <= '9'; ++Index, ++NumIntegerDigits )
+		{
+			Result = Result * 10 + ( Data[ Index ] - '0' );
+		}
+
+		int32 NumFractionDigits = 0;
+		bool bRoundUp = false;
+		if( Index < Len && Data[ Index ] == '.' )
+		{
+			for( ++Index; Index < Len && Data[ Index ] >= '0' && Data[ Index ] <= '9'; ++Index )
+			{
+				if( NumFractionDigits < 7 )
+				{
+					Result = Result * 10 + ( Data[ Index ] - '0' );
+					++NumFractionDigits;
+				}
+				else if( NumFractionDigits == 7 )
+				{
+					bRoundUp = Data[ Index ] >= '5';
+					++NumFractionDigits;
+				}
+			}
+		}
+
+		if( Index < Len || NumIntegerDigits > 3 )
+		{
+			// Exponents and other unexpected formats take the slow path
+			return (int32)FMath::Clamp( FMath::FloorToDouble( ToDouble() * 10000000.0 + 0.5 ), (double)MIN_int32, (double)MAX_int32 );
+		}
+
+		Result = FMath::Min<int64>( Result * FractionScales[ FMath::Min( NumFractionDigits, 7 ) ] + ( bRoundUp ? 1 : 0 ), MAX_int32 );
+		return (int32)( bIsNegative ? -Result : Result );
+	}
+
+	double ToDouble() const
+	{
+		// Numbers in OSM files are short, so a small null terminated copy is all we need for Atod
+		ANSICHAR Buffer[ 64 ];
+		const int32 CopyLen = FMath::Min( Len, (int32)ARRAY_COUNT( Buffer ) - 1 );
+		FMemory::Memcpy( Buffer, Data, CopyLen );
+		Buffer[ CopyLen ] = 0;
+		return FCStringAnsi::Atod( Buffer );
+	}
+
+	FString ToString() const
+	{
+		if( Len == 0 )
+		{
+			return FString();
+		}
+		const FUTF8ToTCHAR Converted( Data, Len );
+		return FString( Converted.Length(), Converted.Get() );
+	}
+
+	FName ToName() const
+	{
+		return FName( *ToString() );
+	}
+};
+
+
+/** Receives parse events from FOSMXmlScanner.  Views passed in are only valid until the next start tag is scanned. */
+class IOSMXmlCallback
+{
+
+public:
+
+	virtual ~IOSMXmlCallback()
+	{
+	}
+
+	/** Called when an element is opened */
+	virtual bool ProcessElement( const FOSMStringView& ElementName ) = 0;
+
+	/** Called for each attribute of the element that was opened last */
+	virtual bool ProcessAttribute( const FOSMStringView& AttributeName, const FOSMStringView& AttributeValue ) = 0;
+
+	/** Called when an element is closed, including empty elements such as <nd ref="1"/> */
+	virtual bool ProcessClose( const FOSMStringView& ElementName ) = 0;
+};
+
+
+/**
+ * SAX style scanner for UTF-8 encoded XML.  Parses the buffer in place without copying or widening it, which lets us
+ * run directly on a memory mapped file.  Only what OpenStreetMap files need is supported: elements, attributes,
+ * entities, comments, processing instructions, CDATA and DOCTYPE declarations (the latter three are skipped).
+ */
+class FOSMXmlScanner
+{
+
+public:
+
+	FOSMXmlScanner( const ANSICHAR* InData, const int64 InSize );
+
+	/**
+	 * Scans the whole buffer, sending events to the callback.  ProgressCallback is invoked every few megabytes with
+	 * the number of bytes scanned so far, and can return false to cancel.
+	 *
+	 * @return True if the whole buffer was scanned successfully
+	 */
+	bool Parse( IOSMXmlCallback& Callback, TFunctionRef<bool( int64 )> ProgressCallback, FText& OutErrorMessage, int32& OutErrorLineNumber );
+
+	/**
+	 * Scans XML that arrives a piece at a time, such as from a decompressor, as if it were one buffer.  The data is
+	 * copied into a window that always ends right before a start tag outside of any comment or CDATA section, so
+	 * every window can be scanned on its own, and views the callback gets never point into more than one window.  The
+	 * window grows if a single element or section doesn't fit.
+	 *
+	 * @param	Read				Reads the next bytes into the buffer.  Returns how many it read, or zero at the end of the data.
+	 * @param	ProgressCallback	Invoked after every window, and can return false to cancel
+	 * @param	OutDataSize			How many bytes were read in total
+	 * @param	WindowSize			Initial size of the window
+	 *
+	 * @return	True if all of the data was scanned successfully
+	 */
+	static bool ParseStream( TFunctionRef<int32( ANSICHAR*, int32 )> Read, IOSMXmlCallback& Callback, TFunctionRef<bool()> ProgressCallback, FText& OutErrorMessage, int32& OutErrorLineNumber, int64& OutDataSize, const int32 WindowSize = DefaultStreamWindowSize );
+
+	/** Initial size of the window ParseStream scans, unless told otherwise */
+	static const int32 DefaultStreamWindowSize = 4 * 1024 * 1024;
+
+	/**
+	 * Finds the first comment or CDATA section that starts in a range of XML data.  Either can hold markup that isn't
+	 * part of the document, so XML data must never be split inside of one.
+	 *
+	 * @param	Position				Where to start looking.  Must not be inside of a comment or CDATA section itself.
+	 * @param	End						Where to stop looking
+	 * @param	OutSectionTerminator	The three characters the section ends with
+	 *
+	 * @return	Where the '<' of the section is, or null if no section starts in the range
+	 */
+	static const ANSICHAR* FindCommentOrCData( const ANSICHAR* Position, const ANSICHAR* End, const ANSICHAR*& OutSectionTerminator );
+
+	/** @return Where a comment or CDATA section ends, just past its terminator, or the end of the data if it never does */
+	static const ANSICHAR* FindSectionEnd( const ANSICHAR* Position, const ANSICHAR* End, const ANSICHAR* SectionTerminator );
+
+private:
+
+	/** Scans a start tag including its attributes.  Cur is right after the '<'. */
+	bool ScanStartTag( IOSMXmlCallback& Callback );
+
+	/** Scans an end tag.  Cur is right after the '</'. */
+	bool ScanEndTag( IOSMXmlCallback& Callback );
+
+	/** Skips everything up to and including the given terminator */
+	bool SkipPast( const ANSICHAR* Terminator );
+
+	/** Replaces entities in an attribute value.  The decoded string is stored in one of the DecodedValues buffers. */
+	FOSMStringView DecodeEntities( const FOSMStringView& Value );
+
+	/** @return The line number of the current scan position (only used for error reporting) */
+	int32 ComputeLineNumber() const;
+
+	const ANSICHAR* Data;
+	const ANSICHAR* Cur;
+	const ANSICHAR* End;
+
+	/** Storage for attribute values that contained entities.  Reused for every start tag. */
+	TArray<TArray<ANSICHAR>> DecodedValues;
+
+	/** Number of DecodedValues in use by the current start tag */
+	int32 NumDecodedValues;
+
+	/** Error set while scanning, if any */
+	FText Error;
+};
@@ -3,726 +3,2237 @@
 #include "StreetMapImporting.h"
 #include "StreetMapFactory.h"
 #include "OSMFile.h"
+#include "OSMChangeFile.h"
 #include "StreetMap.h"
+#include "StreetMapImportingSettings.h"
+#include "StreetMapImportProfile.h"
+#include "StreetMapImportProgress.h"
+#include "StreetMapImportCache.h"
+#include "OSMMultipolygon.h"
+#include "StreetMapSimplifier.h"
+#include "Async/ParallelFor.h"
+#include "Async/Async.h"
+#include "Containers/Ticker.h"
+#include "UObject/GCObject.h"
+#include "AssetRegistryModule.h"
+#include "SNotificationList.h"
+#include "NotificationManager.h"
+#include "Framework/Application/SlateApplication.h"
+
+#define LOCTEXT_NAMESPACE "StreetMapImporting"
+
+
+/**
+ * Turns the categories of highways and railways into the types of roads and railways we import, using the lookup
+ * tables from UStreetMapImportingSettings.  Categories are interned as FNames while parsing, so this is one hash lookup.
+ */
+class FStreetMapWayClassifier
+{
+
+public:
+
+	FStreetMapWayClassifier( const UStreetMapImportingSettings& Settings )
+	{
+		RoadTypes.Reserve( Settings.RoadCategories.Num() );
+		for( const FStreetMapRoadCategory& RoadCategory : Settings.RoadCategories )
+		{
+			RoadTypes.Add( RoadCategory.Category, RoadCategory.RoadType );
+		}
+
+		RailwayTypes.Reserve( Settings.RailwayCategories.Num() );
+		for( const FStreetMapRailwayCategory& RailwayCategory : Settings.RailwayCategories )
+		{
+			RailwayTypes.Add( RailwayCategory.Category, RailwayCategory.RailwayType );
+		}
+	}
+
+	/** Figures out the type of road for a highway.  Returns Other for highways we don't import. */
+	EStreetMapRoadType GetRoadTypeForWay( const FOSMFile::FOSMWayInfo& OSMWay ) const
+	{
+		const EStreetMapRoadType* RoadType = RoadTypes.Find( OSMWay.Category );
+		return RoadType != nullptr ? *RoadType : EStreetMapRoadType::Other;
+	}
+
+	/** Figures out the type of railway.  Returns OtherRailway for railways we don't import. */
+	EStreetMapRailwayType GetRailwayTypeForWay( const FOSMFile::FOSMWayInfo& OSMWay ) const
+	{
+		const EStreetMapRailwayType* RailwayType = RailwayTypes.Find( OSMWay.Category );
+		return RailwayType != nullptr ? *RailwayType : EStreetMapRailwayType::OtherRailway;
+	}
+
+	/** @return True if BuildStreetMapFromOSMFile would turn the way into a road, railway, building or miscellaneous way */
+	bool IsWayImported( const FOSMFile::FOSMWayInfo& OSMWay ) const
+	{
+		switch( OSMWay.WayType )
+		{
+			case FOSMFile::EOSMWayType::Highway: return GetRoadTypeForWay( OSMWay ) != EStreetMapRoadType::Other;
+			case FOSMFile::EOSMWayType::Railway: return GetRailwayTypeForWay( OSMWay ) != EStreetMapRailwayType::OtherRailway;
+			case FOSMFile::EOSMWayType::Other: return false;
+			default: return true;
+		}
+	}
+
+private:
+
+	/** Road type for each highway category we import */
+	TMap<FName, EStreetMapRoadType> RoadTypes;
+
+	/** Railway type for each railway category we import */
+	TMap<FName, EStreetMapRailwayType> RailwayTypes;
+};
+
+
+// OSM data is stored in meters.  This is the scale factor to convert those units into UE4's native units (cm)
+// Keep in mind that if this is changed, UStreetMapComponent sizes for roads may need to be updated too!
+// @todo: We should make this scale factor customizable as an import option
+static const float OSMToCentimetersScaleFactor = 100.0f;
+
+
+/** What a way of an OpenStreetMap file turns into */
+enum class EStreetMapWayOutput : uint8
+{
+	None,
+	Road,
+	Building,
+	Railway,
+	MiscWay,
+};
+
+struct FStreetMapWayOutput
+{
+	EStreetMapWayOutput Kind;
+
+	/** Road or railway type */
+	uint8 Type;
+
+	/** Index of the road, building, railway or misc way in the street map */
+	int32 Index;
+};
+
+
+/** Figures out what a way turns into, if anything */
+static FStreetMapWayOutput ClassifyWay( const FOSMFile::FOSMWayInfo& OSMWay, const FStreetMapWayClassifier& Classifier )
+{
+	FStreetMapWayOutput WayOutput;
+	WayOutput.Kind = EStreetMapWayOutput::None;
+	WayOutput.Type = 0;
+	WayOutput.Index = INDEX_NONE;
+
+	// Handle buildings differently than roads
+	if( OSMWay.WayType == FOSMFile::EOSMWayType::Building )
+	{
+		// Require at least three points so that we don't have degenerate polygon!
+		// @todo: Log skipped ways for the user as an import warning
+		if( OSMWay.Nodes.Num() >= 3 )
+		{
+			WayOutput.Kind = EStreetMapWayOutput::Building;
+		}
+	}
+	else if( OSMWay.WayType == FOSMFile::EOSMWayType::Highway )
+	{
+		// There are other types that we don't recognize yet.  See http://wiki.openstreetmap.org/wiki/Key:highway
+		// Also require at least two points!
+		const EStreetMapRoadType RoadType = Classifier.GetRoadTypeForWay( OSMWay );
+		if( RoadType != EStreetMapRoadType::Other && OSMWay.Nodes.Num() >= 2 )
+		{
+			WayOutput.Kind = EStreetMapWayOutput::Road;
+			WayOutput.Type = (uint8)RoadType;
+		}
+	}
+	else if( OSMWay.WayType == FOSMFile::EOSMWayType::Railway )
+	{
+		// There are other types that we don't recognize yet. See http://wiki.openstreetmap.org/wiki/Key:railway
+		const EStreetMapRailwayType RailwayType = Classifier.GetRailwayTypeForWay( OSMWay );
+		if( RailwayType != EStreetMapRailwayType::OtherRailway && OSMWay.Nodes.Num() >= 2 )
+		{
+			WayOutput.Kind = EStreetMapWayOutput::Railway;
+			WayOutput.Type = (uint8)RailwayType;
+		}
+	}
+	else if( OSMWay.WayType != FOSMFile::EOSMWayType::Other && OSMWay.Nodes.Num() > 0 )
+	{
+		WayOutput.Kind = EStreetMapWayOutput::MiscWay;
+	}
+
+	return WayOutput;
+}
+
+
+/** Computes the bounding box of a way's points */
+static void ComputeWayBounds( 
+	const TArray<FVector2D>& Points, 
+	FVector2D& OutBoundsMin, 
+	FVector2D& OutBoundsMax )
+{
+	FVector2D BoundsMin( TNumericLimits<float>::Max(), TNumericLimits<float>::Max() );
+	FVector2D BoundsMax( TNumericLimits<float>::Lowest(), TNumericLimits<float>::Lowest() );
+
+	for( const FVector2D& Point : Points )
+	{
+		if( Point.X < BoundsMin.X )
+		{
+			BoundsMin.X = Point.X;
+		}
+		if( Point.Y < BoundsMin.Y )
+		{
+			BoundsMin.Y = Point.Y;
+		}
+		if( Point.X > BoundsMax.X )
+		{
+			BoundsMax.X = Point.X;
+		}
+		if( Point.Y > BoundsMax.Y )
+		{
+			BoundsMax.Y = Point.Y;
+		}
+	}
+
+	OutBoundsMin = BoundsMin;
+	OutBoundsMax = BoundsMax;
+}
+
+
+/** Copies a way's points out of the projected nodes, both as floats and exactly, and computes their bounding box */
+static void CopyWayPoints( 
+	const FOSMFile::FOSMWayInfo& OSMWay, 
+	const TArray<FStreetMapExactPoint>& NodePositions,
+	TArray<FVector2D>& OutPoints, 
+	TArray<FStreetMapExactPoint>& OutExactPoints,
+	FVector2D& OutBoundsMin, 
+	FVector2D& OutBoundsMax )
+{
+	OutPoints.SetNumUninitialized( OSMWay.Nodes.Num() );
+	OutExactPoints.SetNumUninitialized( OSMWay.Nodes.Num() );
+	for( int32 PointIndex = 0; PointIndex < OSMWay.Nodes.Num(); ++PointIndex )
+	{
+		OutExactPoints[ PointIndex ] = NodePositions[ OSMWay.Nodes[ PointIndex ] ];
+		OutPoints[ PointIndex ] = OutExactPoints[ PointIndex ].ToVector2D();
+	}
+
+	ComputeWayBounds( OutPoints, OutBoundsMin, OutBoundsMax );
+}
+
+
+/** Fills in a road using the OpenStreetMap data, flattening the road's coordinates into our map's space */
+static void FillRoadForWay(
+	const FOSMFile::FOSMWayInfo& OSMWay, 
+	const TArray<FStreetMapExactPoint>& NodePositions,
+	const EStreetMapRoadType RoadType,
+	FStreetMapRoad& NewRoad )
+{
+	CopyWayPoints( OSMWay, NodePositions, NewRoad.RoadPoints, NewRoad.ExactPoints, NewRoad.BoundsMin, NewRoad.BoundsMax );
+
+	// Set defaults for each node index on this road.  INDEX_NONE means the node is not valid, which may be the case
+	// for nodes that we filter out entirely.  This will be filled in by valid indices to nodes later on.
+	NewRoad.NodeIndices.Init( INDEX_NONE, OSMWay.Nodes.Num() );
+
+	NewRoad.RoadName = OSMWay.Name;
+	if( NewRoad.RoadName.IsEmpty() )
+	{
+		NewRoad.RoadName = OSMWay.Ref;
+	}
+	NewRoad.RoadType = RoadType;
+
+	NewRoad.bIsOneWay = OSMWay.bIsOneWay;
+}
+
+
+/** Fills in a building using the OpenStreetMap data, flattening the road's coordinates into our map's space */
+static void FillBuildingForWay( 
+	const FOSMFile::FOSMWayInfo& OSMWay,
+	const TArray<FStreetMapExactPoint>& NodePositions,
+	FStreetMapBuilding& NewBuilding )
+{
+	CopyWayPoints( OSMWay, NodePositions, NewBuilding.BuildingPoints, NewBuilding.ExactPoints, NewBuilding.BoundsMin, NewBuilding.BoundsMax );
+
+	// Make sure the building ended up with a closed polygon, then remove the final (redundant) point
+	const bool bIsClosed = NewBuilding.BuildingPoints[ 0 ].Equals( NewBuilding.BuildingPoints[ NewBuilding.BuildingPoints.Num() - 1 ], KINDA_SMALL_NUMBER );
+	if( bIsClosed )
+	{
+		// Remove the final redundant point
+		NewBuilding.BuildingPoints.Pop();
+		NewBuilding.ExactPoints.Pop();
+	}
+	else
+	{
+		// Wasn't expecting to have an unclosed shape.  Our tolerances might be off, or the data was malformed.
+		// Either way, it shouldn't be a problem as we'll close the shape ourselves below.
+		// @todo: Log this for the user as an import warning
+	}
+
+	NewBuilding.BuildingName = OSMWay.Name;
+	if( NewBuilding.BuildingName.IsEmpty() )
+	{
+		NewBuilding.BuildingName = OSMWay.Ref;
+	}
+
+	NewBuilding.Height = OSMWay.Height * OSMToCentimetersScaleFactor;
+	NewBuilding.BuildingLevels = OSMWay.BuildingLevels;
+}
+
+
+/** Fills in a railway using the OpenStreetMap data, flattening the railway's coordinates into our map's space */
+static void FillRailwayForWay(
+	const FOSMFile::FOSMWayInfo& OSMWay,
+	const TArray<FStreetMapExactPoint>& NodePositions,
+	const EStreetMapRailwayType RailwayType,
+	FStreetMapRailway& NewRailway)
+{
+	CopyWayPoints(OSMWay, NodePositions, NewRailway.Points, NewRailway.ExactPoints, NewRailway.BoundsMin, NewRailway.BoundsMax);
+
+	// Set defaults for each node index on this railway.  INDEX_NONE means the node is not valid, which may be the case
+	// for nodes that we filter out entirely.  This will be filled in by valid indices to nodes later on.
+	NewRailway.NodeIndices.Init(INDEX_NONE, OSMWay.Nodes.Num());
+
+	NewRailway.Name = OSMWay.Name;
+	if (NewRailway.Name.IsEmpty())
+	{
+		NewRailway.Name = OSMWay.Ref;
+	}
+	NewRailway.Type = RailwayType;
+}
+
+
+/** Fills in any remaining recognized ways using the OpenStreetMap data */
+static void FillMiscWay(
+	const FOSMFile::FOSMWayInfo& OSMWay,
+	const TArray<FStreetMapExactPoint>& NodePositions,
+	FStreetMapMiscWay& NewMiscWay)
+{
+	CopyWayPoints(OSMWay, NodePositions, NewMiscWay.Points, NewMiscWay.ExactPoints, NewMiscWay.BoundsMin, NewMiscWay.BoundsMax);
+
+	// Test if the building ended up with a closed polygon, then remove the final (redundant) point
+	const bool bIsClosed = NewMiscWay.Points[0].Equals(NewMiscWay.Points[NewMiscWay.Points.Num() - 1], KINDA_SMALL_NUMBER);
+	if (bIsClosed)
+	{
+		// Remove the final redundant point
+		NewMiscWay.Points.Pop();
+		NewMiscWay.ExactPoints.Pop();
+	}
+	else
+	{
+		// Unclosed shapes are total fine (e.g. tree_row)
+	}
+
+
+	NewMiscWay.Type = EStreetMapMiscWayType::Unknown;
+	switch (OSMWay.WayType)
+	{
+		case FOSMFile::EOSMWayType::Leisure: NewMiscWay.Type = EStreetMapMiscWayType::Leisure; break;
+		case FOSMFile::EOSMWayType::Natural: NewMiscWay.Type = EStreetMapMiscWayType::Natural; break;
+		case FOSMFile::EOSMWayType::LandUse: NewMiscWay.Type = EStreetMapMiscWayType::LandUse; break;
+	}
+
+	NewMiscWay.Name = OSMWay.Name;
+	if (NewMiscWay.Name.IsEmpty())
+	{
+		NewMiscWay.Name = OSMWay.Ref;
+	}
+
+	NewMiscWay.Category = OSMWay.Category.IsNone() ? FString() : OSMWay.Category.ToString();
+
+	NewMiscWay.bIsClosed = bIsClosed;
+}
+
+
+/** Records which OpenStreetMap way and nodes an element of the street map was built from, one node for each of its NumPoints points */
+static void FillWaySource( 
+	const FOSMFile::FOSMWayInfo& OSMWay, 
+	const int32 NumPoints, 
+	TFunctionRef<int64( int32 )> GetNodeId, 
+	FStreetMapWaySource& NewSource )
+{
+	NewSource.WayId = OSMWay.Id;
+	NewSource.NodeIds.SetNumUninitialized( NumPoints );
+	for( int32 PointIndex = 0; PointIndex < NumPoints; ++PointIndex )
+	{
+		NewSource.NodeIds[ PointIndex ] = GetNodeId( OSMWay.Nodes[ PointIndex ] );
+	}
+}
+
+
+/** Sets up the type, category and name of the areas of a multipolygon from the relation's tags.  @return False if the relation isn't an area we import as misc ways */
+static bool ClassifyMultipolygon( const FOSMFile::FOSMRelation& OSMRelation, FStreetMapMiscWay& OutMiscWay )
+{
+	static const FName NameKey( TEXT( "name" ) );
+	static const FName LeisureKey( TEXT( "leisure" ) );
+	static const FName NaturalKey( TEXT( "natural" ) );
+	static const FName LandUseKey( TEXT( "landuse" ) );
+
+	OutMiscWay.Type = EStreetMapMiscWayType::Unknown;
+	for( const FOSMFile::FOSMTag& Tag : OSMRelation.Tags )
+	{
+		if( Tag.Key == NameKey )
+		{
+			OutMiscWay.Name = Tag.Value.ToString();
+		}
+		else if( OutMiscWay.Type == EStreetMapMiscWayType::Unknown )
+		{
+			// Same as for ways, the first tag we recognize decides what the area is
+			if( Tag.Key == LeisureKey )
+			{
+				OutMiscWay.Type = EStreetMapMiscWayType::Leisure;
+			}
+			else if( Tag.Key == NaturalKey )
+			{
+				OutMiscWay.Type = EStreetMapMiscWayType::Natural;
+			}
+			else if( Tag.Key == LandUseKey )
+			{
+				OutMiscWay.Type = EStreetMapMiscWayType::LandUse;
+			}
+
+			if( OutMiscWay.Type != EStreetMapMiscWayType::Unknown )
+			{
+				OutMiscWay.Category = Tag.Value.ToString();
+			}
+		}
+	}
+
+	OutMiscWay.bIsClosed = true;
+	return OutMiscWay.Type != EStreetMapMiscWayType::Unknown;
+}
+
+
+/** Looks up the positions of a ring's nodes, both as floats and exactly */
+static void CopyRingPoints( 
+	const TArray<int32>& RingNodes, 
+	const TArray<FStreetMapExactPoint>& NodePositions, 
+	TArray<FVector2D>& OutPoints,
+	TArray<FStreetMapExactPoint>& OutExactPoints )
+{
+	OutPoints.SetNumUninitialized( RingNodes.Num() );
+	OutExactPoints.SetNumUninitialized( RingNodes.Num() );
+	for( int32 PointIndex = 0; PointIndex < RingNodes.Num(); ++PointIndex )
+	{
+		OutExactPoints[ PointIndex ] = NodePositions[ RingNodes[ PointIndex ] ];
+		OutPoints[ PointIndex ] = OutExactPoints[ PointIndex ].ToVector2D();
+	}
+}
+
+
+/** The points of the elements we build from ways */
+static TArray<FVector2D>& GetWayPoints( FStreetMapRoad& Road ) { return Road.RoadPoints; }
+static TArray<FVector2D>& GetWayPoints( FStreetMapBuilding& Building ) { return Building.BuildingPoints; }
+static TArray<FVector2D>& GetWayPoints( FStreetMapRailway& Railway ) { return Railway.Points; }
+static TArray<FVector2D>& GetWayPoints( FStreetMapMiscWay& MiscWay ) { return MiscWay.Points; }
+
+
+/**
+ * Moves the points of the elements of a category that are at nodes that moved, and updates their bounding boxes.  The
+ * elements are unpacked to do that, and added to OutMovedElements, so that they can be packed again afterwards.
+ */
+template<typename ElementType>
+static void MoveChangedWayPoints(
+	UStreetMap& StreetMap,
+	const EStreetMapDataCategory Category,
+	TArray<ElementType>& Elements,
+	const TMap<int64, FStreetMapExactPoint>& ChangedNodePositions,
+	TSet<int32>& OutMovedElements )
+{
+	for( const TPair<int64, FStreetMapExactPoint>& ChangedNode : ChangedNodePositions )
+	{
+		StreetMap.ForEachNodePoint( Category, ChangedNode.Key, [&StreetMap, Category, &Elements, &ChangedNode, &OutMovedElements]( int32 ElementIndex, int32 PointIndex )
+		{
+			StreetMap.UnpackElement( Category, ElementIndex );
+			ElementType& Element = Elements[ ElementIndex ];
+			GetWayPoints( Element )[ PointIndex ] = ChangedNode.Value.ToVector2D();
+			Element.ExactPoints[ PointIndex ] = ChangedNode.Value;
+			OutMovedElements.Add( ElementIndex );
+		} );
+	}
+
+	for( const int32 ElementIndex : OutMovedElements )
+	{
+		ComputeWayBounds( GetWayPoints( Elements[ ElementIndex ] ), Elements[ ElementIndex ].BoundsMin, Elements[ ElementIndex ].BoundsMax );
+	}
+}
+
+
+/**
+ * Removes the points the simplifier didn't keep from a way, along with their exact points, node indices and node IDs
+ * where the way has those.  If asked for, fills in where every point went: its new index, or INDEX_NONE if it was removed.
+ */
+static void RemoveSimplifiedPoints(
+	const TArray<bool>& KeepPoints,
+	TArray<FVector2D>& Points,
+	TArray<FStreetMapExactPoint>& ExactPoints,
+	TArray<int32>* NodeIndices,
+	TArray<int64>* NodeIds,
+	TArray<int32>* OutNewPointIndices )
+{
+	if( OutNewPointIndices != nullptr )
+	{
+		OutNewPointIndices->Init( INDEX_NONE, Points.Num() );
+	}
+
+	const bool bHasExactPoints = ExactPoints.Num() == Points.Num();
+	int32 NumKeptPoints = 0;
+	for( int32 PointIndex = 0; PointIndex < Points.Num(); ++PointIndex )
+	{
+		if( KeepPoints[ PointIndex ] )
+		{
+			Points[ NumKeptPoints ] = Points[ PointIndex ];
+			if( bHasExactPoints )
+			{
+				ExactPoints[ NumKeptPoints ] = ExactPoints[ PointIndex ];
+			}
+			if( NodeIndices != nullptr )
+			{
+				( *NodeIndices )[ NumKeptPoints ] = ( *NodeIndices )[ PointIndex ];
+			}
+			if( NodeIds != nullptr )
+			{
+				( *NodeIds )[ NumKeptPoints ] = ( *NodeIds )[ PointIndex ];
+			}
+			if( OutNewPointIndices != nullptr )
+			{
+				( *OutNewPointIndices )[ PointIndex ] = NumKeptPoints;
+			}
+			++NumKeptPoints;
+		}
+	}
+
+	Points.SetNum( NumKeptPoints );
+	if( bHasExactPoints )
+	{
+		ExactPoints.SetNum( NumKeptPoints );
+	}
+	if( NodeIndices != nullptr )
+	{
+		NodeIndices->SetNum( NumKeptPoints );
+	}
+	if( NodeIds != nullptr )
+	{
+		NodeIds->SetNum( NumKeptPoints );
+	}
+}
+
+
+/** Looks up where a node is, using the point of any element of a category that is at it.  @return False if no element of the category is. */
+template<typename ElementType>
+static bool FindWayNodePosition(
+	const UStreetMap& StreetMap,
+	const EStreetMapDataCategory Category,
+	const TArray<ElementType>& Elements,
+	const int64 NodeId,
+	FStreetMapExactPoint& OutPosition )
+{
+	bool bFound = false;
+	StreetMap.ForEachNodePoint( Category, NodeId, [&StreetMap, &Elements, &OutPosition, &bFound]( int32 ElementIndex, int32 PointIndex )
+	{
+		Elements[ ElementIndex ].GetPoints( StreetMap ).GetExact( PointIndex, OutPosition.X, OutPosition.Y );
+		bFound = true;
+	} );
+	return bFound;
+}
+
+
+/**
+ * An import that runs on a thread of its own while the editor keeps going.  The thread only builds a plain
+ * FStreetMapBuildResult.  A ticker on the game thread shows its progress in a notification, passes on the notification's
+ * cancel button, and creates the street map from the result once the thread is done.  The package the street map goes
+ * into and the factory are kept alive until then.
+ *
+ * The editor was told the import was canceled when it moved to the background, since there was nothing to report yet.
+ * Once the street map is there, the import broadcasts the post-import (and for reimports, the reimport) events the
+ * editor would have, and its notification says how it went.
+ */
+class FStreetMapBackgroundImport : public FGCObject, public TSharedFromThis<FStreetMapBackgroundImport>
+{
+
+public:
+
+	/** Loads and builds the street map.  Runs on the import's thread. */
+	typedef TFunction<bool( FStreetMapBuildResult&, FStreetMapImportProfile&, FStreetMapImportProgress*, FFeedbackContext* )> FBuildFunction;
+
+	/** Creates the street map from what was built.  Runs on the game thread. */
+	typedef TFunction<UStreetMap*( UObject*, FStreetMapBuildResult&, FStreetMapImportProfile&, FFeedbackContext* )> FCreateFunction;
+
+	/** Starts building on a thread of its own.  The import takes care of itself from here on. */
+	static void Start( UFactory* Factory, const bool bReimport, UObject* Parent, const FString& Name, FBuildFunction Build, FCreateFunction Create )
+	{
+		check( IsInGameThread() );
+
+		TSharedRef<FStreetMapBackgroundImport> Import = MakeShareable( new FStreetMapBackgroundImport( Factory, bReimport, Parent, Name, MoveTemp( Create ) ) );
+
+		FNotificationInfo Info( Import->GetProgressText() );
+		Info.bFireAndForget = false;
+		Info.ButtonDetails.Add( FNotificationButtonInfo( 
+			LOCTEXT( "CancelStreetMapImport", "Cancel" ), 
+			LOCTEXT( "CancelStreetMapImportTooltip", "Stops importing the street map" ), 
+			FSimpleDelegate::CreateSP( Import, &FStreetMapBackgroundImport::Cancel ), 
+			SNotificationItem::CS_Pending ) );
+		Import->Notification = FSlateNotificationManager::Get().AddNotification( Info );
+		if( Import->Notification.IsValid() )
+		{
+			Import->Notification->SetCompletionState( SNotificationItem::CS_Pending );
+		}
+
+		// Everything the thread uses belongs to the import, which the ticker keeps alive until the thread is done
+		FStreetMapBackgroundImport* ImportPtr = &Import.Get();
+		Import->Work = Async<bool>( EAsyncExecution::Thread, [ImportPtr, Build]()
+		{
+			return Build( ImportPtr->Result, ImportPtr->Profile, &ImportPtr->Progress, &ImportPtr->Feedback );
+		} );
+
+		FTicker::GetCoreTicker().AddTicker( FTickerDelegate::CreateLambda( [Import]( float DeltaTime )
+		{
+			return Import->Tick();
+		} ) );
+	}
+
+	virtual ~FStreetMapBackgroundImport()
+	{
+		// Only happens before the thread is done if the editor shuts down
+		if( Work.IsValid() )
+		{
+			Progress.RequestCancel();
+			Work.Wait();
+		}
+	}
+
+	// FGCObject overrides
+	virtual void AddReferencedObjects( FReferenceCollector& Collector ) override
+	{
+		Collector.AddReferencedObject( Factory );
+		Collector.AddReferencedObject( Parent );
+	}
+
+private:
+
+	FStreetMapBackgroundImport( UFactory* InFactory, const bool bInReimport, UObject* InParent, const FString& InName, FCreateFunction InCreate )
+		: Factory( InFactory )
+		, bReimport( bInReimport )
+		, Parent( InParent )
+		, Name( InName )
+		, Create( MoveTemp( InCreate ) )
+	{
+	}
+
+	/** Shows how far along the thread is, and finishes the import once it's done.  @return False once the import is finished. */
+	bool Tick()
+	{
+		if( !Work.IsReady() )
+		{
+			if( Notification.IsValid() )
+			{
+				Notification->SetText( GetProgressText() );
+			}
+			return true;
+		}
+
+		Finish();
+		return false;
+	}
+
+	/** @return What the notification says while the thread is busy */
+	FText GetProgressText() const
+	{
+		const FText Description = Progress.GetDescription();
+		return Description.IsEmpty() ?
+			FText::Format( bReimport ? LOCTEXT( "ReimportingStreetMapInBackground", "Reimporting street map {0} in the background" ) : LOCTEXT( "ImportingStreetMapInBackground", "Importing street map {0} in the background" ), FText::FromString( Name ) ) :
+			FText::Format( bReimport ? LOCTEXT( "ReimportingStreetMapInBackgroundProgress", "Reimporting street map {0} in the background: {1} ({2})" ) : LOCTEXT( "ImportingStreetMapInBackgroundProgress", "Importing street map {0} in the background: {1} ({2})" ), FText::FromString( Name ), Description, FText::AsPercent( Progress.GetFraction() ) );
+	}
+
+	/** Creates the street map, if building it worked out, and tells the editor and the user how it went */
+	void Finish()
+	{
+		const bool bBuilt = Work.Get();
+		Work = TFuture<bool>();
+
+		// Whoever started the import is long gone, so its messages go to the editor's log
+		Feedback.Flush( []( ELogVerbosity::Type Verbosity, const FString& Message )
+		{
+			GWarn->Logf( Verbosity, TEXT( "%s" ), *Message );
+		} );
+
+		UStreetMap* StreetMap = nullptr;
+		const bool bCanceled = Progress.ShouldCancel();
+		if( bCanceled )
+		{
+			GWarn->Logf( ELogVerbosity::Warning, TEXT( "Import of street map '%s' was canceled" ), *Name );
+		}
+		else if( bBuilt && Parent != nullptr && !Parent->IsPendingKill() )
+		{
+			// Reimports replace the street map that is already there, which the asset registry knows about
+			const bool bIsNewAsset = FindObject<UStreetMap>( Parent, *Name ) == nullptr;
+			StreetMap = Create( Parent, Result, Profile, GWarn );
+			if( StreetMap != nullptr )
+			{
+				if( bIsNewAsset )
+				{
+					FAssetRegistryModule::AssetCreated( StreetMap );
+				}
+				StreetMap->MarkPackageDirty();
+				StreetMap->PostEditChange();
+			}
+		}
+
+		// What FactoryCreateFile and the reimport manager would have broadcast, had the import finished right away
+		FEditorDelegates::OnAssetPostImport.Broadcast( Factory, StreetMap );
+		if( bReimport && StreetMap != nullptr && GEditor != nullptr )
+		{
+			GEditor->BroadcastObjectReimported( StreetMap );
+			FEditorDelegates::OnAssetReimport.Broadcast( StreetMap );
+		}
+
+		if( Notification.IsValid() )
+		{
+			const FText NameText = FText::FromString( Name );
+			FText Text;
+			if( StreetMap != nullptr )
+			{
+				Text = bReimport ? LOCTEXT( "ReimportedStreetMap", "Reimported street map {0}" ) : LOCTEXT( "ImportedStreetMap", "Imported street map {0}" );
+			}
+			else if( bCanceled )
+			{
+				Text = bReimport ? LOCTEXT( "CanceledStreetMapReimport", "Canceled reimport of street map {0}" ) : LOCTEXT( "CanceledStreetMapImport", "Canceled import of street map {0}" );
+			}
+			else
+			{
+				Text = bReimport ? LOCTEXT( "FailedStreetMapReimport", "Failed to reimport street map {0}.  See the output log for details." ) : LOCTEXT( "FailedStreetMapImport", "Failed to import street map {0}.  See the output log for details." );
+			}
+			Notification->SetText( FText::Format( Text, NameText ) );
+			Notification->SetCompletionState( StreetMap != nullptr ? SNotificationItem::CS_Success : SNotificationItem::CS_Fail );
+			Notification->ExpireAndFadeout();
+			Notification.Reset();
+		}
+	}
+
+	/** Called by the notification's cancel button */
+	void Cancel()
+	{
+		Progress.RequestCancel();
+	}
+
+	/** Factory that started the import, which the editor's import events are broadcast for */
+	UFactory* Factory;
+
+	/** True if the import replaces a street map's contents from its source file */
+	bool bReimport;
+
+	/** Where the street map goes, and what it's called */
+	UObject* Parent;
+	FString Name;
+
+	FCreateFunction Create;
+
+	/** Written by the thread, and only read on the game thread once it's done */
+	FStreetMapBuildResult Result;
+	FStreetMapImportProfile Profile;
+
+	/** Shared by the thread and the game thread */
+	FStreetMapImportProgress Progress;
+	FStreetMapBufferedFeedback Feedback;
+
+	/** The thread.  Invalid once the import is finished. */
+	TFuture<bool> Work;
+
+	TSharedPtr<SNotificationItem> Notification;
+};
+
+
+UStreetMapFactory::UStreetMapFactory(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	SupportedClass = UStreetMap::StaticClass();
+
+	Formats.Add( TEXT( "osm;OpenStreetMap XML" ) );
+	Formats.Add( TEXT( "pbf;OpenStreetMap PBF" ) );
+	Formats.Add( TEXT( "gz;OpenStreetMap XML (gzip)" ) );
+	Formats.Add( TEXT( "bz2;OpenStreetMap XML (bzip2)" ) );
+	bCreateNew = false;
+	bEditorImport = true;
+	bEditAfterNew = false;
+	bText = true;
+	bImportingInBackground = false;
+	bReimporting = false;
+}
+
+
+UObject* UStreetMapFactory::FactoryCreateText( UClass* Class, UObject* Parent, FName Name, EObjectFlags Flags, UObject* Context, const TCHAR* Type, const TCHAR*& Buffer, const TCHAR* BufferEnd, FFeedbackContext* Warn )
+{
+	// NOTE: Files are imported through FactoryCreateFile, which parses them in place.  We only end up here when
+	//       somebody hands us text that is already in memory, which our scanner wants as UTF-8.  Whoever does that
+	//       wants the street map back, so this never runs in the background.
+	const int32 CharacterCount = BufferEnd - Buffer;
+	const FTCHARToUTF8 Utf8Buffer( Buffer, CharacterCount );
+	TSharedRef<TArray<ANSICHAR>> XmlData = MakeShareable( new TArray<ANSICHAR>( Utf8Buffer.Get(), Utf8Buffer.Length() ) );
+
+	// There's no file to hash, so there's nothing to cache either
+	return ImportStreetMap( Parent, Name, Flags, GetCurrentFilename(), false, [XmlData]( FOSMFile& OSMFile, FFeedbackContext* LoadFeedbackContext )
+	{
+		return OSMFile.LoadOpenStreetMapXml( XmlData->GetData(), XmlData->Num(), LoadFeedbackContext );
+	}, false, Warn );
+}
+
+
+UObject* UStreetMapFactory::FactoryCreateFile( UClass* InClass, UObject* InParent, FName InName, EObjectFlags Flags, const FString& Filename, const TCHAR* Parms, FFeedbackContext* Warn, bool& bOutOperationCanceled )
+{
+	const FString FileExtension = FPaths::GetExtension( Filename );
+
+	FEditorDelegates::OnAssetPreImport.Broadcast( this, InClass, InParent, InName, *FileExtension );
+
+	// Change files only describe what changed, so they can't be imported on their own.  See UStreetMapReimportFactory.
+	if( FileExtension.Equals( TEXT( "osc" ), ESearchCase::IgnoreCase ) )
+	{
+		if( Warn != nullptr )
+		{
+			Warn->Logf( ELogVerbosity::Error, TEXT( "'%s' is an OpenStreetMap change file.  Reimport an existing street map with it to apply it." ), *Filename );
+		}
+		FEditorDelegates::OnAssetPostImport.Broadcast( this, nullptr );
+		return nullptr;
+	}
+
+	// We read the files ourselves instead of letting UFactory load them into an FString.  PBF files are binary,
+	// compressed XML files are decompressed while we parse them, and XML files are memory mapped and parsed in place
+	// as UTF-8.
+	UStreetMap* StreetMap = ImportStreetMap( InParent, InName, Flags, Filename, true, MakeFileLoadFunction( Filename ), true, Warn );
+
+	// An import that goes on in the background counts as canceled here, since there is nothing to report yet and
+	// the editor would report it as failed otherwise.  It broadcasts the post-import event and notifies the user
+	// itself once it's done.
+	bOutOperationCanceled = bImportingInBackground;
+	if( !bImportingInBackground )
+	{
+		FEditorDelegates::OnAssetPostImport.Broadcast( this, StreetMap );
+	}
+
+	return StreetMap;
+}
+
+
+void UStreetMapFactory::ConfigureOSMFile( const FStreetMapImportSettings& Settings, FOSMFile& OSMFile )
+{
+	if( Settings.bOnlyLoadReferencedNodes )
+	{
+		// The filter is copied into every chunk of a file that is parsed in parallel, so they all share one classifier
+		TSharedRef<const FStreetMapWayClassifier> Classifier = MakeShareable( new FStreetMapWayClassifier( *GetDefault<UStreetMapImportingSettings>() ) );
+		OSMFile.SetWayFilter( [Classifier]( const FOSMFile::FOSMWayInfo& OSMWay ) { return Classifier->IsWayImported( OSMWay ); } );
+	}
+
+	OSMFile.SetParallelParsing( Settings.bParseXmlInParallel );
+
+	if( Settings.ImportArea == EStreetMapImportArea::BoundingBox )
+	{
+		OSMFile.SetImportBounds( Settings.MinLatitude, Settings.MinLongitude, Settings.MaxLatitude, Settings.MaxLongitude );
+	}
+	else if( Settings.ImportArea == EStreetMapImportArea::Radius )
+	{
+		OSMFile.SetImportRadius( Settings.CenterLatitude, Settings.CenterLongitude, Settings.RadiusMeters );
+	}
+}
+
+
+UStreetMapFactory::FLoadFunction UStreetMapFactory::MakeFileLoadFunction( const FString& OSMFilePath )
+{
+	const FString FileExtension = FPaths::GetExtension( OSMFilePath );
+	if( FileExtension.Equals( TEXT( "pbf" ), ESearchCase::IgnoreCase ) )
+	{
+		return [OSMFilePath]( FOSMFile& OSMFile, FFeedbackContext* LoadFeedbackContext )
+		{
+			return OSMFile.LoadOpenStreetMapPbfFile( OSMFilePath, LoadFeedbackContext );
+		};
+	}
+	if( IsCompressedFileExtension( FileExtension ) )
+	{
+		return [OSMFilePath]( FOSMFile& OSMFile, FFeedbackContext* LoadFeedbackContext )
+		{
+			return OSMFile.LoadOpenStreetMapCompressedFile( OSMFilePath, LoadFeedbackContext );
+		};
+	}
+
+	// Load up the OSM file.  It's in XML format.
+	return [OSMFilePath]( FOSMFile& OSMFile, FFeedbackContext* LoadFeedbackContext )
+	{
+		return OSMFile.LoadOpenStreetMapFile( OSMFilePath, LoadFeedbackContext );
+	};
+}
+
+
+bool UStreetMapFactory::IsCompressedFileExtension( const FString& FileExtension )
+{
+	return FileExtension.Equals( TEXT( "gz" ), ESearchCase::IgnoreCase ) || FileExtension.Equals( TEXT( "bz2" ), ESearchCase::IgnoreCase );
+}
+
+
+UStreetMap* UStreetMapFactory::ImportStreetMap( UObject* Parent, FName Name, EObjectFlags Flags, const FString& SourceFilePath, const bool bUseCache, FLoadFunction LoadFile, const bool bCanRunInBackground, FFeedbackContext* FeedbackContext )
+{
+	check( IsInGameThread() );
+
+	bImportingInBackground = false;
+
+	// Building only gets copies of what it needs, so that the factory may go away or start another import in the meantime
+	const FStreetMapImportSettings Settings = ImportSettings;
+	const FString CacheFilePath = bUseCache ? SourceFilePath : FString();
+	auto Build = [Settings, CacheFilePath, LoadFile]( FStreetMapBuildResult& Result, FStreetMapImportProfile& Profile, FStreetMapImportProgress* Progress, FFeedbackContext* BuildFeedbackContext )
+	{
+		FScopedStreetMapImportProgress ImportProgress( Progress, 4.0f, FText() );
+
+		ImportProgress.EnterProgressFrame( 3.0f );
+		const TSharedPtr<FOSMFile> OSMFile = LoadOSMFile( Settings, CacheFilePath, LoadFile, Profile, Progress, BuildFeedbackContext );
+		if( !OSMFile.IsValid() )
+		{
+			// Loading failed.  The actual error message will be sent to the FeedbackContext's log.
+			return false;
+		}
+
+		ImportProgress.EnterProgressFrame( 1.0f );
+		FScopedStreetMapImportPhase BuildPhase( &Profile, TEXT( "Build" ) );
+		return BuildStreetMapFromOSMFile( Settings, *OSMFile, Result, &Profile, Progress, BuildFeedbackContext );
+	};
+	auto Create = [Name, Flags, SourceFilePath, Settings]( UObject* CreateParent, FStreetMapBuildResult& Result, FStreetMapImportProfile& Profile, FFeedbackContext* CreateFeedbackContext )
+	{
+		return CreateStreetMap( CreateParent, Name, Flags, SourceFilePath, Settings, Result, Profile, CreateFeedbackContext );
+	};
+
+	// Unattended imports expect the street map to be there when we return, so they wait for it
+	const bool bIsInteractive = GIsEditor && !IsRunningCommandlet() && !GIsAutomationTesting && !IsAutomatedImport() && FSlateApplication::IsInitialized();
+	if( bCanRunInBackground && bIsInteractive )
+	{
+		FStreetMapBackgroundImport::Start( this, bReimporting, Parent, Name.ToString(), Build, Create );
+		bImportingInBackground = true;
+		return nullptr;
+	}
+
+	FStreetMapImportProfile Profile;
+	FStreetMapBuildResult Result;
+	if( !Build( Result, Profile, nullptr, FeedbackContext ) )
+	{
+		return nullptr;
+	}
+	return Create( Parent, Result, Profile, FeedbackContext );
+}
+
+
+TSharedPtr<FOSMFile> UStreetMapFactory::LoadOSMFileForImport( const FString& OSMFilePath, FStreetMapImportProfile& Profile, FFeedbackContext* FeedbackContext ) const
+{
+	return LoadOSMFile( ImportSettings, OSMFilePath, MakeFileLoadFunction( OSMFilePath ), Profile, nullptr, FeedbackContext );
+}
+
+
+TSharedPtr<FOSMFile> UStreetMapFactory::LoadOSMFile( const FStreetMapImportSettings& Settings, const FString& SourceFilePath, TFunctionRef<bool( FOSMFile&, FFeedbackContext* )> LoadFile, FStreetMapImportProfile& Profile, FStreetMapImportProgress* Progress, FFeedbackContext* FeedbackContext )
+{
+	const UStreetMapImportingSettings& ImportingSettings = *GetDefault<UStreetMapImportingSettings>();
+
+	FScopedStreetMapImportPhase LoadPhase( &Profile, TEXT( "Load" ) );
+
+	// Hashing and writing the cache entry are quick compared to parsing
+	FScopedStreetMapImportProgress LoadProgress( Progress, 10.0f, FText() );
+
+	TSharedPtr<FOSMFile> LoadedOSMFile = MakeShareable( new FOSMFile() );
+
+	LoadProgress.EnterProgressFrame( 1.0f, LOCTEXT( "HashingSourceFile", "Hashing OpenStreetMap file" ) );
+	FString CacheKey;
+	if( ImportingSettings.bCacheParsedFiles && !SourceFilePath.IsEmpty() )
+	{
+		FScopedStreetMapImportPhase CachePhase( &Profile, TEXT( "Hash source file" ) );
+		CacheKey = FStreetMapImportCache::MakeCacheKey( SourceFilePath, Settings, ImportingSettings );
+	}
+
+	LoadProgress.EnterProgressFrame( 8.0f, LOCTEXT( "LoadingSourceFile", "Loading OpenStreetMap file" ) );
+	if( LoadProgress.ShouldCancel() )
+	{
+		return nullptr;
+	}
+
+	bool bLoadedFromCache = false;
+	if( !CacheKey.IsEmpty() )
+	{
+		FScopedStreetMapImportPhase CachePhase( &Profile, TEXT( "Load from cache" ) );
+		LoadedOSMFile->SetProfile( &Profile );
+		bLoadedFromCache = FStreetMapImportCache::Load( CacheKey, *LoadedOSMFile );
+		if( !bLoadedFromCache )
+		{
+			// Start over with a clean file, in case we got halfway through a broken entry
+			LoadedOSMFile = MakeShareable( new FOSMFile() );
+		}
+	}
+
+	if( bLoadedFromCache )
+	{
+		if( FeedbackContext != nullptr )
+		{
+			FeedbackContext->Logf( ELogVerbosity::Display, TEXT( "Street map cache hit for '%s', skipped parsing (%s)" ), *SourceFilePath, *CacheKey );
+		}
+	}
+	else
+	{
+		ConfigureOSMFile( Settings, *LoadedOSMFile );
+		LoadedOSMFile->SetProfile( &Profile );
+		LoadedOSMFile->SetProgress( Progress );
+		if( !LoadFile( *LoadedOSMFile, FeedbackContext ) )
+		{
+			return nullptr;
+		}
+
+		if( !CacheKey.IsEmpty() )
+		{
+			LoadProgress.EnterProgressFrame( 1.0f, LOCTEXT( "SavingToCache", "Caching the parsed file" ) );
+			FScopedStreetMapImportPhase CachePhase( &Profile, TEXT( "Save to cache" ) );
+			const bool bSaved = FStreetMapImportCache::Save( CacheKey, *LoadedOSMFile, ImportingSettings );
+			if( FeedbackContext != nullptr )
+			{
+				FeedbackContext->Logf( 
+					bSaved ? ELogVerbosity::Display : ELogVerbosity::Warning, 
+					bSaved ? TEXT( "Street map cache miss for '%s', cached the parsed file (%s)" ) : TEXT( "Street map cache miss for '%s', failed to cache the parsed file (%s)" ), 
+					*SourceFilePath, 
+					*CacheKey );
+			}
+		}
+	}
+
+	// The profile and progress may go away before the file does
+	LoadedOSMFile->SetProfile( nullptr );
+	LoadedOSMFile->SetProgress( nullptr );
+
+	Profile.SetCounter( TEXT( "Cache hits" ), bLoadedFromCache ? 1 : 0 );
+
+	return LoadedOSMFile;
+}
+
+
+UStreetMap* UStreetMapFactory::CreateStreetMapFromOSMFile( UObject* Parent, FName Name, EObjectFlags Flags, const FString& SourceFilePath, const FOSMFile& OSMFile, FStreetMapImportProfile& Profile, FFeedbackContext* FeedbackContext )
+{
+	check( IsInGameThread() );
+
+	FStreetMapBuildResult Result;
+	{
+		FScopedStreetMapImportPhase BuildPhase( &Profile, TEXT( "Build" ) );
+		if( !BuildStreetMapFromOSMFile( ImportSettings, OSMFile, Result, &Profile, nullptr, FeedbackContext ) )
+		{
+			return nullptr;
+		}
+	}
+
+	return CreateStreetMap( Parent, Name, Flags, SourceFilePath, ImportSettings, Result, Profile, FeedbackContext );
+}
+
+
+UStreetMap* UStreetMapFactory::CreateStreetMap( UObject* Parent, FName Name, EObjectFlags Flags, const FString& SourceFilePath, const FStreetMapImportSettings& Settings, FStreetMapBuildResult& Result, FStreetMapImportProfile& Profile, FFeedbackContext* FeedbackContext )
+{
+	check( IsInGameThread() );
+
+	UStreetMap* StreetMap = NewObject<UStreetMap>( Parent, Name, Flags | RF_Transactional );
+
+	StreetMap->AssetImportData->Update( SourceFilePath );
+	StreetMap->ImportSettings = Settings;
+
+	{
+		FScopedStreetMapImportPhase PackPhase( &Profile, TEXT( "Pack" ) );
+
+		StreetMap->OriginLongitude = Result.OriginLongitude;
+		StreetMap->OriginLatitude = Result.OriginLatitude;
+		StreetMap->BoundsMin = Result.BoundsMin;
+		StreetMap->BoundsMax = Result.BoundsMax;
+		StreetMap->Roads = MoveTemp( Result.Roads );
+		StreetMap->Nodes = MoveTemp( Result.Nodes );
+		StreetMap->Buildings = MoveTemp( Result.Buildings );
+		StreetMap->Railways = MoveTemp( Result.Railways );
+		StreetMap->MiscWays = MoveTemp( Result.MiscWays );
+		StreetMap->RoadSources = MoveTemp( Result.RoadSources );
+		StreetMap->RailwaySources = MoveTemp( Result.RailwaySources );
+		StreetMap->BuildingSources = MoveTemp( Result.BuildingSources );
+		StreetMap->MiscWaySources = MoveTemp( Result.MiscWaySources );
+		StreetMap->NodeSources = MoveTemp( Result.NodeSources );
+
+		StreetMap->PointStorage = Settings.PointStorage;
+		StreetMap->PackGeometry();
+		StreetMap->BuildSourceIndices();
+	}
+
+	Profile.LogReport( FeedbackContext, StreetMap->AssetImportData->GetFirstFilename() );
+	Profile.GetStats( StreetMap->ImportStats );
+
+	return StreetMap;
+}
+
+
+bool UStreetMapFactory::BuildStreetMapFromOSMFile( const FStreetMapImportSettings& Settings, const FOSMFile& OSMFile, FStreetMapBuildResult& OutResult, FStreetMapImportProfile* Profile, FStreetMapImportProgress* Progress, FFeedbackContext* FeedbackContext )
+{
+	const FStreetMapWayClassifier Classifier( *GetDefault<UStreetMapImportingSettings>() );
+
+	FScopedStreetMapImportPhase Phase( Profile, TEXT( "Project nodes" ) );
+
+	// Frames are roughly as long as the phases take on a typical city extract
+	FScopedStreetMapImportProgress BuildProgress( Progress, 9.0f, FText() );
+	BuildProgress.EnterProgressFrame( 1.0f, LOCTEXT( "ProjectingNodes", "Projecting nodes" ) );
+
+	// Every node is projected into our map's space once, instead of once for every way it's a part of.  Elements keep
+	// the exact positions next to their float points, so quantized storage doesn't round them twice.
+	TArray<FStreetMapExactPoint> ExactNodePositions;
+	TArray<FVector2D> NodePositions;
+	ExactNodePositions.SetNumUninitialized( OSMFile.GetNumNodes() );
+	NodePositions.SetNumUninitialized( OSMFile.GetNumNodes() );
+	ParallelFor( OSMFile.GetNumNodes(), [&OSMFile, &ExactNodePositions, &NodePositions]( int32 OSMNodeIndex )
+	{
+		FStreetMapExactPoint& Position = ExactNodePositions[ OSMNodeIndex ];
+		OSMFile.SpatialReferenceSystem.FromEPSG4326( OSMFile.GetNodeLongitude( OSMNodeIndex ), OSMFile.GetNodeLatitude( OSMNodeIndex ), Position.X, Position.Y );
+		Position.X *= OSMToCentimetersScaleFactor;
+		Position.Y *= OSMToCentimetersScaleFactor;
+		NodePositions[ OSMNodeIndex ] = Position.ToVector2D();
+	} );
+
+	auto GetNodeId = [&OSMFile]( const int32 OSMNodeIndex )
+	{
+		return OSMFile.GetNodeId( OSMNodeIndex );
+	};
+
+	OutResult.OriginLongitude = OSMFile.SpatialReferenceSystem.GetOriginLongitude();
+	OutResult.OriginLatitude = OSMFile.SpatialReferenceSystem.GetOriginLatitude();
+
+	// @todo: Street maps that store their points as floats (EStreetMapPointStorage::Float) keep them relative to the
+	//        center of the map's 2D bounds, so they lose precision far from it.  Quantized street maps are built from
+	//        the exact positions above and don't.  Of course, there will be many other considerations for handling
+	//        huge maps (loading, rendering, collision, etc.)
+
+	Phase.Next( TEXT( "Convert ways" ) );
+	BuildProgress.EnterProgressFrame( 2.0f, LOCTEXT( "ConvertingWays", "Converting ways" ) );
+	if( BuildProgress.ShouldCancel() )
+	{
+		return false;
+	}
+
+	// Classify all ways first.  This is independent for every way.
+	TArray<FStreetMapWayOutput> WayOutputs;
+	WayOutputs.SetNumUninitialized( OSMFile.Ways.Num() );
+	ParallelFor( OSMFile.Ways.Num(), [&OSMFile, &WayOutputs, &Classifier]( int32 OSMWayIndex )
+	{
+		WayOutputs[ OSMWayIndex ] = ClassifyWay( *OSMFile.Ways[ OSMWayIndex ], Classifier );
+	} );
+
+	// Hand out indices in way order (a prefix sum per output type), so that we end up with exactly the same street map
+	// as when adding the ways one after another
+	int32 NumRoads = OutResult.Roads.Num();
+	int32 NumBuildings = OutResult.Buildings.Num();
+	int32 NumRailways = OutResult.Railways.Num();
+	int32 NumMiscWays = OutResult.MiscWays.Num();
+	for( FStreetMapWayOutput& WayOutput : WayOutputs )
+	{
+		switch( WayOutput.Kind )
+		{
+			case EStreetMapWayOutput::Road: WayOutput.Index = NumRoads++; break;
+			case EStreetMapWayOutput::Building: WayOutput.Index = NumBuildings++; break;
+			case EStreetMapWayOutput::Railway: WayOutput.Index = NumRailways++; break;
+			case EStreetMapWayOutput::MiscWay: WayOutput.Index = NumMiscWays++; break;
+		}
+	}
+	OutResult.Roads.SetNum( NumRoads );
+	OutResult.Buildings.SetNum( NumBuildings );
+	OutResult.Railways.SetNum( NumRailways );
+	OutResult.MiscWays.SetNum( NumMiscWays );
+	OutResult.RoadSources.SetNum( NumRoads );
+	OutResult.BuildingSources.SetNum( NumBuildings );
+	OutResult.RailwaySources.SetNum( NumRailways );
+	OutResult.MiscWaySources.SetNum( NumMiscWays );
+
+	// Every way writes to its own element, so we can convert them all at once
+	ParallelFor( OSMFile.Ways.Num(), [&OSMFile, &WayOutputs, &ExactNodePositions, &GetNodeId, &OutResult]( int32 OSMWayIndex )
+	{
+		const FOSMFile::FOSMWayInfo& OSMWay = *OSMFile.Ways[ OSMWayIndex ];
+		const FStreetMapWayOutput& WayOutput = WayOutputs[ OSMWayIndex ];
+		switch( WayOutput.Kind )
+		{
+			case EStreetMapWayOutput::Road:
+			{
+				FStreetMapRoad& NewRoad = OutResult.Roads[ WayOutput.Index ];
+				FillRoadForWay( OSMWay, ExactNodePositions, (EStreetMapRoadType)WayOutput.Type, NewRoad );
+				FillWaySource( OSMWay, NewRoad.RoadPoints.Num(), GetNodeId, OutResult.RoadSources[ WayOutput.Index ] );
+				break;
+			}
+			case EStreetMapWayOutput::Building:
+			{
+				FStreetMapBuilding& NewBuilding = OutResult.Buildings[ WayOutput.Index ];
+				FillBuildingForWay( OSMWay, ExactNodePositions, NewBuilding );
+				FillWaySource( OSMWay, NewBuilding.BuildingPoints.Num(), GetNodeId, OutResult.BuildingSources[ WayOutput.Index ] );
+				break;
+			}
+			case EStreetMapWayOutput::Railway:
+			{
+				FStreetMapRailway& NewRailway = OutResult.Railways[ WayOutput.Index ];
+				FillRailwayForWay( OSMWay, ExactNodePositions, (EStreetMapRailwayType)WayOutput.Type, NewRailway );
+				FillWaySource( OSMWay, NewRailway.Points.Num(), GetNodeId, OutResult.RailwaySources[ WayOutput.Index ] );
+				break;
+			}
+			case EStreetMapWayOutput::MiscWay:
+			{
+				FStreetMapMiscWay& NewMiscWay = OutResult.MiscWays[ WayOutput.Index ];
+				FillMiscWay( OSMWay, ExactNodePositions, NewMiscWay );
+				FillWaySource( OSMWay, NewMiscWay.Points.Num(), GetNodeId, OutResult.MiscWaySources[ WayOutput.Index ] );
+				break;
+			}
+		}
+	} );
+
+	// Maps the index of each way in the OSMFile to the (Road/Railway)-Index we created for that way, or INDEX_NONE
+	TArray<int32> OSMWayToRoadIndex;
+	TArray<int32> OSMWayToRailwayIndex;
+	OSMWayToRoadIndex.Init( INDEX_NONE, OSMFile.Ways.Num() );
+	OSMWayToRailwayIndex.Init( INDEX_NONE, OSMFile.Ways.Num() );
+	for( int32 OSMWayIndex = 0; OSMWayIndex < OSMFile.Ways.Num(); ++OSMWayIndex )
+	{
+		const FStreetMapWayOutput& WayOutput = WayOutputs[ OSMWayIndex ];
+		if( WayOutput.Kind == EStreetMapWayOutput::Road )
+		{
+			OSMWayToRoadIndex[ OSMWayIndex ] = WayOutput.Index;
+		}
+		else if( WayOutput.Kind == EStreetMapWayOutput::Railway )
+		{
+			OSMWayToRailwayIndex[ OSMWayIndex ] = WayOutput.Index;
+		}
+	}
 
+	Phase.Next( TEXT( "Multipolygons" ) );
+	BuildProgress.EnterProgressFrame( 1.0f, LOCTEXT( "AssemblingMultipolygons", "Assembling multipolygons" ) );
+	if( BuildProgress.ShouldCancel() )
+	{
+		return false;
+	}
 
-UStreetMapFactory::UStreetMapFactory(const FObjectInitializer& ObjectInitializer)
-	: Super(ObjectInitializer)
-{
-	SupportedClass = UStreetMap::StaticClass();
+	// Areas made of several ways, possibly with holes.  The member ways are usually untagged and weren't imported above,
+	// but a closed way tagged as an area of its own already was, and just gets its holes added instead of a copy.
+	int32 NumMultipolygonAreas = 0;
+	int32 NumOpenMultipolygonRings = 0;
+	if( OSMFile.Relations.Num() > 0 )
+	{
+		TMap<int64, int32> MiscWayIndicesByWayId;
+		MiscWayIndicesByWayId.Reserve( OutResult.MiscWaySources.Num() );
+		for( int32 MiscWayIndex = 0; MiscWayIndex < OutResult.MiscWaySources.Num(); ++MiscWayIndex )
+		{
+			MiscWayIndicesByWayId.Add( OutResult.MiscWaySources[ MiscWayIndex ].WayId, MiscWayIndex );
+		}
 
-	Formats.Add( TEXT( "osm;OpenStreetMap XML" ) );
-	bCreateNew = false;
-	bEditorImport = true;
-	bEditAfterNew = false;
-	bText = true;
-}
+		FOSMMultipolygonAssembler Assembler;
+		TArray<FOSMMultipolygonAssembler::FArea> Areas;
+		for( const FOSMFile::FOSMRelation* OSMRelation : OSMFile.Relations )
+		{
+			if( BuildProgress.ShouldCancel() )
+			{
+				return false;
+			}
 
+			// @todo: Building multipolygons (e.g. courtyards) would need holes in FStreetMapBuilding
+			FStreetMapMiscWay AreaTemplate;
+			if( OSMRelation->Type != FOSMFile::EOSMRelationType::Multipolygon || !ClassifyMultipolygon( *OSMRelation, AreaTemplate ) )
+			{
+				continue;
+			}
 
-UObject* UStreetMapFactory::FactoryCreateText( UClass* Class, UObject* Parent, FName Name, EObjectFlags Flags, UObject* Context, const TCHAR* Type, const TCHAR*& Buffer, const TCHAR* BufferEnd, FFeedbackContext* Warn )
-{
-	UStreetMap* StreetMap = NewObject<UStreetMap>( Parent, Name, Flags | RF_Transactional );
+			Areas.Reset();
+			NumOpenMultipolygonRings += Assembler.Assemble( OSMFile, *OSMRelation, NodePositions, Areas );
 
-	StreetMap->AssetImportData->Update( this->GetCurrentFilename() );
+			for( const FOSMMultipolygonAssembler::FArea& Area : Areas )
+			{
+				const int32* ExistingMiscWayIndex = Area.bIsSingleWay ? MiscWayIndicesByWayId.Find( Area.WayId ) : nullptr;
+				int32 MiscWayIndex;
+				if( ExistingMiscWayIndex != nullptr && OutResult.MiscWays[ *ExistingMiscWayIndex ].bIsClosed )
+				{
+					MiscWayIndex = *ExistingMiscWayIndex;
+				}
+				else
+				{
+					MiscWayIndex = OutResult.MiscWays.Add( AreaTemplate );
+					FStreetMapMiscWay& NewMiscWay = OutResult.MiscWays[ MiscWayIndex ];
+					CopyRingPoints( Area.OuterNodes, ExactNodePositions, NewMiscWay.Points, NewMiscWay.ExactPoints );
+					ComputeWayBounds( NewMiscWay.Points, NewMiscWay.BoundsMin, NewMiscWay.BoundsMax );
+
+					// The source points at the first way of the outer ring, so that changes to it remove the area
+					FStreetMapWaySource& NewSource = OutResult.MiscWaySources[ OutResult.MiscWaySources.AddDefaulted() ];
+					NewSource.WayId = Area.WayId;
+					NewSource.NodeIds.SetNumUninitialized( Area.OuterNodes.Num() );
+					for( int32 PointIndex = 0; PointIndex < Area.OuterNodes.Num(); ++PointIndex )
+					{
+						NewSource.NodeIds[ PointIndex ] = GetNodeId( Area.OuterNodes[ PointIndex ] );
+					}
 
-	// @todo: Performance: This will copy the entire text buffer into an FString.  We need to do this
-	//        because the FFastXml parser is expecting a buffer that it can mutate as it parses.
-	const int32 CharacterCount = BufferEnd - Buffer;
-	FString MutableTextBuffer( CharacterCount, Buffer );
+					++NumMultipolygonAreas;
+				}
 
-	const bool bIsFilePathActuallyTextBuffer = true;
-	const bool bLoadedOkay = LoadFromOpenStreetMapXMLFile( StreetMap, MutableTextBuffer, bIsFilePathActuallyTextBuffer, Warn );
+				FStreetMapMiscWay& MiscWay = OutResult.MiscWays[ MiscWayIndex ];
+				for( const TArray<int32>& InnerNodes : Area.InnerNodes )
+				{
+					FStreetMapPolygonRing& Hole = MiscWay.Holes[ MiscWay.Holes.AddDefaulted() ];
+					CopyRingPoints( InnerNodes, ExactNodePositions, Hole.Points, Hole.ExactPoints );
+				}
+			}
+		}
+	}
 
-	if( !bLoadedOkay )
+	if( NumOpenMultipolygonRings > 0 && FeedbackContext != nullptr )
 	{
-		StreetMap->MarkPendingKill();
-		StreetMap = nullptr;
+		// Usually relations that reach past the edge of the imported area
+		FeedbackContext->Logf( ELogVerbosity::Warning, TEXT( "%i multipolygon rings could not be closed and were skipped" ), NumOpenMultipolygonRings );
 	}
 
-	return StreetMap;
-}
+	// The street map's bounds enclose everything we've added
+	UpdateStreetMapBounds( OutResult );
 
 
-bool UStreetMapFactory::LoadFromOpenStreetMapXMLFile( UStreetMap* StreetMap, FString& OSMFilePath, const bool bIsFilePathActuallyTextBuffer, FFeedbackContext* FeedbackContext )
-{
-	// OSM data is stored in meters.  This is the scale factor to convert those units into UE4's native units (cm)
-	// Keep in mind that if this is changed, UStreetMapComponent sizes for roads may need to be updated too!
-	// @todo: We should make this scale factor customizable as an import option
-	const float OSMToCentimetersScaleFactor = 100.0f;
-
-	// Adds a road to the street map using the OpenStreetMap data, flattening the road's coordinates into our map's space
-	auto AddRoadForWay = [OSMToCentimetersScaleFactor](
-		const FOSMFile& OSMFile, 
-		UStreetMap& StreetMapRef, 
-		const FOSMFile::FOSMWayInfo& OSMWay, 
-		int32& OutRoadIndex ) -> bool
-	{
-		EStreetMapRoadType RoadType = EStreetMapRoadType::Other;
-		if ((OSMWay.Category == TEXT("residential")) || // ~32% of all highways
-			(OSMWay.Category == TEXT("service")) ||		// ~15% of all highways
-			(OSMWay.Category == TEXT("unclassified")) ||
-			(OSMWay.Category == TEXT("road"))) // @todo: Consider excluding "Road" from our data set, as it could be a highway that wasn't properly tagged in OSM yet
-			RoadType = EStreetMapRoadType::Street;
-		else if (
-			(OSMWay.Category == TEXT("tertiary")) ||	// ~4% of all highways
-			(OSMWay.Category == TEXT("secondary")) ||	// ~2% of all highways
-			(OSMWay.Category == TEXT("secondary_link")) ||
-			(OSMWay.Category == TEXT("tertiary_link")) ||
-			(OSMWay.Category == TEXT("raceway")))
-			RoadType = EStreetMapRoadType::MajorRoad;
-		else if( 
-			(OSMWay.Category == TEXT("primary")) || // ~2% of all highways
-			(OSMWay.Category == TEXT("primary_link")) ||
-			(OSMWay.Category == TEXT("motorway")) ||
-			(OSMWay.Category == TEXT("motorway_link")) ||
-			(OSMWay.Category == TEXT("trunk")) ||
-			(OSMWay.Category == TEXT("trunk_link")))
-			RoadType = EStreetMapRoadType::Highway;
-
-		if (RoadType == EStreetMapRoadType::Other)
-		{
-			// There are other types that we don't recognize yet.  See http://wiki.openstreetmap.org/wiki/Key:highway
-			return false;
+	Phase.Next( TEXT( "Connect nodes" ) );
+
+	// This phase takes three frames, split up into steps of this many nodes
+	const int32 NodesPerProgressFrame = 64 * 1024;
+	const FText ConnectingNodesText = LOCTEXT( "ConnectingNodes", "Connecting nodes" );
+
+	for (int32 OSMNodeIndex = 0; OSMNodeIndex < OSMFile.GetNumNodes(); ++OSMNodeIndex)
+	{
+		if( OSMNodeIndex % NodesPerProgressFrame == 0 )
+		{
+			const int32 NumNodesInFrame = FMath::Min( NodesPerProgressFrame, OSMFile.GetNumNodes() - OSMNodeIndex );
+			BuildProgress.EnterProgressFrame( 3.0f * NumNodesInFrame / OSMFile.GetNumNodes(), ConnectingNodesText );
+			if( BuildProgress.ShouldCancel() )
+			{
+				return false;
+			}
 		}
 
-		// Require at least two points!
-		if (OSMWay.Nodes.Num() < 2)
+		const TArrayView<const FOSMFile::FOSMTag> OSMNodeTags = OSMFile.GetNodeTags(OSMNodeIndex);
+		const TArrayView<const FOSMFile::FOSMWayRef> OSMNodeWayRefs = OSMFile.GetNodeWayRefs(OSMNodeIndex);
+		FStreetMapNode NewNode;
+
+		// copy all tags first
+		for (const FOSMFile::FOSMTag& OSMNodeTag : OSMNodeTags)
 		{
-			// NOTE: Skipped adding road for way because it has less than 2 points
-			// @todo: Log this for the user as an import warning
-			return false;
+			FStreetMapTag Tag;
+			Tag.Key = OSMNodeTag.Key;
+			Tag.Value = OSMNodeTag.Value;
+			NewNode.Tags.Add(Tag);
 		}
 
-		// Create a road for this way
-		OutRoadIndex = StreetMapRef.Roads.Num();
-		FStreetMapRoad& NewRoad = *new( StreetMapRef.Roads )FStreetMapRoad();
+		// Any ways touching this node?
+		if (OSMNodeWayRefs.Num() == 0)
+		{
+			// Is this node important beyond any references by ways?
+			if (OSMNodeTags.Num() > 0)
+			{
+				const FVector2D NodePos = NodePositions[OSMNodeIndex];
+				NewNode.Location.X = NodePos.X;
+				NewNode.Location.Y = NodePos.Y;
 
-		FVector2D BoundsMin( TNumericLimits<float>::Max(), TNumericLimits<float>::Max() );
-		FVector2D BoundsMax( TNumericLimits<float>::Lowest(), TNumericLimits<float>::Lowest() );
+				OutResult.Nodes.Add(NewNode);
+				OutResult.NodeSources.Add(OSMFile.GetNodeId(OSMNodeIndex));
+			}
 
-		NewRoad.RoadPoints.AddUninitialized( OSMWay.Nodes.Num() );
-		int32 CurRoadPoint = 0;
+			continue;
+		}
 
-		// Set defaults for each node index on this road.  INDEX_NONE means the node is not valid, which may be the case
-		// for nodes that we filter out entirely.  This will be filled in by valid indices to nodes later on.
-		NewRoad.NodeIndices.AddUninitialized( OSMWay.Nodes.Num() );
-		for( int32& NodeIndex : NewRoad.NodeIndices )
+		for (const FOSMFile::FOSMWayRef& OSMWayRef : OSMNodeWayRefs)
 		{
-			NodeIndex = INDEX_NONE;
+			const int32 FoundRoadIndex = OSMWayToRoadIndex[OSMWayRef.WayIndex];
+			if (FoundRoadIndex != INDEX_NONE)
+			{
+
+				FStreetMapRoadRef RoadRef;
+				RoadRef.RoadIndex = FoundRoadIndex;
+
+				const int32 RoadPointIndex = OSMWayRef.NodeIndex;
+				RoadRef.RoadPointIndex = RoadPointIndex;
+				NewNode.RoadRefs.Add(RoadRef);
+				NewNode.Location = OutResult.Roads[FoundRoadIndex].RoadPoints[RoadPointIndex];
+			}
+
+			const int32 FoundRailwayIndex = OSMWayToRailwayIndex[OSMWayRef.WayIndex];
+			if (FoundRailwayIndex != INDEX_NONE)
+			{
+
+				FStreetMapRailwayRef RailwayRef;
+				RailwayRef.RailwayIndex = FoundRailwayIndex;
+
+				const int32 RailwayPointIndex = OSMWayRef.NodeIndex;
+				RailwayRef.RailwayPointIndex = RailwayPointIndex;
+				NewNode.RailwayRefs.Add(RailwayRef);
+				NewNode.Location = OutResult.Railways[FoundRailwayIndex].Points[RailwayPointIndex];
+			}
+			else
+			{
+				// Skipped ref because we didn't keep this road nor railway in our data set							
+			}
 		}
 
+		int32 NewNodeIndex = INDEX_NONE;
 
-		for( const FOSMFile::FOSMNodeInfo* OSMNodePtr : OSMWay.Nodes )
+		// Only store nodes that are attached to at least one road or railway.  We must have at least a connection to a single
+		// road/railway, otherwise we've filtered this node's road out and there's no point in wasting memory on the node itself.
+		if (NewNode.RoadRefs.Num() > 0)
 		{
-			const FOSMFile::FOSMNodeInfo& OSMNode = *OSMNodePtr;
-			const FVector2D NodePos = OSMFile.SpatialReferenceSystem.FromEPSG4326(OSMNode.Longitude, OSMNode.Latitude) * OSMToCentimetersScaleFactor;
+			// Most nodes from OpenStreetMap will only be touching a single road.  These nodes usually make up the points
+			// along the length of the road, even for roads with no intersections except at the beginning and end.  We
+			// don't need to store these points unless they are at the ends of the road.  Keeping the points at the
+			// beginning and end of the road is useful when calculating navigation data, but the other nodes can go!
+			// In the road's NodeIndices array, any nodes we filter out here will simply have an INDEX_NONE value in that
+			// array, and we'll only store the positions of the road at these points in the road's RoadPoints array.
+
+			const FStreetMapRoadRef& FirstRoadRef = NewNode.RoadRefs[0];
+			const FStreetMapRoad& FirstRoad = OutResult.Roads[FirstRoadRef.RoadIndex];
 
-			// Update bounding box
+			if (NewNode.RoadRefs.Num() > 1 ||					// Does the node connect to more than one road?
+				FirstRoadRef.RoadPointIndex == 0 ||				// Does the node connect to the beginning of the road?
+				FirstRoadRef.RoadPointIndex == (FirstRoad.NodeIndices.Num() - 1))	// Does the node connect to the end of the road?
 			{
-				if( NodePos.X < BoundsMin.X )
-				{
-					BoundsMin.X = NodePos.X;
-				}
-				if( NodePos.Y < BoundsMin.Y )
+				NewNodeIndex = OutResult.Nodes.Num();
+				OutResult.Nodes.Add(NewNode);
+				OutResult.NodeSources.Add(OSMFile.GetNodeId(OSMNodeIndex));
+
+				// Update the roads that are overlapping this node
+				for (const FStreetMapRoadRef& RoadRef : NewNode.RoadRefs)
 				{
-					BoundsMin.Y = NodePos.Y;
+					FStreetMapRoad& Road = OutResult.Roads[RoadRef.RoadIndex];
+					check(Road.NodeIndices[RoadRef.RoadPointIndex] == INDEX_NONE);
+					Road.NodeIndices[RoadRef.RoadPointIndex] = NewNodeIndex;
 				}
-				if( NodePos.X > BoundsMax.X )
+			}
+			else
+			{
+				// Node has only one road that it references, and it wasn't the beginning or end of the road, so filter it out!
+			}
+		}
+
+		if (NewNode.RailwayRefs.Num() > 0)
+		{
+			// see text for roads above and replace the words roads with railways
+			const FStreetMapRailwayRef& FirstRailwayRef = NewNode.RailwayRefs[0];
+			const FStreetMapRailway& FirstRailway = OutResult.Railways[FirstRailwayRef.RailwayIndex];
+
+			if (NewNode.RailwayRefs.Num() > 1 ||						// Does the node connect to more than one railway?
+				FirstRailwayRef.RailwayPointIndex == 0 ||				// Does the node connect to the beginning of the railway?
+				FirstRailwayRef.RailwayPointIndex == (FirstRailway.NodeIndices.Num() - 1))	// Does the node connect to the end of the railway?
+			{
+				if (NewNodeIndex == INDEX_NONE)
 				{
-					BoundsMax.X = NodePos.X;
+					NewNodeIndex = OutResult.Nodes.Num();
+					OutResult.Nodes.Add(NewNode);
+					OutResult.NodeSources.Add(OSMFile.GetNodeId(OSMNodeIndex));
 				}
-				if( NodePos.Y > BoundsMax.Y )
+
+				// Update the railways that are overlapping this node
+				for (const FStreetMapRailwayRef& RailwayRef : NewNode.RailwayRefs)
 				{
-					BoundsMax.Y = NodePos.Y;
+					FStreetMapRailway& Railway = OutResult.Railways[RailwayRef.RailwayIndex];
+					check(Railway.NodeIndices[RailwayRef.RailwayPointIndex] == INDEX_NONE);
+					Railway.NodeIndices[RailwayRef.RailwayPointIndex] = NewNodeIndex;
 				}
 			}
-
-			// Fill in the points
-			NewRoad.RoadPoints[ CurRoadPoint++ ] = NodePos;
+			else
+			{
+				// Node has only one railway that it references, and it wasn't the beginning or end of the railway, so filter it out!
+			}
 		}
-
-
-		NewRoad.RoadName = OSMWay.Name;
-		if( NewRoad.RoadName.IsEmpty() )
+		else
 		{
-			NewRoad.RoadName = OSMWay.Ref;
+			// Node doesn't reference any roads that we kept, or the data was malformed.  Filter it out.
 		}
-		NewRoad.RoadType = RoadType;
-		NewRoad.BoundsMin = BoundsMin;
-		NewRoad.BoundsMax = BoundsMax;
+	}
+
+	Phase.Next( TEXT( "Simplify" ) );
+	BuildProgress.EnterProgressFrame( 1.0f, LOCTEXT( "SimplifyingWays", "Simplifying ways" ) );
+	if( BuildProgress.ShouldCancel() )
+	{
+		return false;
+	}
+
+	// Simplification needs to know which points the nodes are at, so it comes after connecting them
+	if( Settings.Simplification != EStreetMapSimplification::None )
+	{
+		SimplifyStreetMap( OutResult, Settings, 0, 0, 0, 0, nullptr, Profile, FeedbackContext );
+		UpdateStreetMapBounds( OutResult );
+	}
+
+	Phase.Next( TEXT( "Validate" ) );
+	BuildProgress.EnterProgressFrame( 1.0f, LOCTEXT( "Validating", "Validating" ) );
+	if( BuildProgress.ShouldCancel() )
+	{
+		return false;
+	}
+
+	// Validation test: Make sure that all roads have at least two nodes referencing them, one at the beginning and one at the end.
+	for (const FStreetMapRoad& Road : OutResult.Roads)
+	{
+		const bool bHasNodeAtBeginning = Road.NodeIndices[0] != INDEX_NONE;
+		const bool bHasNodeAtEnd = Road.NodeIndices[Road.NodeIndices.Num() - 1] != INDEX_NONE;
+
+		// All roads should have at least two nodes referencing them, one at the beginning and one at the end
+		ensure(bHasNodeAtBeginning && bHasNodeAtEnd);
+	}
+
+	// Validation test: Make sure that all railways have at least two nodes referencing them, one at the beginning and one at the end.
+	for (const FStreetMapRailway& Railway : OutResult.Railways)
+	{
+		const bool bHasNodeAtBeginning = Railway.NodeIndices[0] != INDEX_NONE;
+		const bool bHasNodeAtEnd = Railway.NodeIndices[Railway.NodeIndices.Num() - 1] != INDEX_NONE;
+
+		// All railways should have at least two nodes referencing them, one at the beginning and one at the end
+		ensure(bHasNodeAtBeginning && bHasNodeAtEnd);
+	}
+
+	if( Profile != nullptr )
+	{
+		Profile->SetCounter( TEXT( "Roads" ), OutResult.Roads.Num() );
+		Profile->SetCounter( TEXT( "Railways" ), OutResult.Railways.Num() );
+		Profile->SetCounter( TEXT( "Buildings" ), OutResult.Buildings.Num() );
+		Profile->SetCounter( TEXT( "Misc ways" ), OutResult.MiscWays.Num() );
+		Profile->SetCounter( TEXT( "Multipolygon areas" ), NumMultipolygonAreas );
+		Profile->SetCounter( TEXT( "Street map nodes" ), OutResult.Nodes.Num() );
+	}
+
+	return true;
+}
+
+
 
-		NewRoad.bIsOneWay = OSMWay.bIsOneWay;
 
-		StreetMapRef.BoundsMin.X = FMath::Min( StreetMapRef.BoundsMin.X, BoundsMin.X );
-		StreetMapRef.BoundsMin.Y = FMath::Min( StreetMapRef.BoundsMin.Y, BoundsMin.Y );
-		StreetMapRef.BoundsMax.X = FMath::Max( StreetMapRef.BoundsMax.X, BoundsMax.X );
-		StreetMapRef.BoundsMax.Y = FMath::Max( StreetMapRef.BoundsMax.Y, BoundsMax.Y );
 
-		return true;
+void UStreetMapFactory::UpdateStreetMapBounds( FStreetMapBuildResult& Result )
+{
+	Result.BoundsMin = FVector2D( TNumericLimits<float>::Max(), TNumericLimits<float>::Max() );
+	Result.BoundsMax = FVector2D( TNumericLimits<float>::Lowest(), TNumericLimits<float>::Lowest() );
+	auto ExpandStreetMapBounds = [&Result]( const FVector2D& BoundsMin, const FVector2D& BoundsMax )
+	{
+		Result.BoundsMin.X = FMath::Min( Result.BoundsMin.X, BoundsMin.X );
+		Result.BoundsMin.Y = FMath::Min( Result.BoundsMin.Y, BoundsMin.Y );
+		Result.BoundsMax.X = FMath::Max( Result.BoundsMax.X, BoundsMax.X );
+		Result.BoundsMax.Y = FMath::Max( Result.BoundsMax.Y, BoundsMax.Y );
 	};
+	for( const FStreetMapRoad& Road : Result.Roads )
+	{
+		ExpandStreetMapBounds( Road.BoundsMin, Road.BoundsMax );
+	}
+	for( const FStreetMapBuilding& Building : Result.Buildings )
+	{
+		ExpandStreetMapBounds( Building.BoundsMin, Building.BoundsMax );
+	}
+	for( const FStreetMapRailway& Railway : Result.Railways )
+	{
+		ExpandStreetMapBounds( Railway.BoundsMin, Railway.BoundsMax );
+	}
+	for( const FStreetMapMiscWay& MiscWay : Result.MiscWays )
+	{
+		ExpandStreetMapBounds( MiscWay.BoundsMin, MiscWay.BoundsMax );
+	}
+}
+
 
+template<typename StreetMapType>
+void UStreetMapFactory::SimplifyStreetMap( StreetMapType& StreetMap, const FStreetMapImportSettings& Settings, const int32 FirstRoad, const int32 FirstRailway, const int32 FirstBuilding, const int32 FirstMiscWay, const TArray<int32>* NodeIndices, FStreetMapImportProfile* Profile, FFeedbackContext* FeedbackContext )
+{
+	const EStreetMapSimplification Method = Settings.Simplification;
+	const int32 NumRoads = StreetMap.Roads.Num() - FirstRoad;
+	const int32 NumRailways = StreetMap.Railways.Num() - FirstRailway;
+	const int32 NumBuildings = StreetMap.Buildings.Num() - FirstBuilding;
+	const int32 NumMiscWays = StreetMap.MiscWays.Num() - FirstMiscWay;
 
-	// Adds a building to the street map using the OpenStreetMap data, flattening the road's coordinates into our map's space
-	auto AddBuildingForWay = [OSMToCentimetersScaleFactor]( 
-		const FOSMFile& OSMFile, 
-		UStreetMap& StreetMapRef, 
-		const FOSMFile::FOSMWayInfo& OSMWay ) -> bool
+	auto CountPoints = [&StreetMap, FirstRoad, FirstRailway, FirstBuilding, FirstMiscWay]( int64& OutNumRoadPoints, int64& OutNumRailwayPoints, int64& OutNumBuildingPoints, int64& OutNumMiscWayPoints )
 	{
-		// Require at least three points so that we don't have degenerate polygon!
-		if (OSMWay.Nodes.Num() < 3)
+		OutNumRoadPoints = OutNumRailwayPoints = OutNumBuildingPoints = OutNumMiscWayPoints = 0;
+		for( int32 RoadIndex = FirstRoad; RoadIndex < StreetMap.Roads.Num(); ++RoadIndex )
 		{
-			// NOTE: Skipped adding building for way because it has less than 3 points
-			// @todo: Log this for the user as an import warning
-			return false;
+			OutNumRoadPoints += StreetMap.Roads[ RoadIndex ].RoadPoints.Num();
 		}
+		for( int32 RailwayIndex = FirstRailway; RailwayIndex < StreetMap.Railways.Num(); ++RailwayIndex )
+		{
+			OutNumRailwayPoints += StreetMap.Railways[ RailwayIndex ].Points.Num();
+		}
+		for( int32 BuildingIndex = FirstBuilding; BuildingIndex < StreetMap.Buildings.Num(); ++BuildingIndex )
+		{
+			OutNumBuildingPoints += StreetMap.Buildings[ BuildingIndex ].BuildingPoints.Num();
+		}
+		for( int32 MiscWayIndex = FirstMiscWay; MiscWayIndex < StreetMap.MiscWays.Num(); ++MiscWayIndex )
+		{
+			const FStreetMapMiscWay& MiscWay = StreetMap.MiscWays[ MiscWayIndex ];
+			OutNumMiscWayPoints += MiscWay.Points.Num();
+			for( const FStreetMapPolygonRing& Hole : MiscWay.Holes )
+			{
+				OutNumMiscWayPoints += Hole.Points.Num();
+			}
+		}
+	};
 
-		// Create a building for this way
-		FStreetMapBuilding& NewBuilding = *new( StreetMapRef.Buildings )FStreetMapBuilding();
-
-		FVector2D BoundsMin( TNumericLimits<float>::Max(), TNumericLimits<float>::Max() );
-		FVector2D BoundsMax( TNumericLimits<float>::Lowest(), TNumericLimits<float>::Lowest() );
-
-		NewBuilding.BuildingPoints.AddUninitialized( OSMWay.Nodes.Num() );
-		int32 CurBuildingPoint = 0;
+	int64 NumRoadPointsBefore, NumRailwayPointsBefore, NumBuildingPointsBefore, NumMiscWayPointsBefore;
+	CountPoints( NumRoadPointsBefore, NumRailwayPointsBefore, NumBuildingPointsBefore, NumMiscWayPointsBefore );
 
-		for( const FOSMFile::FOSMNodeInfo* OSMNodePtr : OSMWay.Nodes )
+	// Only nodes that refer to the elements we simplify matter, and the caller may know which those are
+	TArray<FStreetMapNode*> NodesToCheck;
+	if( NodeIndices != nullptr )
+	{
+		NodesToCheck.Reserve( NodeIndices->Num() );
+		for( const int32 NodeIndex : *NodeIndices )
+		{
+			NodesToCheck.Add( &StreetMap.Nodes[ NodeIndex ] );
+		}
+	}
+	else
+	{
+		NodesToCheck.Reserve( StreetMap.Nodes.Num() );
+		for( FStreetMapNode& Node : StreetMap.Nodes )
 		{
-			const FOSMFile::FOSMNodeInfo& OSMNode = *OSMNodePtr;
-			const FVector2D NodePos = OSMFile.SpatialReferenceSystem.FromEPSG4326(OSMNode.Longitude, OSMNode.Latitude) * OSMToCentimetersScaleFactor;
+			NodesToCheck.Add( &Node );
+		}
+	}
 
-			// Update bounding box
+	// Points that nodes refer to are where roads and railways end or connect to each other, so they have to stay.  That
+	// includes points in the middle of a road where a railway ends, which the road's node indices don't know about.
+	// Arrays below only cover the elements we simplify, starting at the first one.
+	TArray<TArray<bool>> RoadKeepPoints;
+	TArray<TArray<bool>> RailwayKeepPoints;
+	RoadKeepPoints.SetNum( NumRoads );
+	RailwayKeepPoints.SetNum( NumRailways );
+	for( int32 Index = 0; Index < NumRoads; ++Index )
+	{
+		RoadKeepPoints[ Index ].Init( false, StreetMap.Roads[ FirstRoad + Index ].RoadPoints.Num() );
+	}
+	for( int32 Index = 0; Index < NumRailways; ++Index )
+	{
+		RailwayKeepPoints[ Index ].Init( false, StreetMap.Railways[ FirstRailway + Index ].Points.Num() );
+	}
+	for( const FStreetMapNode* Node : NodesToCheck )
+	{
+		for( const FStreetMapRoadRef& RoadRef : Node->RoadRefs )
+		{
+			if( RoadRef.RoadIndex >= FirstRoad )
 			{
-				if( NodePos.X < BoundsMin.X )
-				{
-					BoundsMin.X = NodePos.X;
-				}
-				if( NodePos.Y < BoundsMin.Y )
-				{
-					BoundsMin.Y = NodePos.Y;
-				}
-				if( NodePos.X > BoundsMax.X )
-				{
-					BoundsMax.X = NodePos.X;
-				}
-				if( NodePos.Y > BoundsMax.Y )
-				{
-					BoundsMax.Y = NodePos.Y;
-				}
+				RoadKeepPoints[ RoadRef.RoadIndex - FirstRoad ][ RoadRef.RoadPointIndex ] = true;
+			}
+		}
+		for( const FStreetMapRailwayRef& RailwayRef : Node->RailwayRefs )
+		{
+			if( RailwayRef.RailwayIndex >= FirstRailway )
+			{
+				RailwayKeepPoints[ RailwayRef.RailwayIndex - FirstRailway ][ RailwayRef.RailwayPointIndex ] = true;
 			}
+		}
+	}
+
+	// Every way is simplified on its own, so we can do them all at once.  The sources lose the same points as the ways.
+	TArray<TArray<int32>> RoadNewPointIndices;
+	TArray<TArray<int32>> RailwayNewPointIndices;
+	RoadNewPointIndices.SetNum( NumRoads );
+	RailwayNewPointIndices.SetNum( NumRailways );
+
+	ParallelFor( NumRoads, [&StreetMap, &Settings, Method, FirstRoad, &RoadKeepPoints, &RoadNewPointIndices]( int32 Index )
+	{
+		FStreetMapRoad& Road = StreetMap.Roads[ FirstRoad + Index ];
+		FStreetMapSimplifier::Simplify( Road.RoadPoints, false, Method, Settings.RoadSimplificationTolerance, RoadKeepPoints[ Index ] );
+		RemoveSimplifiedPoints( RoadKeepPoints[ Index ], Road.RoadPoints, Road.ExactPoints, &Road.NodeIndices, &StreetMap.RoadSources[ FirstRoad + Index ].NodeIds, &RoadNewPointIndices[ Index ] );
+		ComputeWayBounds( Road.RoadPoints, Road.BoundsMin, Road.BoundsMax );
+	} );
 
-			// Fill in the points
-			NewBuilding.BuildingPoints[ CurBuildingPoint++ ] = NodePos;
+	ParallelFor( NumRailways, [&StreetMap, &Settings, Method, FirstRailway, &RailwayKeepPoints, &RailwayNewPointIndices]( int32 Index )
+	{
+		FStreetMapRailway& Railway = StreetMap.Railways[ FirstRailway + Index ];
+		FStreetMapSimplifier::Simplify( Railway.Points, false, Method, Settings.RailwaySimplificationTolerance, RailwayKeepPoints[ Index ] );
+		RemoveSimplifiedPoints( RailwayKeepPoints[ Index ], Railway.Points, Railway.ExactPoints, &Railway.NodeIndices, &StreetMap.RailwaySources[ FirstRailway + Index ].NodeIds, &RailwayNewPointIndices[ Index ] );
+		ComputeWayBounds( Railway.Points, Railway.BoundsMin, Railway.BoundsMax );
+	} );
+
+	ParallelFor( NumBuildings, [&StreetMap, &Settings, Method, FirstBuilding]( int32 Index )
+	{
+		FStreetMapBuilding& Building = StreetMap.Buildings[ FirstBuilding + Index ];
+		TArray<bool> KeepPoints;
+		KeepPoints.Init( false, Building.BuildingPoints.Num() );
+		FStreetMapSimplifier::Simplify( Building.BuildingPoints, true, Method, Settings.BuildingSimplificationTolerance, KeepPoints );
+		RemoveSimplifiedPoints( KeepPoints, Building.BuildingPoints, Building.ExactPoints, nullptr, &StreetMap.BuildingSources[ FirstBuilding + Index ].NodeIds, nullptr );
+		ComputeWayBounds( Building.BuildingPoints, Building.BoundsMin, Building.BoundsMax );
+	} );
+
+	ParallelFor( NumMiscWays, [&StreetMap, &Settings, Method, FirstMiscWay]( int32 Index )
+	{
+		FStreetMapMiscWay& MiscWay = StreetMap.MiscWays[ FirstMiscWay + Index ];
+		TArray<bool> KeepPoints;
+		KeepPoints.Init( false, MiscWay.Points.Num() );
+		FStreetMapSimplifier::Simplify( MiscWay.Points, MiscWay.bIsClosed, Method, Settings.MiscWaySimplificationTolerance, KeepPoints );
+		RemoveSimplifiedPoints( KeepPoints, MiscWay.Points, MiscWay.ExactPoints, nullptr, &StreetMap.MiscWaySources[ FirstMiscWay + Index ].NodeIds, nullptr );
+		ComputeWayBounds( MiscWay.Points, MiscWay.BoundsMin, MiscWay.BoundsMax );
+
+		for( FStreetMapPolygonRing& Hole : MiscWay.Holes )
+		{
+			KeepPoints.Init( false, Hole.Points.Num() );
+			FStreetMapSimplifier::Simplify( Hole.Points, true, Method, Settings.MiscWaySimplificationTolerance, KeepPoints );
+			RemoveSimplifiedPoints( KeepPoints, Hole.Points, Hole.ExactPoints, nullptr, nullptr, nullptr );
 		}
+	} );
 
-		// Make sure the building ended up with a closed polygon, then remove the final (redundant) point
-		const bool bIsClosed = NewBuilding.BuildingPoints[ 0 ].Equals( NewBuilding.BuildingPoints[ NewBuilding.BuildingPoints.Num() - 1 ], KINDA_SMALL_NUMBER );
-		if( bIsClosed )
+	// Nodes still point at the points they were at before
+	for( FStreetMapNode* Node : NodesToCheck )
+	{
+		for( FStreetMapRoadRef& RoadRef : Node->RoadRefs )
 		{
-			// Remove the final redundant point
-			NewBuilding.BuildingPoints.Pop();
+			if( RoadRef.RoadIndex >= FirstRoad )
+			{
+				RoadRef.RoadPointIndex = RoadNewPointIndices[ RoadRef.RoadIndex - FirstRoad ][ RoadRef.RoadPointIndex ];
+				check( RoadRef.RoadPointIndex != INDEX_NONE );
+			}
 		}
-		else
+		for( FStreetMapRailwayRef& RailwayRef : Node->RailwayRefs )
 		{
-			// Wasn't expecting to have an unclosed shape.  Our tolerances might be off, or the data was malformed.
-			// Either way, it shouldn't be a problem as we'll close the shape ourselves below.
-			// @todo: Log this for the user as an import warning
+			if( RailwayRef.RailwayIndex >= FirstRailway )
+			{
+				RailwayRef.RailwayPointIndex = RailwayNewPointIndices[ RailwayRef.RailwayIndex - FirstRailway ][ RailwayRef.RailwayPointIndex ];
+				check( RailwayRef.RailwayPointIndex != INDEX_NONE );
+			}
 		}
+	}
 
-		NewBuilding.BuildingName = OSMWay.Name;
-		if( NewBuilding.BuildingName.IsEmpty() )
+	int64 NumRoadPointsAfter, NumRailwayPointsAfter, NumBuildingPointsAfter, NumMiscWayPointsAfter;
+	CountPoints( NumRoadPointsAfter, NumRailwayPointsAfter, NumBuildingPointsAfter, NumMiscWayPointsAfter );
+
+	if( FeedbackContext != nullptr )
+	{
+		auto LogReduction = [FeedbackContext]( const TCHAR* WayKind, const int64 NumPointsBefore, const int64 NumPointsAfter )
 		{
-			NewBuilding.BuildingName = OSMWay.Ref;
-		}
+			if( NumPointsBefore > 0 )
+			{
+				FeedbackContext->Logf( 
+					ELogVerbosity::Log, 
+					TEXT( "Simplified %s from %lld to %lld points (%.1f%% fewer)" ), 
+					WayKind, 
+					NumPointsBefore, 
+					NumPointsAfter, 
+					100.0 * ( NumPointsBefore - NumPointsAfter ) / NumPointsBefore );
+			}
+		};
+		LogReduction( TEXT( "roads" ), NumRoadPointsBefore, NumRoadPointsAfter );
+		LogReduction( TEXT( "railways" ), NumRailwayPointsBefore, NumRailwayPointsAfter );
+		LogReduction( TEXT( "buildings" ), NumBuildingPointsBefore, NumBuildingPointsAfter );
+		LogReduction( TEXT( "misc ways" ), NumMiscWayPointsBefore, NumMiscWayPointsAfter );
+	}
 
-		NewBuilding.Height = OSMWay.Height * OSMToCentimetersScaleFactor;
-		NewBuilding.BuildingLevels = OSMWay.BuildingLevels;
+	if( Profile != nullptr )
+	{
+		Profile->SetCounter( TEXT( "Points before simplification" ), NumRoadPointsBefore + NumRailwayPointsBefore + NumBuildingPointsBefore + NumMiscWayPointsBefore );
+		Profile->SetCounter( TEXT( "Points after simplification" ), NumRoadPointsAfter + NumRailwayPointsAfter + NumBuildingPointsAfter + NumMiscWayPointsAfter );
+	}
+}
 
-		NewBuilding.BoundsMin = BoundsMin;
-		NewBuilding.BoundsMax = BoundsMax;
 
-		StreetMapRef.BoundsMin.X = FMath::Min( StreetMapRef.BoundsMin.X, BoundsMin.X );
-		StreetMapRef.BoundsMin.Y = FMath::Min( StreetMapRef.BoundsMin.Y, BoundsMin.Y );
-		StreetMapRef.BoundsMax.X = FMath::Max( StreetMapRef.BoundsMax.X, BoundsMax.X );
-		StreetMapRef.BoundsMax.Y = FMath::Max( StreetMapRef.BoundsMax.Y, BoundsMax.Y );
+bool UStreetMapFactory::ApplyOpenStreetMapChangeFile( UStreetMap* StreetMap, const FString& OSCFilePath, FFeedbackContext* FeedbackContext )
+{
+	// We can only find the elements a change applies to if we know which ways and nodes they were built from
+	if( StreetMap->RoadSources.Num() != StreetMap->Roads.Num() ||
+		StreetMap->BuildingSources.Num() != StreetMap->Buildings.Num() ||
+		StreetMap->RailwaySources.Num() != StreetMap->Railways.Num() ||
+		StreetMap->MiscWaySources.Num() != StreetMap->MiscWays.Num() ||
+		StreetMap->NodeSources.Num() != StreetMap->Nodes.Num() )
+	{
+		if( FeedbackContext != nullptr )
+		{
+			FeedbackContext->Logf( 
+				ELogVerbosity::Error, 
+				TEXT( "Can't apply OpenStreetMap change file '%s' to '%s', because the street map doesn't know which OpenStreetMap elements it was built from.  Reimport it from its source file once, then apply the change file again." ), 
+				*OSCFilePath, 
+				*StreetMap->GetName() );
+		}
+		return false;
+	}
 
-		return true;
-	};
+	FStreetMapImportProfile Profile;
 
-	// Adds a railway to the street map using the OpenStreetMap data, flattening the railway's coordinates into our map's space
-	auto AddRailwayForWay = [OSMToCentimetersScaleFactor](
-		const FOSMFile& OSMFile,
-		UStreetMap& StreetMapRef,
-		const FOSMFile::FOSMWayInfo& OSMWay,
-		int32& OutRailwayIndex) -> bool
-	{
-		EStreetMapRailwayType RailwayType = EStreetMapRailwayType::OtherRailway;
-		if (OSMWay.Category == TEXT("rail"))
-			RailwayType = EStreetMapRailwayType::Rail;
-		else if (OSMWay.Category == TEXT("light_rail"))
-			RailwayType = EStreetMapRailwayType::LightRail;
-		else if (OSMWay.Category == TEXT("subway"))
-			RailwayType = EStreetMapRailwayType::Subway;
-		else if (OSMWay.Category == TEXT("tram"))
-			RailwayType = EStreetMapRailwayType::Tram;
-
-		if (RailwayType == EStreetMapRailwayType::OtherRailway)
-		{
-			// There are other types that we don't recognize yet. See http://wiki.openstreetmap.org/wiki/Key:railway
+	FOSMChangeFile ChangeFile;
+	{
+		FScopedStreetMapImportPhase LoadPhase( &Profile, TEXT( "Load change file" ) );
+		if( !ChangeFile.LoadOpenStreetMapChangeFile( OSCFilePath, FeedbackContext ) )
+		{
 			return false;
 		}
+	}
+
+	Profile.SetCounter( TEXT( "Changed nodes" ), ChangeFile.NodeChanges.Num() );
+	Profile.SetCounter( TEXT( "Changed ways" ), ChangeFile.WayChanges.Num() );
+	Profile.SetCounter( TEXT( "Changed relations" ), ChangeFile.NumRelationChanges );
 
-		// Require at least two points!
-		if (OSMWay.Nodes.Num() < 2)
+	{
+		FScopedStreetMapImportPhase ApplyPhase( &Profile, TEXT( "Apply" ) );
+		if( !ApplyChangesToStreetMap( StreetMap, ChangeFile, OSCFilePath, &Profile, FeedbackContext ) )
 		{
-			// NOTE: Skipped adding railway for way because it has less than 2 points
-			// @todo: Log this for the user as an import warning
 			return false;
 		}
+	}
+
+	if( ChangeFile.NumRelationChanges > 0 && FeedbackContext != nullptr )
+	{
+		// @todo: Apply changes to multipolygons.  Their outer rings follow moved nodes, but to rebuild them we'd have to
+		//        remember which relations the misc ways came from, and the nodes of their holes.
+		FeedbackContext->Logf( ELogVerbosity::Warning, TEXT( "%i changed relations in OpenStreetMap change file '%s' were not applied" ), ChangeFile.NumRelationChanges, *OSCFilePath );
+	}
+
+	Profile.LogReport( FeedbackContext, OSCFilePath );
+
+	return true;
+}
+
 
-		// Create a railway for this way
-		OutRailwayIndex = StreetMapRef.Railways.Num();
-		FStreetMapRailway& NewRailway = *new(StreetMapRef.Railways)FStreetMapRailway();
+bool UStreetMapFactory::ApplyChangesToStreetMap( UStreetMap* StreetMap, FOSMChangeFile& ChangeFile, const FString& OSCFilePath, FStreetMapImportProfile* Profile, FFeedbackContext* FeedbackContext )
+{
+	FScopedStreetMapImportPhase Phase( Profile, TEXT( "Resolve nodes" ) );
 
-		FVector2D BoundsMin(TNumericLimits<float>::Max(), TNumericLimits<float>::Max());
-		FVector2D BoundsMax(TNumericLimits<float>::Lowest(), TNumericLimits<float>::Lowest());
+	// Everything below finds elements and nodes through the source indices, which are built once for street maps that
+	// were imported before we had them
+	if( !StreetMap->HasSourceIndices() )
+	{
+		StreetMap->BuildSourceIndices();
+	}
 
-		NewRailway.Points.AddUninitialized(OSMWay.Nodes.Num());
-		int32 CurRailwayPoint = 0;
+	const FStreetMapWayClassifier Classifier( *GetDefault<UStreetMapImportingSettings>() );
 
-		// Set defaults for each node index on this railway.  INDEX_NONE means the node is not valid, which may be the case
-		// for nodes that we filter out entirely.  This will be filled in by valid indices to nodes later on.
-		NewRailway.NodeIndices.AddUninitialized(OSMWay.Nodes.Num());
-		for (int32& NodeIndex : NewRailway.NodeIndices)
+	// Changed nodes are projected into the street map's space the same way they were when it was imported.  Deleted
+	// nodes don't have a location.
+	const FSpatialReferenceSystem SpatialReferenceSystem( StreetMap->OriginLongitude, StreetMap->OriginLatitude );
+	TMap<int64, FStreetMapExactPoint> ChangedNodePositions;
+	for( const TPair<int64, FOSMChangeFile::FOSMNodeChange>& NodeChange : ChangeFile.NodeChanges )
+	{
+		if( NodeChange.Value.Action != FOSMChangeFile::EOSMChangeAction::Delete )
 		{
-			NodeIndex = INDEX_NONE;
+			const double Longitude = FOSMFile::CoordinateToDegrees( NodeChange.Value.Longitude );
+			const double Latitude = FOSMFile::CoordinateToDegrees( NodeChange.Value.Latitude );
+			FStreetMapExactPoint& Position = ChangedNodePositions.Add( NodeChange.Key );
+			SpatialReferenceSystem.FromEPSG4326( Longitude, Latitude, Position.X, Position.Y );
+			Position.X *= OSMToCentimetersScaleFactor;
+			Position.Y *= OSMToCentimetersScaleFactor;
 		}
+	}
 
-		for (const FOSMFile::FOSMNodeInfo* OSMNodePtr : OSMWay.Nodes)
+	// Changed ways may use nodes that didn't change themselves.  We find those on the ways we built before.
+	TSet<int64> ChangedWayNodeIds;
+	TSet<int64> UnchangedNodeIds;
+	for( const TPair<int64, FOSMChangeFile::FOSMWayChange>& WayChange : ChangeFile.WayChanges )
+	{
+		for( const int64 NodeId : WayChange.Value.NodeRefs )
 		{
-			const FOSMFile::FOSMNodeInfo& OSMNode = *OSMNodePtr;
-			const FVector2D NodePos = OSMFile.SpatialReferenceSystem.FromEPSG4326(OSMNode.Longitude, OSMNode.Latitude) * OSMToCentimetersScaleFactor;
-
-			// Update bounding box
+			ChangedWayNodeIds.Add( NodeId );
+			if( !ChangedNodePositions.Contains( NodeId ) )
 			{
-				if (NodePos.X < BoundsMin.X)
-				{
-					BoundsMin.X = NodePos.X;
-				}
-				if (NodePos.Y < BoundsMin.Y)
-				{
-					BoundsMin.Y = NodePos.Y;
-				}
-				if (NodePos.X > BoundsMax.X)
-				{
-					BoundsMax.X = NodePos.X;
-				}
-				if (NodePos.Y > BoundsMax.Y)
-				{
-					BoundsMax.Y = NodePos.Y;
-				}
+				UnchangedNodeIds.Add( NodeId );
 			}
-
-			// Fill in the points
-			NewRailway.Points[CurRailwayPoint++] = NodePos;
 		}
+	}
 
-
-		NewRailway.Name = OSMWay.Name;
-		if (NewRailway.Name.IsEmpty())
+	TMap<int64, FStreetMapExactPoint> UnchangedNodePositions;
+	for( const int64 NodeId : UnchangedNodeIds )
+	{
+		FStreetMapExactPoint Position;
+		if( FindWayNodePosition( *StreetMap, EStreetMapDataCategory::Roads, StreetMap->Roads, NodeId, Position ) ||
+			FindWayNodePosition( *StreetMap, EStreetMapDataCategory::Buildings, StreetMap->Buildings, NodeId, Position ) ||
+			FindWayNodePosition( *StreetMap, EStreetMapDataCategory::Railways, StreetMap->Railways, NodeId, Position ) ||
+			FindWayNodePosition( *StreetMap, EStreetMapDataCategory::MiscWays, StreetMap->MiscWays, NodeId, Position ) )
 		{
-			NewRailway.Name = OSMWay.Ref;
+			UnchangedNodePositions.Add( NodeId, Position );
 		}
-		NewRailway.Type = RailwayType;
-		NewRailway.BoundsMin = BoundsMin;
-		NewRailway.BoundsMax = BoundsMax;
-
-		StreetMapRef.BoundsMin.X = FMath::Min(StreetMapRef.BoundsMin.X, BoundsMin.X);
-		StreetMapRef.BoundsMin.Y = FMath::Min(StreetMapRef.BoundsMin.Y, BoundsMin.Y);
-		StreetMapRef.BoundsMax.X = FMath::Max(StreetMapRef.BoundsMax.X, BoundsMax.X);
-		StreetMapRef.BoundsMax.Y = FMath::Max(StreetMapRef.BoundsMax.Y, BoundsMax.Y);
-
-		return true;
-	};
+	}
 
-	// Adds a remaining recognized ways to the street map using the OpenStreetMap data
-	auto AddMiscWay = [OSMToCentimetersScaleFactor](
-		const FOSMFile& OSMFile,
-		UStreetMap& StreetMapRef,
-		const FOSMFile::FOSMWayInfo& OSMWay) -> bool
+	// Build a small node table for the changed ways, so that we can convert them just like the ways of a whole file
+	TArray<FStreetMapExactPoint> NodePositions;
+	TArray<int64> NodeIds;
+	TMap<int64, int32> NodeIdToIndex;
+	TArray<TPair<const FOSMFile::FOSMWayInfo*, FStreetMapWayOutput>> NewWays;
+	for( TPair<int64, FOSMChangeFile::FOSMWayChange>& WayChange : ChangeFile.WayChanges )
 	{
-		if (OSMWay.WayType == FOSMFile::EOSMWayType::Other)
+		if( WayChange.Value.Action == FOSMChangeFile::EOSMChangeAction::Delete )
 		{
-			return false;
+			continue;
 		}
 
-		// Create a MiscWay for this way
-		FStreetMapMiscWay& NewMiscWay = *new(StreetMapRef.MiscWays)FStreetMapMiscWay();
-
-		FVector2D BoundsMin(TNumericLimits<float>::Max(), TNumericLimits<float>::Max());
-		FVector2D BoundsMax(TNumericLimits<float>::Lowest(), TNumericLimits<float>::Lowest());
+		FOSMFile::FOSMWayInfo& OSMWay = WayChange.Value.WayInfo;
+		OSMWay.Nodes.Reset( WayChange.Value.NodeRefs.Num() );
 
-		NewMiscWay.Points.AddUninitialized(OSMWay.Nodes.Num());
-		int32 CurBuildingPoint = 0;
-
-		for (const FOSMFile::FOSMNodeInfo* OSMNodePtr : OSMWay.Nodes)
+		int64 MissingNodeId = 0;
+		for( const int64 NodeId : WayChange.Value.NodeRefs )
 		{
-			const FOSMFile::FOSMNodeInfo& OSMNode = *OSMNodePtr;
-			const FVector2D NodePos = OSMFile.SpatialReferenceSystem.FromEPSG4326(OSMNode.Longitude, OSMNode.Latitude) * OSMToCentimetersScaleFactor;
-
-			// Update bounding box
+			const int32* FoundNodeIndex = NodeIdToIndex.Find( NodeId );
+			int32 NodeIndex = FoundNodeIndex != nullptr ? *FoundNodeIndex : INDEX_NONE;
+			if( FoundNodeIndex == nullptr )
 			{
-				if (NodePos.X < BoundsMin.X)
-				{
-					BoundsMin.X = NodePos.X;
-				}
-				if (NodePos.Y < BoundsMin.Y)
+				const FStreetMapExactPoint* NodePosition = ChangedNodePositions.Find( NodeId );
+				if( NodePosition == nullptr )
 				{
-					BoundsMin.Y = NodePos.Y;
+					NodePosition = UnchangedNodePositions.Find( NodeId );
 				}
-				if (NodePos.X > BoundsMax.X)
+				if( NodePosition == nullptr )
 				{
-					BoundsMax.X = NodePos.X;
+					MissingNodeId = NodeId;
 				}
-				if (NodePos.Y > BoundsMax.Y)
+				else
 				{
-					BoundsMax.Y = NodePos.Y;
+					NodeIndex = NodePositions.Add( *NodePosition );
+					NodeIds.Add( NodeId );
+					NodeIdToIndex.Add( NodeId, NodeIndex );
 				}
 			}
-
-			// Fill in the points
-			NewMiscWay.Points[CurBuildingPoint++] = NodePos;
-		}
-
-		// Test if the building ended up with a closed polygon, then remove the final (redundant) point
-		const bool bIsClosed = NewMiscWay.Points[0].Equals(NewMiscWay.Points[NewMiscWay.Points.Num() - 1], KINDA_SMALL_NUMBER);
-		if (bIsClosed)
-		{
-			// Remove the final redundant point
-			NewMiscWay.Points.Pop();
+			OSMWay.Nodes.Add( NodeIndex );
 		}
-		else
-		{
-			// Unclosed shapes are total fine (e.g. tree_row)
-		}
-
 
-		NewMiscWay.Type = EStreetMapMiscWayType::Unknown;
-		switch (OSMWay.WayType)
+		const FStreetMapWayOutput WayOutput = ClassifyWay( OSMWay, Classifier );
+		if( WayOutput.Kind == EStreetMapWayOutput::None )
 		{
-			case FOSMFile::EOSMWayType::Leisure: NewMiscWay.Type = EStreetMapMiscWayType::Leisure; break;
-			case FOSMFile::EOSMWayType::Natural: NewMiscWay.Type = EStreetMapMiscWayType::Natural; break;
-			case FOSMFile::EOSMWayType::LandUse: NewMiscWay.Type = EStreetMapMiscWayType::LandUse; break;
+			continue;
 		}
 
-		NewMiscWay.Name = OSMWay.Name;
-		if (NewMiscWay.Name.IsEmpty())
+		// The way uses a node that neither changed, nor is part of anything we imported.  This happens when a way we
+		// filtered out turns into one we import, or when a way grows past the import area.  Nothing has been modified
+		// yet, so we can simply bail out.
+		if( MissingNodeId != 0 )
 		{
-			NewMiscWay.Name = OSMWay.Ref;
+			if( FeedbackContext != nullptr )
+			{
+				FeedbackContext->Logf( 
+					ELogVerbosity::Error, 
+					TEXT( "Can't apply OpenStreetMap change file '%s', because way %lld uses node %lld, which is not in the street map.  Reimport the street map from an up to date source file instead." ), 
+					*OSCFilePath, 
+					WayChange.Key, 
+					MissingNodeId );
+			}
+			return false;
 		}
 
-		NewMiscWay.Category = OSMWay.Category;
-
-		NewMiscWay.BoundsMin = BoundsMin;
-		NewMiscWay.BoundsMax = BoundsMax;
-		NewMiscWay.bIsClosed = bIsClosed;
+		NewWays.Emplace( &OSMWay, WayOutput );
+	}
 
-		StreetMapRef.BoundsMin.X = FMath::Min(StreetMapRef.BoundsMin.X, BoundsMin.X);
-		StreetMapRef.BoundsMin.Y = FMath::Min(StreetMapRef.BoundsMin.Y, BoundsMin.Y);
-		StreetMapRef.BoundsMax.X = FMath::Max(StreetMapRef.BoundsMax.X, BoundsMax.X);
-		StreetMapRef.BoundsMax.Y = FMath::Max(StreetMapRef.BoundsMax.Y, BoundsMax.Y);
+	Phase.Next( TEXT( "Convert ways" ) );
 
-		return true;
+	const EStreetMapDataCategory Categories[] = 
+	{ 
+		EStreetMapDataCategory::Roads, 
+		EStreetMapDataCategory::Railways, 
+		EStreetMapDataCategory::Buildings, 
+		EStreetMapDataCategory::MiscWays 
 	};
-
-	// Adds multipolygons recognized as MiscWays - the ways are actually already present but with 
-	auto AddMultipolygon = [OSMToCentimetersScaleFactor, AddMiscWay](
-		const FOSMFile& OSMFile,
-		UStreetMap& StreetMapRef,
-		const FOSMFile::FOSMRelation& OSMRelation) -> bool
+	const int32 NumCategories = (int32)EStreetMapDataCategory::Count;
+
+	// Changed ways are built again from scratch, so the elements we built from them before go away.  Nodes on those
+	// elements, nodes on the changed ways, and changed nodes themselves are the only ones that may have to be connected
+	// again.  We find all of them before anything changes.
+	TArray<int32> RemovedElements[ NumCategories ];
+	TSet<int64> AffectedNodeIds;
+	for( const EStreetMapDataCategory Category : Categories )
 	{
-		if (OSMRelation.Type == FOSMFile::EOSMRelationType::Multipolygon)
+		const TArray<FStreetMapWaySource>& Sources = StreetMap->GetWaySources( Category );
+		TArray<int32>& CategoryRemovedElements = RemovedElements[ (int32)Category ];
+		for( const TPair<int64, FOSMChangeFile::FOSMWayChange>& WayChange : ChangeFile.WayChanges )
 		{
-			// TODO: could already parse the relation type in osmfile.cpp analog to ways types (landuse, leisure, etc)
-			bool bHasLandUseTag = false;
-			FString TagValue;
-			for (const FOSMFile::FOSMTag& Tag : OSMRelation.Tags)
-			{
-				if (Tag.Key.IsEqual(FName("landuse")))
-				{
-					bHasLandUseTag = true;
-					TagValue = Tag.Value.ToString();
-					break;
-				}
-			}
-
-			// if its a multipolygon and has a landuse tag, we can modify the corresponding outer way with this information
-			if (bHasLandUseTag)
+			StreetMap->ForEachWayElement( Category, WayChange.Key, [&CategoryRemovedElements]( int32 ElementIndex )
 			{
-				for (const FOSMFile::FOSMRelationMember* Member : OSMRelation.Members)
-				{
-					if (Member->Role == FOSMFile::EOSMRelationMemberRole::Outer)
-					{
-						FOSMFile::FOSMWayInfo* ReferencedWay = OSMFile.WayMap.FindRef(Member->Ref);
-						if (ReferencedWay)
-						{
-							// match - modify MiscWay with the multipolygon outer information
-							ReferencedWay->Category = TagValue;
-							if (ReferencedWay->WayType == FOSMFile::EOSMWayType::Other)
-							{
-								ReferencedWay->WayType = FOSMFile::EOSMWayType::LandUse;
-								// it its definately not part of the misc ways yet, so add it
-								AddMiscWay(OSMFile, StreetMapRef, *ReferencedWay);
-							}
-							return true;
-						}
-					}
-					else if (Member->Role == FOSMFile::EOSMRelationMemberRole::Inner)
-					{
-						// TODO: seems like inners have their own landuse tags, so they should get painted correctly, too
-						// maybe just a problem of order remaining?!
-					}
-				}
-			}
-
-		// TODO: we can create misc ways but have to keep the outer and inner relations somehow for advanced cases
-		// all inner polygons having influence on the layer painting. it should work as inner ways are added later and repaint the area - or not???
-		// or we add a special drawing function to the CreateLandscape() function on how to handle multipolygons
+				CategoryRemovedElements.Add( ElementIndex );
+			} );
 		}
+		for( const int32 ElementIndex : CategoryRemovedElements )
+		{
+			AffectedNodeIds.Append( Sources[ ElementIndex ].NodeIds );
+		}
+	}
+	for( const TPair<int64, FOSMChangeFile::FOSMNodeChange>& NodeChange : ChangeFile.NodeChanges )
+	{
+		AffectedNodeIds.Add( NodeChange.Key );
+	}
+	AffectedNodeIds.Append( ChangedWayNodeIds );
 
-		return false;
-	};
-
-
-	// Load up the OSM file.  It's in XML format.
-	FOSMFile OSMFile;
-	if( !OSMFile.LoadOpenStreetMapFile( OSMFilePath, bIsFilePathActuallyTextBuffer, FeedbackContext ) )
+	// Points of interest are the nodes we stored that aren't on any road or railway
+	TSet<int64> PointOfInterestIds;
+	for( const int64 NodeId : AffectedNodeIds )
 	{
-		// Loading failed.  The actual error message will be sent to the FeedbackContext's log.
-		return false;
+		const int32 NodeIndex = StreetMap->FindNodeBySource( NodeId );
+		if( NodeIndex != INDEX_NONE && StreetMap->Nodes[ NodeIndex ].RoadRefs.Num() == 0 && StreetMap->Nodes[ NodeIndex ].RailwayRefs.Num() == 0 )
+		{
+			PointOfInterestIds.Add( NodeId );
+		}
 	}
 
-	StreetMap->OriginLongitude = OSMFile.SpatialReferenceSystem.GetOriginLongitude();
-	StreetMap->OriginLatitude = OSMFile.SpatialReferenceSystem.GetOriginLatitude();
+	// Removing an element moves the last one into its place, so going from the back never moves one we still have to remove
+	for( const EStreetMapDataCategory Category : Categories )
+	{
+		TArray<int32>& CategoryRemovedElements = RemovedElements[ (int32)Category ];
+		CategoryRemovedElements.Sort( TGreater<int32>() );
+		for( const int32 ElementIndex : CategoryRemovedElements )
+		{
+			StreetMap->RemoveElement( Category, ElementIndex );
+		}
+	}
 
-	// @todo: The loaded OSMFile stores data in double precision, but our runtime representation (UStreetMap)
-	//        truncates everything to single precision, after transposing coordinates to be relative to the
-	//        center of the map's 2D bounds.  Large maps will suffer from floating point precision issues.
-	//        To solve this we'd need to either store everything in double precision, or store map elements
-	//        in integral grid cells with coordinates relative to their cell.  Of course, there will be many
-	//        other considerations for handling huge maps (loading, rendering, collision, etc.)
+	// Everything else only needs to follow the nodes that moved.  Elements we touch are unpacked, and packed again at the end.
+	TSet<int32> ChangedElements[ NumCategories ];
+	if( ChangedNodePositions.Num() > 0 )
+	{
+		MoveChangedWayPoints( *StreetMap, EStreetMapDataCategory::Roads, StreetMap->Roads, ChangedNodePositions, ChangedElements[ (int32)EStreetMapDataCategory::Roads ] );
+		MoveChangedWayPoints( *StreetMap, EStreetMapDataCategory::Railways, StreetMap->Railways, ChangedNodePositions, ChangedElements[ (int32)EStreetMapDataCategory::Railways ] );
+		MoveChangedWayPoints( *StreetMap, EStreetMapDataCategory::Buildings, StreetMap->Buildings, ChangedNodePositions, ChangedElements[ (int32)EStreetMapDataCategory::Buildings ] );
+		MoveChangedWayPoints( *StreetMap, EStreetMapDataCategory::MiscWays, StreetMap->MiscWays, ChangedNodePositions, ChangedElements[ (int32)EStreetMapDataCategory::MiscWays ] );
+	}
 
-	// Maps OSMWayInfos to the (Road/Railway)-Index we created for that way
-	TMap< const FOSMFile::FOSMWayInfo*, int32 > OSMWayToRoadIndexMap;
-	TMap< const FOSMFile::FOSMWayInfo*, int32 > OSMWayToRailwayIndexMap;
+	auto GetNodeId = [&NodeIds]( const int32 NodeIndex )
+	{
+		return NodeIds[ NodeIndex ];
+	};
 
-	StreetMap->BoundsMin = FVector2D( TNumericLimits<float>::Max(), TNumericLimits<float>::Max() );
-	StreetMap->BoundsMax = FVector2D( TNumericLimits<float>::Lowest(), TNumericLimits<float>::Lowest() );
+	// Rebuilt ways go after everything else, which is how simplification finds them later
+	const int32 FirstNewRoad = StreetMap->Roads.Num();
+	const int32 FirstNewRailway = StreetMap->Railways.Num();
+	const int32 FirstNewBuilding = StreetMap->Buildings.Num();
+	const int32 FirstNewMiscWay = StreetMap->MiscWays.Num();
 
-	for( const FOSMFile::FOSMWayInfo* OSMWay : OSMFile.Ways )
+	for( const TPair<const FOSMFile::FOSMWayInfo*, FStreetMapWayOutput>& NewWay : NewWays )
 	{
-		// Handle buildings differently than roads
-		if( OSMWay->WayType == FOSMFile::EOSMWayType::Building )
+		const FOSMFile::FOSMWayInfo& OSMWay = *NewWay.Key;
+		const FStreetMapWayOutput& WayOutput = NewWay.Value;
+		switch( WayOutput.Kind )
 		{
-			if( AddBuildingForWay( OSMFile, *StreetMap, *OSMWay ) )
+			case EStreetMapWayOutput::Road:
 			{
-				// ...
+				FStreetMapRoad& NewRoad = StreetMap->Roads[ StreetMap->Roads.AddDefaulted() ];
+				FillRoadForWay( OSMWay, NodePositions, (EStreetMapRoadType)WayOutput.Type, NewRoad );
+				FillWaySource( OSMWay, NewRoad.RoadPoints.Num(), GetNodeId, StreetMap->RoadSources[ StreetMap->RoadSources.AddDefaulted() ] );
+				StreetMap->AddElementToSourceIndices( EStreetMapDataCategory::Roads, StreetMap->Roads.Num() - 1 );
+				break;
 			}
-		}
-		else if( OSMWay->WayType == FOSMFile::EOSMWayType::Highway )
-		{
-			int32 RoadIndex = INDEX_NONE;
-			if( AddRoadForWay( OSMFile, *StreetMap, *OSMWay, RoadIndex ) )
+			case EStreetMapWayOutput::Building:
 			{
-				OSMWayToRoadIndexMap.Add( OSMWay, RoadIndex );
+				FStreetMapBuilding& NewBuilding = StreetMap->Buildings[ StreetMap->Buildings.AddDefaulted() ];
+				FillBuildingForWay( OSMWay, NodePositions, NewBuilding );
+				FillWaySource( OSMWay, NewBuilding.BuildingPoints.Num(), GetNodeId, StreetMap->BuildingSources[ StreetMap->BuildingSources.AddDefaulted() ] );
+				StreetMap->AddElementToSourceIndices( EStreetMapDataCategory::Buildings, StreetMap->Buildings.Num() - 1 );
+				break;
 			}
-		}
-		else if (OSMWay->WayType == FOSMFile::EOSMWayType::Railway)
-		{
-			int32 RailwayIndex = INDEX_NONE;
-			if (AddRailwayForWay(OSMFile, *StreetMap, *OSMWay, RailwayIndex))
+			case EStreetMapWayOutput::Railway:
 			{
-				OSMWayToRailwayIndexMap.Add(OSMWay, RailwayIndex);
+				FStreetMapRailway& NewRailway = StreetMap->Railways[ StreetMap->Railways.AddDefaulted() ];
+				FillRailwayForWay( OSMWay, NodePositions, (EStreetMapRailwayType)WayOutput.Type, NewRailway );
+				FillWaySource( OSMWay, NewRailway.Points.Num(), GetNodeId, StreetMap->RailwaySources[ StreetMap->RailwaySources.AddDefaulted() ] );
+				StreetMap->AddElementToSourceIndices( EStreetMapDataCategory::Railways, StreetMap->Railways.Num() - 1 );
+				break;
 			}
-		}
-		else if (AddMiscWay(OSMFile, *StreetMap, *OSMWay))
-		{
-			// ...
-		}
-	}
-
-	for (const FOSMFile::FOSMRelation* OSMRelation : OSMFile.Relations)
-	{
-		// TODO ....
-		// Handle multipolgyons
-		if (OSMRelation->Type == FOSMFile::EOSMRelationType::Multipolygon)
-		{
-			if (AddMultipolygon(OSMFile, *StreetMap, *OSMRelation))
+			case EStreetMapWayOutput::MiscWay:
 			{
-				// ...
+				FStreetMapMiscWay& NewMiscWay = StreetMap->MiscWays[ StreetMap->MiscWays.AddDefaulted() ];
+				FillMiscWay( OSMWay, NodePositions, NewMiscWay );
+				FillWaySource( OSMWay, NewMiscWay.Points.Num(), GetNodeId, StreetMap->MiscWaySources[ StreetMap->MiscWaySources.AddDefaulted() ] );
+				StreetMap->AddElementToSourceIndices( EStreetMapDataCategory::MiscWays, StreetMap->MiscWays.Num() - 1 );
+				break;
 			}
 		}
 	}
 
+	Phase.Next( TEXT( "Connect nodes" ) );
 
-	for (const auto& NodeMapHashPair : OSMFile.NodeMap)
+	// Node indices of unpacked roads and railways are in their own arrays, and the rest are still in the pools
+	auto GetRoadNodeIndex = [StreetMap]( const FStreetMapRoadRef& RoadRef ) -> int32&
 	{
-		const FOSMFile::FOSMNodeInfo& OSMNode = *NodeMapHashPair.Value;
-		FStreetMapNode NewNode;
+		FStreetMapRoad& Road = StreetMap->Roads[ RoadRef.RoadIndex ];
+		return Road.NodeIndices.Num() > 0 ? Road.NodeIndices[ RoadRef.RoadPointIndex ] : StreetMap->RoadNodeIndices[ Road.FirstPoint + RoadRef.RoadPointIndex ];
+	};
+	auto GetRailwayNodeIndex = [StreetMap]( const FStreetMapRailwayRef& RailwayRef ) -> int32&
+	{
+		FStreetMapRailway& Railway = StreetMap->Railways[ RailwayRef.RailwayIndex ];
+		return Railway.NodeIndices.Num() > 0 ? Railway.NodeIndices[ RailwayRef.RailwayPointIndex ] : StreetMap->RailwayNodeIndices[ Railway.FirstPoint + RailwayRef.RailwayPointIndex ];
+	};
+	auto GetRoadPoint = [StreetMap]( const FStreetMapRoadRef& RoadRef )
+	{
+		const FStreetMapRoad& Road = StreetMap->Roads[ RoadRef.RoadIndex ];
+		return Road.RoadPoints.Num() > 0 ? Road.RoadPoints[ RoadRef.RoadPointIndex ] : Road.GetPoints( *StreetMap )[ RoadRef.RoadPointIndex ];
+	};
+	auto GetRailwayPoint = [StreetMap]( const FStreetMapRailwayRef& RailwayRef )
+	{
+		const FStreetMapRailway& Railway = StreetMap->Railways[ RailwayRef.RailwayIndex ];
+		return Railway.Points.Num() > 0 ? Railway.Points[ RailwayRef.RailwayPointIndex ] : Railway.GetPoints( *StreetMap )[ RailwayRef.RailwayPointIndex ];
+	};
 
-		// copy all tags first
-		for (const FOSMFile::FOSMTag& OSMNodeTag : OSMNode.Tags)
-		{
-			FStreetMapTag Tag;
-			Tag.Key = OSMNodeTag.Key;
-			Tag.Value = OSMNodeTag.Value;
-			NewNode.Tags.Add(Tag);
-		}
+	// Only nodes at the ends of roads and railways, and where they meet, are stored.  See BuildStreetMapFromOSMFile.
+	auto IsRoadNodeKept = [StreetMap]( const FStreetMapNode& Node )
+	{
+		return Node.RoadRefs.Num() > 1 || 
+			( Node.RoadRefs.Num() == 1 && ( Node.RoadRefs[ 0 ].RoadPointIndex == 0 || Node.RoadRefs[ 0 ].RoadPointIndex == StreetMap->RoadSources[ Node.RoadRefs[ 0 ].RoadIndex ].NodeIds.Num() - 1 ) );
+	};
+	auto IsRailwayNodeKept = [StreetMap]( const FStreetMapNode& Node )
+	{
+		return Node.RailwayRefs.Num() > 1 || 
+			( Node.RailwayRefs.Num() == 1 && ( Node.RailwayRefs[ 0 ].RailwayPointIndex == 0 || Node.RailwayRefs[ 0 ].RailwayPointIndex == StreetMap->RailwaySources[ Node.RailwayRefs[ 0 ].RailwayIndex ].NodeIds.Num() - 1 ) );
+	};
 
-		// Any ways touching this node?
-		if (OSMNode.WayRefs.Num() == 0)
+	// Every affected node is connected again from the points that are at it now, following the same rules as
+	// BuildStreetMapFromOSMFile.  Nodes that aren't on any road or railway are kept if they were points of interest
+	// before, or if they were just created with tags and aren't on any way.
+	TArray<int64> KeptNodeIds;
+	for( const int64 NodeId : AffectedNodeIds )
+	{
+		FStreetMapNode ConnectedNode;
+		StreetMap->ForEachNodePoint( EStreetMapDataCategory::Roads, NodeId, [&ConnectedNode, &GetRoadNodeIndex]( int32 RoadIndex, int32 RoadPointIndex )
 		{
-			// Is this node important beyond any references by ways?
-			if (OSMNode.Tags.Num() > 0)
+			FStreetMapRoadRef& RoadRef = ConnectedNode.RoadRefs[ ConnectedNode.RoadRefs.AddUninitialized() ];
+			RoadRef.RoadIndex = RoadIndex;
+			RoadRef.RoadPointIndex = RoadPointIndex;
+			GetRoadNodeIndex( RoadRef ) = INDEX_NONE;
+		} );
+		StreetMap->ForEachNodePoint( EStreetMapDataCategory::Railways, NodeId, [&ConnectedNode, &GetRailwayNodeIndex]( int32 RailwayIndex, int32 RailwayPointIndex )
+		{
+			FStreetMapRailwayRef& RailwayRef = ConnectedNode.RailwayRefs[ ConnectedNode.RailwayRefs.AddUninitialized() ];
+			RailwayRef.RailwayIndex = RailwayIndex;
+			RailwayRef.RailwayPointIndex = RailwayPointIndex;
+			GetRailwayNodeIndex( RailwayRef ) = INDEX_NONE;
+		} );
+
+		const FOSMChangeFile::FOSMNodeChange* NodeChange = ChangeFile.NodeChanges.Find( NodeId );
+		const bool bIsDeleted = NodeChange != nullptr && NodeChange->Action == FOSMChangeFile::EOSMChangeAction::Delete;
+		const bool bIsRoadNodeKept = IsRoadNodeKept( ConnectedNode );
+		const bool bIsRailwayNodeKept = IsRailwayNodeKept( ConnectedNode );
+		const bool bIsConnected = ConnectedNode.RoadRefs.Num() > 0 || ConnectedNode.RailwayRefs.Num() > 0;
+		const bool bIsKept = bIsConnected ? 
+			( bIsRoadNodeKept || bIsRailwayNodeKept ) :
+			( ( PointOfInterestIds.Contains( NodeId ) && !bIsDeleted ) ||
+			  ( NodeChange != nullptr && NodeChange->Action == FOSMChangeFile::EOSMChangeAction::Create && NodeChange->Tags.Num() > 0 && !ChangedWayNodeIds.Contains( NodeId ) ) );
+
+		int32 NodeIndex = StreetMap->FindNodeBySource( NodeId );
+		if( bIsKept )
+		{
+			if( NodeIndex == INDEX_NONE )
 			{
-				const FVector2D NodePos = OSMFile.SpatialReferenceSystem.FromEPSG4326(OSMNode.Longitude, OSMNode.Latitude) * OSMToCentimetersScaleFactor;
-				NewNode.Location.X = NodePos.X;
-				NewNode.Location.Y = NodePos.Y;
-
-				StreetMap->Nodes.Add(NewNode);
+				NodeIndex = StreetMap->Nodes.AddDefaulted();
+				StreetMap->NodeSources.Add( NodeId );
+				StreetMap->AddNodeToSourceIndices( NodeIndex );
 			}
 
-			continue;
-		}
-
-		for (const FOSMFile::FOSMWayRef& OSMWayRef : OSMNode.WayRefs)
-		{
-			const int32* FoundRoadIndexPtr = OSMWayToRoadIndexMap.Find(OSMWayRef.Way);
-			if (FoundRoadIndexPtr != nullptr)
+			// Nodes keep their tags unless they changed.  Tags of nodes we didn't store before are unknown.
+			FStreetMapNode& Node = StreetMap->Nodes[ NodeIndex ];
+			if( NodeChange != nullptr )
 			{
-				const int32 FoundRoadIndex = *FoundRoadIndexPtr;
-
-				FStreetMapRoadRef RoadRef;
-				RoadRef.RoadIndex = FoundRoadIndex;
-
-				const int32 RoadPointIndex = OSMWayRef.NodeIndex;
-				RoadRef.RoadPointIndex = RoadPointIndex;
-				NewNode.RoadRefs.Add(RoadRef);
-				NewNode.Location = StreetMap->Roads[FoundRoadIndex].RoadPoints[RoadPointIndex];
+				Node.Tags.Reset();
+				for( const FOSMFile::FOSMTag& OSMNodeTag : NodeChange->Tags )
+				{
+					FStreetMapTag Tag;
+					Tag.Key = OSMNodeTag.Key;
+					Tag.Value = OSMNodeTag.Value;
+					Node.Tags.Add( Tag );
+				}
 			}
 
-			const int32* FoundRailwayIndexPtr = OSMWayToRailwayIndexMap.Find(OSMWayRef.Way);
-			if (FoundRailwayIndexPtr != nullptr)
+			Node.RoadRefs = MoveTemp( ConnectedNode.RoadRefs );
+			Node.RailwayRefs = MoveTemp( ConnectedNode.RailwayRefs );
+			if( Node.RoadRefs.Num() > 0 )
 			{
-				const int32 FoundRailwayIndex = *FoundRailwayIndexPtr;
-
-				FStreetMapRailwayRef RailwayRef;
-				RailwayRef.RailwayIndex = FoundRailwayIndex;
-
-				const int32 RailwayPointIndex = OSMWayRef.NodeIndex;
-				RailwayRef.RailwayPointIndex = RailwayPointIndex;
-				NewNode.RailwayRefs.Add(RailwayRef);
-				NewNode.Location = StreetMap->Railways[FoundRailwayIndex].Points[RailwayPointIndex];
+				Node.Location = GetRoadPoint( Node.RoadRefs[ 0 ] );
 			}
-			else
+			else if( Node.RailwayRefs.Num() > 0 )
 			{
-				// Skipped ref because we didn't keep this road nor railway in our data set							
+				Node.Location = GetRailwayPoint( Node.RailwayRefs[ 0 ] );
 			}
-		}
-
-		int32 NewNodeIndex = INDEX_NONE;
-
-		// Only store nodes that are attached to at least one road or railway.  We must have at least a connection to a single
-		// road/railway, otherwise we've filtered this node's road out and there's no point in wasting memory on the node itself.
-		if (NewNode.RoadRefs.Num() > 0)
-		{
-			// Most nodes from OpenStreetMap will only be touching a single road.  These nodes usually make up the points
-			// along the length of the road, even for roads with no intersections except at the beginning and end.  We
-			// don't need to store these points unless they are at the ends of the road.  Keeping the points at the
-			// beginning and end of the road is useful when calculating navigation data, but the other nodes can go!
-			// In the road's NodeIndices array, any nodes we filter out here will simply have an INDEX_NONE value in that
-			// array, and we'll only store the positions of the road at these points in the road's RoadPoints array.
-
-			const FStreetMapRoadRef& FirstRoadRef = NewNode.RoadRefs[0];
-			const FStreetMapRoad& FirstRoad = StreetMap->Roads[FirstRoadRef.RoadIndex];
-
-			if (NewNode.RoadRefs.Num() > 1 ||					// Does the node connect to more than one road?
-				FirstRoadRef.RoadPointIndex == 0 ||				// Does the node connect to the beginning of the road?
-				FirstRoadRef.RoadPointIndex == (FirstRoad.NodeIndices.Num() - 1))	// Does the node connect to the end of the road?
+			else if( const FStreetMapExactPoint* NewPosition = ChangedNodePositions.Find( NodeId ) )
 			{
-				NewNodeIndex = StreetMap->Nodes.Num();
-				StreetMap->Nodes.Add(NewNode);
+				Node.Location = NewPosition->ToVector2D();
+			}
 
-				// Update the roads that are overlapping this node
-				for (const FStreetMapRoadRef& RoadRef : NewNode.RoadRefs)
+			if( bIsRoadNodeKept )
+			{
+				for( const FStreetMapRoadRef& RoadRef : Node.RoadRefs )
 				{
-					FStreetMapRoad& Road = StreetMap->Roads[RoadRef.RoadIndex];
-					check(Road.NodeIndices[RoadRef.RoadPointIndex] == INDEX_NONE);
-					Road.NodeIndices[RoadRef.RoadPointIndex] = NewNodeIndex;
+					GetRoadNodeIndex( RoadRef ) = NodeIndex;
 				}
 			}
-			else
+			if( bIsRailwayNodeKept )
 			{
-				// Node has only one road that it references, and it wasn't the beginning or end of the road, so filter it out!
+				for( const FStreetMapRailwayRef& RailwayRef : Node.RailwayRefs )
+				{
+					GetRailwayNodeIndex( RailwayRef ) = NodeIndex;
+				}
 			}
+			KeptNodeIds.Add( NodeId );
 		}
-
-		if (NewNode.RailwayRefs.Num() > 0)
+		else if( NodeIndex != INDEX_NONE )
 		{
-			// see text for roads above and replace the words roads with railways
-			const FStreetMapRailwayRef& FirstRailwayRef = NewNode.RailwayRefs[0];
-			const FStreetMapRailway& FirstRailway = StreetMap->Railways[FirstRailwayRef.RailwayIndex];
-
-			if (NewNode.RailwayRefs.Num() > 1 ||						// Does the node connect to more than one railway?
-				FirstRailwayRef.RailwayPointIndex == 0 ||				// Does the node connect to the beginning of the railway?
-				FirstRailwayRef.RailwayPointIndex == (FirstRailway.NodeIndices.Num() - 1))	// Does the node connect to the end of the railway?
+			// The last node takes the place of the one that goes away, and the points at it follow
+			const int32 LastNodeIndex = StreetMap->Nodes.Num() - 1;
+			if( NodeIndex != LastNodeIndex )
 			{
-				if (NewNodeIndex == INDEX_NONE)
+				const FStreetMapNode& LastNode = StreetMap->Nodes[ LastNodeIndex ];
+				for( const FStreetMapRoadRef& RoadRef : LastNode.RoadRefs )
 				{
-					NewNodeIndex = StreetMap->Nodes.Num();
-					StreetMap->Nodes.Add(NewNode);
+					int32& RoadNodeIndex = GetRoadNodeIndex( RoadRef );
+					if( RoadNodeIndex == LastNodeIndex )
+					{
+						RoadNodeIndex = NodeIndex;
+					}
 				}
-
-				// Update the railways that are overlapping this node
-				for (const FStreetMapRailwayRef& RailwayRef : NewNode.RailwayRefs)
+				for( const FStreetMapRailwayRef& RailwayRef : LastNode.RailwayRefs )
 				{
-					FStreetMapRailway& Railway = StreetMap->Railways[RailwayRef.RailwayIndex];
-					check(Railway.NodeIndices[RailwayRef.RailwayPointIndex] == INDEX_NONE);
-					Railway.NodeIndices[RailwayRef.RailwayPointIndex] = NewNodeIndex;
+					int32& RailwayNodeIndex = GetRailwayNodeIndex( RailwayRef );
+					if( RailwayNodeIndex == LastNodeIndex )
+					{
+						RailwayNodeIndex = NodeIndex;
+					}
 				}
 			}
-			else
+
+			StreetMap->Nodes.RemoveAtSwap( NodeIndex, 1, false );
+			StreetMap->NodeSources.RemoveAtSwap( NodeIndex, 1, false );
+			if( NodeIndex != LastNodeIndex )
 			{
-				// Node has only one railway that it references, and it wasn't the beginning or end of the railway, so filter it out!
+				StreetMap->AddNodeToSourceIndices( NodeIndex );
 			}
 		}
-		else
+	}
+
+	// Rebuilt ways are simplified like the ways of a full import, with the settings the street map was imported with.
+	// Every node on them was affected, so those are the only nodes simplification has to look at.
+	const FStreetMapImportSettings& Settings = StreetMap->ImportSettings;
+	if( Settings.Simplification != EStreetMapSimplification::None )
+	{
+		Phase.Next( TEXT( "Simplify" ) );
+		TArray<int32> KeptNodeIndices;
+		KeptNodeIndices.Reserve( KeptNodeIds.Num() );
+		for( const int64 NodeId : KeptNodeIds )
 		{
-			// Node doesn't reference any roads that we kept, or the data was malformed.  Filter it out.
+			KeptNodeIndices.Add( StreetMap->FindNodeBySource( NodeId ) );
+		}
+		SimplifyStreetMap( *StreetMap, Settings, FirstNewRoad, FirstNewRailway, FirstNewBuilding, FirstNewMiscWay, &KeptNodeIndices, Profile, FeedbackContext );
+
+		// Points were removed from the sources of the new elements, which moves the rest of their points
+		for( int32 RoadIndex = FirstNewRoad; RoadIndex < StreetMap->Roads.Num(); ++RoadIndex )
+		{
+			StreetMap->AddElementToSourceIndices( EStreetMapDataCategory::Roads, RoadIndex );
+		}
+		for( int32 RailwayIndex = FirstNewRailway; RailwayIndex < StreetMap->Railways.Num(); ++RailwayIndex )
+		{
+			StreetMap->AddElementToSourceIndices( EStreetMapDataCategory::Railways, RailwayIndex );
+		}
+		for( int32 BuildingIndex = FirstNewBuilding; BuildingIndex < StreetMap->Buildings.Num(); ++BuildingIndex )
+		{
+			StreetMap->AddElementToSourceIndices( EStreetMapDataCategory::Buildings, BuildingIndex );
+		}
+		for( int32 MiscWayIndex = FirstNewMiscWay; MiscWayIndex < StreetMap->MiscWays.Num(); ++MiscWayIndex )
+		{
+			StreetMap->AddElementToSourceIndices( EStreetMapDataCategory::MiscWays, MiscWayIndex );
 		}
 	}
 
-	// Validation test: Make sure that all roads have at least two nodes referencing them, one at the beginning and one at the end.
-	for (const FStreetMapRoad& Road : StreetMap->Roads)
+	Phase.Next( TEXT( "Pack" ) );
+
+	// Only the elements we touched go back into the pools.  The street map's bounds grow to fit them, but don't shrink
+	// when elements go away, since that would mean looking at all of them.
+	const int32 FirstNewElements[ NumCategories ] = { FirstNewRoad, FirstNewRailway, FirstNewBuilding, FirstNewMiscWay };
+	for( const EStreetMapDataCategory Category : Categories )
 	{
-		const bool bHasNodeAtBeginning = Road.NodeIndices[0] != INDEX_NONE;
-		const bool bHasNodeAtEnd = Road.NodeIndices[Road.NodeIndices.Num() - 1] != INDEX_NONE;
+		const int32 CategoryIndex = (int32)Category;
+		TArray<int32> RepackedElements = ChangedElements[ CategoryIndex ].Array();
+		for( int32 ElementIndex = FirstNewElements[ CategoryIndex ]; ElementIndex < StreetMap->GetNumElements( Category ); ++ElementIndex )
+		{
+			RepackedElements.Add( ElementIndex );
+		}
 
-		// All roads should have at least two nodes referencing them, one at the beginning and one at the end
-		ensure(bHasNodeAtBeginning && bHasNodeAtEnd);
+		for( const int32 ElementIndex : RepackedElements )
+		{
+			const FBox2D Box = StreetMap->GetElementBox( Category, ElementIndex );
+			StreetMap->BoundsMin = StreetMap->BoundsMin.ComponentMin( Box.Min );
+			StreetMap->BoundsMax = StreetMap->BoundsMax.ComponentMax( Box.Max );
+		}
+		StreetMap->RepackElements( Category, RepackedElements );
 	}
 
-	// Validation test: Make sure that all railways have at least two nodes referencing them, one at the beginning and one at the end.
-	for (const FStreetMapRailway& Railway : StreetMap->Railways)
-	{
-		const bool bHasNodeAtBeginning = Railway.NodeIndices[0] != INDEX_NONE;
-		const bool bHasNodeAtEnd = Railway.NodeIndices[Railway.NodeIndices.Num() - 1] != INDEX_NONE;
+	StreetMap->UpdateStaleSourceIndices();
 
-		// All railways should have at least two nodes referencing them, one at the beginning and one at the end
-		ensure(bHasNodeAtBeginning && bHasNodeAtEnd);
+	if( Profile != nullptr )
+	{
+		Profile->SetCounter( TEXT( "Roads" ), StreetMap->Roads.Num() );
+		Profile->SetCounter( TEXT( "Railways" ), StreetMap->Railways.Num() );
+		Profile->SetCounter( TEXT( "Buildings" ), StreetMap->Buildings.Num() );
+		Profile->SetCounter( TEXT( "Misc ways" ), StreetMap->MiscWays.Num() );
+		Profile->SetCounter( TEXT( "Street map nodes" ), StreetMap->Nodes.Num() );
 	}
 
 	return true;
 }
 
 
-
+#undef LOCTEXT_NAMESPACE
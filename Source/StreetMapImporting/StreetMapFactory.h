@@ -2,9 +2,45 @@
 #pragma once
 
 #include "Factories/Factory.h"
+#include "StreetMap.h"
 #include "StreetMapFactory.generated.h"
 
 
+/**
+ * What building a street map from an OpenStreetMap file comes up with, before there is a street map to put it in.  It's
+ * only plain data, so it can be built on any thread, and then moved into a new street map on the game thread.  Elements
+ * have points of their own, the way they do in an unpacked street map.
+ */
+struct FStreetMapBuildResult
+{
+	TArray<FStreetMapRoad> Roads;
+	TArray<FStreetMapNode> Nodes;
+	TArray<FStreetMapBuilding> Buildings;
+	TArray<FStreetMapRailway> Railways;
+	TArray<FStreetMapMiscWay> MiscWays;
+
+	/** Where the elements and nodes came from.  See UStreetMap::RoadSources. */
+	TArray<FStreetMapWaySource> RoadSources;
+	TArray<FStreetMapWaySource> RailwaySources;
+	TArray<FStreetMapWaySource> BuildingSources;
+	TArray<FStreetMapWaySource> MiscWaySources;
+	TArray<int64> NodeSources;
+
+	FVector2D BoundsMin;
+	FVector2D BoundsMax;
+	double OriginLongitude;
+	double OriginLatitude;
+
+	FStreetMapBuildResult()
+		: BoundsMin( FVector2D::ZeroVector )
+		, BoundsMax( FVector2D::ZeroVector )
+		, OriginLongitude( 0.0 )
+		, OriginLatitude( 0.0 )
+	{
+	}
+};
+
+
 /**
  * Import factory object for OpenStreetMap assets
  */
@@ -18,12 +54,93 @@ public:
 	/** UStreetMapFactory constructor */
 	UStreetMapFactory( const class FObjectInitializer& ObjectInitializer );
 
+	/**
+	 * Loads an OpenStreetMap XML, compressed XML or PBF file with this factory's import settings, from the cache if possible.  Doesn't
+	 * touch any UObjects, so it may run on any thread, and for several files at once.  Returns null on failure.
+	 */
+	TSharedPtr<class FOSMFile> LoadOSMFileForImport( const FString& OSMFilePath, class FStreetMapImportProfile& Profile, class FFeedbackContext* FeedbackContext ) const;
+
+	/** Creates a street map asset from a file loaded by LoadOSMFileForImport.  Game thread only.  Returns null on failure. */
+	class UStreetMap* CreateStreetMapFromOSMFile( UObject* Parent, FName Name, EObjectFlags Flags, const FString& SourceFilePath, const class FOSMFile& OSMFile, class FStreetMapImportProfile& Profile, class FFeedbackContext* FeedbackContext );
+
+	/** Options for the next import.  The reimport factory fills these in from the asset. */
+	UPROPERTY()
+	FStreetMapImportSettings ImportSettings;
+
 protected:
 
 	// UFactory overrides
 	virtual UObject* FactoryCreateText( UClass* Class, UObject* Parent, FName Name, EObjectFlags Flags, UObject* Context, const TCHAR* Type, const TCHAR*& Buffer, const TCHAR* BufferEnd, FFeedbackContext* Warn ) override;
+	virtual UObject* FactoryCreateFile( UClass* InClass, UObject* InParent, FName InName, EObjectFlags Flags, const FString& Filename, const TCHAR* Parms, FFeedbackContext* Warn, bool& bOutOperationCanceled ) override;
+
+	/** Loads an OpenStreetMap file.  Must log to the feedback context it's given, and own whatever it loads from, since it may run after its creator returned. */
+	typedef TFunction<bool( class FOSMFile&, class FFeedbackContext* )> FLoadFunction;
+
+	/** @return A function that loads an OpenStreetMap XML, compressed XML or PBF file, going by its extension.  XML files are memory mapped and parsed in place. */
+	static FLoadFunction MakeFileLoadFunction( const FString& OSMFilePath );
+
+	/** @return True for the extensions of compressed XML files, such as the "bz2" of "planet.osm.bz2" */
+	static bool IsCompressedFileExtension( const FString& FileExtension );
+
+	/**
+	 * Loads an OpenStreetMap file using the given function, builds a street map named Name in Parent from it, and reports
+	 * where the time and memory went.  If bUseCache is set, the parsed file is cached, and LoadFile is skipped when the
+	 * same file is imported with compatible settings again.
+	 *
+	 * If bCanRunInBackground is set and the editor is running interactively, loading and building run on a thread of
+	 * their own while a notification shows their progress and lets the user cancel.  The street map is created on the
+	 * game thread once they're done, and this returns null right away, with bImportingInBackground set.  Otherwise this
+	 * waits for the street map and returns it, or null on failure.
+	 */
+	class UStreetMap* ImportStreetMap( UObject* Parent, FName Name, EObjectFlags Flags, const FString& SourceFilePath, const bool bUseCache, FLoadFunction LoadFile, const bool bCanRunInBackground, class FFeedbackContext* FeedbackContext );
+
+	/** First half of an import: loads the file, going through the cache if there is a source file path.  Doesn't touch any UObjects.  Returns null if loading failed or was canceled. */
+	static TSharedPtr<class FOSMFile> LoadOSMFile( const FStreetMapImportSettings& Settings, const FString& SourceFilePath, TFunctionRef<bool( class FOSMFile&, class FFeedbackContext* )> LoadFile, class FStreetMapImportProfile& Profile, class FStreetMapImportProgress* Progress, class FFeedbackContext* FeedbackContext );
+
+	/** Second half of an import: converts a loaded OpenStreetMap file into roads, railways, buildings and other ways.  Doesn't touch any UObjects, so it may run on any thread.  Returns false if canceled. */
+	static bool BuildStreetMapFromOSMFile( const FStreetMapImportSettings& Settings, const class FOSMFile& OSMFile, FStreetMapBuildResult& OutResult, class FStreetMapImportProfile* Profile, class FStreetMapImportProgress* Progress, class FFeedbackContext* FeedbackContext );
+
+	/**
+	 * Last step of an import: creates the street map, moves everything that was built into it, packs its geometry and
+	 * indexes it.  Reports where the time and memory of the whole import went.  Game thread only.
+	 */
+	static class UStreetMap* CreateStreetMap( UObject* Parent, FName Name, EObjectFlags Flags, const FString& SourceFilePath, const FStreetMapImportSettings& Settings, FStreetMapBuildResult& Result, class FStreetMapImportProfile& Profile, class FFeedbackContext* FeedbackContext );
+
+	/**
+	 * Updates a street map in place with an OpenStreetMap change file (.osc), instead of importing the whole map again.
+	 * Only works for street maps that know which OpenStreetMap elements they were built from, and only if the changed
+	 * ways don't use nodes the street map never had.  Changed relations are not applied.  Nothing is modified if the
+	 * change can't be applied.
+	 */
+	bool ApplyOpenStreetMapChangeFile( class UStreetMap* StreetMap, const FString& OSCFilePath, class FFeedbackContext* FeedbackContext );
+
+	/**
+	 * Rebuilds the changed ways, moves the points of changed nodes, and connects the nodes they touch again.  Only the
+	 * elements and nodes the change is about are looked at, so this takes time in proportion to the change rather than
+	 * the street map.  Rebuilt ways are simplified with the street map's import settings.
+	 */
+	bool ApplyChangesToStreetMap( class UStreetMap* StreetMap, class FOSMChangeFile& ChangeFile, const FString& OSCFilePath, class FStreetMapImportProfile* Profile, class FFeedbackContext* FeedbackContext );
+
+	/** Sets the bounds of what was built to enclose all of its roads, buildings, railways and misc ways */
+	static void UpdateStreetMapBounds( FStreetMapBuildResult& Result );
+
+	/**
+	 * Removes points that barely change the shape of the street map's ways, using the simplification settings.  Only
+	 * elements from the given indices on are simplified, so that a change file can simplify just the ways it rebuilt.
+	 * Nodes must already be connected, since the points they are at are kept.  If NodeIndices is given, only those
+	 * nodes may refer to the simplified elements, and the others aren't looked at.  Logs how many points were removed.
+	 * Works on street maps as well as on what is being built into one.
+	 */
+	template<typename StreetMapType>
+	static void SimplifyStreetMap( StreetMapType& StreetMap, const FStreetMapImportSettings& Settings, const int32 FirstRoad, const int32 FirstRailway, const int32 FirstBuilding, const int32 FirstMiscWay, const TArray<int32>* NodeIndices, class FStreetMapImportProfile* Profile, class FFeedbackContext* FeedbackContext );
+
+	/** Applies the import settings to a file before it is loaded */
+	static void ConfigureOSMFile( const FStreetMapImportSettings& Settings, class FOSMFile& OSMFile );
+
+	/** True if the last ImportStreetMap left the import running in the background, and returned null because of that */
+	bool bImportingInBackground;
 
-	/** Loads the street map from an OpenStreetMap XML file.  Note that in the case of the file path containing the XML data, the string must be mutable for us to parse it quickly. */
-	bool LoadFromOpenStreetMapXMLFile( class UStreetMap* StreetMap, FString& OSMFilePath, const bool bIsFilePathActuallyTextBuffer, class FFeedbackContext* FeedbackContext );		
+	/** True while the reimport factory imports a street map's source file again.  Background imports then finish as reimports. */
+	bool bReimporting;
 };
 
@@ -0,0 +1,212 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapImporting.h"
+#include "StreetMapImportCache.h"
+#include "OSMFile.h"
+#include "StreetMap.h"
+#include "StreetMapImportingSettings.h"
+#include "HAL/PlatformFilemanager.h"
+#include "HAL/FileManager.h"
+#include "Misc/SecureHash.h"
+#include "Serialization/BufferReader.h"
+
+
+/** Marks the start and end of a cache file.  A file that was cut short won't end with it. */
+static const uint32 CacheFileMagic = 0x434D534F;	// "OSMC"
+
+
+/** Writes or reads a whole cache file */
+static bool SerializeCacheFile( FArchive& Ar, FOSMFile& OSMFile )
+{
+	uint32 Magic = CacheFileMagic;
+	uint32 Version = FOSMFile::ParsedDataVersion;
+	Ar << Magic << Version;
+	if( Ar.IsError() || Magic != CacheFileMagic || Version != FOSMFile::ParsedDataVersion )
+	{
+		return false;
+	}
+
+	if( !OSMFile.SerializeParsedData( Ar ) )
+	{
+		return false;
+	}
+
+	uint32 EndMagic = CacheFileMagic;
+	Ar << EndMagic;
+	return !Ar.IsError() && EndMagic == CacheFileMagic;
+}
+
+
+static FString GetCacheFilePath( const FString& CacheKey )
+{
+	return FStreetMapImportCache::GetCacheDirectory() / CacheKey + TEXT( ".osmcache" );
+}
+
+
+/** Removes the least recently used cache files until the cache fits into its size limit again */
+static void TrimCache( const FString& KeepFilePath, const int64 MaxCacheSize )
+{
+	IFileManager& FileManager = IFileManager::Get();
+	const FString CacheDirectory = FStreetMapImportCache::GetCacheDirectory();
+
+	TArray<FString> FileNames;
+	FileManager.FindFiles( FileNames, *( CacheDirectory / TEXT( "*.osmcache" ) ), true, false );
+
+	struct FCacheFile
+	{
+		FString Path;
+		int64 Size;
+		FDateTime TimeStamp;
+	};
+
+	TArray<FCacheFile> CacheFiles;
+	int64 CacheSize = 0;
+	for( const FString& FileName : FileNames )
+	{
+		FCacheFile CacheFile;
+		CacheFile.Path = CacheDirectory / FileName;
+		CacheFile.Size = FileManager.FileSize( *CacheFile.Path );
+		CacheFile.TimeStamp = FileManager.GetTimeStamp( *CacheFile.Path );
+		CacheSize += FMath::Max<int64>( CacheFile.Size, 0 );
+		CacheFiles.Add( CacheFile );
+	}
+
+	CacheFiles.Sort( []( const FCacheFile& A, const FCacheFile& B ) { return A.TimeStamp < B.TimeStamp; } );
+	for( const FCacheFile& CacheFile : CacheFiles )
+	{
+		if( CacheSize <= MaxCacheSize )
+		{
+			break;
+		}
+		if( CacheFile.Path != KeepFilePath && FileManager.Delete( *CacheFile.Path, false, false, true ) )
+		{
+			CacheSize -= CacheFile.Size;
+		}
+	}
+}
+
+
+FString FStreetMapImportCache::GetCacheDirectory()
+{
+	return FPaths::ProjectIntermediateDir() / TEXT( "StreetMapCache" );
+}
+
+
+FString FStreetMapImportCache::MakeCacheKey( const FString& SourceFilePath, const FStreetMapImportSettings& ImportSettings, const UStreetMapImportingSettings& Settings )
+{
+	// Hashing is a small fraction of what parsing costs, and unlike time stamps it can't be fooled by copying files around
+	const FMD5Hash FileHash = FMD5Hash::HashFile( *SourceFilePath );
+	if( !FileHash.IsValid() )
+	{
+		return FString();
+	}
+
+	// Parsing in parallel gives the same result, so that setting doesn't matter
+	FString SettingsString = FString::Printf( TEXT( "%u;%d;" ), FOSMFile::ParsedDataVersion, ImportSettings.bOnlyLoadReferencedNodes ? 1 : 0 );
+	if( ImportSettings.ImportArea == EStreetMapImportArea::BoundingBox )
+	{
+		SettingsString += FString::Printf( TEXT( "box;%.7f;%.7f;%.7f;%.7f;" ), ImportSettings.MinLatitude, ImportSettings.MinLongitude, ImportSettings.MaxLatitude, ImportSettings.MaxLongitude );
+	}
+	else if( ImportSettings.ImportArea == EStreetMapImportArea::Radius )
+	{
+		SettingsString += FString::Printf( TEXT( "radius;%.7f;%.7f;%f;" ), ImportSettings.CenterLatitude, ImportSettings.CenterLongitude, ImportSettings.RadiusMeters );
+	}
+
+	// The two-pass import only keeps ways we're going to import, so which categories we import matters too.  The
+	// types they turn into don't, since those are only looked at when building the street map.
+	if( ImportSettings.bOnlyLoadReferencedNodes )
+	{
+		TArray<FString> Categories;
+		for( const FStreetMapRoadCategory& RoadCategory : Settings.RoadCategories )
+		{
+			if( RoadCategory.RoadType != EStreetMapRoadType::Other )
+			{
+				Categories.Add( TEXT( "highway=" ) + RoadCategory.Category.ToString().ToLower() );
+			}
+		}
+		for( const FStreetMapRailwayCategory& RailwayCategory : Settings.RailwayCategories )
+		{
+			if( RailwayCategory.RailwayType != EStreetMapRailwayType::OtherRailway )
+			{
+				Categories.Add( TEXT( "railway=" ) + RailwayCategory.Category.ToString().ToLower() );
+			}
+		}
+		Categories.Sort();
+		SettingsString += FString::Join( Categories, TEXT( ";" ) );
+	}
+
+	FMD5 Md5;
+	Md5.Update( FileHash.GetBytes(), FileHash.GetSize() );
+	const FTCHARToUTF8 SettingsUtf8( *SettingsString );
+	Md5.Update( (const uint8*)SettingsUtf8.Get(), SettingsUtf8.Length() );
+
+	FMD5Hash CacheKey;
+	CacheKey.Set( Md5 );
+	return BytesToHex( CacheKey.GetBytes(), CacheKey.GetSize() );
+}
+
+
+bool FStreetMapImportCache::Load( const FString& CacheKey, FOSMFile& OSMFile )
+{
+	const FString CacheFilePath = GetCacheFilePath( CacheKey );
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	if( !PlatformFile.FileExists( *CacheFilePath ) )
+	{
+		return false;
+	}
+
+	bool bLoaded = false;
+	{
+		// Map the file instead of reading it, so that loading it is mostly copying out of the OS's file cache
+		TUniquePtr<IMappedFileHandle> MappedFile( PlatformFile.OpenMapped( *CacheFilePath ) );
+		TUniquePtr<IMappedFileRegion> MappedRegion( MappedFile.IsValid() ? MappedFile->MapRegion() : nullptr );
+		if( MappedRegion.IsValid() )
+		{
+			FBufferReader Reader( (void*)MappedRegion->GetMappedPtr(), MappedRegion->GetMappedSize(), false );
+			bLoaded = SerializeCacheFile( Reader, OSMFile );
+		}
+		else
+		{
+			TUniquePtr<FArchive> Reader( IFileManager::Get().CreateFileReader( *CacheFilePath ) );
+			bLoaded = Reader.IsValid() && SerializeCacheFile( *Reader, OSMFile );
+		}
+	}
+
+	if( bLoaded )
+	{
+		// Keeps the entry from being trimmed as the least recently used one
+		IFileManager::Get().SetTimeStamp( *CacheFilePath, FDateTime::UtcNow() );
+	}
+	else
+	{
+		IFileManager::Get().Delete( *CacheFilePath, false, false, true );
+	}
+
+	return bLoaded;
+}
+
+
+bool FStreetMapImportCache::Save( const FString& CacheKey, FOSMFile& OSMFile, const UStreetMapImportingSettings& Settings )
+{
+	const FString CacheFilePath = GetCacheFilePath( CacheKey );
+	// Files with the same contents may be imported at the same time, so each writer gets its own temporary file
+	const FString TempFilePath = CacheFilePath + TEXT( "." ) + FGuid::NewGuid().ToString() + TEXT( ".tmp" );
+
+	bool bSaved = false;
+	{
+		TUniquePtr<FArchive> Writer( IFileManager::Get().CreateFileWriter( *TempFilePath ) );
+		bSaved = Writer.IsValid() && SerializeCacheFile( *Writer, OSMFile ) && Writer->Close();
+	}
+
+	// Only complete files are moved into place, so a crash while writing never leaves a broken entry behind
+	bSaved = bSaved && IFileManager::Get().Move( *CacheFilePath, *TempFilePath, true, true, false, true );
+	if( !bSaved )
+	{
+		IFileManager::Get().Delete( *TempFilePath, false, false, true );
+		return false;
+	}
+
+	TrimCache( CacheFilePath, (int64)Settings.MaxCacheSizeMB * 1024 * 1024 );
+	return true;
+}
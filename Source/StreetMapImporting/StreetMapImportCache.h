@@ -0,0 +1,30 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+class FOSMFile;
+class UStreetMapImportingSettings;
+struct FStreetMapImportSettings;
+
+
+/**
+ * Cache of parsed OpenStreetMap files, so that reimporting a file that didn't change goes straight to building the
+ * street map.  Entries are stored in the project's Intermediate folder, keyed by a hash of the file's contents, the
+ * parser version, and the import settings that change what the parser keeps.
+ */
+class FStreetMapImportCache
+{
+
+public:
+
+	/** @return The key of the cache entry for a file imported with the given settings, or an empty string if the file can't be read */
+	static FString MakeCacheKey( const FString& SourceFilePath, const FStreetMapImportSettings& ImportSettings, const UStreetMapImportingSettings& Settings );
+
+	/** Loads a parsed file from the cache into an empty FOSMFile.  Broken entries are removed.  @return False if there is no usable entry */
+	static bool Load( const FString& CacheKey, FOSMFile& OSMFile );
+
+	/** Stores a parsed file.  The least recently used entries are removed once the cache grows too large. */
+	static bool Save( const FString& CacheKey, FOSMFile& OSMFile, const UStreetMapImportingSettings& Settings );
+
+	/** @return The folder the cache lives in */
+	static FString GetCacheDirectory();
+};
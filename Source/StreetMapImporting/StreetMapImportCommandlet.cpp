@@ -0,0 +1,431 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapImporting.h"
+#include "StreetMapImportCommandlet.h"
+#include "StreetMapFactory.h"
+#include "StreetMapImportProfile.h"
+#include "StreetMapImportProgress.h"
+#include "OSMFile.h"
+#include "StreetMap.h"
+#include "ObjectTools.h"
+#include "AssetRegistryModule.h"
+#include "Async/Async.h"
+
+DEFINE_LOG_CATEGORY_STATIC( LogStreetMapImportCommandlet, Log, All );
+
+/** Printed when the arguments don't make sense.  Keep in sync with the comment on UStreetMapImportCommandlet. */
+static const TCHAR* StreetMapImportUsage =
+	TEXT( "Usage: -run=StreetMapImport -Source=<Directory or manifest> [-Destination=/Game/StreetMaps] [-Jobs=N] " )
+	TEXT( "[-OnlyReferencedNodes=true|false] [-ParallelXml=true|false] [-BoundingBox=MinLat,MinLon,MaxLat,MaxLon] [-Radius=Lat,Lon,Meters] " )
+	TEXT( "[-Simplify=None|DouglasPeucker|Visvalingam] [-SimplifyTolerances=Roads,Railways,Buildings,MiscWays] [-PointStorage=Float|Quantized]" );
+
+
+/** One file of a batch import */
+struct FStreetMapBatchImportJob
+{
+	/** OpenStreetMap file to import */
+	FString SourceFile;
+
+	/** Long name of the package the street map is saved to */
+	FString PackageName;
+
+	/** Size of the source file, in bytes */
+	int64 SourceFileSize;
+
+	/** Times the load on a worker thread, then the build on the game thread */
+	FStreetMapImportProfile Profile;
+
+	/** Messages of the import, written to the log when it's done */
+	FStreetMapBufferedFeedback Feedback;
+
+	/** The loaded file, once the worker thread is done with it.  Null if loading failed. */
+	TFuture<TSharedPtr<FOSMFile>> LoadedFile;
+};
+
+
+UStreetMapImportCommandlet::UStreetMapImportCommandlet( const FObjectInitializer& ObjectInitializer )
+	: Super( ObjectInitializer )
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+
+int32 UStreetMapImportCommandlet::Main( const FString& Params )
+{
+	FString SourcePath;
+	if( !FParse::Value( *Params, TEXT( "Source=" ), SourcePath ) )
+	{
+		UE_LOG( LogStreetMapImportCommandlet, Error, TEXT( "%s" ), StreetMapImportUsage );
+		return 1;
+	}
+	SourcePath = FPaths::ConvertRelativePathToFull( SourcePath );
+
+	FString DestinationPath = TEXT( "/Game/StreetMaps" );
+	FParse::Value( *Params, TEXT( "Destination=" ), DestinationPath );
+	while( DestinationPath.RemoveFromEnd( TEXT( "/" ) ) )
+	{
+	}
+
+	// Every job holds a whole parsed file in memory until the game thread gets to it, so we don't use all cores by default
+	int32 NumJobs = FMath::Max( 1, FPlatformMisc::NumberOfCores() / 2 );
+	FParse::Value( *Params, TEXT( "Jobs=" ), NumJobs );
+	NumJobs = FMath::Max( 1, NumJobs );
+
+	UStreetMapFactory* Factory = NewObject<UStreetMapFactory>();
+	Factory->AddToRoot();
+	if( !ParseImportSettings( Params, Factory->ImportSettings ) )
+	{
+		UE_LOG( LogStreetMapImportCommandlet, Error, TEXT( "%s" ), StreetMapImportUsage );
+		Factory->RemoveFromRoot();
+		return 1;
+	}
+
+	TArray<FString> SourceFiles;
+	TArray<FString> PackageNames;
+	if( !GatherSourceFiles( SourcePath, DestinationPath, SourceFiles, PackageNames ) )
+	{
+		Factory->RemoveFromRoot();
+		return 1;
+	}
+
+	UE_LOG( LogStreetMapImportCommandlet, Display, TEXT( "Importing %i OpenStreetMap files into %s, loading up to %i at once" ), SourceFiles.Num(), *DestinationPath, NumJobs );
+
+	TArray<TUniquePtr<FStreetMapBatchImportJob>> Jobs;
+	for( int32 FileIndex = 0; FileIndex < SourceFiles.Num(); ++FileIndex )
+	{
+		FStreetMapBatchImportJob* Job = new FStreetMapBatchImportJob();
+		Job->SourceFile = SourceFiles[ FileIndex ];
+		Job->PackageName = PackageNames[ FileIndex ];
+		Job->SourceFileSize = FMath::Max<int64>( 0, IFileManager::Get().FileSize( *Job->SourceFile ) );
+		Jobs.Emplace( Job );
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	int32 NumSucceeded = 0;
+	int64 TotalSourceBytes = 0;
+	double TotalLoadSeconds = 0.0;
+	double TotalBuildSeconds = 0.0;
+	double TotalSaveSeconds = 0.0;
+	int64 TotalCacheHits = 0;
+	int64 TotalRoads = 0;
+	int64 TotalRailways = 0;
+	int64 TotalBuildings = 0;
+	int64 TotalMiscWays = 0;
+	int64 TotalNodes = 0;
+
+	int32 NextJobToStart = 0;
+	for( int32 JobIndex = 0; JobIndex < Jobs.Num(); ++JobIndex )
+	{
+		// Keep the worker threads busy with the files after this one while we build it
+		while( NextJobToStart < Jobs.Num() && NextJobToStart < JobIndex + NumJobs )
+		{
+			FStreetMapBatchImportJob* JobToStart = Jobs[ NextJobToStart++ ].Get();
+			JobToStart->LoadedFile = Async<TSharedPtr<FOSMFile>>( EAsyncExecution::ThreadPool, [Factory, JobToStart]()
+			{
+				return Factory->LoadOSMFileForImport( JobToStart->SourceFile, JobToStart->Profile, &JobToStart->Feedback );
+			} );
+		}
+
+		FStreetMapBatchImportJob& Job = *Jobs[ JobIndex ];
+		TSharedPtr<FOSMFile> OSMFile = Job.LoadedFile.Get();
+
+		// Let go of the future's reference, so the file is freed as soon as we're done with it
+		Job.LoadedFile = TFuture<TSharedPtr<FOSMFile>>();
+
+		bool bSucceeded = false;
+		if( OSMFile.IsValid() )
+		{
+			UPackage* Package = CreatePackage( nullptr, *Job.PackageName );
+			Package->FullyLoad();
+
+			const FName AssetName = *FPackageName::GetLongPackageAssetName( Job.PackageName );
+			UStreetMap* StreetMap = Factory->CreateStreetMapFromOSMFile( Package, AssetName, RF_Public | RF_Standalone, Job.SourceFile, *OSMFile, Job.Profile, &Job.Feedback );
+			OSMFile.Reset();
+
+			if( StreetMap != nullptr )
+			{
+				FAssetRegistryModule::AssetCreated( StreetMap );
+				Package->MarkPackageDirty();
+
+				const double SaveStartTime = FPlatformTime::Seconds();
+				const FString PackageFileName = FPackageName::LongPackageNameToFilename( Job.PackageName, FPackageName::GetAssetPackageExtension() );
+				bSucceeded = UPackage::SavePackage( Package, StreetMap, RF_Public | RF_Standalone, *PackageFileName, &Job.Feedback, nullptr, false, true, SAVE_NoError );
+				TotalSaveSeconds += FPlatformTime::Seconds() - SaveStartTime;
+
+				if( !bSucceeded )
+				{
+					Job.Feedback.Logf( ELogVerbosity::Error, TEXT( "Failed to save '%s'" ), *PackageFileName );
+				}
+
+				// Nobody needs the street map anymore once it's saved
+				StreetMap->ClearFlags( RF_Standalone );
+			}
+		}
+
+		const FString SourceFileName = FPaths::GetCleanFilename( Job.SourceFile );
+		Job.Feedback.Flush( [&SourceFileName]( ELogVerbosity::Type Verbosity, const FString& Message )
+		{
+			if( Verbosity == ELogVerbosity::Error || Verbosity == ELogVerbosity::Fatal )
+			{
+				UE_LOG( LogStreetMapImportCommandlet, Error, TEXT( "%s: %s" ), *SourceFileName, *Message );
+			}
+			else if( Verbosity == ELogVerbosity::Warning )
+			{
+				UE_LOG( LogStreetMapImportCommandlet, Warning, TEXT( "%s: %s" ), *SourceFileName, *Message );
+			}
+			else
+			{
+				UE_LOG( LogStreetMapImportCommandlet, Display, TEXT( "%s: %s" ), *SourceFileName, *Message );
+			}
+		} );
+
+		TotalLoadSeconds += Job.Profile.GetPhaseSeconds( TEXT( "Load" ) );
+		TotalBuildSeconds += Job.Profile.GetPhaseSeconds( TEXT( "Build" ) );
+
+		if( bSucceeded )
+		{
+			++NumSucceeded;
+			TotalSourceBytes += Job.SourceFileSize;
+			TotalCacheHits += Job.Profile.GetCounter( TEXT( "Cache hits" ) );
+			TotalRoads += Job.Profile.GetCounter( TEXT( "Roads" ) );
+			TotalRailways += Job.Profile.GetCounter( TEXT( "Railways" ) );
+			TotalBuildings += Job.Profile.GetCounter( TEXT( "Buildings" ) );
+			TotalMiscWays += Job.Profile.GetCounter( TEXT( "Misc ways" ) );
+			TotalNodes += Job.Profile.GetCounter( TEXT( "Street map nodes" ) );
+
+			UE_LOG( LogStreetMapImportCommandlet, Display, TEXT( "[%i/%i] Imported %s" ), JobIndex + 1, Jobs.Num(), *Job.PackageName );
+		}
+		else
+		{
+			UE_LOG( LogStreetMapImportCommandlet, Error, TEXT( "[%i/%i] Failed to import '%s'" ), JobIndex + 1, Jobs.Num(), *Job.SourceFile );
+		}
+
+		// Free the street maps we've saved so far
+		if( ( JobIndex + 1 ) % NumJobs == 0 )
+		{
+			CollectGarbage( GARBAGE_COLLECTION_KEEPFLAGS );
+		}
+	}
+
+	Factory->RemoveFromRoot();
+	CollectGarbage( GARBAGE_COLLECTION_KEEPFLAGS );
+
+	const double WallSeconds = FMath::Max( FPlatformTime::Seconds() - StartTime, SMALL_NUMBER );
+	const int32 NumFailed = Jobs.Num() - NumSucceeded;
+
+	UE_LOG( LogStreetMapImportCommandlet, Display, TEXT( "Street map batch import summary" ) );
+	UE_LOG( LogStreetMapImportCommandlet, Display, TEXT( "  Files:       %i imported, %i failed, %i cache hits" ), NumSucceeded, NumFailed, (int32)TotalCacheHits );
+	UE_LOG( LogStreetMapImportCommandlet, Display, TEXT( "  Source data: %.1f MB" ), TotalSourceBytes / ( 1024.0 * 1024.0 ) );
+	UE_LOG( LogStreetMapImportCommandlet, Display, TEXT( "  Wall time:   %.2f s" ), WallSeconds );
+	UE_LOG( LogStreetMapImportCommandlet, Display, TEXT( "  Throughput:  %.2f MB/s, %.2f files/s" ), TotalSourceBytes / ( 1024.0 * 1024.0 ) / WallSeconds, NumSucceeded / WallSeconds );
+	UE_LOG( LogStreetMapImportCommandlet, Display, TEXT( "  Loading:     %.2f s on up to %i worker threads (%.1fx wall time)" ), TotalLoadSeconds, NumJobs, TotalLoadSeconds / WallSeconds );
+	UE_LOG( LogStreetMapImportCommandlet, Display, TEXT( "  Building:    %.2f s on the game thread" ), TotalBuildSeconds );
+	UE_LOG( LogStreetMapImportCommandlet, Display, TEXT( "  Saving:      %.2f s on the game thread" ), TotalSaveSeconds );
+	UE_LOG( LogStreetMapImportCommandlet, Display, TEXT( "  Imported:    %lld roads, %lld railways, %lld buildings, %lld misc ways, %lld nodes" ), TotalRoads, TotalRailways, TotalBuildings, TotalMiscWays, TotalNodes );
+
+	return NumFailed == 0 ? 0 : 1;
+}
+
+
+bool UStreetMapImportCommandlet::ParseImportSettings( const FString& Params, FStreetMapImportSettings& ImportSettings ) const
+{
+	FParse::Bool( *Params, TEXT( "OnlyReferencedNodes=" ), ImportSettings.bOnlyLoadReferencedNodes );
+	FParse::Bool( *Params, TEXT( "ParallelXml=" ), ImportSettings.bParseXmlInParallel );
+
+	FString BoundingBox;
+	if( FParse::Value( *Params, TEXT( "BoundingBox=" ), BoundingBox, false ) )
+	{
+		TArray<FString> Values;
+		BoundingBox.ParseIntoArray( Values, TEXT( "," ) );
+		if( Values.Num() != 4 )
+		{
+			UE_LOG( LogStreetMapImportCommandlet, Error, TEXT( "-BoundingBox expects four values: MinLat,MinLon,MaxLat,MaxLon" ) );
+			return false;
+		}
+		ImportSettings.ImportArea = EStreetMapImportArea::BoundingBox;
+		ImportSettings.MinLatitude = FCString::Atod( *Values[ 0 ] );
+		ImportSettings.MinLongitude = FCString::Atod( *Values[ 1 ] );
+		ImportSettings.MaxLatitude = FCString::Atod( *Values[ 2 ] );
+		ImportSettings.MaxLongitude = FCString::Atod( *Values[ 3 ] );
+	}
+
+	FString Radius;
+	if( FParse::Value( *Params, TEXT( "Radius=" ), Radius, false ) )
+	{
+		TArray<FString> Values;
+		Radius.ParseIntoArray( Values, TEXT( "," ) );
+		if( Values.Num() != 3 )
+		{
+			UE_LOG( LogStreetMapImportCommandlet, Error, TEXT( "-Radius expects three values: Lat,Lon,Meters" ) );
+			return false;
+		}
+		if( ImportSettings.ImportArea != EStreetMapImportArea::EntireFile )
+		{
+			UE_LOG( LogStreetMapImportCommandlet, Error, TEXT( "-BoundingBox and -Radius can't be used together" ) );
+			return false;
+		}
+		ImportSettings.ImportArea = EStreetMapImportArea::Radius;
+		ImportSettings.CenterLatitude = FCString::Atod( *Values[ 0 ] );
+		ImportSettings.CenterLongitude = FCString::Atod( *Values[ 1 ] );
+		ImportSettings.RadiusMeters = FCString::Atof( *Values[ 2 ] );
+	}
+
+	FString Simplification;
+	if( FParse::Value( *Params, TEXT( "Simplify=" ), Simplification ) )
+	{
+		if( Simplification.Equals( TEXT( "DouglasPeucker" ), ESearchCase::IgnoreCase ) )
+		{
+			ImportSettings.Simplification = EStreetMapSimplification::DouglasPeucker;
+		}
+		else if( Simplification.Equals( TEXT( "Visvalingam" ), ESearchCase::IgnoreCase ) )
+		{
+			ImportSettings.Simplification = EStreetMapSimplification::Visvalingam;
+		}
+		else if( Simplification.Equals( TEXT( "None" ), ESearchCase::IgnoreCase ) )
+		{
+			ImportSettings.Simplification = EStreetMapSimplification::None;
+		}
+		else
+		{
+			UE_LOG( LogStreetMapImportCommandlet, Error, TEXT( "-Simplify expects None, DouglasPeucker or Visvalingam" ) );
+			return false;
+		}
+	}
+
+	FString SimplifyTolerances;
+	if( FParse::Value( *Params, TEXT( "SimplifyTolerances=" ), SimplifyTolerances, false ) )
+	{
+		TArray<FString> Values;
+		SimplifyTolerances.ParseIntoArray( Values, TEXT( "," ) );
+		if( Values.Num() != 4 )
+		{
+			UE_LOG( LogStreetMapImportCommandlet, Error, TEXT( "-SimplifyTolerances expects four values in centimeters: Roads,Railways,Buildings,MiscWays" ) );
+			return false;
+		}
+		ImportSettings.RoadSimplificationTolerance = FMath::Max( FCString::Atof( *Values[ 0 ] ), 0.0f );
+		ImportSettings.RailwaySimplificationTolerance = FMath::Max( FCString::Atof( *Values[ 1 ] ), 0.0f );
+		ImportSettings.BuildingSimplificationTolerance = FMath::Max( FCString::Atof( *Values[ 2 ] ), 0.0f );
+		ImportSettings.MiscWaySimplificationTolerance = FMath::Max( FCString::Atof( *Values[ 3 ] ), 0.0f );
+	}
+
+	FString PointStorage;
+	if( FParse::Value( *Params, TEXT( "PointStorage=" ), PointStorage ) )
+	{
+		if( PointStorage.Equals( TEXT( "Float" ), ESearchCase::IgnoreCase ) )
+		{
+			ImportSettings.PointStorage = EStreetMapPointStorage::Float;
+		}
+		else if( PointStorage.Equals( TEXT( "Quantized" ), ESearchCase::IgnoreCase ) )
+		{
+			ImportSettings.PointStorage = EStreetMapPointStorage::Quantized;
+		}
+		else
+		{
+			UE_LOG( LogStreetMapImportCommandlet, Error, TEXT( "-PointStorage expects Float or Quantized" ) );
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+bool UStreetMapImportCommandlet::GatherSourceFiles( const FString& SourcePath, const FString& DestinationPath, TArray<FString>& OutSourceFiles, TArray<FString>& OutPackageNames ) const
+{
+	// Directory the package folders are relative to
+	FString BaseDirectory;
+
+	if( FPaths::DirectoryExists( SourcePath ) )
+	{
+		BaseDirectory = SourcePath;
+		IFileManager::Get().FindFilesRecursive( OutSourceFiles, *SourcePath, TEXT( "*.osm" ), true, false );
+		IFileManager::Get().FindFilesRecursive( OutSourceFiles, *SourcePath, TEXT( "*.pbf" ), true, false, false );
+		IFileManager::Get().FindFilesRecursive( OutSourceFiles, *SourcePath, TEXT( "*.osm.gz" ), true, false, false );
+		IFileManager::Get().FindFilesRecursive( OutSourceFiles, *SourcePath, TEXT( "*.osm.bz2" ), true, false, false );
+		OutSourceFiles.Sort();
+	}
+	else if( FPaths::FileExists( SourcePath ) )
+	{
+		// Manifests list the files wherever they are, so they all go straight into the destination
+		TArray<FString> Lines;
+		if( !FFileHelper::LoadFileToStringArray( Lines, *SourcePath ) )
+		{
+			UE_LOG( LogStreetMapImportCommandlet, Error, TEXT( "Failed to read manifest '%s'" ), *SourcePath );
+			return false;
+		}
+
+		const FString ManifestDirectory = FPaths::GetPath( SourcePath );
+		for( FString Line : Lines )
+		{
+			Line.TrimStartAndEndInline();
+			if( Line.IsEmpty() || Line.StartsWith( TEXT( "#" ) ) )
+			{
+				continue;
+			}
+
+			const FString SourceFile = FPaths::IsRelative( Line ) ? FPaths::ConvertRelativePathToFull( ManifestDirectory, Line ) : Line;
+			if( !FPaths::FileExists( SourceFile ) )
+			{
+				UE_LOG( LogStreetMapImportCommandlet, Error, TEXT( "'%s' is listed in the manifest, but doesn't exist" ), *SourceFile );
+				return false;
+			}
+			OutSourceFiles.Add( SourceFile );
+		}
+	}
+	else
+	{
+		UE_LOG( LogStreetMapImportCommandlet, Error, TEXT( "'%s' is neither a directory nor a manifest file" ), *SourcePath );
+		return false;
+	}
+
+	if( OutSourceFiles.Num() == 0 )
+	{
+		UE_LOG( LogStreetMapImportCommandlet, Error, TEXT( "Found no OpenStreetMap files in '%s'" ), *SourcePath );
+		return false;
+	}
+
+	TSet<FString> UsedPackageNames;
+	for( const FString& SourceFile : OutSourceFiles )
+	{
+		FString PackagePath = DestinationPath;
+		if( !BaseDirectory.IsEmpty() )
+		{
+			FString RelativeDirectory = FPaths::GetPath( SourceFile );
+			FPaths::MakePathRelativeTo( RelativeDirectory, *( BaseDirectory / TEXT( "" ) ) );
+			if( !RelativeDirectory.IsEmpty() && RelativeDirectory != TEXT( "." ) )
+			{
+				PackagePath /= ObjectTools::SanitizeObjectPath( RelativeDirectory );
+			}
+		}
+
+		// "City.osm.pbf" and "City.osm.bz2" should become "City", not "City_osm"
+		FString AssetName = FPaths::GetBaseFilename( SourceFile );
+		AssetName.RemoveFromEnd( TEXT( ".osm" ), ESearchCase::IgnoreCase );
+		AssetName = ObjectTools::SanitizeObjectName( AssetName );
+
+		const FString PackageName = PackagePath / AssetName;
+
+		FText Reason;
+		if( !FPackageName::IsValidLongPackageName( PackageName, false, &Reason ) )
+		{
+			UE_LOG( LogStreetMapImportCommandlet, Error, TEXT( "Can't import '%s' into '%s': %s" ), *SourceFile, *PackageName, *Reason.ToString() );
+			return false;
+		}
+
+		bool bAlreadyUsed = false;
+		UsedPackageNames.Add( PackageName, &bAlreadyUsed );
+		if( bAlreadyUsed )
+		{
+			UE_LOG( LogStreetMapImportCommandlet, Error, TEXT( "More than one file would be imported into '%s'" ), *PackageName );
+			return false;
+		}
+
+		OutPackageNames.Add( PackageName );
+	}
+
+	return true;
+}
@@ -0,0 +1,42 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "StreetMapImportCommandlet.generated.h"
+
+
+/**
+ * Imports many OpenStreetMap files into street map assets without opening the editor, and saves them.  Files are
+ * parsed on worker threads, several at a time, while the game thread builds and saves the ones that are done.
+ *
+ *   UE4Editor-Cmd.exe <Project> -run=StreetMapImport -Source=<Directory or manifest> [-Destination=/Game/StreetMaps]
+ *       [-Jobs=<Files parsed at once>] [-OnlyReferencedNodes=true|false] [-ParallelXml=true|false]
+ *       [-BoundingBox=<MinLat>,<MinLon>,<MaxLat>,<MaxLon>] [-Radius=<Lat>,<Lon>,<Meters>]
+ *       [-Simplify=None|DouglasPeucker|Visvalingam] [-SimplifyTolerances=<Roads>,<Railways>,<Buildings>,<MiscWays>]
+ *       [-PointStorage=Float|Quantized]
+ *
+ * The source is either a directory, which is searched for .osm, .osm.gz, .osm.bz2 and .pbf files, or a manifest: a
+ * text file with one file path per line, relative to the manifest.  Lines starting with '#' are ignored.  Files found
+ * in subdirectories are imported into matching subfolders of the destination.
+ */
+UCLASS()
+class UStreetMapImportCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	/** UStreetMapImportCommandlet constructor */
+	UStreetMapImportCommandlet( const class FObjectInitializer& ObjectInitializer );
+
+	// UCommandlet overrides
+	virtual int32 Main( const FString& Params ) override;
+
+protected:
+
+	/** Finds the files to import, and the package each of them goes into */
+	bool GatherSourceFiles( const FString& SourcePath, const FString& DestinationPath, TArray<FString>& OutSourceFiles, TArray<FString>& OutPackageNames ) const;
+
+	/** Reads the import options from the command line */
+	bool ParseImportSettings( const FString& Params, FStreetMapImportSettings& ImportSettings ) const;
+};
@@ -0,0 +1,157 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapImporting.h"
+#include "StreetMapImportProfile.h"
+#include "StreetMap.h"
+
+
+/** @return Physical memory currently used by the process, in bytes */
+static uint64 GetUsedPhysical()
+{
+	return FPlatformMemory::GetStats().UsedPhysical;
+}
+
+
+/** @return Bytes as megabytes, for display */
+static double ToMegabytes( const uint64 Bytes )
+{
+	return (double)Bytes / ( 1024.0 * 1024.0 );
+}
+
+
+FStreetMapImportProfile::FStreetMapImportProfile()
+	: StartTime( FPlatformTime::Seconds() )
+	, StartUsedPhysical( GetUsedPhysical() )
+	, PeakUsedPhysical( StartUsedPhysical )
+{
+}
+
+
+void FStreetMapImportProfile::BeginPhase( const TCHAR* PhaseName )
+{
+	SampleMemory();
+
+	FPhase& Phase = Phases[ Phases.AddDefaulted() ];
+	Phase.Name = PhaseName;
+	Phase.Depth = OpenPhases.Num();
+	Phase.StartTime = FPlatformTime::Seconds();
+	Phase.Seconds = 0.0;
+	Phase.UsedPhysicalAtEnd = 0;
+
+	OpenPhases.Add( Phases.Num() - 1 );
+}
+
+
+void FStreetMapImportProfile::EndPhase()
+{
+	if( ensure( OpenPhases.Num() > 0 ) )
+	{
+		SampleMemory();
+
+		FPhase& Phase = Phases[ OpenPhases.Pop() ];
+		Phase.Seconds = FPlatformTime::Seconds() - Phase.StartTime;
+		Phase.UsedPhysicalAtEnd = GetUsedPhysical();
+	}
+}
+
+
+void FStreetMapImportProfile::SetCounter( const TCHAR* CounterName, const int64 Value )
+{
+	for( TPair<FString, int64>& Counter : Counters )
+	{
+		if( Counter.Key == CounterName )
+		{
+			Counter.Value = Value;
+			return;
+		}
+	}
+
+	Counters.Add( TPair<FString, int64>( CounterName, Value ) );
+}
+
+
+void FStreetMapImportProfile::SampleMemory()
+{
+	PeakUsedPhysical = FMath::Max( PeakUsedPhysical, GetUsedPhysical() );
+}
+
+
+double FStreetMapImportProfile::GetTotalSeconds() const
+{
+	return FPlatformTime::Seconds() - StartTime;
+}
+
+
+double FStreetMapImportProfile::GetPhaseSeconds( const TCHAR* PhaseName ) const
+{
+	double Seconds = 0.0;
+	for( const FPhase& Phase : Phases )
+	{
+		if( Phase.Depth == 0 && Phase.Name == PhaseName )
+		{
+			Seconds += Phase.Seconds;
+		}
+	}
+	return Seconds;
+}
+
+
+int64 FStreetMapImportProfile::GetCounter( const TCHAR* CounterName ) const
+{
+	for( const TPair<FString, int64>& Counter : Counters )
+	{
+		if( Counter.Key == CounterName )
+		{
+			return Counter.Value;
+		}
+	}
+	return 0;
+}
+
+
+void FStreetMapImportProfile::LogReport( FFeedbackContext* FeedbackContext, const FString& SourceName ) const
+{
+	if( FeedbackContext == nullptr )
+	{
+		return;
+	}
+
+	const double TotalSeconds = GetTotalSeconds();
+	FeedbackContext->Logf( ELogVerbosity::Log, TEXT( "Imported '%s' in %.3f seconds" ), *SourceName, TotalSeconds );
+
+	for( const FPhase& Phase : Phases )
+	{
+		const FString IndentedName = FString::ChrN( 2 + Phase.Depth * 2, TEXT( ' ' ) ) + Phase.Name;
+		FeedbackContext->Logf(
+			ELogVerbosity::Log,
+			TEXT( "%s %9.3f s  %5.1f%%  %8.1f MB" ),
+			*IndentedName.RightPad( 34 ),
+			Phase.Seconds,
+			TotalSeconds > 0.0 ? 100.0 * Phase.Seconds / TotalSeconds : 0.0,
+			ToMegabytes( Phase.UsedPhysicalAtEnd ) );
+	}
+
+	for( const TPair<FString, int64>& Counter : Counters )
+	{
+		FeedbackContext->Logf( ELogVerbosity::Log, TEXT( "  %s %12lld" ), *Counter.Key.RightPad( 32 ), Counter.Value );
+	}
+
+	FeedbackContext->Logf(
+		ELogVerbosity::Log,
+		TEXT( "  Peak memory %.1f MB (%.1f MB more than at the start of the import)" ),
+		ToMegabytes( PeakUsedPhysical ),
+		ToMegabytes( PeakUsedPhysical - FMath::Min( PeakUsedPhysical, StartUsedPhysical ) ) );
+}
+
+
+void FStreetMapImportProfile::GetStats( FStreetMapImportStats& OutStats ) const
+{
+	OutStats.ImportSeconds = (float)GetTotalSeconds();
+	OutStats.LoadSeconds = (float)GetPhaseSeconds( TEXT( "Load" ) );
+	OutStats.BuildSeconds = (float)GetPhaseSeconds( TEXT( "Build" ) );
+	OutStats.NumOSMNodes = GetCounter( TEXT( "OSM nodes" ) );
+	OutStats.NumOSMWays = GetCounter( TEXT( "OSM ways" ) );
+	OutStats.NumOSMRelations = GetCounter( TEXT( "OSM relations" ) );
+	OutStats.PeakMemoryMB = (float)ToMegabytes( PeakUsedPhysical );
+	OutStats.AddedMemoryMB = (float)ToMegabytes( PeakUsedPhysical - FMath::Min( PeakUsedPhysical, StartUsedPhysical ) );
+}
@@ -0,0 +1,124 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+struct FStreetMapImportStats;
+
+
+/**
+ * Records where an import spends its time and memory: how long each phase took, how many elements went through it,
+ * and the highest memory usage we saw along the way.  Not thread safe; phases are started and ended on the thread
+ * that runs the import, even if the work inside of them is spread over many threads.
+ */
+class FStreetMapImportProfile
+{
+
+public:
+
+	/** Default constructor.  Starts the clock for the whole import. */
+	FStreetMapImportProfile();
+
+	/** Starts timing a phase.  Phases may nest, in which case the report shows them indented under their parent. */
+	void BeginPhase( const TCHAR* PhaseName );
+
+	/** Stops timing the phase that was started last */
+	void EndPhase();
+
+	/** Sets a counter, such as the number of nodes that were loaded.  Counters are reported in the order they were first set. */
+	void SetCounter( const TCHAR* CounterName, const int64 Value );
+
+	/** Samples the memory usage of the process, and remembers it if it's the highest so far.  Called at the start and
+	    end of every phase, and may be called in between, wherever memory usage is likely to peak. */
+	void SampleMemory();
+
+	/** @return Seconds since the import started */
+	double GetTotalSeconds() const;
+
+	/** @return Seconds spent in all top level phases with the given name */
+	double GetPhaseSeconds( const TCHAR* PhaseName ) const;
+
+	/** @return The value of a counter, or zero if it was never set */
+	int64 GetCounter( const TCHAR* CounterName ) const;
+
+	/** @return The highest physical memory usage of the process we sampled, in bytes */
+	uint64 GetPeakUsedPhysical() const
+	{
+		return PeakUsedPhysical;
+	}
+
+	/** Writes the report to the log */
+	void LogReport( class FFeedbackContext* FeedbackContext, const FString& SourceName ) const;
+
+	/** Fills in the summary that is stored with the asset */
+	void GetStats( FStreetMapImportStats& OutStats ) const;
+
+private:
+
+	struct FPhase
+	{
+		FString Name;
+		int32 Depth;
+		double StartTime;
+		double Seconds;
+		uint64 UsedPhysicalAtEnd;
+	};
+
+	/** Time at which the import started */
+	double StartTime;
+
+	/** All phases, in the order they started */
+	TArray<FPhase> Phases;
+
+	/** Indices of the phases that haven't ended yet, innermost last */
+	TArray<int32> OpenPhases;
+
+	/** Counters, in the order they were first set */
+	TArray<TPair<FString, int64>> Counters;
+
+	/** Physical memory used by the process when the import started */
+	uint64 StartUsedPhysical;
+
+	/** Highest physical memory usage sampled so far */
+	uint64 PeakUsedPhysical;
+};
+
+
+/** Times a phase of an import for as long as it is in scope.  Does nothing if there is no profile. */
+class FScopedStreetMapImportPhase
+{
+
+public:
+
+	FScopedStreetMapImportPhase( FStreetMapImportProfile* InProfile, const TCHAR* PhaseName )
+		: Profile( InProfile )
+	{
+		if( Profile != nullptr )
+		{
+			Profile->BeginPhase( PhaseName );
+		}
+	}
+
+	~FScopedStreetMapImportPhase()
+	{
+		if( Profile != nullptr )
+		{
+			Profile->EndPhase();
+		}
+	}
+
+	/** Ends the phase and starts the next one, for phases that simply follow each other */
+	void Next( const TCHAR* PhaseName )
+	{
+		if( Profile != nullptr )
+		{
+			Profile->EndPhase();
+			Profile->BeginPhase( PhaseName );
+		}
+	}
+
+	FScopedStreetMapImportPhase( const FScopedStreetMapImportPhase& ) = delete;
+	FScopedStreetMapImportPhase& operator=( const FScopedStreetMapImportPhase& ) = delete;
+
+private:
+
+	FStreetMapImportProfile* Profile;
+};
@@ -0,0 +1,126 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapImporting.h"
+#include "StreetMapImportProgress.h"
+
+
+FStreetMapImportProgress::FStreetMapImportProgress()
+	: Fraction( 0.0f )
+{
+}
+
+
+void FStreetMapImportProgress::BeginScope( const float TotalWork, const FText& InDescription )
+{
+	FScopeLock Lock( &CriticalSection );
+
+	FScope& Scope = Scopes[ Scopes.AddDefaulted() ];
+	Scope.TotalWork = TotalWork;
+	Scope.CompletedWork = 0.0f;
+	Scope.CurrentFrameWork = 0.0f;
+	Scope.Description = InDescription;
+
+	Update();
+}
+
+
+void FStreetMapImportProgress::EnterProgressFrame( const float ExpectedWork, const FText& FrameDescription )
+{
+	FScopeLock Lock( &CriticalSection );
+
+	if( Scopes.Num() > 0 )
+	{
+		FScope& Scope = Scopes.Last();
+		Scope.CompletedWork += Scope.CurrentFrameWork;
+		Scope.CurrentFrameWork = ExpectedWork;
+		Scope.FrameDescription = FrameDescription;
+	}
+
+	Update();
+}
+
+
+void FStreetMapImportProgress::EndScope()
+{
+	FScopeLock Lock( &CriticalSection );
+
+	check( Scopes.Num() > 0 );
+	Scopes.Pop( false );
+
+	if( Scopes.Num() > 0 )
+	{
+		FScope& Parent = Scopes.Last();
+		Parent.CompletedWork += Parent.CurrentFrameWork;
+		Parent.CurrentFrameWork = 0.0f;
+		Update();
+	}
+	else
+	{
+		Fraction = 1.0f;
+	}
+}
+
+
+float FStreetMapImportProgress::GetFraction() const
+{
+	FScopeLock Lock( &CriticalSection );
+	return Fraction;
+}
+
+
+FText FStreetMapImportProgress::GetDescription() const
+{
+	FScopeLock Lock( &CriticalSection );
+	return Description;
+}
+
+
+void FStreetMapImportProgress::Update()
+{
+	// Each unit of work fills the current frame of its parent, the same way FSlowTask adds up nested tasks
+	float NewFraction = 0.0f;
+	float Scale = 1.0f;
+	for( const FScope& Scope : Scopes )
+	{
+		if( Scope.TotalWork <= 0.0f )
+		{
+			break;
+		}
+		NewFraction += Scale * FMath::Min( Scope.CompletedWork / Scope.TotalWork, 1.0f );
+		Scale *= FMath::Min( Scope.CurrentFrameWork / Scope.TotalWork, 1.0f );
+	}
+	Fraction = FMath::Clamp( NewFraction, 0.0f, 1.0f );
+
+	for( int32 ScopeIndex = Scopes.Num() - 1; ScopeIndex >= 0; --ScopeIndex )
+	{
+		const FScope& Scope = Scopes[ ScopeIndex ];
+		if( !Scope.FrameDescription.IsEmpty() || !Scope.Description.IsEmpty() )
+		{
+			Description = Scope.FrameDescription.IsEmpty() ? Scope.Description : Scope.FrameDescription;
+			break;
+		}
+	}
+}
+
+
+void FStreetMapBufferedFeedback::Serialize( const TCHAR* V, ELogVerbosity::Type Verbosity, const FName& Category )
+{
+	FScopeLock Lock( &CriticalSection );
+	Messages.Emplace( Verbosity, V );
+}
+
+
+void FStreetMapBufferedFeedback::Flush( TFunctionRef<void( ELogVerbosity::Type Verbosity, const FString& Message )> Write )
+{
+	TArray<TPair<ELogVerbosity::Type, FString>> MessagesToWrite;
+	{
+		FScopeLock Lock( &CriticalSection );
+		MessagesToWrite = MoveTemp( Messages );
+		Messages.Reset();
+	}
+
+	for( const TPair<ELogVerbosity::Type, FString>& Message : MessagesToWrite )
+	{
+		Write( Message.Key, Message.Value );
+	}
+}
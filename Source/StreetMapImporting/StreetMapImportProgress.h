@@ -0,0 +1,142 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+
+/**
+ * Progress of an import that runs in the background, and whether the user wants it to stop.  The thread that runs the
+ * import reports progress through FScopedStreetMapImportProgress, much like it would through FScopedSlowTask, and the
+ * game thread shows it and passes on the cancel button.  Thread safe.
+ */
+class FStreetMapImportProgress
+{
+
+public:
+
+	/** Default constructor */
+	FStreetMapImportProgress();
+
+	/** Starts a unit of work made of TotalWork steps.  Units nest like slow tasks do: a unit started inside of a frame of another unit fills that frame. */
+	void BeginScope( const float TotalWork, const FText& Description );
+
+	/** Completes the current frame of the innermost unit of work, and starts the next one */
+	void EnterProgressFrame( const float ExpectedWork, const FText& Description );
+
+	/** Ends the innermost unit of work, which completes the frame of its parent it was started in */
+	void EndScope();
+
+	/** @return How much of the import is done, from 0 to 1 */
+	float GetFraction() const;
+
+	/** @return What the import is busy with right now */
+	FText GetDescription() const;
+
+	/** Asks the import to stop as soon as it can */
+	void RequestCancel()
+	{
+		bCancelRequested = true;
+	}
+
+	/** @return True if the import should stop */
+	bool ShouldCancel() const
+	{
+		return bCancelRequested;
+	}
+
+private:
+
+	/** Updates the fraction and description from the units of work.  Must hold the lock. */
+	void Update();
+
+	struct FScope
+	{
+		float TotalWork;
+		float CompletedWork;
+		float CurrentFrameWork;
+		FText Description;
+		FText FrameDescription;
+	};
+
+	/** Guards everything but the cancel flag */
+	mutable FCriticalSection CriticalSection;
+
+	/** Units of work that haven't ended yet, innermost last */
+	TArray<FScope> Scopes;
+
+	/** How much of the import is done, as of the last change */
+	float Fraction;
+
+	/** What the innermost unit of work that has a description is doing */
+	FText Description;
+
+	/** Set on the game thread, polled by the import */
+	FThreadSafeBool bCancelRequested;
+};
+
+
+/** Reports progress of a unit of work for as long as it is in scope.  Does nothing if there is no progress to report to. */
+class FScopedStreetMapImportProgress
+{
+
+public:
+
+	FScopedStreetMapImportProgress( FStreetMapImportProgress* InProgress, const float TotalWork, const FText& Description )
+		: Progress( InProgress )
+	{
+		if( Progress != nullptr )
+		{
+			Progress->BeginScope( TotalWork, Description );
+		}
+	}
+
+	~FScopedStreetMapImportProgress()
+	{
+		if( Progress != nullptr )
+		{
+			Progress->EndScope();
+		}
+	}
+
+	/** Completes the current frame and starts the next one, which is ExpectedWork steps long */
+	void EnterProgressFrame( const float ExpectedWork = 1.0f, const FText& Description = FText() )
+	{
+		if( Progress != nullptr )
+		{
+			Progress->EnterProgressFrame( ExpectedWork, Description );
+		}
+	}
+
+	/** @return True if the user canceled the import */
+	bool ShouldCancel() const
+	{
+		return Progress != nullptr && Progress->ShouldCancel();
+	}
+
+	FScopedStreetMapImportProgress( const FScopedStreetMapImportProgress& ) = delete;
+	FScopedStreetMapImportProgress& operator=( const FScopedStreetMapImportProgress& ) = delete;
+
+private:
+
+	FStreetMapImportProgress* Progress;
+};
+
+
+/**
+ * Collects the messages of an import running on another thread, so that they can be written out on the game thread
+ * when it's done, all in one piece.
+ */
+class FStreetMapBufferedFeedback : public FFeedbackContext
+{
+
+public:
+
+	// FOutputDevice overrides
+	virtual void Serialize( const TCHAR* V, ELogVerbosity::Type Verbosity, const FName& Category ) override;
+
+	/** Hands the collected messages to Write in the order they came in, and forgets them */
+	void Flush( TFunctionRef<void( ELogVerbosity::Type Verbosity, const FString& Message )> Write );
+
+private:
+
+	FCriticalSection CriticalSection;
+	TArray<TPair<ELogVerbosity::Type, FString>> Messages;
+};
@@ -12,7 +12,6 @@ namespace UnrealBuildTool.Rules
                     "CoreUObject",
                     "Engine",
                     "UnrealEd",
-                    "XmlParser",
                     "AssetTools",
                     "Projects",
                     "Slate",
@@ -30,10 +29,14 @@ namespace UnrealBuildTool.Rules
                     "ImageWrapper",
                     "DesktopPlatform",
                     "Landscape",
-                    "CinematicCamera"
+                    "CinematicCamera",
+                    "Settings"
                 }
             );
 
+            // Compressed XML files are decompressed with zlib while they are parsed
+            AddEngineThirdPartyPrivateStaticDependencies(Target, "zlib");
+
             PrivateIncludePaths.AddRange(
                 new string[] {
                     "Developer/DesktopPlatform/Public",
@@ -5,6 +5,10 @@
 #include "ModuleManager.h"
 #include "StreetMapStyle.h"
 #include "StreetMapComponentDetails.h"
+#include "StreetMapImportingSettings.h"
+#include "ISettingsModule.h"
+
+#define LOCTEXT_NAMESPACE "StreetMapImporting"
 
 
 class FStreetMapImportingModule : public IModuleInterface
@@ -38,6 +42,15 @@ void FStreetMapImportingModule::StartupModule()
 	FPropertyEditorModule& PropertyModule = FModuleManager::GetModuleChecked<FPropertyEditorModule>("PropertyEditor");
 	PropertyModule.RegisterCustomClassLayout("StreetMapComponent", FOnGetDetailCustomizationInstance::CreateStatic(&FStreetMapComponentDetails::MakeInstance));
 	PropertyModule.NotifyCustomizationModuleChanged();
+
+	// Register the import settings, so projects can edit which highways and railways get imported
+	if( ISettingsModule* SettingsModule = FModuleManager::GetModulePtr<ISettingsModule>( "Settings" ) )
+	{
+		SettingsModule->RegisterSettings( "Project", "Plugins", "StreetMap",
+			LOCTEXT( "StreetMapImportingSettingsName", "Street Map" ),
+			LOCTEXT( "StreetMapImportingSettingsDescription", "Configure how OpenStreetMap files are imported." ),
+			GetMutableDefault<UStreetMapImportingSettings>() );
+	}
 }
 
 
@@ -60,4 +73,11 @@ void FStreetMapImportingModule::ShutdownModule()
 		PropertyModule.UnregisterCustomClassLayout("StreetMapComponent");
 		PropertyModule.NotifyCustomizationModuleChanged();
 	}
+
+	if( ISettingsModule* SettingsModule = FModuleManager::GetModulePtr<ISettingsModule>( "Settings" ) )
+	{
+		SettingsModule->UnregisterSettings( "Project", "Plugins", "StreetMap" );
+	}
 }
+
+#undef LOCTEXT_NAMESPACE
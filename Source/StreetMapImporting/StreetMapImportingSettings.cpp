@@ -0,0 +1,37 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapImporting.h"
+#include "StreetMapImportingSettings.h"
+
+
+UStreetMapImportingSettings::UStreetMapImportingSettings( const FObjectInitializer& ObjectInitializer )
+	: Super( ObjectInitializer )
+	, bCacheParsedFiles( true )
+	, MaxCacheSizeMB( 4096 )
+{
+	// Small roads and residential streets
+	RoadCategories.Add( FStreetMapRoadCategory( TEXT( "residential" ), EStreetMapRoadType::Street ) );	// ~32% of all highways
+	RoadCategories.Add( FStreetMapRoadCategory( TEXT( "service" ), EStreetMapRoadType::Street ) );		// ~15% of all highways
+	RoadCategories.Add( FStreetMapRoadCategory( TEXT( "unclassified" ), EStreetMapRoadType::Street ) );
+	RoadCategories.Add( FStreetMapRoadCategory( TEXT( "road" ), EStreetMapRoadType::Street ) );	// @todo: Consider excluding "Road" from our data set, as it could be a highway that wasn't properly tagged in OSM yet
+
+	// Major roads
+	RoadCategories.Add( FStreetMapRoadCategory( TEXT( "tertiary" ), EStreetMapRoadType::MajorRoad ) );	// ~4% of all highways
+	RoadCategories.Add( FStreetMapRoadCategory( TEXT( "secondary" ), EStreetMapRoadType::MajorRoad ) );	// ~2% of all highways
+	RoadCategories.Add( FStreetMapRoadCategory( TEXT( "secondary_link" ), EStreetMapRoadType::MajorRoad ) );
+	RoadCategories.Add( FStreetMapRoadCategory( TEXT( "tertiary_link" ), EStreetMapRoadType::MajorRoad ) );
+	RoadCategories.Add( FStreetMapRoadCategory( TEXT( "raceway" ), EStreetMapRoadType::MajorRoad ) );
+
+	// Highways
+	RoadCategories.Add( FStreetMapRoadCategory( TEXT( "primary" ), EStreetMapRoadType::Highway ) );	// ~2% of all highways
+	RoadCategories.Add( FStreetMapRoadCategory( TEXT( "primary_link" ), EStreetMapRoadType::Highway ) );
+	RoadCategories.Add( FStreetMapRoadCategory( TEXT( "motorway" ), EStreetMapRoadType::Highway ) );
+	RoadCategories.Add( FStreetMapRoadCategory( TEXT( "motorway_link" ), EStreetMapRoadType::Highway ) );
+	RoadCategories.Add( FStreetMapRoadCategory( TEXT( "trunk" ), EStreetMapRoadType::Highway ) );
+	RoadCategories.Add( FStreetMapRoadCategory( TEXT( "trunk_link" ), EStreetMapRoadType::Highway ) );
+
+	RailwayCategories.Add( FStreetMapRailwayCategory( TEXT( "rail" ), EStreetMapRailwayType::Rail ) );
+	RailwayCategories.Add( FStreetMapRailwayCategory( TEXT( "light_rail" ), EStreetMapRailwayType::LightRail ) );
+	RailwayCategories.Add( FStreetMapRailwayCategory( TEXT( "subway" ), EStreetMapRailwayType::Subway ) );
+	RailwayCategories.Add( FStreetMapRailwayCategory( TEXT( "tram" ), EStreetMapRailwayType::Tram ) );
+}
@@ -0,0 +1,92 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+#include "UObject/Object.h"
+#include "StreetMap.h"
+#include "StreetMapImportingSettings.generated.h"
+
+
+/** Maps the value of an OpenStreetMap highway tag to the type of road we import it as */
+USTRUCT()
+struct FStreetMapRoadCategory
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Value of the highway tag, e.g. "residential".  See http://wiki.openstreetmap.org/wiki/Key:highway */
+	UPROPERTY(Category = Import, EditAnywhere)
+	FName Category;
+
+	/** Type of road to import these highways as.  Other skips them. */
+	UPROPERTY(Category = Import, EditAnywhere)
+	TEnumAsByte<EStreetMapRoadType> RoadType;
+
+	FStreetMapRoadCategory()
+		: RoadType(EStreetMapRoadType::Other)
+	{
+	}
+
+	FStreetMapRoadCategory(FName InCategory, EStreetMapRoadType InRoadType)
+		: Category(InCategory)
+		, RoadType(InRoadType)
+	{
+	}
+};
+
+/** Maps the value of an OpenStreetMap railway tag to the type of railway we import it as */
+USTRUCT()
+struct FStreetMapRailwayCategory
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Value of the railway tag, e.g. "light_rail".  See http://wiki.openstreetmap.org/wiki/Key:railway */
+	UPROPERTY(Category = Import, EditAnywhere)
+	FName Category;
+
+	/** Type of railway to import these railways as.  OtherRailway skips them. */
+	UPROPERTY(Category = Import, EditAnywhere)
+	TEnumAsByte<EStreetMapRailwayType> RailwayType;
+
+	FStreetMapRailwayCategory()
+		: RailwayType(EStreetMapRailwayType::OtherRailway)
+	{
+	}
+
+	FStreetMapRailwayCategory(FName InCategory, EStreetMapRailwayType InRailwayType)
+		: Category(InCategory)
+		, RailwayType(InRailwayType)
+	{
+	}
+};
+
+
+/**
+ * Project wide settings for importing OpenStreetMap files.  Shown under Project Settings -> Plugins -> Street Map and
+ * stored in DefaultEditor.ini, so projects can import more kinds of highways and railways without code changes.
+ */
+UCLASS(config = Editor, defaultconfig)
+class UStreetMapImportingSettings : public UObject
+{
+	GENERATED_BODY()
+
+public:
+
+	/** UStreetMapImportingSettings constructor */
+	UStreetMapImportingSettings( const class FObjectInitializer& ObjectInitializer );
+
+	/** Highways we import as roads.  Highways with any other category are skipped. */
+	UPROPERTY(config, Category = Import, EditAnywhere)
+	TArray<FStreetMapRoadCategory> RoadCategories;
+
+	/** Railways we import.  Railways with any other category are skipped. */
+	UPROPERTY(config, Category = Import, EditAnywhere)
+	TArray<FStreetMapRailwayCategory> RailwayCategories;
+
+	/** Keeps parsed OpenStreetMap files in the project's Intermediate folder, so that reimporting a file that didn't
+	    change skips parsing it.  Useful when tweaking the categories above on large files. */
+	UPROPERTY(config, Category = Cache, EditAnywhere)
+	bool bCacheParsedFiles;
+
+	/** Least recently used files are removed from the cache once it grows past this size */
+	UPROPERTY(config, Category = Cache, EditAnywhere, meta = (ClampMin = "0", EditCondition = "bCacheParsedFiles"))
+	int32 MaxCacheSizeMB;
+};
@@ -17,16 +17,18 @@ static void BuildStreetMapRailways(class UStreetMapComponent* StreetMapComponent
 	FStreetMapSplineTools::CleanSplines(SplinesComponent, BuildSettings.RailwayLineMesh, BuildSettings.Landscape->GetWorld());
 
 	TMap< int32, ULandscapeSplineControlPoint* > NodeIndexToControlPointMap;
-	const TArray<FStreetMapRailway>& Railways = StreetMapComponent->GetStreetMap()->GetRailways();
+	const UStreetMap& StreetMap = *StreetMapComponent->GetStreetMap();
+	const TArray<FStreetMapRailway>& Railways = StreetMap.GetRailways();
 
 	for(const FStreetMapRailway& Railway : Railways)
 	{
 		ULandscapeSplineControlPoint* PreviousPoint = nullptr;
-		const int32 NumPoints = Railway.Points.Num();
-		for (int32 PointIndex = 0; PointIndex < NumPoints; PointIndex++)
+		const FStreetMapPointView RailwayPoints = Railway.GetPoints(StreetMap);
+		const TArrayView<const int32> NodeIndices = Railway.GetNodeIndices(StreetMap);
+		for (int32 PointIndex = 0; PointIndex < RailwayPoints.Num(); PointIndex++)
 		{
-			const FVector2D& PointLocation = Railway.Points[PointIndex];
-			const int32 NodeIndex = Railway.NodeIndices[PointIndex];
+			const FVector2D PointLocation = RailwayPoints[PointIndex];
+			const int32 NodeIndex = NodeIndices[PointIndex];
 
 			ULandscapeSplineControlPoint* CurrentPoint = nullptr;
 
@@ -8,6 +8,8 @@
 UStreetMapReimportFactory::UStreetMapReimportFactory(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 {
+	// Lets the user pick a change file when reimporting with a new file
+	Formats.Add( TEXT( "osc;OpenStreetMap Change" ) );
 }
 
 
@@ -26,6 +28,15 @@ bool UStreetMapReimportFactory::CanReimport( UObject* Obj, TArray<FString>& OutF
 void UStreetMapReimportFactory::SetReimportPaths( UObject* Obj, const TArray<FString>& NewReimportPaths )
 {
 	UStreetMap* StreetMap = CastChecked<UStreetMap>( Obj );
+
+	// Change files are applied on top of what we have, so the street map keeps its source file
+	if( FPaths::GetExtension( NewReimportPaths[0] ).Equals( TEXT( "osc" ), ESearchCase::IgnoreCase ) )
+	{
+		PendingChangeFilePath = NewReimportPaths[0];
+		PendingChangeFileStreetMap = StreetMap;
+		return;
+	}
+
 	StreetMap->Modify();
 	StreetMap->AssetImportData->Update( NewReimportPaths[0] );
 }
@@ -35,6 +46,22 @@ EReimportResult::Type UStreetMapReimportFactory::Reimport( UObject* Obj )
 { 
 	UStreetMap* StreetMap = CastChecked<UStreetMap>( Obj );
 
+	if( !PendingChangeFilePath.IsEmpty() && PendingChangeFileStreetMap.Get() == StreetMap )
+	{
+		const FString ChangeFilePath = PendingChangeFilePath;
+		PendingChangeFilePath.Empty();
+		PendingChangeFileStreetMap.Reset();
+
+		StreetMap->Modify();
+		if( ApplyOpenStreetMapChangeFile( StreetMap, ChangeFilePath, GWarn ) )
+		{
+			StreetMap->AppliedChangeFiles.Add( ChangeFilePath );
+			StreetMap->MarkPackageDirty();
+			return EReimportResult::Succeeded;
+		}
+		return EReimportResult::Failed;
+	}
+
 	const FString Filename = StreetMap->AssetImportData->GetFirstFilename();
 	const FString FileExtension = FPaths::GetExtension(Filename);
 
@@ -44,13 +71,28 @@ EReimportResult::Type UStreetMapReimportFactory::Reimport( UObject* Obj )
 		return EReimportResult::Failed;
 	}
 
-	if( UFactory::StaticImportObject( StreetMap->GetClass(), StreetMap->GetOuter(), *StreetMap->GetName(), RF_Public|RF_Standalone, *Filename, nullptr, this ) )
+	// Reimport with the same options the asset was imported with
+	ImportSettings = StreetMap->ImportSettings;
+
+	bReimporting = true;
+	UObject* ImportedObject = UFactory::StaticImportObject( StreetMap->GetClass(), StreetMap->GetOuter(), *StreetMap->GetName(), RF_Public|RF_Standalone, *Filename, nullptr, this );
+	bReimporting = false;
+
+	if( ImportedObject != nullptr )
 	{
 		// Mark the package dirty after the successful import
 		StreetMap->MarkPackageDirty();
 		return EReimportResult::Succeeded;
 	}
 
+	// The street map is replaced once the import going on in the background is done.  Until then there is nothing to
+	// report, so we tell the reimport manager it was canceled, which keeps it quiet.  The background import notifies
+	// the user and broadcasts the reimport itself once it knows how it went.
+	if( bImportingInBackground )
+	{
+		return EReimportResult::Cancelled;
+	}
+
 	return EReimportResult::Failed;
 }
 
@@ -27,5 +27,12 @@ protected:
 	virtual EReimportResult::Type Reimport( UObject* Obj ) override;
 	virtual int32 GetPriority() const override;
 
+private:
+
+	/** OpenStreetMap change file picked for the next reimport.  It's applied to the street map instead of importing its source file again. */
+	FString PendingChangeFilePath;
+
+	/** Street map the pending change file was picked for */
+	TWeakObjectPtr<UStreetMap> PendingChangeFileStreetMap;
 };
 
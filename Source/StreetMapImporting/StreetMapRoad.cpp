@@ -19,16 +19,18 @@ static void BuildStreetMapRoads(class UStreetMapComponent* StreetMapComponent,
 	FStreetMapSplineTools::CleanSplines(SplinesComponent, BuildSettings.RoadMesh, BuildSettings.Landscape->GetWorld());
 
 	TMap< int32, ULandscapeSplineControlPoint* > NodeIndexToControlPointMap;
-	const TArray<FStreetMapRoad>& Roads = StreetMapComponent->GetStreetMap()->GetRoads();
+	const UStreetMap& StreetMap = *StreetMapComponent->GetStreetMap();
+	const TArray<FStreetMapRoad>& Roads = StreetMap.GetRoads();
 
 	for (const FStreetMapRoad& Road : Roads)
 	{
 		ULandscapeSplineControlPoint* PreviousPoint = nullptr;
-		const int32 NumPoints = Road.RoadPoints.Num();
-		for (int32 PointIndex = 0; PointIndex < NumPoints; PointIndex++)
+		const FStreetMapPointView RoadPoints = Road.GetPoints(StreetMap);
+		const TArrayView<const int32> NodeIndices = Road.GetNodeIndices(StreetMap);
+		for (int32 PointIndex = 0; PointIndex < RoadPoints.Num(); PointIndex++)
 		{
-			const FVector2D& PointLocation = Road.RoadPoints[PointIndex];
-			const int32 NodeIndex = Road.NodeIndices[PointIndex];
+			const FVector2D PointLocation = RoadPoints[PointIndex];
+			const int32 NodeIndex = NodeIndices[PointIndex];
 
 			// Width of the Road depends on type - TODO: look up German rules of standard road geometries
 			float RoadWidth = 100.0;
@@ -0,0 +1,244 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapImporting.h"
+#include "StreetMapSimplifier.h"
+
+
+/** @return Squared distance from the point to the closest point of the segment */
+static float PointToSegmentDistSquared( const FVector2D& Point, const FVector2D& Start, const FVector2D& End )
+{
+	const FVector2D Segment = End - Start;
+	const float LengthSquared = Segment.SizeSquared();
+	const float Alpha = LengthSquared > SMALL_NUMBER ? FMath::Clamp( ( ( Point - Start ) | Segment ) / LengthSquared, 0.0f, 1.0f ) : 0.0f;
+	return FVector2D::DistSquared( Point, Start + Segment * Alpha );
+}
+
+
+int32 FStreetMapSimplifier::Simplify( const TArray<FVector2D>& Points, const bool bIsClosed, const EStreetMapSimplification Method, const float Tolerance, TArray<bool>& InOutKeepPoints )
+{
+	const int32 NumPoints = Points.Num();
+	check( InOutKeepPoints.Num() == NumPoints );
+
+	const int32 MinPoints = bIsClosed ? 3 : 2;
+	if( Method == EStreetMapSimplification::None || Tolerance <= 0.0f || NumPoints <= MinPoints )
+	{
+		for( bool& bKeepPoint : InOutKeepPoints )
+		{
+			bKeepPoint = true;
+		}
+		return NumPoints;
+	}
+
+	if( !bIsClosed )
+	{
+		InOutKeepPoints[ 0 ] = true;
+		InOutKeepPoints[ NumPoints - 1 ] = true;
+	}
+
+	TArray<int32> Anchors;
+	for( int32 PointIndex = 0; PointIndex < NumPoints; ++PointIndex )
+	{
+		if( InOutKeepPoints[ PointIndex ] )
+		{
+			Anchors.Add( PointIndex );
+		}
+	}
+
+	if( bIsClosed && Anchors.Num() < 2 )
+	{
+		// Rings need two points to be cut into lines.  The point farthest from the first one makes for two even halves.
+		const int32 FirstAnchor = Anchors.Num() > 0 ? Anchors[ 0 ] : 0;
+		int32 FarthestIndex = FirstAnchor;
+		float FarthestDistSquared = -1.0f;
+		for( int32 PointIndex = 0; PointIndex < NumPoints; ++PointIndex )
+		{
+			const float DistSquared = FVector2D::DistSquared( Points[ PointIndex ], Points[ FirstAnchor ] );
+			if( PointIndex != FirstAnchor && DistSquared > FarthestDistSquared )
+			{
+				FarthestDistSquared = DistSquared;
+				FarthestIndex = PointIndex;
+			}
+		}
+
+		InOutKeepPoints[ FirstAnchor ] = true;
+		InOutKeepPoints[ FarthestIndex ] = true;
+		Anchors.Reset();
+		Anchors.Add( FMath::Min( FirstAnchor, FarthestIndex ) );
+		Anchors.Add( FMath::Max( FirstAnchor, FarthestIndex ) );
+	}
+
+	// Rings have one more span, from the last anchor around to the first one
+	const int32 NumSpans = bIsClosed ? Anchors.Num() : Anchors.Num() - 1;
+	for( int32 SpanIndex = 0; SpanIndex < NumSpans; ++SpanIndex )
+	{
+		const int32 First = Anchors[ SpanIndex ];
+		const int32 Last = SpanIndex + 1 < Anchors.Num() ? Anchors[ SpanIndex + 1 ] : Anchors[ 0 ] + NumPoints;
+		if( Last - First < 2 )
+		{
+			continue;
+		}
+
+		if( Method == EStreetMapSimplification::DouglasPeucker )
+		{
+			SimplifyDouglasPeucker( Points, First, Last, Tolerance, InOutKeepPoints );
+		}
+		else
+		{
+			SimplifyVisvalingam( Points, First, Last, Tolerance, InOutKeepPoints );
+		}
+	}
+
+	int32 NumKeptPoints = 0;
+	for( const bool bKeepPoint : InOutKeepPoints )
+	{
+		NumKeptPoints += bKeepPoint ? 1 : 0;
+	}
+
+	if( NumKeptPoints < MinPoints )
+	{
+		// Slivers that would collapse into a line.  They're small enough that keeping them whole costs next to nothing.
+		for( bool& bKeepPoint : InOutKeepPoints )
+		{
+			bKeepPoint = true;
+		}
+		NumKeptPoints = NumPoints;
+	}
+
+	return NumKeptPoints;
+}
+
+
+void FStreetMapSimplifier::SimplifyDouglasPeucker( const TArray<FVector2D>& Points, const int32 First, const int32 Last, const float Tolerance, TArray<bool>& InOutKeepPoints )
+{
+	const int32 NumPoints = Points.Num();
+	const float ToleranceSquared = Tolerance * Tolerance;
+
+	// Spans still to look at.  Kept on a stack instead of recursing, since long ways can be split many times.
+	TArray<TPair<int32, int32>, TInlineAllocator<32>> Spans;
+	Spans.Emplace( First, Last );
+	while( Spans.Num() > 0 )
+	{
+		const TPair<int32, int32> Span = Spans.Pop( false );
+		const FVector2D& Start = Points[ Span.Key % NumPoints ];
+		const FVector2D& End = Points[ Span.Value % NumPoints ];
+
+		int32 FarthestIndex = INDEX_NONE;
+		float FarthestDistSquared = ToleranceSquared;
+		for( int32 PointIndex = Span.Key + 1; PointIndex < Span.Value; ++PointIndex )
+		{
+			const float DistSquared = PointToSegmentDistSquared( Points[ PointIndex % NumPoints ], Start, End );
+			if( DistSquared > FarthestDistSquared )
+			{
+				FarthestDistSquared = DistSquared;
+				FarthestIndex = PointIndex;
+			}
+		}
+
+		if( FarthestIndex != INDEX_NONE )
+		{
+			InOutKeepPoints[ FarthestIndex % NumPoints ] = true;
+			if( FarthestIndex - Span.Key >= 2 )
+			{
+				Spans.Emplace( Span.Key, FarthestIndex );
+			}
+			if( Span.Value - FarthestIndex >= 2 )
+			{
+				Spans.Emplace( FarthestIndex, Span.Value );
+			}
+		}
+	}
+}
+
+
+void FStreetMapSimplifier::SimplifyVisvalingam( const TArray<FVector2D>& Points, const int32 First, const int32 Last, const float Tolerance, TArray<bool>& InOutKeepPoints )
+{
+	const int32 NumPoints = Points.Num();
+	const int32 NumSpanPoints = Last - First + 1;
+	const float MinArea = Tolerance * Tolerance;
+
+	// Points of the span are linked to their neighbors that are left, and looked up by the index into the span
+	TArray<int32> Previous;
+	TArray<int32> Next;
+	TArray<float> Areas;
+	TArray<bool> Removed;
+	Previous.SetNumUninitialized( NumSpanPoints );
+	Next.SetNumUninitialized( NumSpanPoints );
+	Areas.SetNumZeroed( NumSpanPoints );
+	Removed.SetNumZeroed( NumSpanPoints );
+
+	auto GetPoint = [&Points, NumPoints, First]( const int32 SpanPointIndex ) -> const FVector2D&
+	{
+		return Points[ ( First + SpanPointIndex ) % NumPoints ];
+	};
+	auto ComputeArea = [&GetPoint, &Previous, &Next]( const int32 SpanPointIndex )
+	{
+		const FVector2D& PreviousPoint = GetPoint( Previous[ SpanPointIndex ] );
+		return 0.5f * FMath::Abs( ( GetPoint( SpanPointIndex ) - PreviousPoint ) ^ ( GetPoint( Next[ SpanPointIndex ] ) - PreviousPoint ) );
+	};
+
+	struct FCandidate
+	{
+		float Area;
+		int32 SpanPointIndex;
+
+		bool operator<( const FCandidate& Other ) const
+		{
+			return Area < Other.Area;
+		}
+	};
+
+	// The ends of the span are anchors, and are never candidates for removal
+	TArray<FCandidate> Candidates;
+	for( int32 SpanPointIndex = 0; SpanPointIndex < NumSpanPoints; ++SpanPointIndex )
+	{
+		Previous[ SpanPointIndex ] = SpanPointIndex - 1;
+		Next[ SpanPointIndex ] = SpanPointIndex + 1;
+	}
+	for( int32 SpanPointIndex = 1; SpanPointIndex < NumSpanPoints - 1; ++SpanPointIndex )
+	{
+		Areas[ SpanPointIndex ] = ComputeArea( SpanPointIndex );
+		Candidates.HeapPush( FCandidate{ Areas[ SpanPointIndex ], SpanPointIndex } );
+	}
+
+	while( Candidates.Num() > 0 )
+	{
+		FCandidate Candidate;
+		Candidates.HeapPop( Candidate, false );
+
+		// Points are pushed again whenever their area changes, so skip the outdated entries
+		const int32 SpanPointIndex = Candidate.SpanPointIndex;
+		if( Removed[ SpanPointIndex ] || Candidate.Area != Areas[ SpanPointIndex ] )
+		{
+			continue;
+		}
+		if( Candidate.Area >= MinArea )
+		{
+			break;
+		}
+
+		Removed[ SpanPointIndex ] = true;
+		const int32 PreviousIndex = Previous[ SpanPointIndex ];
+		const int32 NextIndex = Next[ SpanPointIndex ];
+		Next[ PreviousIndex ] = NextIndex;
+		Previous[ NextIndex ] = PreviousIndex;
+
+		// Neighbors never stand for less area than the point removed before them, so that a run of tiny wiggles
+		// doesn't eat into a bend one point at a time
+		for( const int32 NeighborIndex : { PreviousIndex, NextIndex } )
+		{
+			if( NeighborIndex > 0 && NeighborIndex < NumSpanPoints - 1 )
+			{
+				Areas[ NeighborIndex ] = FMath::Max( ComputeArea( NeighborIndex ), Candidate.Area );
+				Candidates.HeapPush( FCandidate{ Areas[ NeighborIndex ], NeighborIndex } );
+			}
+		}
+	}
+
+	for( int32 SpanPointIndex = 1; SpanPointIndex < NumSpanPoints - 1; ++SpanPointIndex )
+	{
+		if( !Removed[ SpanPointIndex ] )
+		{
+			InOutKeepPoints[ ( First + SpanPointIndex ) % NumPoints ] = true;
+		}
+	}
+}
@@ -0,0 +1,38 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+#include "StreetMap.h"
+
+
+/**
+ * Removes points from lines and rings that barely change their shape.  OpenStreetMap traces curves with a node every
+ * few meters, and every point we keep becomes a quad of the rendered road and a control point of its spline.
+ */
+class FStreetMapSimplifier
+{
+
+public:
+
+	/**
+	 * Works out which points of a line or ring to keep.  Points already marked are always kept, and the ways between
+	 * them are simplified one after another, so simplification never moves a kept point or skips past one.  The ends of
+	 * lines are always kept.  Rings that would end up with fewer than three points are kept whole.
+	 *
+	 * @param	Points				The points of the line or ring
+	 * @param	bIsClosed			True for rings.  The last point connects back to the first, which isn't repeated.
+	 * @param	Method				How to simplify
+	 * @param	Tolerance			How far the simplified line may stray from the original, in centimeters
+	 * @param	InOutKeepPoints		One entry per point.  Points that must be kept are set going in, the rest of the kept points are set coming out.
+	 *
+	 * @return	The number of points kept
+	 */
+	static int32 Simplify( const TArray<FVector2D>& Points, const bool bIsClosed, const EStreetMapSimplification Method, const float Tolerance, TArray<bool>& InOutKeepPoints );
+
+protected:
+
+	/** Keeps the point farthest from the line between First and Last, if it's farther than the tolerance, and carries on with both halves.  Indices past the last point wrap around. */
+	static void SimplifyDouglasPeucker( const TArray<FVector2D>& Points, const int32 First, const int32 Last, const float Tolerance, TArray<bool>& InOutKeepPoints );
+
+	/** Removes the points between First and Last that add the least area, until every point left adds at least the tolerance squared.  Indices past the last point wrap around. */
+	static void SimplifyVisvalingam( const TArray<FVector2D>& Points, const int32 First, const int32 Last, const float Tolerance, TArray<bool>& InOutKeepPoints );
+};
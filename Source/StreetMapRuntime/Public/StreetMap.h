@@ -2,6 +2,10 @@
 
 #pragma once
 
+#include "Containers/ArrayView.h"
+#include "Serialization/BulkData.h"
+#include "StreetMapSpatialIndex.h"
+#include "StreetMapSourceIndex.h"
 #include "LandscapeProxy.h"
 #include "Components/SplineMeshComponent.h"
 #include "StreetMap.generated.h"
@@ -386,6 +390,267 @@ public:
 	}
 };
 
+/** How a street map stores the points of its elements */
+UENUM()
+enum class EStreetMapPointStorage : uint8
+{
+	/** Every point is two floats relative to the map's origin.  Far from the origin, points are less precise. */
+	Float,
+
+	/** Every point is two 16 bit centimeter steps from a grid cell close to it.  Half the memory, and just as precise
+	    everywhere on the map. */
+	Quantized,
+};
+
+
+/** A point stored as whole steps away from its element's anchor.  See FStreetMapPointAnchor. */
+struct FStreetMapQuantizedPoint
+{
+	int16 X;
+	int16 Y;
+
+	friend FArchive& operator<<( FArchive& Ar, FStreetMapQuantizedPoint& Point )
+	{
+		return Ar << Point.X << Point.Y;
+	}
+};
+
+
+/** A stretch of an element's quantized points that are measured from the same grid cell.  See FStreetMapPointAnchor. */
+struct FStreetMapPointRun
+{
+	/** The first point of the stretch, counted from the element's first point */
+	int32 FirstPoint;
+
+	/** The grid cell the points are measured from */
+	FIntPoint Cell;
+
+	friend FArchive& operator<<( FArchive& Ar, FStreetMapPointRun& Run )
+	{
+		return Ar << Run.FirstPoint << Run.Cell;
+	}
+};
+
+
+/** A point relative to the map's origin, in centimeters, in double precision.  Elements keep these next to their float
+    points while a street map is built, so that quantized points are measured from where the nodes really are. */
+struct FStreetMapExactPoint
+{
+	double X;
+	double Y;
+
+	FStreetMapExactPoint()
+		: X( 0.0 )
+		, Y( 0.0 )
+	{
+	}
+
+	FStreetMapExactPoint( const double InX, const double InY )
+		: X( InX )
+		, Y( InY )
+	{
+	}
+
+	/** @return The point in single precision */
+	FVector2D ToVector2D() const
+	{
+		return FVector2D( (float)X, (float)Y );
+	}
+};
+
+
+/** Where the quantized points of an element are measured from */
+USTRUCT( BlueprintType )
+struct STREETMAPRUNTIME_API FStreetMapPointAnchor
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Size of the grid cells elements are anchored to, in centimeters */
+	static const int32 CellSize = 1024;
+
+	/** The grid cell the element's first run of points is measured from.  Points are whole centimeters away from the
+	    cell's corner. */
+	UPROPERTY( Category=StreetMap, VisibleAnywhere )
+	FIntPoint Cell;
+
+	/** Street maps saved before elements were split into runs used steps of 2^StepShift centimeters for elements that
+	    stretched farther than an int16 worth of centimeters.  Always 0 for new ones. */
+	UPROPERTY( Category=StreetMap, VisibleAnywhere )
+	uint8 StepShift;
+
+	/** Elements that stretch farther than an int16 worth of centimeters are split into runs of points, each measured
+	    from a cell close to it, so that every point keeps centimeter steps.  Runs after the first one are in the street
+	    map's pool of runs for the element's category, starting here. */
+	UPROPERTY( Category=StreetMap, VisibleAnywhere )
+	int32 FirstRun;
+
+	/** Number of runs after the first one.  Zero for all but the longest elements. */
+	UPROPERTY( Category=StreetMap, VisibleAnywhere )
+	int32 NumRuns;
+
+	FStreetMapPointAnchor()
+		: Cell( 0, 0 )
+		, StepShift( 0 )
+		, FirstRun( 0 )
+		, NumRuns( 0 )
+	{
+	}
+
+	/** @return The corner of the cell, in centimeters */
+	double GetOriginX() const
+	{
+		return (double)Cell.X * CellSize;
+	}
+	double GetOriginY() const
+	{
+		return (double)Cell.Y * CellSize;
+	}
+
+	/** @return The length of a step, in centimeters */
+	double GetStep() const
+	{
+		return (double)( 1 << StepShift );
+	}
+};
+
+
+/** The points of one element, however the street map stores them.  Points are decoded as they are read.  Cheap to copy,
+    and only valid as long as the street map doesn't change. */
+class FStreetMapPointView
+{
+
+public:
+
+	/** Points stored as floats */
+	FStreetMapPointView( const FVector2D* InPoints, const int32 InNumPoints )
+		: Points( InPoints )
+		, QuantizedPoints( nullptr )
+		, Runs( nullptr )
+		, NumPoints( InNumPoints )
+		, NumRuns( 0 )
+		, OriginX( 0.0 )
+		, OriginY( 0.0 )
+		, Step( 1.0 )
+	{
+	}
+
+	/** Quantized points of an element anchored at Anchor, whose runs after the first one are in RunPool */
+	FStreetMapPointView( const FStreetMapQuantizedPoint* InQuantizedPoints, const int32 InNumPoints, const FStreetMapPointAnchor& Anchor, const TArray<FStreetMapPointRun>& RunPool )
+		: Points( nullptr )
+		, QuantizedPoints( InQuantizedPoints )
+		, Runs( Anchor.NumRuns > 0 ? RunPool.GetData() + Anchor.FirstRun : nullptr )
+		, NumPoints( InNumPoints )
+		, NumRuns( Anchor.NumRuns )
+		, OriginX( Anchor.GetOriginX() )
+		, OriginY( Anchor.GetOriginY() )
+		, Step( Anchor.GetStep() )
+	{
+	}
+
+	/** @return The number of points */
+	int32 Num() const
+	{
+		return NumPoints;
+	}
+
+	/** @return The point at Index, relative to the map's origin, in centimeters */
+	FVector2D operator[]( const int32 Index ) const
+	{
+		checkSlow( Index >= 0 && Index < NumPoints );
+		if( QuantizedPoints == nullptr )
+		{
+			return Points[ Index ];
+		}
+
+		double X, Y;
+		GetExact( Index, X, Y );
+		return FVector2D( (float)X, (float)Y );
+	}
+
+	/** Gets the point at Index in double precision.  Quantized points come out exactly the way they were stored. */
+	void GetExact( const int32 Index, double& OutX, double& OutY ) const
+	{
+		checkSlow( Index >= 0 && Index < NumPoints );
+		if( QuantizedPoints == nullptr )
+		{
+			OutX = Points[ Index ].X;
+			OutY = Points[ Index ].Y;
+		}
+		else if( NumRuns == 0 || Index < Runs[ 0 ].FirstPoint )
+		{
+			OutX = OriginX + QuantizedPoints[ Index ].X * Step;
+			OutY = OriginY + QuantizedPoints[ Index ].Y * Step;
+		}
+		else
+		{
+			// Runs only ever use centimeter steps
+			const FStreetMapPointRun& Run = FindRun( Index );
+			OutX = (double)Run.Cell.X * FStreetMapPointAnchor::CellSize + QuantizedPoints[ Index ].X;
+			OutY = (double)Run.Cell.Y * FStreetMapPointAnchor::CellSize + QuantizedPoints[ Index ].Y;
+		}
+	}
+
+	/** Replaces the contents of OutPoints with all of the points */
+	void CopyTo( TArray<FVector2D>& OutPoints ) const
+	{
+		OutPoints.SetNumUninitialized( NumPoints, false );
+		for( int32 Index = 0; Index < NumPoints; ++Index )
+		{
+			OutPoints[ Index ] = ( *this )[ Index ];
+		}
+	}
+
+	/** Replaces the contents of OutPoints with all of the points, in double precision */
+	void CopyTo( TArray<FStreetMapExactPoint>& OutPoints ) const
+	{
+		OutPoints.SetNumUninitialized( NumPoints, false );
+		for( int32 Index = 0; Index < NumPoints; ++Index )
+		{
+			GetExact( Index, OutPoints[ Index ].X, OutPoints[ Index ].Y );
+		}
+	}
+
+private:
+
+	/** @return The last run after the first one that starts at or before Index.  There must be one. */
+	const FStreetMapPointRun& FindRun( const int32 Index ) const
+	{
+		int32 Low = 0;
+		int32 High = NumRuns - 1;
+		while( Low < High )
+		{
+			const int32 Middle = Low + ( High - Low + 1 ) / 2;
+			if( Runs[ Middle ].FirstPoint <= Index )
+			{
+				Low = Middle;
+			}
+			else
+			{
+				High = Middle - 1;
+			}
+		}
+		return Runs[ Low ];
+	}
+
+	/** Points stored as floats, or nullptr if they are quantized */
+	const FVector2D* Points;
+
+	/** Quantized points, or nullptr if they are stored as floats */
+	const FStreetMapQuantizedPoint* QuantizedPoints;
+
+	/** Runs of quantized points after the first one, or nullptr if there are none */
+	const FStreetMapPointRun* Runs;
+
+	int32 NumPoints;
+	int32 NumRuns;
+
+	/** Where quantized points are measured from, and how far apart their steps are, in centimeters */
+	double OriginX;
+	double OriginY;
+	double Step;
+};
+
+
 /** Types of roads */
 UENUM( BlueprintType )
 enum EStreetMapRoadType
@@ -418,13 +683,18 @@ struct STREETMAPRUNTIME_API FStreetMapRoad
 	UPROPERTY( Category=StreetMap, EditAnywhere )
 	TEnumAsByte<EStreetMapRoadType> RoadType;
 	
-	/** Nodes along this road, one at each point in the RoadPoints list */
-	UPROPERTY( Category=StreetMap, EditAnywhere )
-	TArray<int32> NodeIndices;
+	/** Where this road's points start in the street map's pool of road points.  Its node indices start at the same place
+	    in the pool of road node indices. */
+	UPROPERTY( Category=StreetMap, VisibleAnywhere )
+	int32 FirstPoint;
 
-	/** List of all of the points on this road, one for each node in the NodeIndices list */
-	UPROPERTY( Category=StreetMap, EditAnywhere )
-	TArray<FVector2D> RoadPoints;
+	/** Number of points on this road, one for each node index */
+	UPROPERTY( Category=StreetMap, VisibleAnywhere )
+	int32 NumPoints;
+
+	/** Where this road's points are measured from, if the street map stores them quantized */
+	UPROPERTY( Category=StreetMap, VisibleAnywhere )
+	FStreetMapPointAnchor Anchor;
 	
 	// @todo: Performance: Bounding information could be computed at load time if we want to avoid the memory cost of storing it
 
@@ -440,6 +710,38 @@ struct STREETMAPRUNTIME_API FStreetMapRoad
 	UPROPERTY( Category=StreetMap, EditAnywhere )
 	uint8 bIsOneWay : 1;
 
+#if WITH_EDITORONLY_DATA
+	/** Nodes along this road and its points, one array each, while the street map is being built or changed.  Street
+	    maps saved before points were pooled have them too.  Empty once UStreetMap::PackGeometry() moved them into the pools. */
+	UPROPERTY()
+	TArray<int32> NodeIndices;
+	UPROPERTY()
+	TArray<FVector2D> RoadPoints;
+
+	/** The same points in double precision, while the street map is being built.  Quantized storage is measured from
+	    these when there are as many as there are points. */
+	TArray<FStreetMapExactPoint> ExactPoints;
+#endif
+
+	FStreetMapRoad()
+		: FirstPoint( 0 )
+		, NumPoints( 0 )
+	{
+	}
+
+	/** Gets the points along this road */
+	inline FStreetMapPointView GetPoints( const class UStreetMap& StreetMap ) const;
+
+	/** Gets the nodes along this road, one at each point.  Points that aren't at a node have INDEX_NONE. */
+	inline TArrayView<const int32> GetNodeIndices( const class UStreetMap& StreetMap ) const;
+
+	/** Gets how far along this road each of its points is, from the road's beginning.  Always increasing, so positions
+	    along the road can be looked up with a binary search. */
+	inline TArrayView<const float> GetPointDistances( const class UStreetMap& StreetMap ) const;
+
+	/** Finds the first point after the road's beginning that is at or past a position along the road, which is the
+	    end of the segment the position is on.  INDEX_NONE if the road is shorter than that. */
+	inline int32 FindSegmentEndForPositionAlongRoad( const class UStreetMap& StreetMap, const float PositionAlongRoad ) const;
 
 	/** Returns this node's index */
 	inline int32 GetRoadIndex( const class UStreetMap& StreetMap ) const;
@@ -612,13 +914,18 @@ struct STREETMAPRUNTIME_API FStreetMapRailway
 	UPROPERTY(Category = StreetMap, EditAnywhere)
 		TEnumAsByte<EStreetMapRailwayType> Type;
 
-	/** Nodes along this railway, one at each point in the Points list */
-	UPROPERTY(Category = StreetMap, EditAnywhere)
-		TArray<int32> NodeIndices;
+	/** Where this railway's points start in the street map's pool of railway points.  Its node indices start at the same
+	    place in the pool of railway node indices. */
+	UPROPERTY(Category = StreetMap, VisibleAnywhere)
+		int32 FirstPoint;
 
-	/** List of all of the points on this railway */
-	UPROPERTY(Category = StreetMap, EditAnywhere)
-		TArray<FVector2D> Points;
+	/** Number of points on this railway, one for each node index */
+	UPROPERTY(Category = StreetMap, VisibleAnywhere)
+		int32 NumPoints;
+
+	/** Where this railway's points are measured from, if the street map stores them quantized */
+	UPROPERTY(Category = StreetMap, VisibleAnywhere)
+		FStreetMapPointAnchor Anchor;
 
 	// @todo: Performance: Bounding information could be computed at load time if we want to avoid the memory cost of storing it
 
@@ -629,6 +936,30 @@ struct STREETMAPRUNTIME_API FStreetMapRailway
 	/** 2D bounds (max) of this railway's points */
 	UPROPERTY(Category = StreetMap, EditAnywhere)
 		FVector2D BoundsMax;
+
+#if WITH_EDITORONLY_DATA
+	/** Nodes along this railway and its points while the street map is being built or changed, or loaded from before
+	    points were pooled.  See FStreetMapRoad::RoadPoints. */
+	UPROPERTY()
+		TArray<int32> NodeIndices;
+	UPROPERTY()
+		TArray<FVector2D> Points;
+
+	/** The same points in double precision.  See FStreetMapRoad::ExactPoints. */
+	TArray<FStreetMapExactPoint> ExactPoints;
+#endif
+
+	FStreetMapRailway()
+		: FirstPoint(0)
+		, NumPoints(0)
+	{
+	}
+
+	/** Gets the points along this railway */
+	inline FStreetMapPointView GetPoints(const class UStreetMap& StreetMap) const;
+
+	/** Gets the nodes along this railway, one at each point.  Points that aren't at a node have INDEX_NONE. */
+	inline TArrayView<const int32> GetNodeIndices(const class UStreetMap& StreetMap) const;
 };
 
 
@@ -643,9 +974,17 @@ struct STREETMAPRUNTIME_API FStreetMapBuilding
 	UPROPERTY( Category=StreetMap, EditAnywhere )
 	FString BuildingName;
 
-	/** Polygon points that define the perimeter of the building */
-	UPROPERTY( Category=StreetMap, EditAnywhere )
-	TArray<FVector2D> BuildingPoints;
+	/** Where the polygon that defines the perimeter of the building starts in the street map's pool of building points */
+	UPROPERTY( Category=StreetMap, VisibleAnywhere )
+	int32 FirstPoint;
+
+	/** Number of points of the building's polygon */
+	UPROPERTY( Category=StreetMap, VisibleAnywhere )
+	int32 NumPoints;
+
+	/** Where the building's points are measured from, if the street map stores them quantized */
+	UPROPERTY( Category=StreetMap, VisibleAnywhere )
+	FStreetMapPointAnchor Anchor;
 
 	/** Height of the building in meters (if known, otherwise zero) */
 	UPROPERTY( Category=StreetMap, EditAnywhere )
@@ -664,9 +1003,67 @@ struct STREETMAPRUNTIME_API FStreetMapBuilding
 	/** 2D bounds (max) of this building's points */
 	UPROPERTY( Category=StreetMap, EditAnywhere )
 	FVector2D BoundsMax;
+
+#if WITH_EDITORONLY_DATA
+	/** Points of the building while the street map is being built or changed, or loaded from before points were pooled.
+	    See FStreetMapRoad::RoadPoints. */
+	UPROPERTY()
+	TArray<FVector2D> BuildingPoints;
+
+	/** The same points in double precision.  See FStreetMapRoad::ExactPoints. */
+	TArray<FStreetMapExactPoint> ExactPoints;
+#endif
+
+	FStreetMapBuilding()
+		: FirstPoint( 0 )
+		, NumPoints( 0 )
+	{
+	}
+
+	/** Gets the polygon points that define the perimeter of the building */
+	inline FStreetMapPointView GetPoints( const class UStreetMap& StreetMap ) const;
 };
 
 
+/** A closed ring of points, such as a hole in an area */
+USTRUCT(BlueprintType)
+struct STREETMAPRUNTIME_API FStreetMapPolygonRing
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Where the points that define the ring start in the street map's pool of misc way points.  The first point isn't
+	    repeated at the end. */
+	UPROPERTY(Category = StreetMap, VisibleAnywhere)
+		int32 FirstPoint;
+
+	/** Number of points of the ring */
+	UPROPERTY(Category = StreetMap, VisibleAnywhere)
+		int32 NumPoints;
+
+	/** Where the ring's points are measured from, if the street map stores them quantized */
+	UPROPERTY(Category = StreetMap, VisibleAnywhere)
+		FStreetMapPointAnchor Anchor;
+
+#if WITH_EDITORONLY_DATA
+	/** Points of the ring while the street map is being built or changed, or loaded from before points were pooled.
+	    See FStreetMapRoad::RoadPoints. */
+	UPROPERTY()
+		TArray<FVector2D> Points;
+
+	/** The same points in double precision.  See FStreetMapRoad::ExactPoints. */
+	TArray<FStreetMapExactPoint> ExactPoints;
+#endif
+
+	FStreetMapPolygonRing()
+		: FirstPoint(0)
+		, NumPoints(0)
+	{
+	}
+
+	/** Gets the points of the ring */
+	inline FStreetMapPointView GetPoints(const class UStreetMap& StreetMap) const;
+};
+
 /** A miscellaneous way */
 USTRUCT(BlueprintType)
 struct STREETMAPRUNTIME_API FStreetMapMiscWay
@@ -681,9 +1078,17 @@ struct STREETMAPRUNTIME_API FStreetMapMiscWay
 	UPROPERTY(Category = StreetMap, EditAnywhere)
 		FString Category;
 
-	/** points that define the the way (line or polygon) */
-	UPROPERTY(Category = StreetMap, EditAnywhere)
-		TArray<FVector2D> Points;
+	/** Where the points that define the way (line or polygon) start in the street map's pool of misc way points */
+	UPROPERTY(Category = StreetMap, VisibleAnywhere)
+		int32 FirstPoint;
+
+	/** Number of points of the way */
+	UPROPERTY(Category = StreetMap, VisibleAnywhere)
+		int32 NumPoints;
+
+	/** Where the way's points are measured from, if the street map stores them quantized */
+	UPROPERTY(Category = StreetMap, VisibleAnywhere)
+		FStreetMapPointAnchor Anchor;
 
 	// @todo: Performance: Bounding information could be computed at load time if we want to avoid the memory cost of storing it
 
@@ -702,6 +1107,301 @@ struct STREETMAPRUNTIME_API FStreetMapMiscWay
 	/** Indicates whether this a closed polygon or just a line strip */
 	UPROPERTY(Category = StreetMap, EditAnywhere)
 		bool bIsClosed;
+
+	/** Where the holes cut out of the polygon start in the street map's pool of misc way holes.  Only areas that come from
+	    multipolygon relations have holes (e.g. clearings in a forest). */
+	UPROPERTY(Category = StreetMap, VisibleAnywhere)
+		int32 FirstHole;
+
+	/** Number of holes cut out of the polygon */
+	UPROPERTY(Category = StreetMap, VisibleAnywhere)
+		int32 NumHoles;
+
+#if WITH_EDITORONLY_DATA
+	/** Points and holes of the way while the street map is being built or changed, or loaded from before points were
+	    pooled.  See FStreetMapRoad::RoadPoints. */
+	UPROPERTY()
+		TArray<FVector2D> Points;
+	UPROPERTY()
+		TArray<FStreetMapPolygonRing> Holes;
+
+	/** The same points in double precision.  See FStreetMapRoad::ExactPoints. */
+	TArray<FStreetMapExactPoint> ExactPoints;
+#endif
+
+	FStreetMapMiscWay()
+		: FirstPoint(0)
+		, NumPoints(0)
+		, FirstHole(0)
+		, NumHoles(0)
+	{
+	}
+
+	/** Gets the points that define the way */
+	inline FStreetMapPointView GetPoints(const class UStreetMap& StreetMap) const;
+
+	/** Gets the holes cut out of the polygon */
+	inline TArrayView<const FStreetMapPolygonRing> GetHoles(const class UStreetMap& StreetMap) const;
+};
+
+/** Parts of a street map that are saved separately, so that cooked builds can load them one at a time */
+UENUM(BlueprintType)
+enum class EStreetMapDataCategory : uint8
+{
+	/** Roads, and the nodes that connect roads and railways */
+	Roads,
+
+	/** Railways */
+	Railways,
+
+	/** Buildings */
+	Buildings,
+
+	/** Miscellaneous ways, along with their holes */
+	MiscWays,
+
+	Count UMETA(Hidden)
+};
+
+
+/** Where a position snapped to on the road network.  See UStreetMap::SnapToRoad(). */
+USTRUCT( BlueprintType )
+struct STREETMAPRUNTIME_API FStreetMapRoadSnap
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** The road that is closest, or INDEX_NONE if no road was close enough */
+	UPROPERTY( Category=StreetMap, BlueprintReadOnly )
+	int32 RoadIndex;
+
+	/** The point of the road that starts the segment the position snapped to.  The segment ends at the next point. */
+	UPROPERTY( Category=StreetMap, BlueprintReadOnly )
+	int32 RoadPointIndex;
+
+	/** Distance along the road from its beginning, in the same terms as FStreetMapRoad::FindEarlierAndLaterNodesForPositionAlongRoad()
+	    and FStreetMapRoad::MakeLocationAlongRoad() */
+	UPROPERTY( Category=StreetMap, BlueprintReadOnly )
+	float PositionAlongRoad;
+
+	/** The closest location on the road */
+	UPROPERTY( Category=StreetMap, BlueprintReadOnly )
+	FVector2D Location;
+
+	/** How far the position was from the road */
+	UPROPERTY( Category=StreetMap, BlueprintReadOnly )
+	float Distance;
+
+	FStreetMapRoadSnap()
+		: RoadIndex( INDEX_NONE )
+		, RoadPointIndex( INDEX_NONE )
+		, PositionAlongRoad( 0.0f )
+		, Location( FVector2D::ZeroVector )
+		, Distance( 0.0f )
+	{
+	}
+
+	/** @return True if the position snapped to a road */
+	bool IsValid() const
+	{
+		return RoadIndex != INDEX_NONE;
+	}
+};
+
+/** Part of an OpenStreetMap file to import */
+UENUM()
+enum class EStreetMapImportArea : uint8
+{
+	/** Everything in the file */
+	EntireFile,
+
+	/** Only what's inside of a latitude/longitude box */
+	BoundingBox,
+
+	/** Only what's within a radius around a location */
+	Radius,
+};
+
+/** How ways are simplified when they are imported */
+UENUM()
+enum class EStreetMapSimplification : uint8
+{
+	/** Every point is kept */
+	None,
+
+	/** Douglas-Peucker: keeps the points that stray farther than the tolerance from the simplified line.  Keeps the shape of curves best. */
+	DouglasPeucker,
+
+	/** Visvalingam-Whyatt: removes the points that add the least area first, until every point left adds at least the
+	    tolerance squared.  Gives smoother results on wiggly lines, such as coast lines and forest edges. */
+	Visvalingam,
+};
+
+/** Options that control how OpenStreetMap files are imported.  Stored with the asset, so reimports use the same options. */
+USTRUCT(BlueprintType)
+struct STREETMAPRUNTIME_API FStreetMapImportSettings
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Reads the file twice: first to find out which nodes are used by ways we import, then to load only those nodes
+	    and nodes that carry tags.  The result is the same, but large extracts need a fraction of the memory. */
+	UPROPERTY(Category = Import, EditAnywhere)
+	bool bOnlyLoadReferencedNodes;
+
+	/** Splits large XML files into chunks that are parsed on all cores at once.  The result is the same as parsing the
+	    file from start to end. */
+	UPROPERTY(Category = Import, EditAnywhere)
+	bool bParseXmlInParallel;
+
+	/** Limits the import to part of the file.  Ways leaving that part are cut off where they do.  Closed ways, such as
+	    buildings and areas, are only imported when they lie entirely inside of it. */
+	UPROPERTY(Category = Import, EditAnywhere)
+	EStreetMapImportArea ImportArea;
+
+	/** Southern edge of the box to import, in degrees */
+	UPROPERTY(Category = Import, EditAnywhere)
+	double MinLatitude;
+
+	/** Western edge of the box to import, in degrees */
+	UPROPERTY(Category = Import, EditAnywhere)
+	double MinLongitude;
+
+	/** Northern edge of the box to import, in degrees */
+	UPROPERTY(Category = Import, EditAnywhere)
+	double MaxLatitude;
+
+	/** Eastern edge of the box to import, in degrees */
+	UPROPERTY(Category = Import, EditAnywhere)
+	double MaxLongitude;
+
+	/** Latitude of the center of the circle to import, in degrees */
+	UPROPERTY(Category = Import, EditAnywhere)
+	double CenterLatitude;
+
+	/** Longitude of the center of the circle to import, in degrees */
+	UPROPERTY(Category = Import, EditAnywhere)
+	double CenterLongitude;
+
+	/** Radius of the circle to import, in meters */
+	UPROPERTY(Category = Import, EditAnywhere, meta=(ClampMin = "0"))
+	float RadiusMeters;
+
+	/** Removes points that barely change the shape of ways.  Points where roads and railways end or connect to each
+	    other are always kept.  Change files can't be applied to ways that use points that were removed. */
+	UPROPERTY(Category = Simplification, EditAnywhere)
+	EStreetMapSimplification Simplification;
+
+	/** How far simplified roads may stray from the original, in centimeters */
+	UPROPERTY(Category = Simplification, EditAnywhere, meta=(ClampMin = "0"))
+	float RoadSimplificationTolerance;
+
+	/** How far simplified railways may stray from the original, in centimeters */
+	UPROPERTY(Category = Simplification, EditAnywhere, meta=(ClampMin = "0"))
+	float RailwaySimplificationTolerance;
+
+	/** How far simplified building outlines may stray from the original, in centimeters */
+	UPROPERTY(Category = Simplification, EditAnywhere, meta=(ClampMin = "0"))
+	float BuildingSimplificationTolerance;
+
+	/** How far simplified misc ways and their holes may stray from the original, in centimeters */
+	UPROPERTY(Category = Simplification, EditAnywhere, meta=(ClampMin = "0"))
+	float MiscWaySimplificationTolerance;
+
+	/** How the street map stores its points.  Quantized points take half the memory, and don't lose precision far from
+	    the origin of large maps. */
+	UPROPERTY(Category = Storage, EditAnywhere)
+	EStreetMapPointStorage PointStorage;
+
+	FStreetMapImportSettings()
+		: bOnlyLoadReferencedNodes(true)
+		, bParseXmlInParallel(true)
+		, ImportArea(EStreetMapImportArea::EntireFile)
+		, MinLatitude(-90.0)
+		, MinLongitude(-180.0)
+		, MaxLatitude(90.0)
+		, MaxLongitude(180.0)
+		, CenterLatitude(0.0)
+		, CenterLongitude(0.0)
+		, RadiusMeters(2000.0f)
+		, Simplification(EStreetMapSimplification::None)
+		, RoadSimplificationTolerance(100.0f)
+		, RailwaySimplificationTolerance(50.0f)
+		, BuildingSimplificationTolerance(25.0f)
+		, MiscWaySimplificationTolerance(200.0f)
+		, PointStorage(EStreetMapPointStorage::Float)
+	{
+	}
+};
+
+/** The OpenStreetMap way a road, railway, building or miscellaneous way was built from, and the node at each of its points */
+USTRUCT()
+struct STREETMAPRUNTIME_API FStreetMapWaySource
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** OpenStreetMap ID of the way */
+	UPROPERTY()
+	int64 WayId;
+
+	/** OpenStreetMap ID of the node at each point */
+	UPROPERTY()
+	TArray<int64> NodeIds;
+
+	FStreetMapWaySource()
+		: WayId(0)
+	{
+	}
+};
+
+/** Summary of what the last import of a street map cost.  Shown in the Content Browser's tooltips and filters, so
+    import cost can be tracked across versions of a map. */
+USTRUCT(BlueprintType)
+struct STREETMAPRUNTIME_API FStreetMapImportStats
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Seconds spent on the whole import */
+	UPROPERTY(Category = Import, VisibleAnywhere)
+	float ImportSeconds;
+
+	/** Seconds spent loading the OpenStreetMap file */
+	UPROPERTY(Category = Import, VisibleAnywhere)
+	float LoadSeconds;
+
+	/** Seconds spent turning the loaded file into roads, railways, buildings and other ways */
+	UPROPERTY(Category = Import, VisibleAnywhere)
+	float BuildSeconds;
+
+	/** Number of nodes loaded from the file */
+	UPROPERTY(Category = Import, VisibleAnywhere)
+	int64 NumOSMNodes;
+
+	/** Number of ways loaded from the file */
+	UPROPERTY(Category = Import, VisibleAnywhere)
+	int64 NumOSMWays;
+
+	/** Number of relations loaded from the file */
+	UPROPERTY(Category = Import, VisibleAnywhere)
+	int64 NumOSMRelations;
+
+	/** Highest physical memory usage of the editor we saw during the import, in megabytes */
+	UPROPERTY(Category = Import, VisibleAnywhere)
+	float PeakMemoryMB;
+
+	/** How much the peak memory usage was above the memory usage before the import, in megabytes */
+	UPROPERTY(Category = Import, VisibleAnywhere)
+	float AddedMemoryMB;
+
+	FStreetMapImportStats()
+		: ImportSeconds(0.0f)
+		, LoadSeconds(0.0f)
+		, BuildSeconds(0.0f)
+		, NumOSMNodes(0)
+		, NumOSMWays(0)
+		, NumOSMRelations(0)
+		, PeakMemoryMB(0.0f)
+		, AddedMemoryMB(0.0f)
+	{
+	}
 };
 
 /** A loaded street map */
@@ -716,7 +1416,68 @@ public:
 	UStreetMap();
 
 	// UObject overrides
+	virtual void Serialize( FArchive& Ar ) override;
 	virtual void GetAssetRegistryTags( TArray<FAssetRegistryTag>& OutTags ) const override;
+	virtual void PostLoad() override;
+
+	/** @return True if the elements of a category are in memory.  Only categories that load on demand in a cooked build can be missing. */
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+	bool IsCategoryLoaded( EStreetMapDataCategory Category ) const
+	{
+		return bIsCategoryLoaded[ (int32)Category ];
+	}
+
+	/** Loads the elements of a category that loads on demand, or does nothing if they are in memory already.  Reads
+	    from disk before it returns, so it's best called while a level is loading. */
+	UFUNCTION(BlueprintCallable, Category = "StreetMap")
+	void LoadCategory( EStreetMapDataCategory Category );
+
+	// Spatial queries.  Positions and distances are in the street map's space, in centimeters.  Elements are found by
+	// their index into GetRoads(), GetRailways(), GetBuildings() or GetMiscWays().  Categories that aren't loaded have
+	// nothing to find.
+
+	/** Finds the elements of a category whose bounds overlap a box */
+	UFUNCTION(BlueprintCallable, Category = "StreetMap|Queries")
+	void FindElementsInBox( EStreetMapDataCategory Category, FVector2D Min, FVector2D Max, TArray<int32>& OutElementIndices ) const;
+
+	/** Finds the elements of a category that come within Radius of a point.  Roads, railways and open ways count
+	    along their lines, buildings and closed ways count everything inside of them. */
+	UFUNCTION(BlueprintCallable, Category = "StreetMap|Queries")
+	void FindElementsInRadius( EStreetMapDataCategory Category, FVector2D Center, float Radius, TArray<int32>& OutElementIndices ) const;
+
+	/** Finds the element of a category closest to a point, measured the same way as FindElementsInRadius()
+	    @return The element, or INDEX_NONE if none is within MaxDistance */
+	UFUNCTION(BlueprintCallable, Category = "StreetMap|Queries")
+	int32 FindNearestElement( EStreetMapDataCategory Category, FVector2D Point, float MaxDistance, float& OutDistance ) const;
+
+	/** Finds the road of a type closest to a point
+	    @return The road, or INDEX_NONE if none of that type is within MaxDistance */
+	UFUNCTION(BlueprintCallable, Category = "StreetMap|Queries")
+	int32 FindNearestRoadOfType( FVector2D Point, TEnumAsByte<EStreetMapRoadType> RoadType, float MaxDistance, float& OutDistance ) const;
+
+	/** Finds the building that a point is inside of
+	    @return The building, or INDEX_NONE if the point isn't inside of any */
+	UFUNCTION(BlueprintCallable, Category = "StreetMap|Queries")
+	int32 FindBuildingAtPoint( FVector2D Point ) const;
+
+	/** Finds the closest location on any road, along with where on the road it is
+	    @return True if a road was within MaxDistance */
+	UFUNCTION(BlueprintCallable, Category = "StreetMap|Queries")
+	bool SnapToRoad( FVector2D Position, float MaxDistance, FStreetMapRoadSnap& OutSnap ) const;
+
+	/** Snaps many positions to roads at once, spread over worker threads.  OutSnaps gets one entry per position, in the
+	    same order.  Positions that aren't within MaxDistance of any road get an entry that isn't valid. */
+	UFUNCTION(BlueprintCallable, Category = "StreetMap|Queries")
+	void SnapToRoads( const TArray<FVector2D>& Positions, float MaxDistance, TArray<FStreetMapRoadSnap>& OutSnaps ) const;
+
+	/** @return The squared distance from a point to an element, measured the same way as FindElementsInRadius() */
+	float ComputeDistanceSquaredToElement( const EStreetMapDataCategory Category, const int32 ElementIndex, const FVector2D& Point ) const;
+
+	/** Gets the spatial index over the bounds of the elements of a category.  Items of the index are element indices. */
+	const FStreetMapSpatialIndex& GetSpatialIndex( const EStreetMapDataCategory Category ) const
+	{
+		return SpatialIndices[ (int32)Category ];
+	}
 	
 	/** Gets the roads in this street map (read only) */
 	const TArray<FStreetMapRoad>& GetRoads() const
@@ -779,6 +1540,160 @@ public:
 		return MiscWays;
 	}
 
+	/** Gets the points of all roads, back to back.  FStreetMapRoad::GetPoints() gets the points of one road. */
+	const TArray<FVector2D>& GetRoadPoints() const
+	{
+		return RoadPoints;
+	}
+
+	/** Gets the node at each point of all roads, back to back */
+	const TArray<int32>& GetRoadNodeIndices() const
+	{
+		return RoadNodeIndices;
+	}
+
+	/** Gets how far along its road each point of all roads is, back to back */
+	const TArray<float>& GetRoadPointDistances() const
+	{
+		return RoadPointDistances;
+	}
+
+	/** Gets the points of all railways, back to back */
+	const TArray<FVector2D>& GetRailwayPoints() const
+	{
+		return RailwayPoints;
+	}
+
+	/** Gets the node at each point of all railways, back to back */
+	const TArray<int32>& GetRailwayNodeIndices() const
+	{
+		return RailwayNodeIndices;
+	}
+
+	/** Gets the points of all buildings, back to back */
+	const TArray<FVector2D>& GetBuildingPoints() const
+	{
+		return BuildingPoints;
+	}
+
+	/** Gets the points of all miscellaneous ways and their holes, back to back */
+	const TArray<FVector2D>& GetMiscWayPoints() const
+	{
+		return MiscWayPoints;
+	}
+
+	/** Gets the holes of all miscellaneous ways, back to back */
+	const TArray<FStreetMapPolygonRing>& GetMiscWayHoles() const
+	{
+		return MiscWayHoles;
+	}
+
+	/** Gets how the points of all elements are stored.  Only the pools of that kind have points in them. */
+	EStreetMapPointStorage GetPointStorage() const
+	{
+		return PointStorage;
+	}
+
+	/** Gets the quantized points of all roads, back to back */
+	const TArray<FStreetMapQuantizedPoint>& GetRoadQuantizedPoints() const
+	{
+		return RoadQuantizedPoints;
+	}
+
+	/** Gets the quantized points of all railways, back to back */
+	const TArray<FStreetMapQuantizedPoint>& GetRailwayQuantizedPoints() const
+	{
+		return RailwayQuantizedPoints;
+	}
+
+	/** Gets the quantized points of all buildings, back to back */
+	const TArray<FStreetMapQuantizedPoint>& GetBuildingQuantizedPoints() const
+	{
+		return BuildingQuantizedPoints;
+	}
+
+	/** Gets the quantized points of all miscellaneous ways and their holes, back to back */
+	const TArray<FStreetMapQuantizedPoint>& GetMiscWayQuantizedPoints() const
+	{
+		return MiscWayQuantizedPoints;
+	}
+
+	/** Gets the runs of quantized points of all roads that need more than one.  See FStreetMapPointAnchor::FirstRun. */
+	const TArray<FStreetMapPointRun>& GetRoadPointRuns() const
+	{
+		return RoadPointRuns;
+	}
+
+	/** Gets the runs of quantized points of all railways that need more than one */
+	const TArray<FStreetMapPointRun>& GetRailwayPointRuns() const
+	{
+		return RailwayPointRuns;
+	}
+
+	/** Gets the runs of quantized points of all buildings that need more than one */
+	const TArray<FStreetMapPointRun>& GetBuildingPointRuns() const
+	{
+		return BuildingPointRuns;
+	}
+
+	/** Gets the runs of quantized points of all miscellaneous ways and holes that need more than one */
+	const TArray<FStreetMapPointRun>& GetMiscWayPointRuns() const
+	{
+		return MiscWayPointRuns;
+	}
+
+#if WITH_EDITOR
+	/** Moves the points of every element into the pools, one array per kind of element.  Elements must have their own points. */
+	void PackGeometry();
+
+	/** Gives every element its own arrays of points again, so that elements can be added, removed or changed one by one */
+	void UnpackGeometry();
+
+	// Changing a packed street map one element at a time, as when a change file is applied.  Only the elements that
+	// change are touched, along with the spatial indices and nodes that refer to them.
+
+	/** Gives one element its own arrays of points again, leaving the pools as they are.  RepackElements() puts it back. */
+	void UnpackElement( const EStreetMapDataCategory Category, const int32 ElementIndex );
+
+	/**
+	 * Moves the points of elements that have their own arrays of points, either unpacked or just added, to the end of
+	 * the pools, and updates the spatial indices to match.  The points they had in the pools before are left unused,
+	 * until so many are that the whole category is packed again.
+	 */
+	void RepackElements( const EStreetMapDataCategory Category, const TArray<int32>& ElementIndices );
+
+	/** Removes an element along with its source, and moves the last element of the category into its place.  Nodes no
+	    longer refer to the removed element, and refer to the moved one where it is now.  Needs the source indices. */
+	void RemoveElement( const EStreetMapDataCategory Category, const int32 ElementIndex );
+
+	/** Builds the indices that find elements and nodes by the OpenStreetMap ways and nodes they were built from */
+	void BuildSourceIndices();
+
+	/** Builds the source indices again where most of what they hold is stale */
+	void UpdateStaleSourceIndices();
+
+	/** @return True if the source indices were built.  Street maps saved before there were any don't have them. */
+	bool HasSourceIndices() const
+	{
+		return bHasSourceIndices;
+	}
+
+	/** Calls Visit once for every element of a category that was built from an OpenStreetMap way */
+	void ForEachWayElement( const EStreetMapDataCategory Category, const int64 WayId, TFunctionRef<void( int32 ElementIndex )> Visit ) const;
+
+	/** Calls Visit once for every point of the elements of a category that is at an OpenStreetMap node */
+	void ForEachNodePoint( const EStreetMapDataCategory Category, const int64 NodeId, TFunctionRef<void( int32 ElementIndex, int32 PointIndex )> Visit ) const;
+
+	/** @return The node that was built from an OpenStreetMap node, or INDEX_NONE if it wasn't kept */
+	int32 FindNodeBySource( const int64 NodeId ) const;
+
+	/** Adds an element to the source indices, once it was added or moved and has its source */
+	void AddElementToSourceIndices( const EStreetMapDataCategory Category, const int32 ElementIndex );
+
+	/** Adds a node to the source indices, once it was added or moved and has its source */
+	void AddNodeToSourceIndices( const int32 NodeIndex );
+#endif
+
 
 	/** Gets the bounding box of the map */
 	FVector2D GetBoundsMin() const
@@ -821,6 +1736,72 @@ protected:
 	UPROPERTY(Category = StreetMap, VisibleAnywhere)
 	TArray<FStreetMapMiscWay> MiscWays;
 
+	// Geometry of all elements lives in one pool per kind of element, instead of in small arrays on every element.
+	// That is one allocation per pool instead of hundreds of thousands, and iterating a pool walks memory in order.
+
+	/** Points of all roads, back to back */
+	UPROPERTY()
+	TArray<FVector2D> RoadPoints;
+
+	/** Node at each point in RoadPoints, or INDEX_NONE */
+	UPROPERTY()
+	TArray<int32> RoadNodeIndices;
+
+	/** Points of all railways, back to back */
+	UPROPERTY()
+	TArray<FVector2D> RailwayPoints;
+
+	/** Node at each point in RailwayPoints, or INDEX_NONE */
+	UPROPERTY()
+	TArray<int32> RailwayNodeIndices;
+
+	/** Points of all buildings, back to back */
+	UPROPERTY()
+	TArray<FVector2D> BuildingPoints;
+
+	/** Points of all misc ways, each followed by the points of its holes */
+	UPROPERTY()
+	TArray<FVector2D> MiscWayPoints;
+
+	/** Holes of all misc ways, back to back */
+	UPROPERTY()
+	TArray<FStreetMapPolygonRing> MiscWayHoles;
+
+	/** Whether the points are in the float pools above, or in the quantized pools below */
+	UPROPERTY( Category=StreetMap, VisibleAnywhere )
+	EStreetMapPointStorage PointStorage;
+
+	// Quantized points are only ever saved by Serialize(), so they aren't properties
+
+	/** Quantized points of all roads, back to back.  Same layout as RoadPoints. */
+	TArray<FStreetMapQuantizedPoint> RoadQuantizedPoints;
+
+	/** Quantized points of all railways, back to back */
+	TArray<FStreetMapQuantizedPoint> RailwayQuantizedPoints;
+
+	/** Quantized points of all buildings, back to back */
+	TArray<FStreetMapQuantizedPoint> BuildingQuantizedPoints;
+
+	/** Quantized points of all misc ways, each followed by the points of its holes */
+	TArray<FStreetMapQuantizedPoint> MiscWayQuantizedPoints;
+
+	/** Runs of quantized road points after the first run of every road, for roads that need more than one */
+	TArray<FStreetMapPointRun> RoadPointRuns;
+
+	/** Runs of quantized railway points, like RoadPointRuns */
+	TArray<FStreetMapPointRun> RailwayPointRuns;
+
+	/** Runs of quantized building points, like RoadPointRuns */
+	TArray<FStreetMapPointRun> BuildingPointRuns;
+
+	/** Runs of quantized misc way and hole points, like RoadPointRuns */
+	TArray<FStreetMapPointRun> MiscWayPointRuns;
+
+	/** Categories of elements that cooked builds leave on disk until LoadCategory() is called.  The editor always
+	    loads everything. */
+	UPROPERTY( Category=Loading, EditAnywhere )
+	TArray<EStreetMapDataCategory> OnDemandCategories;
+
 	/** 2D bounds (min) of this map's roads and buildings */
 	UPROPERTY( Category=StreetMap, VisibleAnywhere)
 	FVector2D BoundsMin;
@@ -841,14 +1822,247 @@ protected:
 	UPROPERTY( VisibleAnywhere, Instanced, Category=ImportSettings )
 	class UAssetImportData* AssetImportData;
 
+	/** Options used when importing this street map.  Changes are applied the next time the asset is reimported. */
+	UPROPERTY( EditAnywhere, Category=ImportSettings )
+	FStreetMapImportSettings ImportSettings;
+
+	/** What the last import of this street map cost */
+	UPROPERTY( VisibleAnywhere, Category=ImportSettings )
+	FStreetMapImportStats ImportStats;
+
+	/** OpenStreetMap change files (.osc) that were applied since the street map was last imported from its source file, oldest first */
+	UPROPERTY( VisibleAnywhere, Category=ImportSettings )
+	TArray<FString> AppliedChangeFiles;
+
+	/** Where each road, railway, building and misc way came from, so that change files can be applied to them.  One entry per element. */
+	UPROPERTY()
+	TArray<FStreetMapWaySource> RoadSources;
+	UPROPERTY()
+	TArray<FStreetMapWaySource> RailwaySources;
+	UPROPERTY()
+	TArray<FStreetMapWaySource> BuildingSources;
+	UPROPERTY()
+	TArray<FStreetMapWaySource> MiscWaySources;
+
+	/** OpenStreetMap ID of each node */
+	UPROPERTY()
+	TArray<int64> NodeSources;
+
+	/** Elements of each category by the OpenStreetMap way they were built from, and points of the elements of each
+	    category by the OpenStreetMap node they are at.  Built from the sources above, and saved along with them. */
+	FStreetMapSourceIndex WaySourceIndices[ (int32)EStreetMapDataCategory::Count ];
+	FStreetMapSourceIndex NodePointSourceIndices[ (int32)EStreetMapDataCategory::Count ];
+
+	/** Nodes by the OpenStreetMap node they were built from */
+	FStreetMapSourceIndex NodeSourceIndex;
+
+	/** Whether the source indices were built */
+	bool bHasSourceIndices;
+
 	friend class UStreetMapFactory;
 	friend class UStreetMapReimportFactory;
 	friend class FStreetMapAssetTypeActions;
 #endif	// WITH_EDITORONLY_DATA
 
+private:
+
+	/** Reads or writes the elements and geometry of a category, without any property tags */
+	void SerializeCategory( FArchive& Ar, const EStreetMapDataCategory Category );
+
+	/** Trades the arrays that Serialize() writes itself for the ones in Other */
+	void SwapSerializedArrays( struct FStreetMapSerializedArrays& Other );
+
+	/** Saved elements of each category, while the category waits to be loaded on demand.  Only cooked builds use these. */
+	FByteBulkData CategoryBulkData[ (int32)EStreetMapDataCategory::Count ];
+
+	/** Whether each category's elements are in memory */
+	bool bIsCategoryLoaded[ (int32)EStreetMapDataCategory::Count ];
+
+	/** Builds the spatial index of a category over the bounds of its elements */
+	void BuildSpatialIndex( const EStreetMapDataCategory Category );
+
+	/** Builds the spatial index of a loaded category if it doesn't match its elements, as in street maps saved before
+	    there were spatial indices */
+	void UpdateStaleSpatialIndex( const EStreetMapDataCategory Category );
+
+	/** Spatial index of each category.  Saved along with the elements of the category by SerializeCategory(). */
+	FStreetMapSpatialIndex SpatialIndices[ (int32)EStreetMapDataCategory::Count ];
+
+	/** Number of points in the pools of each category that no element uses anymore, since elements were changed one by
+	    one.  Saved along with the elements of the category. */
+	int32 NumUnusedPoints[ (int32)EStreetMapDataCategory::Count ];
+
+	/** Adds up the lengths of the segments of every road into RoadPointDistances */
+	void ComputeRoadPointDistances();
+
+	/** Adds up the lengths of the segments of one road into RoadPointDistances */
+	void ComputeRoadPointDistances( const int32 RoadIndex );
+
+	/** Distance of every road point from the beginning of its road.  Same layout as RoadPoints.  Worked out whenever
+	    the roads are loaded or packed, so it's never saved. */
+	TArray<float> RoadPointDistances;
+
+	/** Spatial index over the segments between the points of all roads, for snapping.  Items index into RoadSegments.
+	    Saved along with the roads. */
+	FStreetMapSpatialIndex RoadSegmentIndex;
+
+	/** The road and the point it starts at, for every segment in RoadSegmentIndex.  Segments of roads that were
+	    changed or removed since the index was built have a road index of INDEX_NONE. */
+	TArray<FStreetMapRoadRef> RoadSegments;
+
+#if WITH_EDITORONLY_DATA
+	/** Where in RoadSegments the segments of every road start, or INDEX_NONE for roads without any.  Worked out
+	    whenever the roads are loaded or their segments are indexed, so it's never saved. */
+	TArray<int32> RoadFirstSegments;
+#endif
+
+#if WITH_EDITOR
+	/** Moves the points of every element of a category into its pools, and builds its spatial index */
+	void PackCategory( const EStreetMapDataCategory Category );
+
+	/** Gives every element of a category its own arrays of points again, and empties its pools */
+	void UnpackCategory( const EStreetMapDataCategory Category );
+
+	/** Adds the points of an element that has its own arrays of points to the end of the pools */
+	void PackElement( const EStreetMapDataCategory Category, const int32 ElementIndex );
+
+	/** @return The number of elements of a category */
+	int32 GetNumElements( const EStreetMapDataCategory Category ) const;
+
+	/** @return The bounds of an element */
+	FBox2D GetElementBox( const EStreetMapDataCategory Category, const int32 ElementIndex ) const;
+
+	/** @return The number of points in the pools of a category, used or not */
+	int32 GetNumPooledPoints( const EStreetMapDataCategory Category ) const;
+
+	/** @return The number of points in the pools of a category that belong to an element, including those of its holes */
+	int32 GetNumPooledPoints( const EStreetMapDataCategory Category, const int32 ElementIndex ) const;
+
+	/** Works out RoadFirstSegments from RoadSegments */
+	void FindRoadFirstSegments();
+
+	/** Adds the segments of a packed road to RoadSegments and RoadSegmentIndex */
+	void AddRoadSegments( const int32 RoadIndex );
+
+	/** Takes the segments of a road out of RoadSegmentIndex */
+	void RemoveRoadSegments( const int32 RoadIndex );
+
+	/** Makes nodes that refer to one road or railway refer to another one instead, or to none if NewElementIndex is INDEX_NONE.  Only the nodes at the given OpenStreetMap nodes are looked at. */
+	void RenameNodeRefs( const EStreetMapDataCategory Category, const TArray<int64>& NodeIds, const int32 ElementIndex, const int32 NewElementIndex );
+
+	/** Gets the sources of the elements of a category */
+	TArray<FStreetMapWaySource>& GetWaySources( const EStreetMapDataCategory Category );
+	const TArray<FStreetMapWaySource>& GetWaySources( const EStreetMapDataCategory Category ) const;
+
+	/** Builds the source indices of the elements of a category */
+	void BuildWaySourceIndices( const EStreetMapDataCategory Category );
+
+	/** Builds the source index of the nodes */
+	void BuildNodeSourceIndex();
+#endif
 };
 
 
+inline FStreetMapPointView FStreetMapRoad::GetPoints( const UStreetMap& StreetMap ) const
+{
+	if( StreetMap.GetPointStorage() == EStreetMapPointStorage::Quantized )
+	{
+		return FStreetMapPointView( StreetMap.GetRoadQuantizedPoints().GetData() + FirstPoint, NumPoints, Anchor, StreetMap.GetRoadPointRuns() );
+	}
+	return FStreetMapPointView( StreetMap.GetRoadPoints().GetData() + FirstPoint, NumPoints );
+}
+
+
+inline TArrayView<const int32> FStreetMapRoad::GetNodeIndices( const UStreetMap& StreetMap ) const
+{
+	return TArrayView<const int32>( StreetMap.GetRoadNodeIndices().GetData() + FirstPoint, NumPoints );
+}
+
+
+inline TArrayView<const float> FStreetMapRoad::GetPointDistances( const UStreetMap& StreetMap ) const
+{
+	return TArrayView<const float>( StreetMap.GetRoadPointDistances().GetData() + FirstPoint, NumPoints );
+}
+
+
+inline int32 FStreetMapRoad::FindSegmentEndForPositionAlongRoad( const UStreetMap& StreetMap, const float PositionAlongRoad ) const
+{
+	const TArrayView<const float> PointDistances = GetPointDistances( StreetMap );
+	if( NumPoints < 2 || PointDistances[ NumPoints - 1 ] < PositionAlongRoad )
+	{
+		return INDEX_NONE;
+	}
+
+	int32 Low = 1;
+	int32 High = NumPoints - 1;
+	while( Low < High )
+	{
+		const int32 Middle = ( Low + High ) / 2;
+		if( PointDistances[ Middle ] >= PositionAlongRoad )
+		{
+			High = Middle;
+		}
+		else
+		{
+			Low = Middle + 1;
+		}
+	}
+	return Low;
+}
+
+
+inline FStreetMapPointView FStreetMapRailway::GetPoints( const UStreetMap& StreetMap ) const
+{
+	if( StreetMap.GetPointStorage() == EStreetMapPointStorage::Quantized )
+	{
+		return FStreetMapPointView( StreetMap.GetRailwayQuantizedPoints().GetData() + FirstPoint, NumPoints, Anchor, StreetMap.GetRailwayPointRuns() );
+	}
+	return FStreetMapPointView( StreetMap.GetRailwayPoints().GetData() + FirstPoint, NumPoints );
+}
+
+
+inline TArrayView<const int32> FStreetMapRailway::GetNodeIndices( const UStreetMap& StreetMap ) const
+{
+	return TArrayView<const int32>( StreetMap.GetRailwayNodeIndices().GetData() + FirstPoint, NumPoints );
+}
+
+
+inline FStreetMapPointView FStreetMapBuilding::GetPoints( const UStreetMap& StreetMap ) const
+{
+	if( StreetMap.GetPointStorage() == EStreetMapPointStorage::Quantized )
+	{
+		return FStreetMapPointView( StreetMap.GetBuildingQuantizedPoints().GetData() + FirstPoint, NumPoints, Anchor, StreetMap.GetBuildingPointRuns() );
+	}
+	return FStreetMapPointView( StreetMap.GetBuildingPoints().GetData() + FirstPoint, NumPoints );
+}
+
+
+inline FStreetMapPointView FStreetMapPolygonRing::GetPoints( const UStreetMap& StreetMap ) const
+{
+	if( StreetMap.GetPointStorage() == EStreetMapPointStorage::Quantized )
+	{
+		return FStreetMapPointView( StreetMap.GetMiscWayQuantizedPoints().GetData() + FirstPoint, NumPoints, Anchor, StreetMap.GetMiscWayPointRuns() );
+	}
+	return FStreetMapPointView( StreetMap.GetMiscWayPoints().GetData() + FirstPoint, NumPoints );
+}
+
+
+inline FStreetMapPointView FStreetMapMiscWay::GetPoints( const UStreetMap& StreetMap ) const
+{
+	if( StreetMap.GetPointStorage() == EStreetMapPointStorage::Quantized )
+	{
+		return FStreetMapPointView( StreetMap.GetMiscWayQuantizedPoints().GetData() + FirstPoint, NumPoints, Anchor, StreetMap.GetMiscWayPointRuns() );
+	}
+	return FStreetMapPointView( StreetMap.GetMiscWayPoints().GetData() + FirstPoint, NumPoints );
+}
+
+
+inline TArrayView<const FStreetMapPolygonRing> FStreetMapMiscWay::GetHoles( const UStreetMap& StreetMap ) const
+{
+	return TArrayView<const FStreetMapPolygonRing>( StreetMap.GetMiscWayHoles().GetData() + FirstHole, NumHoles );
+}
+
+
 inline int32 FStreetMapRoad::GetRoadIndex( const UStreetMap& StreetMap ) const
 {
 	// Pointer arithmetic based on array start
@@ -859,12 +2073,14 @@ inline int32 FStreetMapRoad::GetRoadIndex( const UStreetMap& StreetMap ) const
 
 inline const FStreetMapNode& FStreetMapRoad::GetNodeAtPointIndexOrEarlier( const UStreetMap& StreetMap, const int32 PointIndex, int32& OutNodeAtPointIndex ) const
 {
+	const TArrayView<const int32> PointNodeIndices = GetNodeIndices( StreetMap );
+
 	const FStreetMapNode* CurrentOrEarlierPointNode = nullptr;
 	for( int32 NodePointIndex = PointIndex; NodePointIndex >= 0; --NodePointIndex )
 	{
-		if( NodeIndices[ NodePointIndex ] != INDEX_NONE )
+		if( PointNodeIndices[ NodePointIndex ] != INDEX_NONE )
 		{
-			CurrentOrEarlierPointNode = &StreetMap.GetNodes()[ NodeIndices[ NodePointIndex ] ];
+			CurrentOrEarlierPointNode = &StreetMap.GetNodes()[ PointNodeIndices[ NodePointIndex ] ];
 			OutNodeAtPointIndex = NodePointIndex;
 			break;
 		}
@@ -875,12 +2091,14 @@ inline const FStreetMapNode& FStreetMapRoad::GetNodeAtPointIndexOrEarlier( const
 
 inline const FStreetMapNode& FStreetMapRoad::GetNodeAtPointIndexOrLater( const UStreetMap& StreetMap, const int32 PointIndex, int32& OutNodeAtPointIndex ) const
 {
+	const TArrayView<const int32> PointNodeIndices = GetNodeIndices( StreetMap );
+
 	const FStreetMapNode* NextOrUpcomingNode = nullptr;
-	for( int32 NodePointIndex = PointIndex; NodePointIndex < RoadPoints.Num(); ++NodePointIndex )
+	for( int32 NodePointIndex = PointIndex; NodePointIndex < NumPoints; ++NodePointIndex )
 	{
-		if( NodeIndices[ NodePointIndex ] != INDEX_NONE )
+		if( PointNodeIndices[ NodePointIndex ] != INDEX_NONE )
 		{
-			NextOrUpcomingNode = &StreetMap.GetNodes()[ NodeIndices[ NodePointIndex ] ];
+			NextOrUpcomingNode = &StreetMap.GetNodes()[ PointNodeIndices[ NodePointIndex ] ];
 			OutNodeAtPointIndex = NodePointIndex;
 			break;
 		}
@@ -892,79 +2110,59 @@ inline const FStreetMapNode& FStreetMapRoad::GetNodeAtPointIndexOrLater( const U
 
 inline float FStreetMapRoad::ComputeLengthOfRoad( const class UStreetMap& StreetMap ) const
 {
-	// @todo: Performance: We could cache the road's total length at load time to avoid having to compute it,
-	//        or we could save it right into the asset file
-
-	return ComputeDistanceBetweenNodesOnRoad( StreetMap, 0, this->NodeIndices.Num() - 1 );
+	return NumPoints > 0 ? GetPointDistances( StreetMap )[ NumPoints - 1 ] : 0.0f;
 }
 
 
 inline float FStreetMapRoad::ComputeDistanceBetweenNodesOnRoad( const class UStreetMap& StreetMap, const int32 NodePointIndexA, const int32 NodePointIndexB ) const
 {
-	float TotalDistanceSoFar = 0.0f;
-
 	// NOTE: It is very important that we use the actual road point indices here and not nodes directly, because the same node can appear
 	// more than once on a single road!
 
-	// @todo: Performance: We can cache distances between connected nodes rather than computing them every time.  This
-	//        can be computed at load time or at import time (and stored in the asset).  Most of the other functions
-	//        in this class that perform Size() computations could be changed to use cached distances also!
-
 	const int32 SmallerPointIndex = FMath::Max( 0, FMath::Min( NodePointIndexA, NodePointIndexB ) );
-	const int32 LargerPointIndex = FMath::Min( RoadPoints.Num() - 1, FMath::Max( NodePointIndexA, NodePointIndexB ) );
-
-	for( int32 PointIndex = SmallerPointIndex; PointIndex < LargerPointIndex; ++PointIndex )
+	const int32 LargerPointIndex = FMath::Min( NumPoints - 1, FMath::Max( NodePointIndexA, NodePointIndexB ) );
+	if( LargerPointIndex <= SmallerPointIndex )
 	{
-		const FVector2D PointLocation = RoadPoints[ PointIndex ];
-		const FVector2D NextPointLocation = RoadPoints[ PointIndex + 1 ];
-
-		const float DistanceBetweenPoints = ( NextPointLocation - PointLocation ).Size();
-			
-		TotalDistanceSoFar += DistanceBetweenPoints;
+		return 0.0f;
 	}
-	
-	// @todo: Malformed data can cause this assertion to trigger.  This could be a single road with at least two adjacent nodes
-	//        at the exact same location.  We need to filter this out at load time probably.
-	// check( TotalDistanceSoFar > 0.0f );
 
-	return TotalDistanceSoFar;
+	// @todo: Malformed data can make this zero.  This could be a single road with at least two adjacent nodes
+	//        at the exact same location.  We need to filter this out at load time probably.
+	const TArrayView<const float> PointDistances = GetPointDistances( StreetMap );
+	return PointDistances[ LargerPointIndex ] - PointDistances[ SmallerPointIndex ];
 }
 
 
 inline void FStreetMapRoad::FindEarlierAndLaterNodesForPositionAlongRoad( const class UStreetMap& StreetMap, const float PositionAlongRoad, const FStreetMapNode*& OutEarlierNode, float& OutEarlierNodePositionAlongRoad, const FStreetMapNode*& OutLaterNode, float& OutLaterNodePositionAlongRoad ) const
 {
-	float CurrentPointPositionAlongRoad = 0.0f;
+	const TArrayView<const int32> PointNodeIndices = GetNodeIndices( StreetMap );
+	const TArrayView<const float> PointDistances = GetPointDistances( StreetMap );
 
 	const FStreetMapNode* EarlierStreetMapNode = nullptr;
 	const FStreetMapNode* LaterStreetMapNode = nullptr;
 
-	const int32 NumPoints = RoadPoints.Num();
-	for( int32 CurrentPointIndex = 0; CurrentPointIndex < NumPoints - 1; ++CurrentPointIndex )
+	// The later node is the first one at or past the position, not counting the road's first point.  The earlier node
+	// is the last one before that.
+	const int32 SegmentEndPointIndex = FindSegmentEndForPositionAlongRoad( StreetMap, PositionAlongRoad );
+	int32 LaterPointIndex = SegmentEndPointIndex != INDEX_NONE ? SegmentEndPointIndex : NumPoints;
+	while( LaterPointIndex < NumPoints && PointNodeIndices[ LaterPointIndex ] == INDEX_NONE )
 	{
-		if( this->NodeIndices[ CurrentPointIndex ] != INDEX_NONE )
-		{
-			EarlierStreetMapNode = &StreetMap.GetNodes()[ this->NodeIndices[ CurrentPointIndex ] ];
-			OutEarlierNodePositionAlongRoad = CurrentPointPositionAlongRoad;
-		}
-
-		const int32 NextPointIndex = CurrentPointIndex + 1;
-		const FVector2D CurrentPointLocation = RoadPoints[ CurrentPointIndex ];
-		const FVector2D NextPointLocation = RoadPoints[ NextPointIndex ];
-
-		const float DistanceBetweenPoints = ( NextPointLocation - CurrentPointLocation ).Size();
-		const float NextPointPositionAlongRoad = CurrentPointPositionAlongRoad + DistanceBetweenPoints;
+		++LaterPointIndex;
+	}
+	if( LaterPointIndex < NumPoints )
+	{
+		LaterStreetMapNode = &StreetMap.GetNodes()[ PointNodeIndices[ LaterPointIndex ] ];
+		OutLaterNodePositionAlongRoad = PointDistances[ LaterPointIndex ];
+	}
 
-		if( NextPointPositionAlongRoad >= PositionAlongRoad )
+	for( int32 EarlierPointIndex = FMath::Min( LaterPointIndex, NumPoints - 1 ) - 1; EarlierPointIndex >= 0; --EarlierPointIndex )
+	{
+		if( PointNodeIndices[ EarlierPointIndex ] != INDEX_NONE )
 		{
-			if( NodeIndices[ NextPointIndex ] != INDEX_NONE )
-			{
-				LaterStreetMapNode = &StreetMap.GetNodes()[ this->NodeIndices[ NextPointIndex ] ];
-				OutLaterNodePositionAlongRoad = NextPointPositionAlongRoad;
-				break;
-			}
+			EarlierStreetMapNode = &StreetMap.GetNodes()[ PointNodeIndices[ EarlierPointIndex ] ];
+			OutEarlierNodePositionAlongRoad = PointDistances[ EarlierPointIndex ];
+			break;
 		}
-			
-		CurrentPointPositionAlongRoad = NextPointPositionAlongRoad;
 	}
 
 	check( EarlierStreetMapNode != nullptr && LaterStreetMapNode != nullptr );
@@ -975,6 +2173,8 @@ inline void FStreetMapRoad::FindEarlierAndLaterNodesForPositionAlongRoad( const
 
 inline void FStreetMapRoad::FindEarlierAndLaterNodes( const class UStreetMap& StreetMap, const int32 RoadPointIndex, const FStreetMapNode*& OutEarlierNode, float& OutEarlierNodePositionAlongRoad, const FStreetMapNode*& OutLaterNode, float& OutLaterNodePositionAlongRoad ) const
 {
+	const TArrayView<const int32> PointNodeIndices = GetNodeIndices( StreetMap );
+
 	OutEarlierNode = nullptr;
 	OutEarlierNodePositionAlongRoad = -1.0f;
 	OutLaterNode = nullptr;
@@ -982,19 +2182,19 @@ inline void FStreetMapRoad::FindEarlierAndLaterNodes( const class UStreetMap& St
 
 	for( int32 EarlierPointIndex = RoadPointIndex - 1; EarlierPointIndex >= 0; --EarlierPointIndex )
 	{
-		if( this->NodeIndices[ EarlierPointIndex ] != INDEX_NONE )
+		if( PointNodeIndices[ EarlierPointIndex ] != INDEX_NONE )
 		{
-			OutEarlierNode = &StreetMap.GetNodes()[ this->NodeIndices[ EarlierPointIndex ] ];
+			OutEarlierNode = &StreetMap.GetNodes()[ PointNodeIndices[ EarlierPointIndex ] ];
 			OutEarlierNodePositionAlongRoad = FindPositionAlongRoadForNode( StreetMap, EarlierPointIndex );
 			break;
 		}
 	}
 
-	for( int32 LaterPointIndex = RoadPointIndex + 1; LaterPointIndex < this->RoadPoints.Num(); ++LaterPointIndex )
+	for( int32 LaterPointIndex = RoadPointIndex + 1; LaterPointIndex < NumPoints; ++LaterPointIndex )
 	{
-		if( this->NodeIndices[ LaterPointIndex ] != INDEX_NONE )
+		if( PointNodeIndices[ LaterPointIndex ] != INDEX_NONE )
 		{
-			OutLaterNode = &StreetMap.GetNodes()[ this->NodeIndices[ LaterPointIndex ] ];
+			OutLaterNode = &StreetMap.GetNodes()[ PointNodeIndices[ LaterPointIndex ] ];
 			OutLaterNodePositionAlongRoad = FindPositionAlongRoadForNode( StreetMap, LaterPointIndex );
 			break;
 		}
@@ -1004,54 +2204,21 @@ inline void FStreetMapRoad::FindEarlierAndLaterNodes( const class UStreetMap& St
 
 inline float FStreetMapRoad::FindPositionAlongRoadForNode( const class UStreetMap& StreetMap, const int32 PointIndexForNode ) const
 {
-	float CurrentPointPositionAlongRoad = 0.0f;
-
-	bool bFoundLocation = false;
-	const int32 NumPoints = RoadPoints.Num();
-	for( int32 CurrentPointIndex = 0; CurrentPointIndex < PointIndexForNode; ++CurrentPointIndex )
-	{
-		const FVector2D CurrentPointLocation = RoadPoints[ CurrentPointIndex ];
-		const FVector2D NextPointLocation = RoadPoints[ CurrentPointIndex + 1 ];
-
-		const float DistanceBetweenPoints = ( NextPointLocation - CurrentPointLocation ).Size();
-		const float NextPointPositionAlongRoad = CurrentPointPositionAlongRoad + DistanceBetweenPoints;
-
-		CurrentPointPositionAlongRoad = NextPointPositionAlongRoad;
-	}
-
-	return CurrentPointPositionAlongRoad;
+	return PointIndexForNode > 0 ? GetPointDistances( StreetMap )[ PointIndexForNode ] : 0.0f;
 }
 
 
 inline FVector2D FStreetMapRoad::MakeLocationAlongRoad( const class UStreetMap& StreetMap, const float PositionAlongRoad ) const
 {
-	FVector2D LocationAlongRoad = FVector2D::ZeroVector;
-	float CurrentPointPositionAlongRoad = 0.0f;
-
-	bool bFoundLocation = false;
-	const int32 NumPoints = RoadPoints.Num();
-	for( int32 CurrentPointIndex = 0; CurrentPointIndex < NumPoints - 1; ++CurrentPointIndex )
-	{
-		const FVector2D CurrentPointLocation = RoadPoints[ CurrentPointIndex ];
-		const FVector2D NextPointLocation = RoadPoints[ CurrentPointIndex + 1 ];
-
-		const float DistanceBetweenPoints = ( NextPointLocation - CurrentPointLocation ).Size();
-		const float NextPointPositionAlongRoad = CurrentPointPositionAlongRoad + DistanceBetweenPoints;
-
-		if( NextPointPositionAlongRoad >= PositionAlongRoad )
-		{
-			const float LerpAlpha = ( PositionAlongRoad - CurrentPointPositionAlongRoad ) / DistanceBetweenPoints;
-			LocationAlongRoad = FMath::Lerp( CurrentPointLocation, NextPointLocation, LerpAlpha );
-			bFoundLocation = true;
-			break;
-		}
-			
-		CurrentPointPositionAlongRoad = NextPointPositionAlongRoad;
-	}
-
-	check( bFoundLocation == true );
-
-	return LocationAlongRoad;
+	const int32 SegmentEndPointIndex = FindSegmentEndForPositionAlongRoad( StreetMap, PositionAlongRoad );
+	check( SegmentEndPointIndex != INDEX_NONE );
+
+	const FStreetMapPointView Points = GetPoints( StreetMap );
+	const TArrayView<const float> PointDistances = GetPointDistances( StreetMap );
+	const float SegmentStartPositionAlongRoad = PointDistances[ SegmentEndPointIndex - 1 ];
+	const float DistanceBetweenPoints = PointDistances[ SegmentEndPointIndex ] - SegmentStartPositionAlongRoad;
+	const float LerpAlpha = DistanceBetweenPoints > 0.0f ? ( PositionAlongRoad - SegmentStartPositionAlongRoad ) / DistanceBetweenPoints : 0.0f;
+	return FMath::Lerp( Points[ SegmentEndPointIndex - 1 ], Points[ SegmentEndPointIndex ], LerpAlpha );
 }
 
 
@@ -1072,7 +2239,7 @@ inline bool FStreetMapNode::IsDeadEnd( const UStreetMap& StreetMap ) const
 
 		const FStreetMapRoadRef& SoleRoadRef = RoadRefs[ 0 ];
 		const FStreetMapRoad& SoleRoad = StreetMap.GetRoads()[ SoleRoadRef.RoadIndex ];
-		if( SoleRoadRef.RoadPointIndex == 0 || SoleRoadRef.RoadPointIndex == ( SoleRoad.NodeIndices.Num() - 1 ) )
+		if( SoleRoadRef.RoadPointIndex == 0 || SoleRoadRef.RoadPointIndex == ( SoleRoad.NumPoints - 1 ) )
 		{
 			// The node is attached to only one road, and the node is at the very end of one of the ends of the road
 			return true;
@@ -1140,7 +2307,7 @@ inline int32 FStreetMapNode::GetConnectionCount( const UStreetMap& StreetMap, co
 			++TotalConnections;
 		}
 
-		if( RoadRef.RoadPointIndex < ( Road.NodeIndices.Num() - 1 ) && ( bIsTravelingForward || !Road.IsOneWay() ) )
+		if( RoadRef.RoadPointIndex < ( Road.NumPoints - 1 ) && ( bIsTravelingForward || !Road.IsOneWay() ) )
 		{
 			// We connect to a node further down this road
 			++TotalConnections;
@@ -1167,8 +2334,9 @@ inline const FStreetMapNode* FStreetMapNode::GetConnection( const UStreetMap& St
 	for( const FStreetMapRoadRef& RoadRef : RoadRefs )
 	{
 		const FStreetMapRoad& Road = StreetMap.GetRoads()[ RoadRef.RoadIndex ];
+		const TArrayView<const int32> RoadNodeIndices = Road.GetNodeIndices( StreetMap );
 		
-		// @todo: Performance: We could avoid the "while" loops below by not storing INDEX_NONEs in the NodeIndices array,
+		// @todo: Performance: We could avoid the "while" loops below by not storing INDEX_NONEs in the node indices,
 		//        but instead mapping them to points by going through the node itself, then back to a road
 
 		if( RoadRef.RoadPointIndex > 0 && ( !bIsTravelingForward || !Road.IsOneWay() ) )
@@ -1177,11 +2345,11 @@ inline const FStreetMapNode* FStreetMapNode::GetConnection( const UStreetMap& St
 			if( CurrentConnectionIndex == ConnectionIndex )
 			{
 				int32 EarlierNodeRoadPointIndex = RoadRef.RoadPointIndex - 1;
-				while( Road.NodeIndices[ EarlierNodeRoadPointIndex ] == INDEX_NONE )
+				while( RoadNodeIndices[ EarlierNodeRoadPointIndex ] == INDEX_NONE )
 				{
 					--EarlierNodeRoadPointIndex;
 				}
-				const int32 EarlierNodeIndex = Road.NodeIndices[ EarlierNodeRoadPointIndex ];
+				const int32 EarlierNodeIndex = RoadNodeIndices[ EarlierNodeRoadPointIndex ];
 
 				const FStreetMapNode& EarlierNode = StreetMap.GetNodes()[ EarlierNodeIndex ];
 				ConnectedNode = &EarlierNode;
@@ -1205,17 +2373,17 @@ inline const FStreetMapNode* FStreetMapNode::GetConnection( const UStreetMap& St
 			++CurrentConnectionIndex;
 		}
 
-		if( RoadRef.RoadPointIndex < ( Road.NodeIndices.Num() - 1 ) && ( bIsTravelingForward || !Road.IsOneWay() ) )
+		if( RoadRef.RoadPointIndex < ( Road.NumPoints - 1 ) && ( bIsTravelingForward || !Road.IsOneWay() ) )
 		{
 			// We connect to node further down this road
 			if( CurrentConnectionIndex == ConnectionIndex )
 			{
 				int32 LaterNodeRoadPointIndex = RoadRef.RoadPointIndex + 1;
-				while( Road.NodeIndices[ LaterNodeRoadPointIndex ] == INDEX_NONE )
+				while( RoadNodeIndices[ LaterNodeRoadPointIndex ] == INDEX_NONE )
 				{
 					++LaterNodeRoadPointIndex;
 				}
-				const int32 LaterNodeIndex = Road.NodeIndices[ LaterNodeRoadPointIndex ];
+				const int32 LaterNodeIndex = RoadNodeIndices[ LaterNodeRoadPointIndex ];
 
 				const FStreetMapNode& LaterNode = StreetMap.GetNodes()[ LaterNodeIndex ];
 				ConnectedNode = &LaterNode;
@@ -0,0 +1,72 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/Function.h"
+
+
+/** Where an OpenStreetMap way or node ended up in a street map */
+struct FStreetMapSourceRef
+{
+	/** OpenStreetMap ID of the way or node */
+	int64 Id;
+
+	/** Index of the element or node it ended up as */
+	int32 Element;
+
+	/** Index of the point of the element it ended up at, or INDEX_NONE */
+	int32 Point;
+
+	friend FArchive& operator<<( FArchive& Ar, FStreetMapSourceRef& Ref )
+	{
+		return Ar << Ref.Id << Ref.Element << Ref.Point;
+	}
+};
+
+
+/**
+ * Finds where OpenStreetMap ways or nodes ended up in a street map, by their IDs, so that changes to them can be applied
+ * without looking at every element.  Most references are in one array sorted by ID, and references added since it was
+ * sorted are looked up through a map next to it.
+ *
+ * References are never removed.  Elements that are added or moved have their references added again, and whoever asks
+ * has to ignore references that don't match the street map's sources anymore.  Once there are enough of those to slow
+ * lookups down, IsWorthRebuilding() says so.
+ */
+class STREETMAPRUNTIME_API FStreetMapSourceIndex
+{
+
+public:
+
+	/** Builds the index from all references, replacing what was there before.  Takes the references. */
+	void Build( TArray<FStreetMapSourceRef>& Refs );
+
+	/** Adds a reference, after an element or node was added or moved */
+	void Add( const int64 Id, const int32 Element, const int32 Point );
+
+	/** Forgets all references */
+	void Empty();
+
+	/** @return True if so many references were added since the index was built that building it again would speed up lookups */
+	bool IsWorthRebuilding() const
+	{
+		return AddedRefs.Num() > FMath::Max( SortedRefs.Num() / 4, 1024 );
+	}
+
+	/** Calls Visit for every reference with the given ID, which may include the same one more than once, and stale ones */
+	void ForEach( const int64 Id, TFunctionRef<void( int32 Element, int32 Point )> Visit ) const;
+
+	friend STREETMAPRUNTIME_API FArchive& operator<<( FArchive& Ar, FStreetMapSourceIndex& SourceIndex );
+
+private:
+
+	/** References from when the index was built, sorted by ID */
+	TArray<FStreetMapSourceRef> SortedRefs;
+
+	/** References added since, in the order they were added */
+	TArray<FStreetMapSourceRef> AddedRefs;
+
+	/** Where the references with each ID are in AddedRefs.  Never saved. */
+	TMultiMap<int64, int32> AddedRefsById;
+};
@@ -0,0 +1,131 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/Function.h"
+
+
+/**
+ * Finds the elements of a street map by where they are.  A packed R-tree over the bounds of the elements: items are
+ * sorted along a Hilbert curve and grouped into nodes of NodeSize, level after level up to a single root.  The whole
+ * tree is a few flat arrays, which makes it cheap to save and load.
+ *
+ * Items can be changed after the tree was built.  Removed items leave their leaf behind, which queries skip, and added
+ * items are kept in a short list next to the tree that queries check one by one.  Once enough has changed that queries
+ * would slow down, IsWorthRebuilding() says so.
+ */
+class STREETMAPRUNTIME_API FStreetMapSpatialIndex
+{
+
+public:
+
+	/** Children per node */
+	static const int32 NodeSize = 16;
+
+	/** Default constructor, for an empty tree */
+	FStreetMapSpatialIndex()
+		: NumItems( 0 )
+		, NumRemovedLeaves( 0 )
+	{
+	}
+
+	/** Builds the tree over the bounds of every item, replacing what was there before */
+	void Build( const TArray<FBox2D>& ItemBounds );
+
+	/** Forgets all items */
+	void Empty();
+
+	/** @return The number of items in the tree */
+	int32 Num() const
+	{
+		return NumItems - NumRemovedLeaves + ExtraItems.Num();
+	}
+
+	/** Adds an item, or changes the bounds of one that is there already */
+	void UpdateItem( const int32 Item, const FBox2D& Bounds );
+
+	/** Removes an item, if it is there */
+	void RemoveItem( const int32 Item );
+
+	/** Gives an item another number, which no item may have yet */
+	void RenameItem( const int32 Item, const int32 NewItem );
+
+	/** @return True if so many items were added or removed since the tree was built that building it again would speed up queries */
+	bool IsWorthRebuilding() const
+	{
+		return NumRemovedLeaves + ExtraItems.Num() > FMath::Max( NumItems / 4, NodeSize );
+	}
+
+	/** Calls Visit for every item whose bounds overlap the box, in no particular order */
+	void ForEachInBox( const FVector2D& Min, const FVector2D& Max, TFunctionRef<void( int32 Item )> Visit ) const;
+
+	/**
+	 * Finds the item closest to a point.  Items are visited from the closest bounds outward, and visiting stops once
+	 * no bounds left are closer than the best item so far.
+	 *
+	 * @param	Point						Where to search from
+	 * @param	MaxDistanceSquared			Items farther away than this are never found
+	 * @param	GetItemDistanceSquared		Squared distance from the point to an item.  Items to skip return TNumericLimits<float>::Max().
+	 * @param	OutDistanceSquared			Squared distance to the item that was found
+	 *
+	 * @return	The closest item, or INDEX_NONE if there is none within the maximum distance
+	 */
+	int32 FindNearest( const FVector2D& Point, const float MaxDistanceSquared, TFunctionRef<float( int32 Item )> GetItemDistanceSquared, float& OutDistanceSquared ) const;
+
+	friend STREETMAPRUNTIME_API FArchive& operator<<( FArchive& Ar, FStreetMapSpatialIndex& SpatialIndex );
+
+private:
+
+	struct FNodeBox
+	{
+		FVector2D Min;
+		FVector2D Max;
+
+		bool Intersects( const FVector2D& OtherMin, const FVector2D& OtherMax ) const
+		{
+			return Min.X <= OtherMax.X && Max.X >= OtherMin.X && Min.Y <= OtherMax.Y && Max.Y >= OtherMin.Y;
+		}
+
+		float ComputeDistanceSquared( const FVector2D& Point ) const
+		{
+			const float DX = FMath::Max3( Min.X - Point.X, 0.0f, Point.X - Max.X );
+			const float DY = FMath::Max3( Min.Y - Point.Y, 0.0f, Point.Y - Max.Y );
+			return DX * DX + DY * DY;
+		}
+
+		friend FArchive& operator<<( FArchive& Ar, FNodeBox& Box )
+		{
+			return Ar << Box.Min << Box.Max;
+		}
+	};
+
+	/** @return The index into Boxes just past the last node of the level that the node at Position is on */
+	int32 GetLevelEnd( const int32 Position ) const;
+
+	/** Works out where every item is, if that isn't known yet.  Only changing the tree needs to know. */
+	void FindItemPositions();
+
+	/** Number of leaves of the tree, including the ones of removed items */
+	int32 NumItems;
+
+	/** Number of leaves whose item was removed */
+	int32 NumRemovedLeaves;
+
+	/** Bounds of every node, leaves first, then one level after another up to the root, which is last */
+	TArray<FNodeBox> Boxes;
+
+	/** For leaves, the item, or INDEX_NONE if it was removed.  For nodes above them, where in Boxes their first child is. */
+	TArray<int32> Indices;
+
+	/** Index into Boxes just past the last node of each level, leaves first */
+	TArray<int32> LevelEnds;
+
+	/** Items added since the tree was built, and their bounds */
+	TArray<int32> ExtraItems;
+	TArray<FNodeBox> ExtraBoxes;
+
+	/** Where each item is: the index of its leaf in Boxes, Boxes.Num() plus its index in ExtraItems, or INDEX_NONE.
+	    Never saved, and empty until the tree is first changed. */
+	TArray<int32> ItemPositions;
+};
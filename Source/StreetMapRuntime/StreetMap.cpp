@@ -2,20 +2,722 @@
 
 #include "StreetMapRuntime.h"
 #include "StreetMap.h"
+#include "StreetMapCustomVersion.h"
 #include "EditorFramework/AssetImportData.h"
+#include "Serialization/BufferReader.h"
+#include "Serialization/CustomVersion.h"
+#include "Serialization/MemoryWriter.h"
+#include "Async/ParallelFor.h"
+
+
+const FGuid FStreetMapCustomVersion::GUID( 0x944D8C89, 0xE8B34E12, 0xAD711610, 0x70A5B476 );
+
+static FCustomVersionRegistration GRegisterStreetMapCustomVersion( FStreetMapCustomVersion::GUID, FStreetMapCustomVersion::LatestVersion, TEXT( "StreetMapVer" ) );
+
+
+/** The arrays that UStreetMap::Serialize() writes itself.  They're traded for empty ones while the tagged properties are written. */
+struct FStreetMapSerializedArrays
+{
+	TArray<FStreetMapRoad> Roads;
+	TArray<FStreetMapNode> Nodes;
+	TArray<FStreetMapBuilding> Buildings;
+	TArray<FStreetMapRailway> Railways;
+	TArray<FStreetMapMiscWay> MiscWays;
+	TArray<FVector2D> RoadPoints;
+	TArray<int32> RoadNodeIndices;
+	TArray<FVector2D> RailwayPoints;
+	TArray<int32> RailwayNodeIndices;
+	TArray<FVector2D> BuildingPoints;
+	TArray<FVector2D> MiscWayPoints;
+	TArray<FStreetMapPolygonRing> MiscWayHoles;
+	TArray<FStreetMapQuantizedPoint> RoadQuantizedPoints;
+	TArray<FStreetMapQuantizedPoint> RailwayQuantizedPoints;
+	TArray<FStreetMapQuantizedPoint> BuildingQuantizedPoints;
+	TArray<FStreetMapQuantizedPoint> MiscWayQuantizedPoints;
+	TArray<FStreetMapPointRun> RoadPointRuns;
+	TArray<FStreetMapPointRun> RailwayPointRuns;
+	TArray<FStreetMapPointRun> BuildingPointRuns;
+	TArray<FStreetMapPointRun> MiscWayPointRuns;
+};
+
+
+// Elements are written field by field, without property tags.  Editor-only fields only hold points while a street map
+// is being built, and are left out.
+
+static FArchive& operator<<( FArchive& Ar, FStreetMapRoadRef& RoadRef )
+{
+	return Ar << RoadRef.RoadIndex << RoadRef.RoadPointIndex;
+}
+
+
+static FArchive& operator<<( FArchive& Ar, FStreetMapRailwayRef& RailwayRef )
+{
+	return Ar << RailwayRef.RailwayIndex << RailwayRef.RailwayPointIndex;
+}
+
+
+static FArchive& operator<<( FArchive& Ar, FStreetMapTag& Tag )
+{
+	// Names go out as strings, since not every archive we write to knows how to store an FName
+	FString Key = Tag.Key.ToString();
+	FString Value = Tag.Value.ToString();
+	Ar << Key << Value;
+	if( Ar.IsLoading() )
+	{
+		Tag.Key = FName( *Key );
+		Tag.Value = FName( *Value );
+	}
+	return Ar;
+}
+
+
+static FArchive& operator<<( FArchive& Ar, FStreetMapNode& Node )
+{
+	return Ar << Node.RoadRefs << Node.RailwayRefs << Node.Tags << Node.Location;
+}
+
+
+static FArchive& operator<<( FArchive& Ar, FStreetMapPointAnchor& Anchor )
+{
+	// Anchors were added along with quantized points.  Older street maps have their points as floats.
+	if( Ar.CustomVer( FStreetMapCustomVersion::GUID ) >= FStreetMapCustomVersion::QuantizedPoints )
+	{
+		Ar << Anchor.Cell << Anchor.StepShift;
+	}
+	if( Ar.CustomVer( FStreetMapCustomVersion::GUID ) >= FStreetMapCustomVersion::PointRuns )
+	{
+		Ar << Anchor.FirstRun << Anchor.NumRuns;
+	}
+	return Ar;
+}
+
+
+static FArchive& operator<<( FArchive& Ar, FStreetMapRoad& Road )
+{
+	Ar << Road.RoadName << Road.RoadType << Road.FirstPoint << Road.NumPoints << Road.Anchor << Road.BoundsMin << Road.BoundsMax;
+
+	bool bIsOneWay = Road.bIsOneWay;
+	Ar << bIsOneWay;
+	Road.bIsOneWay = bIsOneWay;
+	return Ar;
+}
+
+
+static FArchive& operator<<( FArchive& Ar, FStreetMapRailway& Railway )
+{
+	return Ar << Railway.Name << Railway.Type << Railway.FirstPoint << Railway.NumPoints << Railway.Anchor << Railway.BoundsMin << Railway.BoundsMax;
+}
+
+
+static FArchive& operator<<( FArchive& Ar, FStreetMapBuilding& Building )
+{
+	return Ar << Building.BuildingName << Building.FirstPoint << Building.NumPoints << Building.Anchor << Building.Height << Building.BuildingLevels << Building.BoundsMin << Building.BoundsMax;
+}
+
+
+static FArchive& operator<<( FArchive& Ar, FStreetMapPolygonRing& Ring )
+{
+	return Ar << Ring.FirstPoint << Ring.NumPoints << Ring.Anchor;
+}
+
+
+static FArchive& operator<<( FArchive& Ar, FStreetMapMiscWay& MiscWay )
+{
+	return Ar << MiscWay.Name << MiscWay.Category << MiscWay.FirstPoint << MiscWay.NumPoints << MiscWay.Anchor << MiscWay.BoundsMin << MiscWay.BoundsMax << MiscWay.Type << MiscWay.bIsClosed << MiscWay.FirstHole << MiscWay.NumHoles;
+}
 
 
 UStreetMap::UStreetMap()
+	: PointStorage( EStreetMapPointStorage::Float )
 {
 #if WITH_EDITORONLY_DATA
 	if( !HasAnyFlags( RF_ClassDefaultObject ) )
 	{
 		AssetImportData = NewObject<UAssetImportData>( this, TEXT( "AssetImportData" ) );
 	}
+	bHasSourceIndices = false;
+#endif
+
+	for( bool& bIsLoaded : bIsCategoryLoaded )
+	{
+		bIsLoaded = true;
+	}
+	for( int32& NumUnused : NumUnusedPoints )
+	{
+		NumUnused = 0;
+	}
+}
+
+
+void UStreetMap::Serialize( FArchive& Ar )
+{
+	Ar.UsingCustomVersion( FStreetMapCustomVersion::GUID );
+
+	if( Ar.IsSaving() )
+	{
+		// Tagged serialization skips arrays that are empty, so it gets to see a street map without any elements.  We
+		// write those below.
+		FStreetMapSerializedArrays SerializedArrays;
+		SwapSerializedArrays( SerializedArrays );
+		Super::Serialize( Ar );
+		SwapSerializedArrays( SerializedArrays );
+	}
+	else
+	{
+		Super::Serialize( Ar );
+	}
+
+	// Street maps saved before there was a version kept everything in tagged properties, which we just read
+	if( ( !Ar.IsLoading() && !Ar.IsSaving() ) || Ar.CustomVer( FStreetMapCustomVersion::GUID ) < FStreetMapCustomVersion::SerializedCategories )
+	{
+		return;
+	}
+
+	// Cooked street maps keep every category in bulk data outside of the export, so that it's only read when it's needed
+	bool bCategoriesInBulkData = Ar.IsCooking();
+	Ar << bCategoriesInBulkData;
+
+	for( int32 CategoryIndex = 0; CategoryIndex < (int32)EStreetMapDataCategory::Count; ++CategoryIndex )
+	{
+		const EStreetMapDataCategory Category = (EStreetMapDataCategory)CategoryIndex;
+		if( !bCategoriesInBulkData )
+		{
+			SerializeCategory( Ar, Category );
+			bIsCategoryLoaded[ CategoryIndex ] = true;
+			continue;
+		}
+
+		FByteBulkData& BulkData = CategoryBulkData[ CategoryIndex ];
+		if( Ar.IsSaving() )
+		{
+			LoadCategory( Category );
+
+			TArray<uint8> Payload;
+			FMemoryWriter Writer( Payload, /* bIsPersistent */ true );
+			Writer.UsingCustomVersion( FStreetMapCustomVersion::GUID );
+			int32 Version = FStreetMapCustomVersion::LatestVersion;
+			Writer << Version;
+			SerializeCategory( Writer, Category );
+
+			// The linker writes the payload out after the exports, so it has to stay around until the next save
+			BulkData.Lock( LOCK_READ_WRITE );
+			FMemory::Memcpy( BulkData.Realloc( Payload.Num() ), Payload.GetData(), Payload.Num() );
+			BulkData.Unlock();
+			BulkData.SetBulkDataFlags( BULKDATA_Force_NOT_InlinePayload );
+		}
+
+		BulkData.Serialize( Ar, this, CategoryIndex );
+
+		if( Ar.IsLoading() )
+		{
+			// PostLoad() reads the categories that aren't loaded on demand
+			bIsCategoryLoaded[ CategoryIndex ] = false;
+		}
+	}
+
+#if WITH_EDITORONLY_DATA
+	// Only the editor applies change files, so cooked street maps leave the source indices out
+	if( !Ar.IsFilterEditorOnly() && Ar.CustomVer( FStreetMapCustomVersion::GUID ) >= FStreetMapCustomVersion::IncrementalChanges )
+	{
+		Ar << bHasSourceIndices;
+		for( int32 CategoryIndex = 0; CategoryIndex < (int32)EStreetMapDataCategory::Count; ++CategoryIndex )
+		{
+			Ar << WaySourceIndices[ CategoryIndex ];
+			Ar << NodePointSourceIndices[ CategoryIndex ];
+		}
+		Ar << NodeSourceIndex;
+	}
 #endif
 }
 
 
+void UStreetMap::SerializeCategory( FArchive& Ar, const EStreetMapDataCategory Category )
+{
+	const bool bHasQuantizedPoints = Ar.CustomVer( FStreetMapCustomVersion::GUID ) >= FStreetMapCustomVersion::QuantizedPoints;
+	const bool bHasPointRuns = Ar.CustomVer( FStreetMapCustomVersion::GUID ) >= FStreetMapCustomVersion::PointRuns;
+
+	// Pools are plain old data, and are read with a single copy.  Only one of the float and quantized pools of a
+	// category has anything in it.
+	switch( Category )
+	{
+		case EStreetMapDataCategory::Roads:
+			Ar << Roads;
+			Ar << Nodes;
+			RoadPoints.BulkSerialize( Ar );
+			RoadNodeIndices.BulkSerialize( Ar );
+			if( bHasQuantizedPoints )
+			{
+				RoadQuantizedPoints.BulkSerialize( Ar );
+			}
+			if( bHasPointRuns )
+			{
+				RoadPointRuns.BulkSerialize( Ar );
+			}
+			break;
+
+		case EStreetMapDataCategory::Railways:
+			Ar << Railways;
+			RailwayPoints.BulkSerialize( Ar );
+			RailwayNodeIndices.BulkSerialize( Ar );
+			if( bHasQuantizedPoints )
+			{
+				RailwayQuantizedPoints.BulkSerialize( Ar );
+			}
+			if( bHasPointRuns )
+			{
+				RailwayPointRuns.BulkSerialize( Ar );
+			}
+			break;
+
+		case EStreetMapDataCategory::Buildings:
+			Ar << Buildings;
+			BuildingPoints.BulkSerialize( Ar );
+			if( bHasQuantizedPoints )
+			{
+				BuildingQuantizedPoints.BulkSerialize( Ar );
+			}
+			if( bHasPointRuns )
+			{
+				BuildingPointRuns.BulkSerialize( Ar );
+			}
+			break;
+
+		case EStreetMapDataCategory::MiscWays:
+			Ar << MiscWays;
+			Ar << MiscWayHoles;
+			MiscWayPoints.BulkSerialize( Ar );
+			if( bHasQuantizedPoints )
+			{
+				MiscWayQuantizedPoints.BulkSerialize( Ar );
+			}
+			if( bHasPointRuns )
+			{
+				MiscWayPointRuns.BulkSerialize( Ar );
+			}
+			break;
+
+		default:
+			check( 0 );
+			break;
+	}
+
+	// Street maps saved before elements could be changed one by one use every point in their pools
+	if( Ar.CustomVer( FStreetMapCustomVersion::GUID ) >= FStreetMapCustomVersion::IncrementalChanges )
+	{
+		Ar << NumUnusedPoints[ (int32)Category ];
+	}
+	else if( Ar.IsLoading() )
+	{
+		NumUnusedPoints[ (int32)Category ] = 0;
+	}
+
+	// Street maps saved before there were spatial indices have them built once they're loaded
+	if( Ar.CustomVer( FStreetMapCustomVersion::GUID ) >= FStreetMapCustomVersion::SpatialIndex )
+	{
+		Ar << SpatialIndices[ (int32)Category ];
+	}
+	if( Category == EStreetMapDataCategory::Roads && Ar.CustomVer( FStreetMapCustomVersion::GUID ) >= FStreetMapCustomVersion::RoadSegmentIndex )
+	{
+		Ar << RoadSegmentIndex;
+		RoadSegments.BulkSerialize( Ar );
+	}
+}
+
+
+void UStreetMap::SwapSerializedArrays( FStreetMapSerializedArrays& Other )
+{
+	Swap( Roads, Other.Roads );
+	Swap( Nodes, Other.Nodes );
+	Swap( Buildings, Other.Buildings );
+	Swap( Railways, Other.Railways );
+	Swap( MiscWays, Other.MiscWays );
+	Swap( RoadPoints, Other.RoadPoints );
+	Swap( RoadNodeIndices, Other.RoadNodeIndices );
+	Swap( RailwayPoints, Other.RailwayPoints );
+	Swap( RailwayNodeIndices, Other.RailwayNodeIndices );
+	Swap( BuildingPoints, Other.BuildingPoints );
+	Swap( MiscWayPoints, Other.MiscWayPoints );
+	Swap( MiscWayHoles, Other.MiscWayHoles );
+	Swap( RoadQuantizedPoints, Other.RoadQuantizedPoints );
+	Swap( RoadPointRuns, Other.RoadPointRuns );
+	Swap( RailwayQuantizedPoints, Other.RailwayQuantizedPoints );
+	Swap( RailwayPointRuns, Other.RailwayPointRuns );
+	Swap( BuildingQuantizedPoints, Other.BuildingQuantizedPoints );
+	Swap( BuildingPointRuns, Other.BuildingPointRuns );
+	Swap( MiscWayQuantizedPoints, Other.MiscWayQuantizedPoints );
+	Swap( MiscWayPointRuns, Other.MiscWayPointRuns );
+}
+
+
+void UStreetMap::LoadCategory( const EStreetMapDataCategory Category )
+{
+	const int32 CategoryIndex = (int32)Category;
+	if( bIsCategoryLoaded[ CategoryIndex ] )
+	{
+		return;
+	}
+
+	// Locking reads the payload from disk if it isn't in memory yet
+	FByteBulkData& BulkData = CategoryBulkData[ CategoryIndex ];
+	const int32 PayloadSize = BulkData.GetBulkDataSize();
+	{
+		FBufferReader Reader( BulkData.Lock( LOCK_READ_ONLY ), PayloadSize, /* bFreeOnClose */ false, /* bIsPersistent */ true );
+		int32 Version = 0;
+		Reader << Version;
+		Reader.SetCustomVersion( FStreetMapCustomVersion::GUID, Version, TEXT( "StreetMapVer" ) );
+		SerializeCategory( Reader, Category );
+	}
+	BulkData.Unlock();
+	BulkData.RemoveBulkData();
+
+	bIsCategoryLoaded[ CategoryIndex ] = true;
+	UpdateStaleSpatialIndex( Category );
+	if( Category == EStreetMapDataCategory::Roads )
+	{
+		ComputeRoadPointDistances();
+#if WITH_EDITOR
+		FindRoadFirstSegments();
+#endif
+	}
+}
+
+
+void UStreetMap::ComputeRoadPointDistances()
+{
+	RoadPointDistances.SetNumUninitialized( RoadNodeIndices.Num() );
+	for( int32 RoadIndex = 0; RoadIndex < Roads.Num(); ++RoadIndex )
+	{
+		ComputeRoadPointDistances( RoadIndex );
+	}
+}
+
+
+void UStreetMap::ComputeRoadPointDistances( const int32 RoadIndex )
+{
+	const FStreetMapRoad& Road = Roads[ RoadIndex ];
+	const FStreetMapPointView Points = Road.GetPoints( *this );
+	float PositionAlongRoad = 0.0f;
+	for( int32 PointIndex = 0; PointIndex < Points.Num(); ++PointIndex )
+	{
+		if( PointIndex > 0 )
+		{
+			PositionAlongRoad += ( Points[ PointIndex ] - Points[ PointIndex - 1 ] ).Size();
+		}
+		RoadPointDistances[ Road.FirstPoint + PointIndex ] = PositionAlongRoad;
+	}
+}
+
+
+/** Adds the bounds of every element to OutBounds */
+template<typename ElementType>
+static void GetElementBounds( const TArray<ElementType>& Elements, TArray<FBox2D>& OutBounds )
+{
+	OutBounds.Reserve( OutBounds.Num() + Elements.Num() );
+	for( const ElementType& Element : Elements )
+	{
+		OutBounds.Add( FBox2D( Element.BoundsMin, Element.BoundsMax ) );
+	}
+}
+
+
+void UStreetMap::BuildSpatialIndex( const EStreetMapDataCategory Category )
+{
+	TArray<FBox2D> ItemBounds;
+	switch( Category )
+	{
+		case EStreetMapDataCategory::Roads: GetElementBounds( Roads, ItemBounds ); break;
+		case EStreetMapDataCategory::Railways: GetElementBounds( Railways, ItemBounds ); break;
+		case EStreetMapDataCategory::Buildings: GetElementBounds( Buildings, ItemBounds ); break;
+		case EStreetMapDataCategory::MiscWays: GetElementBounds( MiscWays, ItemBounds ); break;
+		default: check( 0 ); break;
+	}
+
+	SpatialIndices[ (int32)Category ].Build( ItemBounds );
+
+	if( Category == EStreetMapDataCategory::Roads )
+	{
+		// Snapping looks for the closest segment, so roads get a second index with every segment in it
+		RoadSegments.Reset();
+		ItemBounds.Reset();
+		for( int32 RoadIndex = 0; RoadIndex < Roads.Num(); ++RoadIndex )
+		{
+			const FStreetMapPointView Points = Roads[ RoadIndex ].GetPoints( *this );
+			for( int32 PointIndex = 0; PointIndex < Points.Num() - 1; ++PointIndex )
+			{
+				FStreetMapRoadRef& RoadSegment = RoadSegments[ RoadSegments.AddUninitialized() ];
+				RoadSegment.RoadIndex = RoadIndex;
+				RoadSegment.RoadPointIndex = PointIndex;
+
+				const FVector2D Start = Points[ PointIndex ];
+				const FVector2D End = Points[ PointIndex + 1 ];
+				ItemBounds.Add( FBox2D( Start.ComponentMin( End ), Start.ComponentMax( End ) ) );
+			}
+		}
+		RoadSegmentIndex.Build( ItemBounds );
+#if WITH_EDITOR
+		FindRoadFirstSegments();
+#endif
+	}
+}
+
+
+void UStreetMap::UpdateStaleSpatialIndex( const EStreetMapDataCategory Category )
+{
+	if( !bIsCategoryLoaded[ (int32)Category ] )
+	{
+		return;
+	}
+
+	int32 NumElements = 0;
+	bool bIsSegmentIndexStale = false;
+	switch( Category )
+	{
+		case EStreetMapDataCategory::Roads:
+		{
+			NumElements = Roads.Num();
+			int32 NumSegments = 0;
+			for( const FStreetMapRoad& Road : Roads )
+			{
+				NumSegments += FMath::Max( Road.NumPoints - 1, 0 );
+			}
+			bIsSegmentIndexStale = RoadSegmentIndex.Num() != NumSegments || RoadSegments.Num() < NumSegments;
+			break;
+		}
+		case EStreetMapDataCategory::Railways: NumElements = Railways.Num(); break;
+		case EStreetMapDataCategory::Buildings: NumElements = Buildings.Num(); break;
+		case EStreetMapDataCategory::MiscWays: NumElements = MiscWays.Num(); break;
+		default: check( 0 ); break;
+	}
+
+	if( SpatialIndices[ (int32)Category ].Num() != NumElements || bIsSegmentIndexStale )
+	{
+		BuildSpatialIndex( Category );
+	}
+}
+
+
+/** @return The point of the segment from Start to End that is closest to Point */
+static FVector2D FindClosestPointOnSegment( const FVector2D& Point, const FVector2D& Start, const FVector2D& End )
+{
+	const FVector2D Segment = End - Start;
+	const float LengthSquared = Segment.SizeSquared();
+	const float Alpha = LengthSquared > SMALL_NUMBER ? FMath::Clamp( ( ( Point - Start ) | Segment ) / LengthSquared, 0.0f, 1.0f ) : 0.0f;
+	return Start + Segment * Alpha;
+}
+
+
+/** @return Squared distance from a point to the closest of the lines between the points, including the one from the last point back to the first if the line is closed */
+static float ComputeDistanceSquaredToLine( const FStreetMapPointView& Points, const FVector2D& Point, const bool bIsClosed )
+{
+	const int32 NumPoints = Points.Num();
+	if( NumPoints == 0 )
+	{
+		return TNumericLimits<float>::Max();
+	}
+
+	float MinDistanceSquared = FVector2D::DistSquared( Point, Points[ 0 ] );
+	FVector2D Start = bIsClosed ? Points[ NumPoints - 1 ] : Points[ 0 ];
+	for( int32 PointIndex = bIsClosed ? 0 : 1; PointIndex < NumPoints; ++PointIndex )
+	{
+		const FVector2D End = Points[ PointIndex ];
+		MinDistanceSquared = FMath::Min( MinDistanceSquared, FVector2D::DistSquared( Point, FindClosestPointOnSegment( Point, Start, End ) ) );
+		Start = End;
+	}
+	return MinDistanceSquared;
+}
+
+
+/** @return True if a point is inside of the ring that the points go around */
+static bool IsPointInsideRing( const FStreetMapPointView& Points, const FVector2D& Point )
+{
+	const int32 NumPoints = Points.Num();
+	if( NumPoints < 3 )
+	{
+		return false;
+	}
+
+	// Count how many edges a ray going right from the point crosses
+	bool bIsInside = false;
+	FVector2D Previous = Points[ NumPoints - 1 ];
+	for( int32 PointIndex = 0; PointIndex < NumPoints; ++PointIndex )
+	{
+		const FVector2D Current = Points[ PointIndex ];
+		if( ( Current.Y > Point.Y ) != ( Previous.Y > Point.Y ) &&
+			Point.X < ( Previous.X - Current.X ) * ( Point.Y - Current.Y ) / ( Previous.Y - Current.Y ) + Current.X )
+		{
+			bIsInside = !bIsInside;
+		}
+		Previous = Current;
+	}
+	return bIsInside;
+}
+
+
+float UStreetMap::ComputeDistanceSquaredToElement( const EStreetMapDataCategory Category, const int32 ElementIndex, const FVector2D& Point ) const
+{
+	switch( Category )
+	{
+		case EStreetMapDataCategory::Roads:
+			return ComputeDistanceSquaredToLine( Roads[ ElementIndex ].GetPoints( *this ), Point, /* bIsClosed */ false );
+
+		case EStreetMapDataCategory::Railways:
+			return ComputeDistanceSquaredToLine( Railways[ ElementIndex ].GetPoints( *this ), Point, /* bIsClosed */ false );
+
+		case EStreetMapDataCategory::Buildings:
+		{
+			const FStreetMapPointView OutlinePoints = Buildings[ ElementIndex ].GetPoints( *this );
+			return IsPointInsideRing( OutlinePoints, Point ) ? 0.0f : ComputeDistanceSquaredToLine( OutlinePoints, Point, /* bIsClosed */ true );
+		}
+
+		case EStreetMapDataCategory::MiscWays:
+		{
+			const FStreetMapMiscWay& MiscWay = MiscWays[ ElementIndex ];
+			const FStreetMapPointView Points = MiscWay.GetPoints( *this );
+			if( !MiscWay.bIsClosed )
+			{
+				return ComputeDistanceSquaredToLine( Points, Point, /* bIsClosed */ false );
+			}
+
+			// Holes are outside of the polygon, and their edges count as much as the outer one
+			bool bIsInside = IsPointInsideRing( Points, Point );
+			float MinDistanceSquared = ComputeDistanceSquaredToLine( Points, Point, /* bIsClosed */ true );
+			for( const FStreetMapPolygonRing& Hole : MiscWay.GetHoles( *this ) )
+			{
+				const FStreetMapPointView HolePoints = Hole.GetPoints( *this );
+				bIsInside = bIsInside && !IsPointInsideRing( HolePoints, Point );
+				MinDistanceSquared = FMath::Min( MinDistanceSquared, ComputeDistanceSquaredToLine( HolePoints, Point, /* bIsClosed */ true ) );
+			}
+			return bIsInside ? 0.0f : MinDistanceSquared;
+		}
+
+		default:
+			check( 0 );
+			return TNumericLimits<float>::Max();
+	}
+}
+
+
+void UStreetMap::FindElementsInBox( EStreetMapDataCategory Category, FVector2D Min, FVector2D Max, TArray<int32>& OutElementIndices ) const
+{
+	OutElementIndices.Reset();
+	GetSpatialIndex( Category ).ForEachInBox( Min, Max, [&OutElementIndices]( const int32 ElementIndex )
+	{
+		OutElementIndices.Add( ElementIndex );
+	} );
+}
+
+
+void UStreetMap::FindElementsInRadius( EStreetMapDataCategory Category, FVector2D Center, float Radius, TArray<int32>& OutElementIndices ) const
+{
+	OutElementIndices.Reset();
+	const float RadiusSquared = FMath::Square( Radius );
+	GetSpatialIndex( Category ).ForEachInBox( Center - FVector2D( Radius, Radius ), Center + FVector2D( Radius, Radius ), [this, Category, Center, RadiusSquared, &OutElementIndices]( const int32 ElementIndex )
+	{
+		if( ComputeDistanceSquaredToElement( Category, ElementIndex, Center ) <= RadiusSquared )
+		{
+			OutElementIndices.Add( ElementIndex );
+		}
+	} );
+}
+
+
+int32 UStreetMap::FindNearestElement( EStreetMapDataCategory Category, FVector2D Point, float MaxDistance, float& OutDistance ) const
+{
+	float DistanceSquared;
+	const int32 ElementIndex = GetSpatialIndex( Category ).FindNearest( Point, FMath::Square( MaxDistance ), [this, Category, Point]( const int32 Item )
+	{
+		return ComputeDistanceSquaredToElement( Category, Item, Point );
+	}, DistanceSquared );
+
+	OutDistance = FMath::Sqrt( DistanceSquared );
+	return ElementIndex;
+}
+
+
+int32 UStreetMap::FindNearestRoadOfType( FVector2D Point, TEnumAsByte<EStreetMapRoadType> RoadType, float MaxDistance, float& OutDistance ) const
+{
+	float DistanceSquared;
+	const int32 RoadIndex = GetSpatialIndex( EStreetMapDataCategory::Roads ).FindNearest( Point, FMath::Square( MaxDistance ), [this, RoadType, Point]( const int32 Item )
+	{
+		return Roads[ Item ].RoadType == RoadType ? ComputeDistanceSquaredToElement( EStreetMapDataCategory::Roads, Item, Point ) : TNumericLimits<float>::Max();
+	}, DistanceSquared );
+
+	OutDistance = FMath::Sqrt( DistanceSquared );
+	return RoadIndex;
+}
+
+
+int32 UStreetMap::FindBuildingAtPoint( FVector2D Point ) const
+{
+	// Buildings rarely overlap, but if they do, the first one wins so that the answer doesn't depend on the index
+	int32 FoundBuildingIndex = INDEX_NONE;
+	GetSpatialIndex( EStreetMapDataCategory::Buildings ).ForEachInBox( Point, Point, [this, Point, &FoundBuildingIndex]( const int32 BuildingIndex )
+	{
+		if( ( FoundBuildingIndex == INDEX_NONE || BuildingIndex < FoundBuildingIndex ) && IsPointInsideRing( Buildings[ BuildingIndex ].GetPoints( *this ), Point ) )
+		{
+			FoundBuildingIndex = BuildingIndex;
+		}
+	} );
+	return FoundBuildingIndex;
+}
+
+
+/** Positions snapped by each task of SnapToRoads().  A single snap is quick enough that a task per position would cost more than it saves. */
+static const int32 SnapBatchSize = 64;
+
+
+bool UStreetMap::SnapToRoad( FVector2D Position, float MaxDistance, FStreetMapRoadSnap& OutSnap ) const
+{
+	OutSnap = FStreetMapRoadSnap();
+
+	float DistanceSquared;
+	const int32 SegmentIndex = RoadSegmentIndex.FindNearest( Position, FMath::Square( MaxDistance ), [this, Position]( const int32 Item )
+	{
+		const FStreetMapRoadRef& RoadSegment = RoadSegments[ Item ];
+		const FStreetMapPointView Points = Roads[ RoadSegment.RoadIndex ].GetPoints( *this );
+		return FVector2D::DistSquared( Position, FindClosestPointOnSegment( Position, Points[ RoadSegment.RoadPointIndex ], Points[ RoadSegment.RoadPointIndex + 1 ] ) );
+	}, DistanceSquared );
+
+	if( SegmentIndex == INDEX_NONE )
+	{
+		return false;
+	}
+
+	const FStreetMapRoadRef& RoadSegment = RoadSegments[ SegmentIndex ];
+	const FStreetMapRoad& Road = Roads[ RoadSegment.RoadIndex ];
+	const FStreetMapPointView Points = Road.GetPoints( *this );
+	const FVector2D Start = Points[ RoadSegment.RoadPointIndex ];
+	const FVector2D End = Points[ RoadSegment.RoadPointIndex + 1 ];
+
+	OutSnap.RoadIndex = RoadSegment.RoadIndex;
+	OutSnap.RoadPointIndex = RoadSegment.RoadPointIndex;
+	OutSnap.Location = FindClosestPointOnSegment( Position, Start, End );
+	OutSnap.Distance = FMath::Sqrt( DistanceSquared );
+
+	// Clamped to the end of the segment, so that a snap at the very end of it doesn't land past the point when it's
+	// passed back to the road's own functions
+	const TArrayView<const float> PointDistances = Road.GetPointDistances( *this );
+	OutSnap.PositionAlongRoad = FMath::Min( PointDistances[ RoadSegment.RoadPointIndex ] + ( OutSnap.Location - Start ).Size(), PointDistances[ RoadSegment.RoadPointIndex + 1 ] );
+	return true;
+}
+
+
+void UStreetMap::SnapToRoads( const TArray<FVector2D>& Positions, float MaxDistance, TArray<FStreetMapRoadSnap>& OutSnaps ) const
+{
+	OutSnaps.SetNum( Positions.Num() );
+
+	const int32 NumBatches = ( Positions.Num() + SnapBatchSize - 1 ) / SnapBatchSize;
+	ParallelFor( NumBatches, [this, &Positions, MaxDistance, &OutSnaps]( const int32 BatchIndex )
+	{
+		const int32 EndIndex = FMath::Min( ( BatchIndex + 1 ) * SnapBatchSize, Positions.Num() );
+		for( int32 PositionIndex = BatchIndex * SnapBatchSize; PositionIndex < EndIndex; ++PositionIndex )
+		{
+			SnapToRoad( Positions[ PositionIndex ], MaxDistance, OutSnaps[ PositionIndex ] );
+		}
+	} );
+}
+
+
 void UStreetMap::GetAssetRegistryTags( TArray<FAssetRegistryTag>& OutTags ) const
 {
 #if WITH_EDITORONLY_DATA
@@ -23,7 +725,874 @@ void UStreetMap::GetAssetRegistryTags( TArray<FAssetRegistryTag>& OutTags ) cons
 	{
 		OutTags.Add( FAssetRegistryTag( SourceFileTagName(), AssetImportData->GetSourceData().ToJson(), FAssetRegistryTag::TT_Hidden ) );
 	}
+
+	// Import cost, so it can be compared across versions of a map
+	OutTags.Add( FAssetRegistryTag( TEXT( "ImportSeconds" ), FString::Printf( TEXT( "%.2f" ), ImportStats.ImportSeconds ), FAssetRegistryTag::TT_Numerical ) );
+	OutTags.Add( FAssetRegistryTag( TEXT( "ImportLoadSeconds" ), FString::Printf( TEXT( "%.2f" ), ImportStats.LoadSeconds ), FAssetRegistryTag::TT_Numerical ) );
+	OutTags.Add( FAssetRegistryTag( TEXT( "ImportBuildSeconds" ), FString::Printf( TEXT( "%.2f" ), ImportStats.BuildSeconds ), FAssetRegistryTag::TT_Numerical ) );
+	OutTags.Add( FAssetRegistryTag( TEXT( "ImportPeakMemoryMB" ), FString::Printf( TEXT( "%.1f" ), ImportStats.PeakMemoryMB ), FAssetRegistryTag::TT_Numerical ) );
+	OutTags.Add( FAssetRegistryTag( TEXT( "ImportAddedMemoryMB" ), FString::Printf( TEXT( "%.1f" ), ImportStats.AddedMemoryMB ), FAssetRegistryTag::TT_Numerical ) );
+	OutTags.Add( FAssetRegistryTag( TEXT( "ImportedOSMNodes" ), FString::Printf( TEXT( "%lld" ), ImportStats.NumOSMNodes ), FAssetRegistryTag::TT_Numerical ) );
+	OutTags.Add( FAssetRegistryTag( TEXT( "ImportedOSMWays" ), FString::Printf( TEXT( "%lld" ), ImportStats.NumOSMWays ), FAssetRegistryTag::TT_Numerical ) );
+	OutTags.Add( FAssetRegistryTag( TEXT( "ImportedOSMRelations" ), FString::Printf( TEXT( "%lld" ), ImportStats.NumOSMRelations ), FAssetRegistryTag::TT_Numerical ) );
 #endif
 
 	Super::GetAssetRegistryTags( OutTags );
 }
+
+
+void UStreetMap::PostLoad()
+{
+	Super::PostLoad();
+
+	for( int32 CategoryIndex = 0; CategoryIndex < (int32)EStreetMapDataCategory::Count; ++CategoryIndex )
+	{
+		const EStreetMapDataCategory Category = (EStreetMapDataCategory)CategoryIndex;
+		if( !OnDemandCategories.Contains( Category ) )
+		{
+			LoadCategory( Category );
+		}
+	}
+
+#if WITH_EDITORONLY_DATA
+	// Street maps saved before geometry was pooled have the points on every element
+	const bool bHasUnpackedGeometry = 
+		Roads.ContainsByPredicate( []( const FStreetMapRoad& Road ) { return Road.RoadPoints.Num() > 0; } ) ||
+		Railways.ContainsByPredicate( []( const FStreetMapRailway& Railway ) { return Railway.Points.Num() > 0; } ) ||
+		Buildings.ContainsByPredicate( []( const FStreetMapBuilding& Building ) { return Building.BuildingPoints.Num() > 0; } ) ||
+		MiscWays.ContainsByPredicate( []( const FStreetMapMiscWay& MiscWay ) { return MiscWay.Points.Num() > 0; } );
+	if( bHasUnpackedGeometry )
+	{
+		PackGeometry();
+	}
+#endif
+
+	for( int32 CategoryIndex = 0; CategoryIndex < (int32)EStreetMapDataCategory::Count; ++CategoryIndex )
+	{
+		UpdateStaleSpatialIndex( (EStreetMapDataCategory)CategoryIndex );
+	}
+
+	if( IsCategoryLoaded( EStreetMapDataCategory::Roads ) )
+	{
+		ComputeRoadPointDistances();
+	}
+}
+
+
+#if WITH_EDITOR
+/**
+ * Adds the points of an element to the end of a pool.  Quantized points are measured in centimeter steps from the
+ * exact points, if the element has them.  Elements too long for int16 offsets from a single cell are split into runs
+ * of points, each anchored to the grid cell at its own middle, so that no point is ever farther than a step away.
+ */
+static void AppendPoints( const TArray<FVector2D>& Points, const TArray<FStreetMapExactPoint>& ExactPoints, const EStreetMapPointStorage PointStorage, FStreetMapPointAnchor& OutAnchor, TArray<FVector2D>& FloatPool, TArray<FStreetMapQuantizedPoint>& QuantizedPool, TArray<FStreetMapPointRun>& RunPool )
+{
+	OutAnchor = FStreetMapPointAnchor();
+	if( PointStorage == EStreetMapPointStorage::Float )
+	{
+		FloatPool.Append( Points );
+		return;
+	}
+
+	const bool bHasExactPoints = ExactPoints.Num() == Points.Num();
+	auto GetPoint = [&Points, &ExactPoints, bHasExactPoints]( const int32 Index, double& OutX, double& OutY )
+	{
+		OutX = bHasExactPoints ? ExactPoints[ Index ].X : Points[ Index ].X;
+		OutY = bHasExactPoints ? ExactPoints[ Index ].Y : Points[ Index ].Y;
+	};
+
+	// A run whose bounds are no larger than this still fits around the corner of the cell at its middle
+	const double MaxRunExtent = 2.0 * ( MAX_int16 - FStreetMapPointAnchor::CellSize - 1 );
+
+	QuantizedPool.Reserve( QuantizedPool.Num() + Points.Num() );
+	int32 RunStart = 0;
+	while( RunStart < Points.Num() )
+	{
+		double X, Y;
+		GetPoint( RunStart, X, Y );
+		double MinX = X;
+		double MinY = Y;
+		double MaxX = X;
+		double MaxY = Y;
+		int32 RunEnd = RunStart + 1;
+		for( ; RunEnd < Points.Num(); ++RunEnd )
+		{
+			GetPoint( RunEnd, X, Y );
+			if( FMath::Max( MaxX, X ) - FMath::Min( MinX, X ) > MaxRunExtent || FMath::Max( MaxY, Y ) - FMath::Min( MinY, Y ) > MaxRunExtent )
+			{
+				break;
+			}
+			MinX = FMath::Min( MinX, X );
+			MinY = FMath::Min( MinY, Y );
+			MaxX = FMath::Max( MaxX, X );
+			MaxY = FMath::Max( MaxY, Y );
+		}
+
+		const FIntPoint Cell(
+			(int32)FMath::FloorToDouble( 0.5 * ( MinX + MaxX ) / FStreetMapPointAnchor::CellSize ),
+			(int32)FMath::FloorToDouble( 0.5 * ( MinY + MaxY ) / FStreetMapPointAnchor::CellSize ) );
+		if( RunStart == 0 )
+		{
+			OutAnchor.Cell = Cell;
+		}
+		else
+		{
+			if( OutAnchor.NumRuns == 0 )
+			{
+				OutAnchor.FirstRun = RunPool.Num();
+			}
+			FStreetMapPointRun& Run = RunPool[ RunPool.AddUninitialized() ];
+			Run.FirstPoint = RunStart;
+			Run.Cell = Cell;
+			++OutAnchor.NumRuns;
+		}
+
+		const double OriginX = (double)Cell.X * FStreetMapPointAnchor::CellSize;
+		const double OriginY = (double)Cell.Y * FStreetMapPointAnchor::CellSize;
+		for( int32 Index = RunStart; Index < RunEnd; ++Index )
+		{
+			GetPoint( Index, X, Y );
+			FStreetMapQuantizedPoint& QuantizedPoint = QuantizedPool[ QuantizedPool.AddUninitialized() ];
+			QuantizedPoint.X = (int16)FMath::Clamp<double>( FMath::FloorToDouble( X - OriginX + 0.5 ), MIN_int16, MAX_int16 );
+			QuantizedPoint.Y = (int16)FMath::Clamp<double>( FMath::FloorToDouble( Y - OriginY + 0.5 ), MIN_int16, MAX_int16 );
+		}
+
+		RunStart = RunEnd;
+	}
+}
+
+
+void UStreetMap::PackGeometry()
+{
+	for( int32 CategoryIndex = 0; CategoryIndex < (int32)EStreetMapDataCategory::Count; ++CategoryIndex )
+	{
+		PackCategory( (EStreetMapDataCategory)CategoryIndex );
+	}
+}
+
+
+void UStreetMap::UnpackGeometry()
+{
+	for( int32 CategoryIndex = 0; CategoryIndex < (int32)EStreetMapDataCategory::Count; ++CategoryIndex )
+	{
+		UnpackCategory( (EStreetMapDataCategory)CategoryIndex );
+	}
+}
+
+
+void UStreetMap::PackCategory( const EStreetMapDataCategory Category )
+{
+	// Every pool is allocated once, at its final size.  Only the points go to either the float or the quantized pools.
+	const bool bIsQuantized = PointStorage == EStreetMapPointStorage::Quantized;
+	switch( Category )
+	{
+		case EStreetMapDataCategory::Roads:
+		{
+			int32 NumRoadPoints = 0;
+			for( const FStreetMapRoad& Road : Roads )
+			{
+				NumRoadPoints += Road.RoadPoints.Num();
+			}
+			RoadPoints.Empty( bIsQuantized ? 0 : NumRoadPoints );
+			RoadQuantizedPoints.Empty( bIsQuantized ? NumRoadPoints : 0 );
+			RoadNodeIndices.Empty( NumRoadPoints );
+			RoadPointRuns.Empty();
+			break;
+		}
+
+		case EStreetMapDataCategory::Railways:
+		{
+			int32 NumRailwayPoints = 0;
+			for( const FStreetMapRailway& Railway : Railways )
+			{
+				NumRailwayPoints += Railway.Points.Num();
+			}
+			RailwayPoints.Empty( bIsQuantized ? 0 : NumRailwayPoints );
+			RailwayQuantizedPoints.Empty( bIsQuantized ? NumRailwayPoints : 0 );
+			RailwayNodeIndices.Empty( NumRailwayPoints );
+			RailwayPointRuns.Empty();
+			break;
+		}
+
+		case EStreetMapDataCategory::Buildings:
+		{
+			int32 NumBuildingPoints = 0;
+			for( const FStreetMapBuilding& Building : Buildings )
+			{
+				NumBuildingPoints += Building.BuildingPoints.Num();
+			}
+			BuildingPoints.Empty( bIsQuantized ? 0 : NumBuildingPoints );
+			BuildingQuantizedPoints.Empty( bIsQuantized ? NumBuildingPoints : 0 );
+			BuildingPointRuns.Empty();
+			break;
+		}
+
+		case EStreetMapDataCategory::MiscWays:
+		{
+			int32 NumMiscWayPoints = 0;
+			int32 NumMiscWayHoles = 0;
+			for( const FStreetMapMiscWay& MiscWay : MiscWays )
+			{
+				NumMiscWayPoints += MiscWay.Points.Num();
+				NumMiscWayHoles += MiscWay.Holes.Num();
+				for( const FStreetMapPolygonRing& Hole : MiscWay.Holes )
+				{
+					NumMiscWayPoints += Hole.Points.Num();
+				}
+			}
+			MiscWayPoints.Empty( bIsQuantized ? 0 : NumMiscWayPoints );
+			MiscWayQuantizedPoints.Empty( bIsQuantized ? NumMiscWayPoints : 0 );
+			MiscWayHoles.Empty( NumMiscWayHoles );
+			MiscWayPointRuns.Empty();
+			break;
+		}
+
+		default:
+			check( 0 );
+			break;
+	}
+
+	const int32 NumElements = GetNumElements( Category );
+	for( int32 ElementIndex = 0; ElementIndex < NumElements; ++ElementIndex )
+	{
+		PackElement( Category, ElementIndex );
+	}
+	NumUnusedPoints[ (int32)Category ] = 0;
+
+	BuildSpatialIndex( Category );
+	if( Category == EStreetMapDataCategory::Roads )
+	{
+		ComputeRoadPointDistances();
+	}
+}
+
+
+void UStreetMap::UnpackCategory( const EStreetMapDataCategory Category )
+{
+	const int32 NumElements = GetNumElements( Category );
+	for( int32 ElementIndex = 0; ElementIndex < NumElements; ++ElementIndex )
+	{
+		UnpackElement( Category, ElementIndex );
+	}
+
+	// Nothing is left in the pools for the elements to point at
+	switch( Category )
+	{
+		case EStreetMapDataCategory::Roads:
+			for( FStreetMapRoad& Road : Roads )
+			{
+				Road.FirstPoint = Road.NumPoints = 0;
+				Road.Anchor = FStreetMapPointAnchor();
+			}
+			RoadPoints.Empty();
+			RoadQuantizedPoints.Empty();
+			RoadNodeIndices.Empty();
+			RoadPointRuns.Empty();
+			RoadSegmentIndex.Empty();
+			RoadSegments.Empty();
+			RoadFirstSegments.Empty();
+			RoadPointDistances.Empty();
+			break;
+
+		case EStreetMapDataCategory::Railways:
+			for( FStreetMapRailway& Railway : Railways )
+			{
+				Railway.FirstPoint = Railway.NumPoints = 0;
+				Railway.Anchor = FStreetMapPointAnchor();
+			}
+			RailwayPoints.Empty();
+			RailwayQuantizedPoints.Empty();
+			RailwayNodeIndices.Empty();
+			RailwayPointRuns.Empty();
+			break;
+
+		case EStreetMapDataCategory::Buildings:
+			for( FStreetMapBuilding& Building : Buildings )
+			{
+				Building.FirstPoint = Building.NumPoints = 0;
+				Building.Anchor = FStreetMapPointAnchor();
+			}
+			BuildingPoints.Empty();
+			BuildingQuantizedPoints.Empty();
+			BuildingPointRuns.Empty();
+			break;
+
+		case EStreetMapDataCategory::MiscWays:
+			for( FStreetMapMiscWay& MiscWay : MiscWays )
+			{
+				MiscWay.FirstPoint = MiscWay.NumPoints = 0;
+				MiscWay.FirstHole = MiscWay.NumHoles = 0;
+				MiscWay.Anchor = FStreetMapPointAnchor();
+			}
+			MiscWayPoints.Empty();
+			MiscWayQuantizedPoints.Empty();
+			MiscWayHoles.Empty();
+			MiscWayPointRuns.Empty();
+			break;
+
+		default:
+			check( 0 );
+			break;
+	}
+
+	SpatialIndices[ (int32)Category ].Empty();
+	NumUnusedPoints[ (int32)Category ] = 0;
+}
+
+
+void UStreetMap::PackElement( const EStreetMapDataCategory Category, const int32 ElementIndex )
+{
+	const bool bIsQuantized = PointStorage == EStreetMapPointStorage::Quantized;
+	switch( Category )
+	{
+		case EStreetMapDataCategory::Roads:
+		{
+			FStreetMapRoad& Road = Roads[ ElementIndex ];
+			check( Road.NodeIndices.Num() == Road.RoadPoints.Num() );
+			Road.FirstPoint = RoadNodeIndices.Num();
+			Road.NumPoints = Road.RoadPoints.Num();
+			AppendPoints( Road.RoadPoints, Road.ExactPoints, PointStorage, Road.Anchor, RoadPoints, RoadQuantizedPoints, RoadPointRuns );
+			RoadNodeIndices.Append( Road.NodeIndices );
+			Road.RoadPoints.Empty();
+			Road.ExactPoints.Empty();
+			Road.NodeIndices.Empty();
+			break;
+		}
+
+		case EStreetMapDataCategory::Railways:
+		{
+			FStreetMapRailway& Railway = Railways[ ElementIndex ];
+			check( Railway.NodeIndices.Num() == Railway.Points.Num() );
+			Railway.FirstPoint = RailwayNodeIndices.Num();
+			Railway.NumPoints = Railway.Points.Num();
+			AppendPoints( Railway.Points, Railway.ExactPoints, PointStorage, Railway.Anchor, RailwayPoints, RailwayQuantizedPoints, RailwayPointRuns );
+			RailwayNodeIndices.Append( Railway.NodeIndices );
+			Railway.Points.Empty();
+			Railway.ExactPoints.Empty();
+			Railway.NodeIndices.Empty();
+			break;
+		}
+
+		case EStreetMapDataCategory::Buildings:
+		{
+			FStreetMapBuilding& Building = Buildings[ ElementIndex ];
+			Building.FirstPoint = bIsQuantized ? BuildingQuantizedPoints.Num() : BuildingPoints.Num();
+			Building.NumPoints = Building.BuildingPoints.Num();
+			AppendPoints( Building.BuildingPoints, Building.ExactPoints, PointStorage, Building.Anchor, BuildingPoints, BuildingQuantizedPoints, BuildingPointRuns );
+			Building.BuildingPoints.Empty();
+			Building.ExactPoints.Empty();
+			break;
+		}
+
+		case EStreetMapDataCategory::MiscWays:
+		{
+			FStreetMapMiscWay& MiscWay = MiscWays[ ElementIndex ];
+			MiscWay.FirstPoint = bIsQuantized ? MiscWayQuantizedPoints.Num() : MiscWayPoints.Num();
+			MiscWay.NumPoints = MiscWay.Points.Num();
+			AppendPoints( MiscWay.Points, MiscWay.ExactPoints, PointStorage, MiscWay.Anchor, MiscWayPoints, MiscWayQuantizedPoints, MiscWayPointRuns );
+			MiscWay.Points.Empty();
+			MiscWay.ExactPoints.Empty();
+
+			MiscWay.FirstHole = MiscWayHoles.Num();
+			MiscWay.NumHoles = MiscWay.Holes.Num();
+			for( FStreetMapPolygonRing& Hole : MiscWay.Holes )
+			{
+				FStreetMapPolygonRing& PooledHole = MiscWayHoles[ MiscWayHoles.AddDefaulted() ];
+				PooledHole.FirstPoint = bIsQuantized ? MiscWayQuantizedPoints.Num() : MiscWayPoints.Num();
+				PooledHole.NumPoints = Hole.Points.Num();
+				AppendPoints( Hole.Points, Hole.ExactPoints, PointStorage, PooledHole.Anchor, MiscWayPoints, MiscWayQuantizedPoints, MiscWayPointRuns );
+			}
+			MiscWay.Holes.Empty();
+			break;
+		}
+
+		default:
+			check( 0 );
+			break;
+	}
+}
+
+
+void UStreetMap::UnpackElement( const EStreetMapDataCategory Category, const int32 ElementIndex )
+{
+	// Quantized points come back out as floats for editing, and in double precision for the element to be quantized
+	// again without losing anything.  Where the element was in the pools stays as it is, so that RepackElements() knows
+	// which points it leaves unused.
+	switch( Category )
+	{
+		case EStreetMapDataCategory::Roads:
+		{
+			FStreetMapRoad& Road = Roads[ ElementIndex ];
+			if( Road.RoadPoints.Num() == 0 )
+			{
+				Road.GetPoints( *this ).CopyTo( Road.RoadPoints );
+				Road.GetPoints( *this ).CopyTo( Road.ExactPoints );
+				Road.NodeIndices.Append( RoadNodeIndices.GetData() + Road.FirstPoint, Road.NumPoints );
+			}
+			break;
+		}
+
+		case EStreetMapDataCategory::Railways:
+		{
+			FStreetMapRailway& Railway = Railways[ ElementIndex ];
+			if( Railway.Points.Num() == 0 )
+			{
+				Railway.GetPoints( *this ).CopyTo( Railway.Points );
+				Railway.GetPoints( *this ).CopyTo( Railway.ExactPoints );
+				Railway.NodeIndices.Append( RailwayNodeIndices.GetData() + Railway.FirstPoint, Railway.NumPoints );
+			}
+			break;
+		}
+
+		case EStreetMapDataCategory::Buildings:
+		{
+			FStreetMapBuilding& Building = Buildings[ ElementIndex ];
+			if( Building.BuildingPoints.Num() == 0 )
+			{
+				Building.GetPoints( *this ).CopyTo( Building.BuildingPoints );
+				Building.GetPoints( *this ).CopyTo( Building.ExactPoints );
+			}
+			break;
+		}
+
+		case EStreetMapDataCategory::MiscWays:
+		{
+			FStreetMapMiscWay& MiscWay = MiscWays[ ElementIndex ];
+			if( MiscWay.Points.Num() == 0 )
+			{
+				MiscWay.GetPoints( *this ).CopyTo( MiscWay.Points );
+				MiscWay.GetPoints( *this ).CopyTo( MiscWay.ExactPoints );
+				MiscWay.Holes.Reset( MiscWay.NumHoles );
+				for( const FStreetMapPolygonRing& PooledHole : MiscWay.GetHoles( *this ) )
+				{
+					FStreetMapPolygonRing& Hole = MiscWay.Holes[ MiscWay.Holes.AddDefaulted() ];
+					PooledHole.GetPoints( *this ).CopyTo( Hole.Points );
+					PooledHole.GetPoints( *this ).CopyTo( Hole.ExactPoints );
+				}
+			}
+			break;
+		}
+
+		default:
+			check( 0 );
+			break;
+	}
+}
+
+
+void UStreetMap::RepackElements( const EStreetMapDataCategory Category, const TArray<int32>& ElementIndices )
+{
+	const int32 CategoryIndex = (int32)Category;
+	FStreetMapSpatialIndex& SpatialIndex = SpatialIndices[ CategoryIndex ];
+	if( Category == EStreetMapDataCategory::Roads )
+	{
+		// Roads added since the segments were indexed don't have any yet
+		while( RoadFirstSegments.Num() < Roads.Num() )
+		{
+			RoadFirstSegments.Add( INDEX_NONE );
+		}
+	}
+
+	for( const int32 ElementIndex : ElementIndices )
+	{
+		NumUnusedPoints[ CategoryIndex ] += GetNumPooledPoints( Category, ElementIndex );
+		if( Category == EStreetMapDataCategory::Roads )
+		{
+			RemoveRoadSegments( ElementIndex );
+		}
+
+		PackElement( Category, ElementIndex );
+		SpatialIndex.UpdateItem( ElementIndex, GetElementBox( Category, ElementIndex ) );
+
+		if( Category == EStreetMapDataCategory::Roads )
+		{
+			RoadPointDistances.SetNumUninitialized( RoadNodeIndices.Num() );
+			ComputeRoadPointDistances( ElementIndex );
+			AddRoadSegments( ElementIndex );
+		}
+	}
+
+	// Packing and indexing the whole category again costs as much as all of it, so it only happens once enough has
+	// changed since the last time
+	if( NumUnusedPoints[ CategoryIndex ] > GetNumPooledPoints( Category ) / 4 )
+	{
+		UnpackCategory( Category );
+		PackCategory( Category );
+	}
+	else if( SpatialIndex.IsWorthRebuilding() || ( Category == EStreetMapDataCategory::Roads && RoadSegmentIndex.IsWorthRebuilding() ) )
+	{
+		BuildSpatialIndex( Category );
+	}
+}
+
+
+void UStreetMap::RemoveElement( const EStreetMapDataCategory Category, const int32 ElementIndex )
+{
+	check( bHasSourceIndices );
+
+	const int32 CategoryIndex = (int32)Category;
+	const int32 LastIndex = GetNumElements( Category ) - 1;
+	TArray<FStreetMapWaySource>& Sources = GetWaySources( Category );
+
+	NumUnusedPoints[ CategoryIndex ] += GetNumPooledPoints( Category, ElementIndex );
+
+	RenameNodeRefs( Category, Sources[ ElementIndex ].NodeIds, ElementIndex, INDEX_NONE );
+	FStreetMapSpatialIndex& SpatialIndex = SpatialIndices[ CategoryIndex ];
+	SpatialIndex.RemoveItem( ElementIndex );
+	if( Category == EStreetMapDataCategory::Roads )
+	{
+		while( RoadFirstSegments.Num() < Roads.Num() )
+		{
+			RoadFirstSegments.Add( INDEX_NONE );
+		}
+		RemoveRoadSegments( ElementIndex );
+	}
+
+	if( ElementIndex != LastIndex )
+	{
+		RenameNodeRefs( Category, Sources[ LastIndex ].NodeIds, LastIndex, ElementIndex );
+		SpatialIndex.RenameItem( LastIndex, ElementIndex );
+		if( Category == EStreetMapDataCategory::Roads && RoadFirstSegments[ LastIndex ] != INDEX_NONE )
+		{
+			const int32 FirstSegment = RoadFirstSegments[ LastIndex ];
+			for( int32 Segment = FirstSegment; Segment < FirstSegment + Roads[ LastIndex ].NumPoints - 1; ++Segment )
+			{
+				RoadSegments[ Segment ].RoadIndex = ElementIndex;
+			}
+		}
+	}
+
+	switch( Category )
+	{
+		case EStreetMapDataCategory::Roads:
+			Roads.RemoveAtSwap( ElementIndex, 1, false );
+			RoadFirstSegments.RemoveAtSwap( ElementIndex, 1, false );
+			break;
+		case EStreetMapDataCategory::Railways: Railways.RemoveAtSwap( ElementIndex, 1, false ); break;
+		case EStreetMapDataCategory::Buildings: Buildings.RemoveAtSwap( ElementIndex, 1, false ); break;
+		case EStreetMapDataCategory::MiscWays: MiscWays.RemoveAtSwap( ElementIndex, 1, false ); break;
+		default: check( 0 ); break;
+	}
+	Sources.RemoveAtSwap( ElementIndex, 1, false );
+
+	if( ElementIndex != LastIndex )
+	{
+		AddElementToSourceIndices( Category, ElementIndex );
+	}
+}
+
+
+int32 UStreetMap::GetNumElements( const EStreetMapDataCategory Category ) const
+{
+	switch( Category )
+	{
+		case EStreetMapDataCategory::Roads: return Roads.Num();
+		case EStreetMapDataCategory::Railways: return Railways.Num();
+		case EStreetMapDataCategory::Buildings: return Buildings.Num();
+		case EStreetMapDataCategory::MiscWays: return MiscWays.Num();
+		default: check( 0 ); return 0;
+	}
+}
+
+
+FBox2D UStreetMap::GetElementBox( const EStreetMapDataCategory Category, const int32 ElementIndex ) const
+{
+	switch( Category )
+	{
+		case EStreetMapDataCategory::Roads: return FBox2D( Roads[ ElementIndex ].BoundsMin, Roads[ ElementIndex ].BoundsMax );
+		case EStreetMapDataCategory::Railways: return FBox2D( Railways[ ElementIndex ].BoundsMin, Railways[ ElementIndex ].BoundsMax );
+		case EStreetMapDataCategory::Buildings: return FBox2D( Buildings[ ElementIndex ].BoundsMin, Buildings[ ElementIndex ].BoundsMax );
+		case EStreetMapDataCategory::MiscWays: return FBox2D( MiscWays[ ElementIndex ].BoundsMin, MiscWays[ ElementIndex ].BoundsMax );
+		default: check( 0 ); return FBox2D( ForceInit );
+	}
+}
+
+
+int32 UStreetMap::GetNumPooledPoints( const EStreetMapDataCategory Category ) const
+{
+	const bool bIsQuantized = PointStorage == EStreetMapPointStorage::Quantized;
+	switch( Category )
+	{
+		case EStreetMapDataCategory::Roads: return RoadNodeIndices.Num();
+		case EStreetMapDataCategory::Railways: return RailwayNodeIndices.Num();
+		case EStreetMapDataCategory::Buildings: return bIsQuantized ? BuildingQuantizedPoints.Num() : BuildingPoints.Num();
+		case EStreetMapDataCategory::MiscWays: return bIsQuantized ? MiscWayQuantizedPoints.Num() : MiscWayPoints.Num();
+		default: check( 0 ); return 0;
+	}
+}
+
+
+int32 UStreetMap::GetNumPooledPoints( const EStreetMapDataCategory Category, const int32 ElementIndex ) const
+{
+	switch( Category )
+	{
+		case EStreetMapDataCategory::Roads: return Roads[ ElementIndex ].NumPoints;
+		case EStreetMapDataCategory::Railways: return Railways[ ElementIndex ].NumPoints;
+		case EStreetMapDataCategory::Buildings: return Buildings[ ElementIndex ].NumPoints;
+		case EStreetMapDataCategory::MiscWays:
+		{
+			const FStreetMapMiscWay& MiscWay = MiscWays[ ElementIndex ];
+			int32 NumPoints = MiscWay.NumPoints;
+			for( const FStreetMapPolygonRing& PooledHole : MiscWay.GetHoles( *this ) )
+			{
+				NumPoints += PooledHole.NumPoints;
+			}
+			return NumPoints;
+		}
+		default: check( 0 ); return 0;
+	}
+}
+
+
+void UStreetMap::FindRoadFirstSegments()
+{
+	// Segments of a road are always added together, starting with the one at its first point
+	RoadFirstSegments.Init( INDEX_NONE, Roads.Num() );
+	for( int32 Segment = 0; Segment < RoadSegments.Num(); ++Segment )
+	{
+		const FStreetMapRoadRef& RoadSegment = RoadSegments[ Segment ];
+		if( RoadSegment.RoadIndex != INDEX_NONE && RoadSegment.RoadPointIndex == 0 && RoadFirstSegments.IsValidIndex( RoadSegment.RoadIndex ) )
+		{
+			RoadFirstSegments[ RoadSegment.RoadIndex ] = Segment;
+		}
+	}
+}
+
+
+void UStreetMap::AddRoadSegments( const int32 RoadIndex )
+{
+	const FStreetMapPointView Points = Roads[ RoadIndex ].GetPoints( *this );
+	RoadFirstSegments[ RoadIndex ] = Points.Num() > 1 ? RoadSegments.Num() : INDEX_NONE;
+	for( int32 PointIndex = 0; PointIndex < Points.Num() - 1; ++PointIndex )
+	{
+		FStreetMapRoadRef& RoadSegment = RoadSegments[ RoadSegments.AddUninitialized() ];
+		RoadSegment.RoadIndex = RoadIndex;
+		RoadSegment.RoadPointIndex = PointIndex;
+
+		const FVector2D Start = Points[ PointIndex ];
+		const FVector2D End = Points[ PointIndex + 1 ];
+		RoadSegmentIndex.UpdateItem( RoadSegments.Num() - 1, FBox2D( Start.ComponentMin( End ), Start.ComponentMax( End ) ) );
+	}
+}
+
+
+void UStreetMap::RemoveRoadSegments( const int32 RoadIndex )
+{
+	const int32 FirstSegment = RoadFirstSegments[ RoadIndex ];
+	if( FirstSegment == INDEX_NONE )
+	{
+		return;
+	}
+
+	// The segments stay in RoadSegments, so that the items of the index keep their numbers
+	for( int32 Segment = FirstSegment; Segment < FirstSegment + Roads[ RoadIndex ].NumPoints - 1; ++Segment )
+	{
+		RoadSegmentIndex.RemoveItem( Segment );
+		RoadSegments[ Segment ].RoadIndex = INDEX_NONE;
+	}
+	RoadFirstSegments[ RoadIndex ] = INDEX_NONE;
+}
+
+
+void UStreetMap::RenameNodeRefs( const EStreetMapDataCategory Category, const TArray<int64>& NodeIds, const int32 ElementIndex, const int32 NewElementIndex )
+{
+	if( Category != EStreetMapDataCategory::Roads && Category != EStreetMapDataCategory::Railways )
+	{
+		return;
+	}
+
+	for( const int64 NodeId : NodeIds )
+	{
+		const int32 NodeIndex = FindNodeBySource( NodeId );
+		if( NodeIndex == INDEX_NONE )
+		{
+			continue;
+		}
+
+		FStreetMapNode& Node = Nodes[ NodeIndex ];
+		if( Category == EStreetMapDataCategory::Roads )
+		{
+			for( int32 RefIndex = Node.RoadRefs.Num() - 1; RefIndex >= 0; --RefIndex )
+			{
+				if( Node.RoadRefs[ RefIndex ].RoadIndex == ElementIndex )
+				{
+					if( NewElementIndex == INDEX_NONE )
+					{
+						Node.RoadRefs.RemoveAt( RefIndex );
+					}
+					else
+					{
+						Node.RoadRefs[ RefIndex ].RoadIndex = NewElementIndex;
+					}
+				}
+			}
+		}
+		else
+		{
+			for( int32 RefIndex = Node.RailwayRefs.Num() - 1; RefIndex >= 0; --RefIndex )
+			{
+				if( Node.RailwayRefs[ RefIndex ].RailwayIndex == ElementIndex )
+				{
+					if( NewElementIndex == INDEX_NONE )
+					{
+						Node.RailwayRefs.RemoveAt( RefIndex );
+					}
+					else
+					{
+						Node.RailwayRefs[ RefIndex ].RailwayIndex = NewElementIndex;
+					}
+				}
+			}
+		}
+	}
+}
+
+
+TArray<FStreetMapWaySource>& UStreetMap::GetWaySources( const EStreetMapDataCategory Category )
+{
+	switch( Category )
+	{
+		case EStreetMapDataCategory::Roads: return RoadSources;
+		case EStreetMapDataCategory::Railways: return RailwaySources;
+		case EStreetMapDataCategory::Buildings: return BuildingSources;
+		default: check( Category == EStreetMapDataCategory::MiscWays ); return MiscWaySources;
+	}
+}
+
+
+const TArray<FStreetMapWaySource>& UStreetMap::GetWaySources( const EStreetMapDataCategory Category ) const
+{
+	return const_cast<UStreetMap*>( this )->GetWaySources( Category );
+}
+
+
+void UStreetMap::BuildSourceIndices()
+{
+	for( int32 CategoryIndex = 0; CategoryIndex < (int32)EStreetMapDataCategory::Count; ++CategoryIndex )
+	{
+		BuildWaySourceIndices( (EStreetMapDataCategory)CategoryIndex );
+	}
+	BuildNodeSourceIndex();
+	bHasSourceIndices = true;
+}
+
+
+void UStreetMap::BuildWaySourceIndices( const EStreetMapDataCategory Category )
+{
+	const TArray<FStreetMapWaySource>& Sources = GetWaySources( Category );
+	TArray<FStreetMapSourceRef> WayRefs;
+	TArray<FStreetMapSourceRef> PointRefs;
+	WayRefs.Reserve( Sources.Num() );
+	for( int32 ElementIndex = 0; ElementIndex < Sources.Num(); ++ElementIndex )
+	{
+		const FStreetMapWaySource& Source = Sources[ ElementIndex ];
+		WayRefs.Add( FStreetMapSourceRef{ Source.WayId, ElementIndex, INDEX_NONE } );
+		for( int32 PointIndex = 0; PointIndex < Source.NodeIds.Num(); ++PointIndex )
+		{
+			PointRefs.Add( FStreetMapSourceRef{ Source.NodeIds[ PointIndex ], ElementIndex, PointIndex } );
+		}
+	}
+	WaySourceIndices[ (int32)Category ].Build( WayRefs );
+	NodePointSourceIndices[ (int32)Category ].Build( PointRefs );
+}
+
+
+void UStreetMap::BuildNodeSourceIndex()
+{
+	TArray<FStreetMapSourceRef> NodeRefs;
+	NodeRefs.Reserve( NodeSources.Num() );
+	for( int32 NodeIndex = 0; NodeIndex < NodeSources.Num(); ++NodeIndex )
+	{
+		NodeRefs.Add( FStreetMapSourceRef{ NodeSources[ NodeIndex ], NodeIndex, INDEX_NONE } );
+	}
+	NodeSourceIndex.Build( NodeRefs );
+}
+
+
+void UStreetMap::UpdateStaleSourceIndices()
+{
+	for( int32 CategoryIndex = 0; CategoryIndex < (int32)EStreetMapDataCategory::Count; ++CategoryIndex )
+	{
+		if( WaySourceIndices[ CategoryIndex ].IsWorthRebuilding() || NodePointSourceIndices[ CategoryIndex ].IsWorthRebuilding() )
+		{
+			BuildWaySourceIndices( (EStreetMapDataCategory)CategoryIndex );
+		}
+	}
+	if( NodeSourceIndex.IsWorthRebuilding() )
+	{
+		BuildNodeSourceIndex();
+	}
+}
+
+
+// Source indices never forget a reference, so every one they find is checked against the sources.  References to
+// elements or nodes that were removed or moved since don't match, and moved ones were added again where they are now.
+
+void UStreetMap::ForEachWayElement( const EStreetMapDataCategory Category, const int64 WayId, TFunctionRef<void( int32 ElementIndex )> Visit ) const
+{
+	const TArray<FStreetMapWaySource>& Sources = GetWaySources( Category );
+	TArray<int32, TInlineAllocator<4>> ElementIndices;
+	WaySourceIndices[ (int32)Category ].ForEach( WayId, [&Sources, &ElementIndices, WayId]( int32 ElementIndex, int32 PointIndex )
+	{
+		if( Sources.IsValidIndex( ElementIndex ) && Sources[ ElementIndex ].WayId == WayId )
+		{
+			ElementIndices.AddUnique( ElementIndex );
+		}
+	} );
+
+	for( const int32 ElementIndex : ElementIndices )
+	{
+		Visit( ElementIndex );
+	}
+}
+
+
+void UStreetMap::ForEachNodePoint( const EStreetMapDataCategory Category, const int64 NodeId, TFunctionRef<void( int32 ElementIndex, int32 PointIndex )> Visit ) const
+{
+	const TArray<FStreetMapWaySource>& Sources = GetWaySources( Category );
+	TArray<FIntPoint, TInlineAllocator<8>> Points;
+	NodePointSourceIndices[ (int32)Category ].ForEach( NodeId, [&Sources, &Points, NodeId]( int32 ElementIndex, int32 PointIndex )
+	{
+		if( Sources.IsValidIndex( ElementIndex ) && Sources[ ElementIndex ].NodeIds.IsValidIndex( PointIndex ) && Sources[ ElementIndex ].NodeIds[ PointIndex ] == NodeId )
+		{
+			Points.AddUnique( FIntPoint( ElementIndex, PointIndex ) );
+		}
+	} );
+
+	for( const FIntPoint& Point : Points )
+	{
+		Visit( Point.X, Point.Y );
+	}
+}
+
+
+int32 UStreetMap::FindNodeBySource( const int64 NodeId ) const
+{
+	int32 FoundNodeIndex = INDEX_NONE;
+	NodeSourceIndex.ForEach( NodeId, [this, NodeId, &FoundNodeIndex]( int32 NodeIndex, int32 PointIndex )
+	{
+		if( NodeSources.IsValidIndex( NodeIndex ) && NodeSources[ NodeIndex ] == NodeId )
+		{
+			FoundNodeIndex = NodeIndex;
+		}
+	} );
+	return FoundNodeIndex;
+}
+
+
+void UStreetMap::AddElementToSourceIndices( const EStreetMapDataCategory Category, const int32 ElementIndex )
+{
+	const FStreetMapWaySource& Source = GetWaySources( Category )[ ElementIndex ];
+	WaySourceIndices[ (int32)Category ].Add( Source.WayId, ElementIndex, INDEX_NONE );
+	for( int32 PointIndex = 0; PointIndex < Source.NodeIds.Num(); ++PointIndex )
+	{
+		NodePointSourceIndices[ (int32)Category ].Add( Source.NodeIds[ PointIndex ], ElementIndex, PointIndex );
+	}
+}
+
+
+void UStreetMap::AddNodeToSourceIndices( const int32 NodeIndex )
+{
+	NodeSourceIndex.Add( NodeSources[ NodeIndex ], NodeIndex, INDEX_NONE );
+}
+#endif
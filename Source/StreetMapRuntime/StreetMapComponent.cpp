@@ -266,6 +266,10 @@ void UStreetMapComponent::GenerateMesh()
 		FBox MeshBoundingBox;
 		MeshBoundingBox.Init();
 
+		// Cooked street maps may leave these on disk until somebody needs them
+		StreetMap->LoadCategory( EStreetMapDataCategory::Roads );
+		StreetMap->LoadCategory( EStreetMapDataCategory::Buildings );
+
 		const auto& Roads = StreetMap->GetRoads();
 		const auto& Nodes = StreetMap->GetNodes();
 		const auto& Buildings = StreetMap->GetBuildings();
@@ -295,11 +299,12 @@ void UStreetMapComponent::GenerateMesh()
 					break;
 			}
 			
-			for( int32 PointIndex = 0; PointIndex < Road.RoadPoints.Num() - 1; ++PointIndex )
+			const FStreetMapPointView RoadPoints = Road.GetPoints( *StreetMap );
+			for( int32 PointIndex = 0; PointIndex < RoadPoints.Num() - 1; ++PointIndex )
 			{
 				AddThick2DLine( 
-					Road.RoadPoints[ PointIndex ],
-					Road.RoadPoints[ PointIndex + 1 ],
+					RoadPoints[ PointIndex ],
+					RoadPoints[ PointIndex + 1 ],
 					RoadZ,
 					RoadThickness,
 					RoadColor,
@@ -311,17 +316,21 @@ void UStreetMapComponent::GenerateMesh()
 		TArray< int32 > TempIndices;
 		TArray< int32 > TriangulatedVertexIndices;
 		TArray< FVector > TempPoints;
+		TArray< FVector2D > BuildingPoints;
 		for( int32 BuildingIndex = 0; BuildingIndex < Buildings.Num(); ++BuildingIndex )
 		{
 			const auto& Building = Buildings[ BuildingIndex ];
 
+			// Triangulation goes back and forth over the points, so they're decoded once up front
+			Building.GetPoints( *StreetMap ).CopyTo( BuildingPoints );
+
 			// Building mesh (or filled area, if the building has no height)
 
 			// Triangulate this building
 			// @todo: Performance: Triangulating lots of building polygons is quite slow.  We could easily do this 
 			//        as part of the import process and store tessellated geometry instead of doing this at load time.
 			bool WindsClockwise;
-			if( FPolygonTools::TriangulatePolygon( Building.BuildingPoints, TempIndices, /* Out */ TriangulatedVertexIndices, /* Out */ WindsClockwise ) )
+			if( FPolygonTools::TriangulatePolygon( BuildingPoints, TempIndices, /* Out */ TriangulatedVertexIndices, /* Out */ WindsClockwise ) )
 			{
 				// @todo: Performance: We could preprocess the building shapes so that the points always wind
 				//        in a consistent direction, so we can skip determining the winding above.
@@ -342,10 +351,10 @@ void UStreetMapComponent::GenerateMesh()
 
 				// Top of building
 				{
-					TempPoints.SetNum( Building.BuildingPoints.Num(), false );
-					for( int32 PointIndex = 0; PointIndex < Building.BuildingPoints.Num(); ++PointIndex )
+					TempPoints.SetNum( BuildingPoints.Num(), false );
+					for( int32 PointIndex = 0; PointIndex < BuildingPoints.Num(); ++PointIndex )
 					{
-						TempPoints[ PointIndex ] = FVector( Building.BuildingPoints[ ( Building.BuildingPoints.Num() - PointIndex ) - 1 ], BuildingFillZ );
+						TempPoints[ PointIndex ] = FVector( BuildingPoints[ ( BuildingPoints.Num() - PointIndex ) - 1 ], BuildingFillZ );
 					}
 					AddTriangles( TempPoints, TriangulatedVertexIndices, FVector::ForwardVector, FVector::UpVector, BuildingFillColor, MeshBoundingBox );
 				}
@@ -356,23 +365,23 @@ void UStreetMapComponent::GenerateMesh()
 					if( bWantLitBuildings )
 					{
 						// Create edges for the walls of the 3D buildings
-						for( int32 LeftPointIndex = 0; LeftPointIndex < Building.BuildingPoints.Num(); ++LeftPointIndex )
+						for( int32 LeftPointIndex = 0; LeftPointIndex < BuildingPoints.Num(); ++LeftPointIndex )
 						{
-							const int32 RightPointIndex = ( LeftPointIndex + 1 ) % Building.BuildingPoints.Num();
+							const int32 RightPointIndex = ( LeftPointIndex + 1 ) % BuildingPoints.Num();
 
 							TempPoints.SetNum( 4, false );
 
 							const int32 TopLeftVertexIndex = 0;
-							TempPoints[ TopLeftVertexIndex ] = FVector( Building.BuildingPoints[ WindsClockwise ? RightPointIndex : LeftPointIndex ], BuildingFillZ );
+							TempPoints[ TopLeftVertexIndex ] = FVector( BuildingPoints[ WindsClockwise ? RightPointIndex : LeftPointIndex ], BuildingFillZ );
 
 							const int32 TopRightVertexIndex = 1;
-							TempPoints[ TopRightVertexIndex ] = FVector( Building.BuildingPoints[ WindsClockwise ? LeftPointIndex : RightPointIndex ], BuildingFillZ );
+							TempPoints[ TopRightVertexIndex ] = FVector( BuildingPoints[ WindsClockwise ? LeftPointIndex : RightPointIndex ], BuildingFillZ );
 
 							const int32 BottomRightVertexIndex = 2;
-							TempPoints[ BottomRightVertexIndex ] = FVector( Building.BuildingPoints[ WindsClockwise ? LeftPointIndex : RightPointIndex ], 0.0f );
+							TempPoints[ BottomRightVertexIndex ] = FVector( BuildingPoints[ WindsClockwise ? LeftPointIndex : RightPointIndex ], 0.0f );
 
 							const int32 BottomLeftVertexIndex = 3;
-							TempPoints[ BottomLeftVertexIndex ] = FVector( Building.BuildingPoints[ WindsClockwise ? RightPointIndex : LeftPointIndex ], 0.0f );
+							TempPoints[ BottomLeftVertexIndex ] = FVector( BuildingPoints[ WindsClockwise ? RightPointIndex : LeftPointIndex ], 0.0f );
 
 
 							TempIndices.SetNum( 6, false );
@@ -395,9 +404,9 @@ void UStreetMapComponent::GenerateMesh()
 					{
 						// Create vertices for the bottom
 						const int32 FirstBottomVertexIndex = this->Vertices.Num();
-						for( int32 PointIndex = 0; PointIndex < Building.BuildingPoints.Num(); ++PointIndex )
+						for( int32 PointIndex = 0; PointIndex < BuildingPoints.Num(); ++PointIndex )
 						{
-							const FVector2D Point = Building.BuildingPoints[ PointIndex ];
+							const FVector2D Point = BuildingPoints[ PointIndex ];
 
 							FStreetMapVertex& NewVertex = *new( this->Vertices )FStreetMapVertex();
 							NewVertex.Position = FVector( Point, 0.0f );
@@ -410,9 +419,9 @@ void UStreetMapComponent::GenerateMesh()
 						}
 
 						// Create edges for the walls of the 3D buildings
-						for( int32 LeftPointIndex = 0; LeftPointIndex < Building.BuildingPoints.Num(); ++LeftPointIndex )
+						for( int32 LeftPointIndex = 0; LeftPointIndex < BuildingPoints.Num(); ++LeftPointIndex )
 						{
-							const int32 RightPointIndex = ( LeftPointIndex + 1 ) % Building.BuildingPoints.Num();
+							const int32 RightPointIndex = ( LeftPointIndex + 1 ) % BuildingPoints.Num();
 
 							const int32 BottomLeftVertexIndex = FirstBottomVertexIndex + LeftPointIndex;
 							const int32 BottomRightVertexIndex = FirstBottomVertexIndex + RightPointIndex;
@@ -439,11 +448,11 @@ void UStreetMapComponent::GenerateMesh()
 			// Building border
 			if( bWantBuildingBorderOnGround )
 			{
-				for( int32 PointIndex = 0; PointIndex < Building.BuildingPoints.Num(); ++PointIndex )
+				for( int32 PointIndex = 0; PointIndex < BuildingPoints.Num(); ++PointIndex )
 				{
 					AddThick2DLine(
-						Building.BuildingPoints[ PointIndex ],
-						Building.BuildingPoints[ ( PointIndex + 1 ) % Building.BuildingPoints.Num() ],
+						BuildingPoints[ PointIndex ],
+						BuildingPoints[ ( PointIndex + 1 ) % BuildingPoints.Num() ],
 						BuildingBorderZ,
 						BuildingBorderThickness,		// Thickness
 						BuildingBorderColor,
@@ -0,0 +1,45 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+#pragma once
+
+#include "Misc/Guid.h"
+
+
+/** Versions of the parts of a street map that UStreetMap::Serialize() writes itself, instead of as tagged properties */
+struct FStreetMapCustomVersion
+{
+	enum Type
+	{
+		/** Everything was saved as tagged properties */
+		BeforeCustomVersionWasAdded = 0,
+
+		/** Elements and their geometry are saved in one untagged block per category */
+		SerializedCategories,
+
+		/** Elements have an anchor, and geometry may be stored as quantized offsets from it */
+		QuantizedPoints,
+
+		/** Every category is saved with a spatial index over its elements */
+		SpatialIndex,
+
+		/** Roads are saved with a spatial index over their segments */
+		RoadSegmentIndex,
+
+		/** Quantized points always use centimeter steps, and long elements are split into runs anchored separately */
+		PointRuns,
+
+		/** Change files are applied in place: spatial indices and pools can change after they were built, and the editor
+		    keeps indices of the OpenStreetMap ways and nodes that elements were built from */
+		IncrementalChanges,
+
+		// -----<new versions can be added above this line>-------------------------------------------------
+		VersionPlusOne,
+		LatestVersion = VersionPlusOne - 1
+	};
+
+	/** The GUID for this custom version number */
+	static const FGuid GUID;
+
+private:
+
+	FStreetMapCustomVersion() {}
+};
@@ -0,0 +1,85 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapRuntime.h"
+#include "StreetMapSourceIndex.h"
+
+
+void FStreetMapSourceIndex::Build( TArray<FStreetMapSourceRef>& Refs )
+{
+	Empty();
+
+	SortedRefs = MoveTemp( Refs );
+	SortedRefs.Sort( []( const FStreetMapSourceRef& A, const FStreetMapSourceRef& B )
+	{
+		if( A.Id != B.Id )
+		{
+			return A.Id < B.Id;
+		}
+		return A.Element < B.Element || ( A.Element == B.Element && A.Point < B.Point );
+	} );
+}
+
+
+void FStreetMapSourceIndex::Add( const int64 Id, const int32 Element, const int32 Point )
+{
+	FStreetMapSourceRef& Ref = AddedRefs[ AddedRefs.AddUninitialized() ];
+	Ref.Id = Id;
+	Ref.Element = Element;
+	Ref.Point = Point;
+	AddedRefsById.Add( Id, AddedRefs.Num() - 1 );
+}
+
+
+void FStreetMapSourceIndex::Empty()
+{
+	SortedRefs.Empty();
+	AddedRefs.Empty();
+	AddedRefsById.Empty();
+}
+
+
+void FStreetMapSourceIndex::ForEach( const int64 Id, TFunctionRef<void( int32 Element, int32 Point )> Visit ) const
+{
+	// First sorted reference with the ID, or past it
+	int32 Low = 0;
+	int32 High = SortedRefs.Num();
+	while( Low < High )
+	{
+		const int32 Middle = ( Low + High ) / 2;
+		if( SortedRefs[ Middle ].Id < Id )
+		{
+			Low = Middle + 1;
+		}
+		else
+		{
+			High = Middle;
+		}
+	}
+	for( int32 Index = Low; Index < SortedRefs.Num() && SortedRefs[ Index ].Id == Id; ++Index )
+	{
+		Visit( SortedRefs[ Index ].Element, SortedRefs[ Index ].Point );
+	}
+
+	for( TMultiMap<int64, int32>::TConstKeyIterator It( AddedRefsById, Id ); It; ++It )
+	{
+		const FStreetMapSourceRef& Ref = AddedRefs[ It.Value() ];
+		Visit( Ref.Element, Ref.Point );
+	}
+}
+
+
+FArchive& operator<<( FArchive& Ar, FStreetMapSourceIndex& SourceIndex )
+{
+	SourceIndex.SortedRefs.BulkSerialize( Ar );
+	SourceIndex.AddedRefs.BulkSerialize( Ar );
+
+	if( Ar.IsLoading() )
+	{
+		SourceIndex.AddedRefsById.Empty( SourceIndex.AddedRefs.Num() );
+		for( int32 Index = 0; Index < SourceIndex.AddedRefs.Num(); ++Index )
+		{
+			SourceIndex.AddedRefsById.Add( SourceIndex.AddedRefs[ Index ].Id, Index );
+		}
+	}
+	return Ar;
+}
@@ -0,0 +1,414 @@
+// Copyright 2017 Mike Fricker. All Rights Reserved.
+
+#include "StreetMapRuntime.h"
+#include "StreetMapSpatialIndex.h"
+#include "StreetMapCustomVersion.h"
+
+
+/** @return Distance along a Hilbert curve that fills a 65536 x 65536 grid, for a cell of the grid */
+static uint32 ComputeHilbertDistance( uint32 X, uint32 Y )
+{
+	const uint32 GridSize = 1 << 16;
+	uint32 Distance = 0;
+	for( uint32 HalfSize = GridSize / 2; HalfSize > 0; HalfSize /= 2 )
+	{
+		const uint32 RX = ( X & HalfSize ) != 0 ? 1 : 0;
+		const uint32 RY = ( Y & HalfSize ) != 0 ? 1 : 0;
+		Distance += HalfSize * HalfSize * ( ( 3 * RX ) ^ RY );
+
+		// Rotate the quadrant, so that the curve inside of it starts and ends next to its neighbors
+		if( RY == 0 )
+		{
+			if( RX == 1 )
+			{
+				X = GridSize - 1 - X;
+				Y = GridSize - 1 - Y;
+			}
+			Swap( X, Y );
+		}
+	}
+	return Distance;
+}
+
+
+void FStreetMapSpatialIndex::Build( const TArray<FBox2D>& ItemBounds )
+{
+	Empty();
+
+	NumItems = ItemBounds.Num();
+	if( NumItems == 0 )
+	{
+		return;
+	}
+
+	FVector2D Min( TNumericLimits<float>::Max(), TNumericLimits<float>::Max() );
+	FVector2D Max( TNumericLimits<float>::Lowest(), TNumericLimits<float>::Lowest() );
+	for( const FBox2D& Bounds : ItemBounds )
+	{
+		Min = Min.ComponentMin( Bounds.Min );
+		Max = Max.ComponentMax( Bounds.Max );
+	}
+
+	// Items close to each other on the curve are close to each other on the map, so neighbors end up in the same nodes
+	const FVector2D Scale( 65535.0f / FMath::Max( Max.X - Min.X, KINDA_SMALL_NUMBER ), 65535.0f / FMath::Max( Max.Y - Min.Y, KINDA_SMALL_NUMBER ) );
+	TArray<TPair<uint32, int32>> SortedItems;
+	SortedItems.SetNumUninitialized( NumItems );
+	for( int32 Item = 0; Item < NumItems; ++Item )
+	{
+		const FVector2D Center = ( ItemBounds[ Item ].GetCenter() - Min ) * Scale;
+		const uint32 X = (uint32)FMath::Clamp( FMath::FloorToInt( Center.X ), 0, 65535 );
+		const uint32 Y = (uint32)FMath::Clamp( FMath::FloorToInt( Center.Y ), 0, 65535 );
+		SortedItems[ Item ] = TPair<uint32, int32>( ComputeHilbertDistance( X, Y ), Item );
+	}
+	SortedItems.Sort( []( const TPair<uint32, int32>& A, const TPair<uint32, int32>& B )
+	{
+		return A.Key < B.Key || ( A.Key == B.Key && A.Value < B.Value );
+	} );
+
+	int32 NumNodes = NumItems;
+	for( int32 NumLevelNodes = NumItems; NumLevelNodes > 1; )
+	{
+		NumLevelNodes = ( NumLevelNodes + NodeSize - 1 ) / NodeSize;
+		NumNodes += NumLevelNodes;
+	}
+	Boxes.SetNumUninitialized( NumNodes );
+	Indices.SetNumUninitialized( NumNodes );
+
+	for( int32 Position = 0; Position < NumItems; ++Position )
+	{
+		const FBox2D& Bounds = ItemBounds[ SortedItems[ Position ].Value ];
+		Boxes[ Position ].Min = Bounds.Min;
+		Boxes[ Position ].Max = Bounds.Max;
+		Indices[ Position ] = SortedItems[ Position ].Value;
+	}
+	LevelEnds.Add( NumItems );
+
+	// Every run of NodeSize nodes on a level gets a parent on the next one, until one is left
+	int32 LevelStart = 0;
+	int32 LevelEnd = NumItems;
+	while( LevelEnd - LevelStart > 1 )
+	{
+		int32 Parent = LevelEnd;
+		for( int32 FirstChild = LevelStart; FirstChild < LevelEnd; FirstChild += NodeSize, ++Parent )
+		{
+			FNodeBox& ParentBox = Boxes[ Parent ];
+			ParentBox = Boxes[ FirstChild ];
+			const int32 ChildEnd = FMath::Min( FirstChild + NodeSize, LevelEnd );
+			for( int32 Child = FirstChild + 1; Child < ChildEnd; ++Child )
+			{
+				ParentBox.Min = ParentBox.Min.ComponentMin( Boxes[ Child ].Min );
+				ParentBox.Max = ParentBox.Max.ComponentMax( Boxes[ Child ].Max );
+			}
+			Indices[ Parent ] = FirstChild;
+		}
+		LevelStart = LevelEnd;
+		LevelEnd = Parent;
+		LevelEnds.Add( LevelEnd );
+	}
+	check( LevelEnd == NumNodes );
+}
+
+
+void FStreetMapSpatialIndex::Empty()
+{
+	NumItems = 0;
+	NumRemovedLeaves = 0;
+	Boxes.Empty();
+	Indices.Empty();
+	LevelEnds.Empty();
+	ExtraItems.Empty();
+	ExtraBoxes.Empty();
+	ItemPositions.Empty();
+}
+
+
+void FStreetMapSpatialIndex::FindItemPositions()
+{
+	if( ItemPositions.Num() > 0 || Num() == 0 )
+	{
+		return;
+	}
+
+	int32 MaxItem = INDEX_NONE;
+	for( int32 Position = 0; Position < NumItems; ++Position )
+	{
+		MaxItem = FMath::Max( MaxItem, Indices[ Position ] );
+	}
+	for( const int32 Item : ExtraItems )
+	{
+		MaxItem = FMath::Max( MaxItem, Item );
+	}
+
+	ItemPositions.Init( INDEX_NONE, MaxItem + 1 );
+	for( int32 Position = 0; Position < NumItems; ++Position )
+	{
+		if( Indices[ Position ] != INDEX_NONE )
+		{
+			ItemPositions[ Indices[ Position ] ] = Position;
+		}
+	}
+	for( int32 Slot = 0; Slot < ExtraItems.Num(); ++Slot )
+	{
+		ItemPositions[ ExtraItems[ Slot ] ] = Boxes.Num() + Slot;
+	}
+}
+
+
+void FStreetMapSpatialIndex::UpdateItem( const int32 Item, const FBox2D& Bounds )
+{
+	FindItemPositions();
+	while( ItemPositions.Num() <= Item )
+	{
+		ItemPositions.Add( INDEX_NONE );
+	}
+
+	FNodeBox Box;
+	Box.Min = Bounds.Min;
+	Box.Max = Bounds.Max;
+
+	int32 Position = ItemPositions[ Item ];
+	if( Position == INDEX_NONE )
+	{
+		ItemPositions[ Item ] = Boxes.Num() + ExtraItems.Num();
+		ExtraItems.Add( Item );
+		ExtraBoxes.Add( Box );
+	}
+	else if( Position >= Boxes.Num() )
+	{
+		ExtraBoxes[ Position - Boxes.Num() ] = Box;
+	}
+	else
+	{
+		// Nodes above the leaf only ever grow, so they still enclose everything they enclosed before
+		Boxes[ Position ] = Box;
+		int32 LevelStart = 0;
+		for( int32 Level = 0; Level < LevelEnds.Num() - 1; ++Level )
+		{
+			const int32 LevelEnd = LevelEnds[ Level ];
+			const int32 Parent = LevelEnd + ( Position - LevelStart ) / NodeSize;
+			Boxes[ Parent ].Min = Boxes[ Parent ].Min.ComponentMin( Box.Min );
+			Boxes[ Parent ].Max = Boxes[ Parent ].Max.ComponentMax( Box.Max );
+			LevelStart = LevelEnd;
+			Position = Parent;
+		}
+	}
+}
+
+
+void FStreetMapSpatialIndex::RemoveItem( const int32 Item )
+{
+	FindItemPositions();
+	if( !ItemPositions.IsValidIndex( Item ) || ItemPositions[ Item ] == INDEX_NONE )
+	{
+		return;
+	}
+
+	const int32 Position = ItemPositions[ Item ];
+	if( Position >= Boxes.Num() )
+	{
+		const int32 Slot = Position - Boxes.Num();
+		ExtraItems.RemoveAtSwap( Slot );
+		ExtraBoxes.RemoveAtSwap( Slot );
+		if( Slot < ExtraItems.Num() )
+		{
+			ItemPositions[ ExtraItems[ Slot ] ] = Position;
+		}
+	}
+	else
+	{
+		Indices[ Position ] = INDEX_NONE;
+		++NumRemovedLeaves;
+	}
+	ItemPositions[ Item ] = INDEX_NONE;
+}
+
+
+void FStreetMapSpatialIndex::RenameItem( const int32 Item, const int32 NewItem )
+{
+	FindItemPositions();
+	if( !ItemPositions.IsValidIndex( Item ) || ItemPositions[ Item ] == INDEX_NONE )
+	{
+		return;
+	}
+	check( !ItemPositions.IsValidIndex( NewItem ) || ItemPositions[ NewItem ] == INDEX_NONE );
+
+	while( ItemPositions.Num() <= NewItem )
+	{
+		ItemPositions.Add( INDEX_NONE );
+	}
+
+	const int32 Position = ItemPositions[ Item ];
+	if( Position >= Boxes.Num() )
+	{
+		ExtraItems[ Position - Boxes.Num() ] = NewItem;
+	}
+	else
+	{
+		Indices[ Position ] = NewItem;
+	}
+	ItemPositions[ NewItem ] = Position;
+	ItemPositions[ Item ] = INDEX_NONE;
+}
+
+
+int32 FStreetMapSpatialIndex::GetLevelEnd( const int32 Position ) const
+{
+	for( const int32 LevelEnd : LevelEnds )
+	{
+		if( Position < LevelEnd )
+		{
+			return LevelEnd;
+		}
+	}
+	return Boxes.Num();
+}
+
+
+void FStreetMapSpatialIndex::ForEachInBox( const FVector2D& Min, const FVector2D& Max, TFunctionRef<void( int32 Item )> Visit ) const
+{
+	for( int32 Slot = 0; Slot < ExtraItems.Num(); ++Slot )
+	{
+		if( ExtraBoxes[ Slot ].Intersects( Min, Max ) )
+		{
+			Visit( ExtraItems[ Slot ] );
+		}
+	}
+
+	if( Boxes.Num() == 0 )
+	{
+		return;
+	}
+
+	TArray<int32, TInlineAllocator<64>> Stack;
+	Stack.Add( Boxes.Num() - 1 );
+	while( Stack.Num() > 0 )
+	{
+		const int32 Position = Stack.Pop( false );
+		if( !Boxes[ Position ].Intersects( Min, Max ) )
+		{
+			continue;
+		}
+
+		if( Position < NumItems )
+		{
+			if( Indices[ Position ] != INDEX_NONE )
+			{
+				Visit( Indices[ Position ] );
+			}
+			continue;
+		}
+
+		const int32 FirstChild = Indices[ Position ];
+		const int32 ChildEnd = FMath::Min( FirstChild + NodeSize, GetLevelEnd( FirstChild ) );
+		for( int32 Child = FirstChild; Child < ChildEnd; ++Child )
+		{
+			Stack.Add( Child );
+		}
+	}
+}
+
+
+int32 FStreetMapSpatialIndex::FindNearest( const FVector2D& Point, const float MaxDistanceSquared, TFunctionRef<float( int32 Item )> GetItemDistanceSquared, float& OutDistanceSquared ) const
+{
+	int32 NearestItem = INDEX_NONE;
+	OutDistanceSquared = MaxDistanceSquared;
+	if( Num() == 0 )
+	{
+		return NearestItem;
+	}
+
+	struct FCandidate
+	{
+		float DistanceSquared;
+		int32 Position;
+
+		bool operator<( const FCandidate& Other ) const
+		{
+			return DistanceSquared < Other.DistanceSquared;
+		}
+	};
+
+	// Nodes and items waiting to be looked at, closest bounds first.  Items added since the tree was built are at
+	// positions past the end of Boxes.
+	TArray<FCandidate, TInlineAllocator<64>> Candidates;
+	if( Boxes.Num() > 0 )
+	{
+		Candidates.HeapPush( FCandidate{ Boxes.Last().ComputeDistanceSquared( Point ), Boxes.Num() - 1 } );
+	}
+	for( int32 Slot = 0; Slot < ExtraItems.Num(); ++Slot )
+	{
+		const float DistanceSquared = ExtraBoxes[ Slot ].ComputeDistanceSquared( Point );
+		if( DistanceSquared <= OutDistanceSquared )
+		{
+			Candidates.HeapPush( FCandidate{ DistanceSquared, Boxes.Num() + Slot } );
+		}
+	}
+	while( Candidates.Num() > 0 )
+	{
+		FCandidate Candidate;
+		Candidates.HeapPop( Candidate, false );
+		if( Candidate.DistanceSquared > OutDistanceSquared )
+		{
+			break;
+		}
+
+		if( Candidate.Position < NumItems || Candidate.Position >= Boxes.Num() )
+		{
+			const int32 Item = Candidate.Position < NumItems ? Indices[ Candidate.Position ] : ExtraItems[ Candidate.Position - Boxes.Num() ];
+			if( Item == INDEX_NONE )
+			{
+				continue;
+			}
+
+			const float DistanceSquared = GetItemDistanceSquared( Item );
+			if( DistanceSquared < TNumericLimits<float>::Max() && DistanceSquared <= OutDistanceSquared )
+			{
+				OutDistanceSquared = DistanceSquared;
+				NearestItem = Item;
+			}
+			continue;
+		}
+
+		const int32 FirstChild = Indices[ Candidate.Position ];
+		const int32 ChildEnd = FMath::Min( FirstChild + NodeSize, GetLevelEnd( FirstChild ) );
+		for( int32 Child = FirstChild; Child < ChildEnd; ++Child )
+		{
+			const float DistanceSquared = Boxes[ Child ].ComputeDistanceSquared( Point );
+			if( DistanceSquared <= OutDistanceSquared )
+			{
+				Candidates.HeapPush( FCandidate{ DistanceSquared, Child } );
+			}
+		}
+	}
+
+	return NearestItem;
+}
+
+
+FArchive& operator<<( FArchive& Ar, FStreetMapSpatialIndex& SpatialIndex )
+{
+	Ar << SpatialIndex.NumItems;
+	SpatialIndex.Boxes.BulkSerialize( Ar );
+	SpatialIndex.Indices.BulkSerialize( Ar );
+	Ar << SpatialIndex.LevelEnds;
+
+	// Trees saved before they could be changed are exactly what they were built from
+	if( Ar.CustomVer( FStreetMapCustomVersion::GUID ) >= FStreetMapCustomVersion::IncrementalChanges )
+	{
+		Ar << SpatialIndex.NumRemovedLeaves;
+		SpatialIndex.ExtraItems.BulkSerialize( Ar );
+		SpatialIndex.ExtraBoxes.BulkSerialize( Ar );
+	}
+	else if( Ar.IsLoading() )
+	{
+		SpatialIndex.NumRemovedLeaves = 0;
+		SpatialIndex.ExtraItems.Empty();
+		SpatialIndex.ExtraBoxes.Empty();
+	}
+
+	if( Ar.IsLoading() )
+	{
+		SpatialIndex.ItemPositions.Empty();
+	}
+	return Ar;
+}